@@ -39,6 +39,7 @@
 #include "Geometry/Image.h"
 #include "Geometry/RGBDImage.h"
 #include "Geometry/KDTreeFlann.h"
+#include "Geometry/Octree.h"
 
 #include "Camera/PinholeCameraIntrinsic.h"
 #include "Camera/PinholeCameraTrajectory.h"
@@ -0,0 +1,275 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+
+#include "BruteForceIndex.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <Eigen/Core>
+
+#include <Core/Geometry/NeighborSearchBatch.h>
+#include <Core/Utility/MappedFile.h>
+
+namespace three{
+
+template<typename Scalar>
+bool BruteForceIndex<Scalar>::Build(const double *points, size_t dimension,
+		size_t num_points)
+{
+	Clear();
+	if (dimension == 0 || num_points == 0) {
+		return false;
+	}
+	dimension_ = dimension;
+	return AddPoints(points, num_points);
+}
+
+template<typename Scalar>
+void BruteForceIndex<Scalar>::Clear()
+{
+	data_.clear();
+	data_.shrink_to_fit();
+	data_array_ = nullptr;
+	removed_.clear();
+	removed_.shrink_to_fit();
+	num_removed_ = 0;
+	dimension_ = 0;
+	num_points_ = 0;
+}
+
+template<typename Scalar>
+void BruteForceIndex<Scalar>::GetPoints(std::vector<double> &points) const
+{
+	points.resize(num_points_ * dimension_);
+	for (size_t i = 0; i < num_points_; i++) {
+		const Scalar *block = GetBlock(i / BlockSize) + i % BlockSize;
+		for (size_t k = 0; k < dimension_; k++) {
+			points[i * dimension_ + k] = (double)block[k * BlockSize];
+		}
+	}
+}
+
+template<typename Scalar>
+bool BruteForceIndex<Scalar>::AddPoints(const double *points,
+		size_t num_points)
+{
+	if (dimension_ == 0 || num_points_ + num_points >
+			(size_t)std::numeric_limits<int>::max()) {
+		return false;
+	}
+	size_t block_length = dimension_ * BlockSize;
+	size_t num_blocks = (num_points_ + num_points + BlockSize - 1) /
+			BlockSize;
+	if (data_array_ != data_.data()) {
+		// copy mapped data before modifying it
+		data_.assign(data_array_, data_array_ + (num_points_ + BlockSize -
+				1) / BlockSize * block_length);
+	}
+	// The unused slots of the last block are zero; they are never reported
+	// since searches stop at num_points_.
+	data_.resize(num_blocks * block_length, (Scalar)0);
+	for (size_t j = 0; j < num_points; j++) {
+		size_t i = num_points_ + j;
+		Scalar *block = data_.data() + i / BlockSize * block_length +
+				i % BlockSize;
+		for (size_t k = 0; k < dimension_; k++) {
+			block[k * BlockSize] = (Scalar)points[j * dimension_ + k];
+		}
+	}
+	data_array_ = data_.data();
+	num_points_ += num_points;
+	if (removed_.empty() == false) {
+		removed_.resize(num_points_, 0);
+	}
+	return true;
+}
+
+template<typename Scalar>
+bool BruteForceIndex<Scalar>::RemovePoints(const int *indices,
+		size_t num_indices)
+{
+	for (size_t i = 0; i < num_indices; i++) {
+		if (indices[i] < 0 || (size_t)indices[i] >= num_points_) {
+			return false;
+		}
+	}
+	if (num_indices > 0 && removed_.empty()) {
+		removed_.resize(num_points_, 0);
+	}
+	for (size_t i = 0; i < num_indices; i++) {
+		if (removed_[indices[i]] == 0) {
+			removed_[indices[i]] = 1;
+			num_removed_++;
+		}
+	}
+	return true;
+}
+
+template<typename Scalar>
+bool BruteForceIndex<Scalar>::Write(FILE *file, size_t &offset) const
+{
+	uint64_t header[5] = {sizeof(Scalar), (uint64_t)BlockSize, dimension_,
+			num_points_, removed_.size()};
+	return WriteMappedFileBlock(file, offset, header, sizeof(header)) &&
+			WriteMappedFileBlock(file, offset, data_array_,
+			(num_points_ + BlockSize - 1) / BlockSize * dimension_ *
+			BlockSize * sizeof(Scalar)) &&
+			WriteMappedFileBlock(file, offset, removed_.data(),
+			removed_.size());
+}
+
+template<typename Scalar>
+bool BruteForceIndex<Scalar>::Read(const char *file_data, size_t file_size,
+		size_t &offset)
+{
+	Clear();
+	uint64_t header[5];
+	const char *data = ReadMappedFileBlock(file_data, file_size, offset,
+			sizeof(header));
+	if (data == nullptr) {
+		return false;
+	}
+	memcpy(header, data, sizeof(header));
+	if (header[0] != sizeof(Scalar) || header[1] != (uint64_t)BlockSize ||
+			header[2] == 0 || header[3] >
+			(uint64_t)std::numeric_limits<int>::max() ||
+			(header[4] != 0 && header[4] != header[3])) {
+		return false;
+	}
+	size_t num_points = (size_t)header[3];
+	size_t dimension = (size_t)header[2];
+	const char *points = dimension > file_size ? nullptr :
+			ReadMappedFileArray(file_data, file_size, offset,
+			(num_points + BlockSize - 1) / BlockSize * BlockSize,
+			dimension * sizeof(Scalar));
+	const char *removed = ReadMappedFileArray(file_data, file_size, offset,
+			header[4], 1);
+	if (points == nullptr || removed == nullptr ||
+			(uintptr_t)points % alignof(Scalar) != 0) {
+		return false;
+	}
+	data_array_ = reinterpret_cast<const Scalar *>(points);
+	removed_.assign(removed, removed + header[4]);
+	for (char r : removed_) {
+		num_removed_ += r != 0 ? 1 : 0;
+	}
+	dimension_ = dimension;
+	num_points_ = num_points;
+	return true;
+}
+
+template<typename Scalar>
+int BruteForceIndex<Scalar>::SearchKNN(const double *query, int knn,
+		std::vector<int> &indices, std::vector<double> &distance2) const
+{
+	if (num_points_ == 0 || knn < 0) {
+		return -1;
+	}
+	indices.resize(knn);
+	distance2.resize(knn);
+	if (knn > 0) {
+		KNNResultSet result(indices.data(), distance2.data(), knn,
+				std::numeric_limits<double>::max());
+		SearchAll(result, query);
+		knn = result.count_;
+	}
+	indices.resize(knn);
+	distance2.resize(knn);
+	return knn;
+}
+
+template<typename Scalar>
+int BruteForceIndex<Scalar>::SearchRadius(const double *query,
+		double radius, std::vector<int> &indices,
+		std::vector<double> &distance2) const
+{
+	if (num_points_ == 0) {
+		return -1;
+	}
+	indices.clear();
+	distance2.clear();
+	RadiusResultSet result(indices, distance2, radius * radius);
+	SearchAll(result, query);
+	SortNeighborsByDistance(indices.data(), distance2.data(),
+			(int)indices.size());
+	return (int)indices.size();
+}
+
+template<typename Scalar>
+int BruteForceIndex<Scalar>::SearchHybrid(const double *query,
+		double radius, int max_nn, std::vector<int> &indices,
+		std::vector<double> &distance2) const
+{
+	if (num_points_ == 0 || max_nn < 0) {
+		return -1;
+	}
+	indices.resize(max_nn);
+	distance2.resize(max_nn);
+	if (max_nn > 0) {
+		KNNResultSet result(indices.data(), distance2.data(), max_nn,
+				radius * radius);
+		SearchAll(result, query);
+		max_nn = result.count_;
+	}
+	indices.resize(max_nn);
+	distance2.resize(max_nn);
+	return max_nn;
+}
+
+template<typename Scalar>
+template<typename ResultSet>
+void BruteForceIndex<Scalar>::SearchAll(ResultSet &result,
+		const double *query) const
+{
+	size_t num_blocks = (num_points_ + BlockSize - 1) / BlockSize;
+	for (size_t b = 0; b < num_blocks; b++) {
+		const Scalar *block = GetBlock(b);
+		Eigen::Array<Scalar, BlockSize, 1> dists =
+				Eigen::Array<Scalar, BlockSize, 1>::Zero();
+		for (size_t k = 0; k < dimension_; k++) {
+			dists += ((Scalar)query[k] - Eigen::Map<const Eigen::Array<Scalar,
+					BlockSize, 1>>(block + k * BlockSize)).square();
+		}
+		int count = (int)std::min((size_t)BlockSize,
+				num_points_ - b * BlockSize);
+		for (int l = 0; l < count; l++) {
+			if ((double)dists[l] < result.WorstDistance()) {
+				int index = (int)(b * BlockSize) + l;
+				if (num_removed_ == 0 || removed_[index] == 0) {
+					result.AddPoint((double)dists[l], index);
+				}
+			}
+		}
+	}
+}
+
+template class BruteForceIndex<double>;
+template class BruteForceIndex<float>;
+
+}	// namespace three
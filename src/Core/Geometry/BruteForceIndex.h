@@ -0,0 +1,106 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+namespace three {
+
+/// Class of an exhaustive nearest neighbor search for small datasets of any
+/// dimension, where building a tree costs more than scanning all the points:
+/// KDTreeFlann uses it for up to BRUTE_FORCE_THRESHOLD_3D (64) 3D points and
+/// BRUTE_FORCE_THRESHOLD (256) points of other dimensions, e.g. FPFH
+/// features of a few keypoints.
+/// The points are stored in blocks of BlockSize points; inside a block the
+/// coordinates are grouped by dimension, so the distances from a query to a
+/// whole block are accumulated in a fixed-size Eigen array, i.e. with the
+/// SSE/AVX instructions Eigen is compiled for. The nearest neighbors are
+/// selected while scanning by an insertion into a sorted top-k list that
+/// most points fail to enter. Distances are exact, so results match the
+/// trees'.
+template<typename Scalar>
+class BruteForceIndex
+{
+public:
+	static const int BlockSize = 8;
+
+public:
+	BruteForceIndex() {}
+	~BruteForceIndex() {}
+	BruteForceIndex(const BruteForceIndex &) = delete;
+	BruteForceIndex &operator=(const BruteForceIndex &) = delete;
+
+public:
+	/// Function to build the index on \param num_points points stored as
+	/// consecutive \param dimension-tuples in \param points
+	bool Build(const double *points, size_t dimension, size_t num_points);
+	void Clear();
+	/// Function to return the number of point indices, including removed ones
+	size_t Size() const { return num_points_; }
+	size_t GetDimension() const { return dimension_; }
+
+	/// Function to copy the points, including removed ones, as consecutive
+	/// tuples into \param points
+	void GetPoints(std::vector<double> &points) const;
+	const std::vector<char> &GetRemoved() const { return removed_; }
+
+	/// Functions to update the index; see KDTreeNative
+	bool AddPoints(const double *points, size_t num_points);
+	bool RemovePoints(const int *indices, size_t num_indices);
+
+	/// Functions to serialize the index; see KDTreeNative
+	bool Write(FILE *file, size_t &offset) const;
+	bool Read(const char *file_data, size_t file_size, size_t &offset);
+
+	/// Search functions, see KDTreeNative
+	int SearchKNN(const double *query, int knn, std::vector<int> &indices,
+			std::vector<double> &distance2) const;
+	int SearchRadius(const double *query, double radius,
+			std::vector<int> &indices, std::vector<double> &distance2) const;
+	int SearchHybrid(const double *query, double radius, int max_nn,
+			std::vector<int> &indices, std::vector<double> &distance2) const;
+
+private:
+	template<typename ResultSet>
+	void SearchAll(ResultSet &result, const double *query) const;
+	const Scalar *GetBlock(size_t block) const {
+		return data_array_ + block * dimension_ * BlockSize;
+	}
+
+private:
+	std::vector<Scalar> data_;
+	const Scalar *data_array_ = nullptr;	// data_, or mapped memory
+	std::vector<char> removed_;				// per index, empty if none removed
+	size_t num_removed_ = 0;
+	size_t dimension_ = 0;
+	size_t num_points_ = 0;
+};
+
+}	// namespace three
@@ -0,0 +1,707 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+
+#include "ChunkedPointCloud.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <Core/Geometry/PointCloud.h>
+#include <Core/Utility/Console.h>
+#include <Core/Utility/MappedFile.h>
+
+namespace three{
+
+namespace {
+
+/// Header of the chunked point cloud files: signature, version, number of
+/// points, number of chunks, normals and colors flags, offset of the chunk
+/// index and a reserved field, followed by the tile size and the bounds.
+const uint64_t chunked_file_signature = 0x4B4E554843443345ULL;	// "E3DCHUNK"
+const uint64_t chunked_file_version = 1;
+const int chunked_file_header_size = 8;
+const int chunked_file_geometry_size = 7;
+
+bool IntersectsBox(const Eigen::Vector3d &min_bound1,
+		const Eigen::Vector3d &max_bound1, const Eigen::Vector3d &min_bound2,
+		const Eigen::Vector3d &max_bound2)
+{
+	return (min_bound1.array() <= max_bound2.array()).all() &&
+			(min_bound2.array() <= max_bound1.array()).all();
+}
+
+bool IsInBox(const Eigen::Vector3d &point, const Eigen::Vector3d &min_bound,
+		const Eigen::Vector3d &max_bound)
+{
+	return (point.array() >= min_bound.array()).all() &&
+			(point.array() <= max_bound.array()).all();
+}
+
+}	// unnamed namespace
+
+ChunkedPointCloud::PointIterator::PointIterator(const ChunkedPointCloud &cloud,
+		size_t chunk) : cloud_(&cloud), chunk_(chunk), index_(0)
+{
+	SkipEmptyChunks();
+}
+
+ChunkedPointCloud::PointIterator &ChunkedPointCloud::PointIterator::operator++()
+{
+	index_++;
+	if (index_ >= view_.num_points_) {
+		chunk_++;
+		index_ = 0;
+		SkipEmptyChunks();
+	}
+	return *this;
+}
+
+void ChunkedPointCloud::PointIterator::SkipEmptyChunks()
+{
+	while (chunk_ < cloud_->chunks_.size() &&
+			cloud_->chunks_[chunk_].num_points_ == 0) {
+		chunk_++;
+	}
+	if (chunk_ < cloud_->chunks_.size()) {
+		view_ = cloud_->GetChunkView(chunk_);
+	} else {
+		chunk_ = cloud_->chunks_.size();
+		view_.num_points_ = 0;
+		view_.points_ = nullptr;
+		view_.normals_ = nullptr;
+		view_.colors_ = nullptr;
+	}
+}
+
+ChunkedPointCloud::ChunkedPointCloud()
+{
+}
+
+ChunkedPointCloud::~ChunkedPointCloud()
+{
+}
+
+bool ChunkedPointCloud::Open(const std::string &filename)
+{
+	Close();
+	std::unique_ptr<MappedFile> mapped_file(new MappedFile);
+	if (mapped_file->Open(filename) == false) {
+		PrintDebug("[ChunkedPointCloud::Open] Unable to open file %s.\n",
+				filename.c_str());
+		return false;
+	}
+	const char *file_data = mapped_file->GetData();
+	size_t file_size = mapped_file->GetSize();
+	size_t offset = 0;
+	uint64_t header[chunked_file_header_size];
+	double geometry[chunked_file_geometry_size];
+	const char *header_data = ReadMappedFileBlock(file_data, file_size,
+			offset, sizeof(header));
+	const char *geometry_data = ReadMappedFileBlock(file_data, file_size,
+			offset, sizeof(geometry));
+	if (header_data == nullptr || geometry_data == nullptr) {
+		PrintDebug("[ChunkedPointCloud::Open] Invalid file %s.\n",
+				filename.c_str());
+		return false;
+	}
+	memcpy(header, header_data, sizeof(header));
+	memcpy(geometry, geometry_data, sizeof(geometry));
+	// The counts of a corrupt file may overflow the sizes of the index
+	// arrays and of the chunks, so they are checked against the file size.
+	offset = (size_t)header[6];
+	const char *tile_data = ReadMappedFileArray(file_data, file_size, offset,
+			header[3], 3 * sizeof(int32_t));
+	const char *chunk_data = ReadMappedFileArray(file_data, file_size, offset,
+			header[3], 2 * sizeof(uint64_t));
+	const char *bound_data = ReadMappedFileArray(file_data, file_size, offset,
+			header[3], 6 * sizeof(double));
+	if (header[0] != chunked_file_signature ||
+			header[1] != chunked_file_version || !(geometry[0] > 0.0) ||
+			header[2] > file_size / sizeof(Eigen::Vector3d) ||
+			tile_data == nullptr || chunk_data == nullptr ||
+			bound_data == nullptr) {
+		PrintDebug("[ChunkedPointCloud::Open] Invalid file %s.\n",
+				filename.c_str());
+		return false;
+	}
+	size_t num_chunks = (size_t)header[3];
+	num_points_ = (size_t)header[2];
+	has_normals_ = header[4] != 0;
+	has_colors_ = header[5] != 0;
+	tile_size_ = geometry[0];
+	min_bound_ = Eigen::Vector3d(geometry[1], geometry[2], geometry[3]);
+	max_bound_ = Eigen::Vector3d(geometry[4], geometry[5], geometry[6]);
+	chunks_.resize(num_chunks);
+	uint64_t num_chunk_points = 0;
+	for (size_t i = 0; i < num_chunks; i++) {
+		auto &chunk = chunks_[i];
+		int32_t tile_index[3];
+		uint64_t chunk_info[2];
+		double bounds[6];
+		memcpy(tile_index, tile_data + i * sizeof(tile_index),
+				sizeof(tile_index));
+		memcpy(chunk_info, chunk_data + i * sizeof(chunk_info),
+				sizeof(chunk_info));
+		memcpy(bounds, bound_data + i * sizeof(bounds), sizeof(bounds));
+		chunk.tile_index_ = Eigen::Vector3i(tile_index[0], tile_index[1],
+				tile_index[2]);
+		chunk.num_points_ = (size_t)chunk_info[0];
+		chunk.offset_ = (size_t)chunk_info[1];
+		chunk.min_bound_ = Eigen::Vector3d(bounds[0], bounds[1], bounds[2]);
+		chunk.max_bound_ = Eigen::Vector3d(bounds[3], bounds[4], bounds[5]);
+		size_t chunk_offset = chunk.offset_;
+		num_chunk_points += chunk_info[0];
+		if (ReadMappedFileArray(file_data, file_size, chunk_offset,
+				chunk_info[0], sizeof(Eigen::Vector3d)) == nullptr ||
+				(has_normals_ && ReadMappedFileArray(file_data, file_size,
+				chunk_offset, chunk_info[0], sizeof(Eigen::Vector3d)) ==
+				nullptr) || (has_colors_ && ReadMappedFileArray(file_data,
+				file_size, chunk_offset, chunk_info[0],
+				sizeof(Eigen::Vector3d)) == nullptr) ||
+				num_chunk_points > num_points_) {
+			Close();
+			PrintDebug("[ChunkedPointCloud::Open] Invalid file %s.\n",
+					filename.c_str());
+			return false;
+		}
+		auto itr = tile_map_.find(chunk.tile_index_);
+		if (itr == tile_map_.end()) {
+			itr = tile_map_.insert(std::make_pair(chunk.tile_index_,
+					tiles_.size())).first;
+			Tile tile;
+			tile.tile_index_ = chunk.tile_index_;
+			tile.num_points_ = 0;
+			tile.min_bound_ = chunk.min_bound_;
+			tile.max_bound_ = chunk.max_bound_;
+			tiles_.push_back(tile);
+		}
+		auto &tile = tiles_[itr->second];
+		tile.chunks_.push_back(i);
+		tile.num_points_ += chunk.num_points_;
+		tile.min_bound_ = tile.min_bound_.cwiseMin(chunk.min_bound_);
+		tile.max_bound_ = tile.max_bound_.cwiseMax(chunk.max_bound_);
+	}
+	if (num_chunk_points != num_points_) {
+		Close();
+		PrintDebug("[ChunkedPointCloud::Open] Invalid file %s.\n",
+				filename.c_str());
+		return false;
+	}
+	mapped_file_ = std::move(mapped_file);
+	return true;
+}
+
+void ChunkedPointCloud::Close()
+{
+	mapped_file_.reset();
+	num_points_ = 0;
+	has_normals_ = false;
+	has_colors_ = false;
+	tile_size_ = 0.0;
+	min_bound_.setZero();
+	max_bound_.setZero();
+	chunks_.clear();
+	tiles_.clear();
+	tile_map_.clear();
+}
+
+bool ChunkedPointCloud::IsOpen() const
+{
+	return mapped_file_ != nullptr;
+}
+
+int ChunkedPointCloud::FindTile(const Eigen::Vector3i &tile_index) const
+{
+	auto itr = tile_map_.find(tile_index);
+	return itr == tile_map_.end() ? -1 : (int)itr->second;
+}
+
+ChunkedPointCloud::ChunkView ChunkedPointCloud::GetChunkView(
+		size_t chunk) const
+{
+	const char *file_data = mapped_file_->GetData();
+	size_t file_size = mapped_file_->GetSize();
+	size_t offset = chunks_[chunk].offset_;
+	size_t size = chunks_[chunk].num_points_ * sizeof(Eigen::Vector3d);
+	ChunkView view;
+	view.num_points_ = chunks_[chunk].num_points_;
+	view.points_ = (const Eigen::Vector3d *)ReadMappedFileBlock(file_data,
+			file_size, offset, size);
+	view.normals_ = has_normals_ ? (const Eigen::Vector3d *)
+			ReadMappedFileBlock(file_data, file_size, offset, size) : nullptr;
+	view.colors_ = has_colors_ ? (const Eigen::Vector3d *)
+			ReadMappedFileBlock(file_data, file_size, offset, size) : nullptr;
+	return view;
+}
+
+void ChunkedPointCloud::ReadChunk(size_t chunk, PointCloud &cloud) const
+{
+	ChunkView view = GetChunkView(chunk);
+	cloud.points_.insert(cloud.points_.end(), view.points_,
+			view.points_ + view.num_points_);
+	if (has_normals_) {
+		cloud.normals_.insert(cloud.normals_.end(), view.normals_,
+				view.normals_ + view.num_points_);
+	}
+	if (has_colors_) {
+		cloud.colors_.insert(cloud.colors_.end(), view.colors_,
+				view.colors_ + view.num_points_);
+	}
+}
+
+bool ChunkedPointCloud::ReadTile(size_t tile, PointCloud &cloud,
+		double halo_width/* = 0.0*/) const
+{
+	cloud.Clear();
+	if (tile >= tiles_.size()) {
+		PrintDebug("[ChunkedPointCloud::ReadTile] Invalid tile.\n");
+		return false;
+	}
+	if (halo_width > tile_size_) {
+		PrintDebug("[ChunkedPointCloud::ReadTile] halo_width exceeds the tile size.\n");
+		return false;
+	}
+	const Tile &center = tiles_[tile];
+	cloud.points_.reserve(center.num_points_);
+	for (size_t chunk : center.chunks_) {
+		ReadChunk(chunk, cloud);
+	}
+	if (halo_width <= 0.0) {
+		return true;
+	}
+	Eigen::Vector3d halo3(halo_width, halo_width, halo_width);
+	Eigen::Vector3d halo_min_bound = center.min_bound_ - halo3;
+	Eigen::Vector3d halo_max_bound = center.max_bound_ + halo3;
+	for (int dx = -1; dx <= 1; dx++) {
+		for (int dy = -1; dy <= 1; dy++) {
+			for (int dz = -1; dz <= 1; dz++) {
+				int neighbor = FindTile(center.tile_index_ +
+						Eigen::Vector3i(dx, dy, dz));
+				if (neighbor < 0 || neighbor == (int)tile) {
+					continue;
+				}
+				for (size_t chunk : tiles_[neighbor].chunks_) {
+					if (!IntersectsBox(chunks_[chunk].min_bound_,
+							chunks_[chunk].max_bound_, halo_min_bound,
+							halo_max_bound)) {
+						continue;
+					}
+					ChunkView view = GetChunkView(chunk);
+					for (size_t i = 0; i < view.num_points_; i++) {
+						if (!IsInBox(view.points_[i], halo_min_bound,
+								halo_max_bound)) {
+							continue;
+						}
+						cloud.points_.push_back(view.points_[i]);
+						if (has_normals_) {
+							cloud.normals_.push_back(view.normals_[i]);
+						}
+						if (has_colors_) {
+							cloud.colors_.push_back(view.colors_[i]);
+						}
+					}
+				}
+			}
+		}
+	}
+	return true;
+}
+
+bool ChunkedPointCloud::ForEachTile(const std::function<bool(const Tile &,
+		PointCloud &, size_t)> &function, double halo_width/* = 0.0*/) const
+{
+	PointCloud cloud;
+	ResetConsoleProgress((int64_t)tiles_.size(), "Processing tiles: ");
+	for (size_t i = 0; i < tiles_.size(); i++) {
+		if (ReadTile(i, cloud, halo_width) == false ||
+				function(tiles_[i], cloud, tiles_[i].num_points_) == false) {
+			return false;
+		}
+		AdvanceConsoleProgress();
+	}
+	return true;
+}
+
+Eigen::Vector3i ChunkedPointCloud::GetTileIndex(const Eigen::Vector3d &point,
+		double tile_size)
+{
+	return Eigen::Vector3i(int(std::floor(point(0) / tile_size)),
+			int(std::floor(point(1) / tile_size)),
+			int(std::floor(point(2) / tile_size)));
+}
+
+ChunkedPointCloudWriter::~ChunkedPointCloudWriter()
+{
+	if (file_ != NULL) {
+		Close();
+	}
+}
+
+bool ChunkedPointCloudWriter::Open(const std::string &filename,
+		double tile_size, bool has_normals, bool has_colors,
+		size_t chunk_size/* = 65536*/,
+		size_t max_buffered_points/* = 4194304*/)
+{
+	if (file_ != NULL) {
+		Close();
+	}
+	if (!(tile_size > 0.0) || chunk_size == 0) {
+		PrintDebug("[ChunkedPointCloudWriter::Open] Illegal tile or chunk size.\n");
+		return false;
+	}
+	file_ = fopen(filename.c_str(), "wb");
+	if (file_ == NULL) {
+		PrintDebug("[ChunkedPointCloudWriter::Open] Unable to open file %s.\n",
+				filename.c_str());
+		return false;
+	}
+	offset_ = 0;
+	tile_size_ = tile_size;
+	has_normals_ = has_normals;
+	has_colors_ = has_colors;
+	chunk_size_ = chunk_size;
+	max_buffered_points_ = std::max(max_buffered_points, chunk_size);
+	num_buffered_points_ = 0;
+	num_points_ = 0;
+	buffers_.clear();
+	chunks_.clear();
+	// The header is rewritten with the final values by Close().
+	if (WriteHeader(0) == false) {
+		fclose(file_);
+		file_ = NULL;
+		return false;
+	}
+	return true;
+}
+
+bool ChunkedPointCloudWriter::AddPoints(const PointCloud &cloud)
+{
+	if (file_ == NULL) {
+		PrintDebug("[ChunkedPointCloudWriter::AddPoints] File is not open.\n");
+		return false;
+	}
+	if (cloud.HasPoints() && ((has_normals_ && !cloud.HasNormals()) ||
+			(has_colors_ && !cloud.HasColors()))) {
+		PrintDebug("[ChunkedPointCloudWriter::AddPoints] Missing normals or colors.\n");
+		return false;
+	}
+	for (size_t i = 0; i < cloud.points_.size(); i++) {
+		Eigen::Vector3i tile_index = ChunkedPointCloud::GetTileIndex(
+				cloud.points_[i], tile_size_);
+		auto &buffer = buffers_[tile_index];
+		if (buffer == nullptr) {
+			buffer = std::make_shared<PointCloud>();
+		}
+		buffer->points_.push_back(cloud.points_[i]);
+		if (has_normals_) {
+			buffer->normals_.push_back(cloud.normals_[i]);
+		}
+		if (has_colors_) {
+			buffer->colors_.push_back(cloud.colors_[i]);
+		}
+		num_buffered_points_++;
+		if (buffer->points_.size() >= chunk_size_) {
+			if (FlushTile(tile_index, *buffer) == false) {
+				return false;
+			}
+		}
+		if (num_buffered_points_ >= max_buffered_points_) {
+			if (FlushAll() == false) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool ChunkedPointCloudWriter::Close()
+{
+	if (file_ == NULL) {
+		return false;
+	}
+	bool success = FlushAll();
+	size_t num_chunks = chunks_.size();
+	std::vector<int32_t> tile_indices(num_chunks * 3);
+	std::vector<uint64_t> chunk_infos(num_chunks * 2);
+	std::vector<double> bounds(num_chunks * 6);
+	for (size_t i = 0; i < num_chunks; i++) {
+		const auto &chunk = chunks_[i];
+		for (int j = 0; j < 3; j++) {
+			tile_indices[i * 3 + j] = chunk.tile_index_(j);
+			bounds[i * 6 + j] = chunk.min_bound_(j);
+			bounds[i * 6 + 3 + j] = chunk.max_bound_(j);
+		}
+		chunk_infos[i * 2] = chunk.num_points_;
+		chunk_infos[i * 2 + 1] = chunk.offset_;
+	}
+	size_t index_offset = offset_;
+	success = success && WriteMappedFileBlock(file_, offset_,
+			tile_indices.data(), tile_indices.size() * sizeof(int32_t)) &&
+			WriteMappedFileBlock(file_, offset_, chunk_infos.data(),
+			chunk_infos.size() * sizeof(uint64_t)) &&
+			WriteMappedFileBlock(file_, offset_, bounds.data(),
+			bounds.size() * sizeof(double)) &&
+			fseek(file_, 0, SEEK_SET) == 0 && WriteHeader(index_offset);
+	if (fclose(file_) != 0) {
+		success = false;
+	}
+	file_ = NULL;
+	buffers_.clear();
+	chunks_.clear();
+	if (success == false) {
+		PrintDebug("[ChunkedPointCloudWriter::Close] Failed to write file.\n");
+	}
+	return success;
+}
+
+bool ChunkedPointCloudWriter::FlushTile(const Eigen::Vector3i &tile_index,
+		PointCloud &buffer)
+{
+	if (buffer.points_.empty()) {
+		return true;
+	}
+	ChunkedPointCloud::Chunk chunk;
+	chunk.tile_index_ = tile_index;
+	chunk.num_points_ = buffer.points_.size();
+	chunk.min_bound_ = buffer.GetMinBound();
+	chunk.max_bound_ = buffer.GetMaxBound();
+	chunk.offset_ = offset_;
+	size_t size = chunk.num_points_ * sizeof(Eigen::Vector3d);
+	if (WriteMappedFileBlock(file_, offset_, buffer.points_.data(), size) ==
+			false || (has_normals_ && WriteMappedFileBlock(file_, offset_,
+			buffer.normals_.data(), size) == false) || (has_colors_ &&
+			WriteMappedFileBlock(file_, offset_, buffer.colors_.data(), size) ==
+			false)) {
+		PrintDebug("[ChunkedPointCloudWriter] Failed to write chunk.\n");
+		return false;
+	}
+	chunks_.push_back(chunk);
+	num_points_ += chunk.num_points_;
+	num_buffered_points_ -= chunk.num_points_;
+	// The memory of the buffer is released, as the tile may not get more
+	// points.
+	buffer.Clear();
+	buffer.points_.shrink_to_fit();
+	buffer.normals_.shrink_to_fit();
+	buffer.colors_.shrink_to_fit();
+	return true;
+}
+
+bool ChunkedPointCloudWriter::FlushAll()
+{
+	for (auto &buffer : buffers_) {
+		if (FlushTile(buffer.first, *buffer.second) == false) {
+			return false;
+		}
+	}
+	buffers_.clear();
+	return true;
+}
+
+bool ChunkedPointCloudWriter::WriteHeader(size_t index_offset)
+{
+	Eigen::Vector3d min_bound = Eigen::Vector3d::Zero();
+	Eigen::Vector3d max_bound = Eigen::Vector3d::Zero();
+	for (size_t i = 0; i < chunks_.size(); i++) {
+		min_bound = i == 0 ? chunks_[i].min_bound_ :
+				min_bound.cwiseMin(chunks_[i].min_bound_);
+		max_bound = i == 0 ? chunks_[i].max_bound_ :
+				max_bound.cwiseMax(chunks_[i].max_bound_);
+	}
+	uint64_t header[chunked_file_header_size] = {chunked_file_signature,
+			chunked_file_version, num_points_, chunks_.size(),
+			has_normals_ ? 1u : 0u, has_colors_ ? 1u : 0u, index_offset, 0};
+	double geometry[chunked_file_geometry_size] = {tile_size_,
+			min_bound(0), min_bound(1), min_bound(2),
+			max_bound(0), max_bound(1), max_bound(2)};
+	size_t offset = 0;
+	if (WriteMappedFileBlock(file_, offset, header, sizeof(header)) == false ||
+			WriteMappedFileBlock(file_, offset, geometry,
+			sizeof(geometry)) == false) {
+		PrintDebug("[ChunkedPointCloudWriter] Failed to write header.\n");
+		return false;
+	}
+	if (offset_ < offset) {
+		offset_ = offset;
+	}
+	return true;
+}
+
+bool VoxelDownSample(const ChunkedPointCloud &input, double voxel_size,
+		const std::string &output_filename)
+{
+	if (voxel_size <= 0.0 || voxel_size > input.GetTileSize()) {
+		PrintDebug("[VoxelDownSample] Illegal voxel_size.\n");
+		return false;
+	}
+	ChunkedPointCloudWriter writer;
+	if (writer.Open(output_filename, input.GetTileSize(), input.HasNormals(),
+			input.HasColors()) == false) {
+		return false;
+	}
+	// A voxel spans less than voxel_size, so all of its points are in the
+	// halo of any tile with one of its points. The voxel is down sampled with
+	// the lowest of these tiles.
+	Eigen::Vector3d voxel_origin = input.GetMinBound() -
+			Eigen::Vector3d(voxel_size, voxel_size, voxel_size) * 0.5;
+	auto tile_less = [](const Eigen::Vector3i &a, const Eigen::Vector3i &b) {
+		return std::lexicographical_compare(a.data(), a.data() + 3, b.data(),
+				b.data() + 3);
+	};
+	bool success = input.ForEachTile([&](const ChunkedPointCloud::Tile &tile,
+			PointCloud &cloud, size_t num_tile_points) {
+		std::vector<Eigen::Vector3i> voxel_indices(cloud.points_.size());
+		std::unordered_map<Eigen::Vector3i, Eigen::Vector3i,
+				hash_eigen::hash<Eigen::Vector3i>> voxel_to_tile;
+		for (size_t i = 0; i < cloud.points_.size(); i++) {
+			Eigen::Vector3d ref_coord = (cloud.points_[i] - voxel_origin) /
+					voxel_size;
+			voxel_indices[i] << int(std::floor(ref_coord(0))),
+					int(std::floor(ref_coord(1))),
+					int(std::floor(ref_coord(2)));
+			Eigen::Vector3i tile_index = i < num_tile_points ?
+					tile.tile_index_ : ChunkedPointCloud::GetTileIndex(
+					cloud.points_[i], input.GetTileSize());
+			auto itr = voxel_to_tile.insert(std::make_pair(voxel_indices[i],
+					tile_index)).first;
+			if (tile_less(tile_index, itr->second)) {
+				itr->second = tile_index;
+			}
+		}
+		std::vector<size_t> indices;
+		for (size_t i = 0; i < cloud.points_.size(); i++) {
+			if (voxel_to_tile[voxel_indices[i]] == tile.tile_index_) {
+				indices.push_back(i);
+			}
+		}
+		return writer.AddPoints(*VoxelDownSample(*SelectDownSample(cloud,
+				indices), voxel_size, voxel_origin));
+	}, voxel_size);
+	return writer.Close() && success;
+}
+
+bool CropPointCloud(const ChunkedPointCloud &input,
+		const Eigen::Vector3d &min_bound, const Eigen::Vector3d &max_bound,
+		const std::string &output_filename)
+{
+	if (min_bound(0) > max_bound(0) || min_bound(1) > max_bound(1) ||
+			min_bound(2) > max_bound(2)) {
+		PrintDebug("[CropPointCloud] Illegal boundary clipped all points.\n");
+		return false;
+	}
+	ChunkedPointCloudWriter writer;
+	if (writer.Open(output_filename, input.GetTileSize(), input.HasNormals(),
+			input.HasColors()) == false) {
+		return false;
+	}
+	bool success = true;
+	PointCloud cloud;
+	const auto &chunks = input.GetChunks();
+	for (size_t i = 0; i < chunks.size() && success; i++) {
+		const auto &chunk = chunks[i];
+		if (!IntersectsBox(chunk.min_bound_, chunk.max_bound_, min_bound,
+				max_bound)) {
+			continue;
+		}
+		cloud.Clear();
+		input.ReadChunk(i, cloud);
+		if (IsInBox(chunk.min_bound_, min_bound, max_bound) &&
+				IsInBox(chunk.max_bound_, min_bound, max_bound)) {
+			success = writer.AddPoints(cloud);
+		} else {
+			success = writer.AddPoints(*CropPointCloud(cloud, min_bound,
+					max_bound));
+		}
+	}
+	return writer.Close() && success;
+}
+
+bool EstimateNormals(const ChunkedPointCloud &input,
+		const std::string &output_filename,
+		const KDTreeSearchParam &search_param, double halo_width/* = -1.0*/)
+{
+	if (halo_width < 0.0) {
+		if (search_param.GetSearchType() == KDTreeSearchParam::SEARCH_RADIUS) {
+			halo_width = ((const KDTreeSearchParamRadius &)search_param).
+					radius_;
+		} else if (search_param.GetSearchType() ==
+				KDTreeSearchParam::SEARCH_HYBRID) {
+			halo_width = ((const KDTreeSearchParamHybrid &)search_param).
+					radius_;
+		} else {
+			// Without a halo the points near tile borders would silently
+			// get normals from their own tile only.
+			PrintDebug("[EstimateNormals] A KNN search requires halo_width.\n");
+			return false;
+		}
+	}
+	if (halo_width > input.GetTileSize()) {
+		PrintDebug("[EstimateNormals] halo_width exceeds the tile size.\n");
+		return false;
+	}
+	ChunkedPointCloudWriter writer;
+	if (writer.Open(output_filename, input.GetTileSize(), true,
+			input.HasColors()) == false) {
+		return false;
+	}
+	bool success = input.ForEachTile([&](const ChunkedPointCloud::Tile &,
+			PointCloud &cloud, size_t num_tile_points) {
+		if (EstimateNormals(cloud, search_param) == false) {
+			return false;
+		}
+		// The halo points only serve as neighbors.
+		cloud.points_.resize(num_tile_points);
+		cloud.normals_.resize(num_tile_points);
+		if (input.HasColors()) {
+			cloud.colors_.resize(num_tile_points);
+		}
+		return writer.AddPoints(cloud);
+	}, halo_width);
+	return writer.Close() && success;
+}
+
+bool Transform(const ChunkedPointCloud &input,
+		const Eigen::Matrix4d &transformation,
+		const std::string &output_filename)
+{
+	ChunkedPointCloudWriter writer;
+	if (writer.Open(output_filename, input.GetTileSize(), input.HasNormals(),
+			input.HasColors()) == false) {
+		return false;
+	}
+	bool success = true;
+	PointCloud cloud;
+	for (size_t i = 0; i < input.GetChunks().size() && success; i++) {
+		cloud.Clear();
+		input.ReadChunk(i, cloud);
+		cloud.Transform(transformation);
+		success = writer.AddPoints(cloud);
+	}
+	return writer.Close() && success;
+}
+
+}	// namespace three
@@ -0,0 +1,265 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <cstdio>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <Eigen/Core>
+#include <Core/Geometry/KDTreeSearchParam.h>
+#include <Core/Utility/Helper.h>
+
+namespace three {
+
+class PointCloud;
+class MappedFile;
+
+/// Class of an out-of-core point cloud, stored in a chunked file which is
+/// memory-mapped and read on demand. Space is divided into cubic tiles of
+/// side length tile size; the points of a tile are stored in one or more
+/// chunks of consecutive points, normals and colors. The chunks and tiles form
+/// a spatial index, so that any tile can be read without touching the rest of
+/// the file. Files are written by ChunkedPointCloudWriter. The file must not be
+/// modified while it is open.
+class ChunkedPointCloud
+{
+public:
+	class Chunk
+	{
+	public:
+		Eigen::Vector3i tile_index_;
+		size_t num_points_;
+		Eigen::Vector3d min_bound_;
+		Eigen::Vector3d max_bound_;
+		/// Offset of the chunk data in the file
+		size_t offset_;
+	};
+
+	class Tile
+	{
+	public:
+		Eigen::Vector3i tile_index_;
+		std::vector<size_t> chunks_;
+		size_t num_points_;
+		Eigen::Vector3d min_bound_;
+		Eigen::Vector3d max_bound_;
+	};
+
+	/// The data of a chunk, used in place in the mapped file. normals_ and
+	/// colors_ are nullptr if the point cloud has no normals or colors.
+	class ChunkView
+	{
+	public:
+		size_t num_points_;
+		const Eigen::Vector3d *points_;
+		const Eigen::Vector3d *normals_;
+		const Eigen::Vector3d *colors_;
+	};
+
+	/// Iterator streaming the points of all chunks
+	class PointIterator : public std::iterator<std::forward_iterator_tag,
+			const Eigen::Vector3d>
+	{
+	public:
+		PointIterator(const ChunkedPointCloud &cloud, size_t chunk);
+
+	public:
+		const Eigen::Vector3d &operator*() const { return view_.points_[index_]; }
+		const Eigen::Vector3d *operator->() const {
+			return view_.points_ + index_;
+		}
+		PointIterator &operator++();
+		PointIterator operator++(int) {
+			PointIterator itr = *this;
+			++(*this);
+			return itr;
+		}
+		bool operator==(const PointIterator &itr) const {
+			return chunk_ == itr.chunk_ && index_ == itr.index_;
+		}
+		bool operator!=(const PointIterator &itr) const {
+			return !(*this == itr);
+		}
+
+	private:
+		void SkipEmptyChunks();
+
+	private:
+		const ChunkedPointCloud *cloud_;
+		size_t chunk_;
+		size_t index_;
+		ChunkView view_;
+	};
+
+public:
+	ChunkedPointCloud();
+	~ChunkedPointCloud();
+	ChunkedPointCloud(const ChunkedPointCloud &) = delete;
+	ChunkedPointCloud &operator=(const ChunkedPointCloud &) = delete;
+
+public:
+	bool Open(const std::string &filename);
+	void Close();
+	bool IsOpen() const;
+
+	size_t GetPointNum() const { return num_points_; }
+	bool HasNormals() const { return has_normals_; }
+	bool HasColors() const { return has_colors_; }
+	double GetTileSize() const { return tile_size_; }
+	const Eigen::Vector3d &GetMinBound() const { return min_bound_; }
+	const Eigen::Vector3d &GetMaxBound() const { return max_bound_; }
+	const std::vector<Chunk> &GetChunks() const { return chunks_; }
+	const std::vector<Tile> &GetTiles() const { return tiles_; }
+
+	/// Returns the index of the tile \param tile_index in GetTiles(), or -1
+	int FindTile(const Eigen::Vector3i &tile_index) const;
+
+	ChunkView GetChunkView(size_t chunk) const;
+	PointIterator begin() const { return PointIterator(*this, 0); }
+	PointIterator end() const { return PointIterator(*this, chunks_.size()); }
+
+	/// Function to append the points of chunk \param chunk to \param cloud
+	void ReadChunk(size_t chunk, PointCloud &cloud) const;
+
+	/// Function to read the points of tile \param tile into \param cloud. The
+	/// points of the adjacent tiles within \param halo_width of the tile are
+	/// appended after the points of the tile, e.g. to give the points at the
+	/// tile border complete neighborhoods. \param halo_width must not exceed
+	/// the tile size.
+	bool ReadTile(size_t tile, PointCloud &cloud,
+			double halo_width = 0.0) const;
+
+	/// Function to run \param function on each tile, one tile at a time, so
+	/// that the memory use is bounded by the largest tile. The function gets
+	/// the tile, the points read by ReadTile() and the number of points of
+	/// the tile proper; it returns false to stop.
+	bool ForEachTile(const std::function<bool(const Tile &, PointCloud &,
+			size_t)> &function, double halo_width = 0.0) const;
+
+public:
+	static Eigen::Vector3i GetTileIndex(const Eigen::Vector3d &point,
+			double tile_size);
+
+private:
+	std::unique_ptr<MappedFile> mapped_file_;
+	size_t num_points_ = 0;
+	bool has_normals_ = false;
+	bool has_colors_ = false;
+	double tile_size_ = 0.0;
+	Eigen::Vector3d min_bound_ = Eigen::Vector3d::Zero();
+	Eigen::Vector3d max_bound_ = Eigen::Vector3d::Zero();
+	std::vector<Chunk> chunks_;
+	std::vector<Tile> tiles_;
+	std::unordered_map<Eigen::Vector3i, size_t,
+			hash_eigen::hash<Eigen::Vector3i>> tile_map_;
+};
+
+/// Class to write a ChunkedPointCloud file from a stream of points. Points are
+/// buffered per tile and a chunk is written whenever the buffer of a tile is
+/// full, or all buffers are flushed when \param max_buffered_points points
+/// are buffered, so that the memory use is bounded.
+class ChunkedPointCloudWriter
+{
+public:
+	ChunkedPointCloudWriter() {}
+	~ChunkedPointCloudWriter();
+	ChunkedPointCloudWriter(const ChunkedPointCloudWriter &) = delete;
+	ChunkedPointCloudWriter &operator=(const ChunkedPointCloudWriter &) =
+			delete;
+
+public:
+	bool Open(const std::string &filename, double tile_size, bool has_normals,
+			bool has_colors, size_t chunk_size = 65536,
+			size_t max_buffered_points = 4194304);
+
+	/// Function to add the points of \param cloud. The cloud must have normals
+	/// and colors as declared in Open().
+	bool AddPoints(const PointCloud &cloud);
+
+	/// Function to flush the buffers and write the spatial index. The file is
+	/// incomplete until Close() succeeds.
+	bool Close();
+	bool IsOpen() const { return file_ != NULL; }
+
+private:
+	bool FlushTile(const Eigen::Vector3i &tile_index, PointCloud &buffer);
+	bool FlushAll();
+	bool WriteHeader(size_t index_offset);
+
+private:
+	FILE *file_ = NULL;
+	size_t offset_ = 0;
+	double tile_size_ = 0.0;
+	bool has_normals_ = false;
+	bool has_colors_ = false;
+	size_t chunk_size_ = 0;
+	size_t max_buffered_points_ = 0;
+	size_t num_buffered_points_ = 0;
+	size_t num_points_ = 0;
+	std::unordered_map<Eigen::Vector3i, std::shared_ptr<PointCloud>,
+			hash_eigen::hash<Eigen::Vector3i>> buffers_;
+	std::vector<ChunkedPointCloud::Chunk> chunks_;
+};
+
+/// Function to downsample an out-of-core point cloud with a voxel grid into
+/// the chunked file \param output_filename, one tile at a time. The voxel
+/// grid is the one of VoxelDownSample() on the whole point cloud.
+/// \param voxel_size must not exceed the tile size.
+bool VoxelDownSample(const ChunkedPointCloud &input, double voxel_size,
+		const std::string &output_filename);
+
+/// Function to crop an out-of-core point cloud into the chunked file
+/// \param output_filename. Chunks outside the box are skipped and chunks
+/// inside the box are copied without testing their points.
+bool CropPointCloud(const ChunkedPointCloud &input,
+		const Eigen::Vector3d &min_bound, const Eigen::Vector3d &max_bound,
+		const std::string &output_filename);
+
+/// Function to compute the normals of an out-of-core point cloud into the
+/// chunked file \param output_filename, one tile at a time. The neighbors of
+/// the points of a tile are searched among the points of the tile and the
+/// points of the adjacent tiles within \param halo_width. By default this is
+/// the radius of a radius or hybrid search, which gives the same normals as
+/// the in-core function. A KNN search has no such bound, so it fails unless a
+/// halo is given; its normals match the in-core ones for the points whose k
+/// nearest neighbors are within halo_width.
+bool EstimateNormals(const ChunkedPointCloud &input,
+		const std::string &output_filename,
+		const KDTreeSearchParam &search_param, double halo_width = -1.0);
+
+/// Function to transform an out-of-core point cloud into the chunked file
+/// \param output_filename, one chunk at a time.
+bool Transform(const ChunkedPointCloud &input,
+		const Eigen::Matrix4d &transformation,
+		const std::string &output_filename);
+
+}	// namespace three
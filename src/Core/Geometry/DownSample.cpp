@@ -26,8 +26,13 @@
 
 #include "PointCloud.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <unordered_map>
 
+#include <Core/Geometry/PointCloudT.h>
+
 #include <Core/Utility/Helper.h>
 #include <Core/Utility/Console.h>
 
@@ -35,6 +40,8 @@ namespace three{
 
 namespace {
 
+const double farthest_point_points_per_cell = 64.0;
+
 class AccumulatedPoint
 {
 public:
@@ -63,6 +70,24 @@ public:
 		num_of_points++;
 	}
 
+	/// Colors of a PointCloudT are accumulated in [0, 255].
+	template<typename Scalar>
+	void AddPoint(const PointCloudT<Scalar> &cloud, int index)
+	{
+		point += cloud.points_[index].template cast<double>();
+		if (cloud.HasNormals()) {
+			if (!std::isnan(cloud.normals_[index](0)) &&
+					!std::isnan(cloud.normals_[index](1)) &&
+					!std::isnan(cloud.normals_[index](2))) {
+				normal += cloud.normals_[index].template cast<double>();
+			}
+		}
+		if (cloud.HasColors()) {
+			color += cloud.colors_[index].template cast<double>();
+		}
+		num_of_points++;
+	}
+
 	Eigen::Vector3d GetAveragePoint()
 	{
 		return point / double(num_of_points);
@@ -85,6 +110,184 @@ private:
 	Eigen::Vector3d color;
 };
 
+/// Sorts the points by voxel so that the points of each voxel are contiguous
+/// in \param order, in increasing index order. The points of voxel v are
+/// order[voxel_offsets[v]], ..., order[voxel_offsets[v + 1] - 1], and the
+/// voxels are sorted lexicographically by their integer (x, y, z) index.
+/// The voxel indices are packed into 64-bit keys and radix sorted; grids too
+/// large for 64-bit keys fall back to a comparison sort. \param min_bound and
+/// \param max_bound are the bounds of the points, computed by the caller.
+template<typename PointCloudType>
+void SortPointsByVoxel(const PointCloudType &input, double voxel_size,
+		const Eigen::Vector3d &voxel_origin, const Eigen::Vector3d &min_bound,
+		const Eigen::Vector3d &max_bound, std::vector<uint32_t> &order,
+		std::vector<size_t> &voxel_offsets)
+{
+	size_t num_points = input.points_.size();
+	voxel_offsets.assign(1, 0);
+	order.clear();
+	if (num_points == 0) {
+		return;
+	}
+	auto GetVoxelIndex = [&](size_t i) {
+		Eigen::Vector3d ref_coord = (input.points_[i].template cast<double>() -
+				voxel_origin) / voxel_size;
+		return Eigen::Vector3i(int(floor(ref_coord(0))),
+				int(floor(ref_coord(1))), int(floor(ref_coord(2))));
+	};
+	// floor() is monotonic, so the voxel indices of the bounds are the
+	// extreme voxel indices of the points.
+	Eigen::Vector3d min_coord = (min_bound - voxel_origin) / voxel_size;
+	Eigen::Vector3d max_coord = (max_bound - voxel_origin) / voxel_size;
+	Eigen::Vector3i min_index(int(floor(min_coord(0))),
+			int(floor(min_coord(1))), int(floor(min_coord(2))));
+	int bits[3];
+	for (int k = 0; k < 3; k++) {
+		uint64_t extent = (uint64_t)((int64_t)floor(max_coord(k)) -
+				min_index(k));
+		bits[k] = 0;
+		while (bits[k] < 64 && (extent >> bits[k]) > 0) {
+			bits[k]++;
+		}
+	}
+	int num_key_bits = bits[0] + bits[1] + bits[2];
+
+	if (num_key_bits <= 64) {
+		std::vector<uint64_t> keys(num_points);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for (int i = 0; i < (int)num_points; i++) {
+			Eigen::Vector3i voxel_index = GetVoxelIndex(i) - min_index;
+			keys[i] = ((uint64_t)voxel_index(0) << (bits[1] + bits[2])) |
+					((uint64_t)voxel_index(1) << bits[2]) |
+					(uint64_t)voxel_index(2);
+		}
+		RadixSortKeys(keys, order, num_key_bits);
+		for (size_t i = 1; i < num_points; i++) {
+			if (keys[i] != keys[i - 1]) {
+				voxel_offsets.push_back(i);
+			}
+		}
+	} else {
+		std::vector<Eigen::Vector3i> voxel_indices(num_points);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for (int i = 0; i < (int)num_points; i++) {
+			voxel_indices[i] = GetVoxelIndex(i);
+		}
+		auto IsLess = [](const Eigen::Vector3i &a, const Eigen::Vector3i &b) {
+			return std::make_tuple(a(0), a(1), a(2)) <
+					std::make_tuple(b(0), b(1), b(2));
+		};
+		order.resize(num_points);
+		for (size_t i = 0; i < num_points; i++) {
+			order[i] = (uint32_t)i;
+		}
+		std::stable_sort(order.begin(), order.end(),
+				[&](uint32_t a, uint32_t b) {
+			return IsLess(voxel_indices[a], voxel_indices[b]);
+		});
+		for (size_t i = 1; i < num_points; i++) {
+			if (voxel_indices[order[i]] != voxel_indices[order[i - 1]]) {
+				voxel_offsets.push_back(i);
+			}
+		}
+	}
+	voxel_offsets.push_back(num_points);
+}
+
+/// Down samples \param input and, if the trace pointers are not null,
+/// returns the points merged into each output point and the output point of
+/// each input point. The grid starts at \param voxel_origin, or half a voxel
+/// below the minimum bound if voxel_origin is null. The bounds are computed
+/// once and shared by the range check and the sort.
+std::shared_ptr<PointCloud> VoxelDownSampleWithTrace(const PointCloud &input,
+		double voxel_size, const Eigen::Vector3d *voxel_origin,
+		std::vector<size_t> *voxel_offsets, std::vector<size_t> *indices,
+		std::vector<size_t> *point_to_voxel)
+{
+	auto output = std::make_shared<PointCloud>();
+	if (voxel_size <= 0.0) {
+		PrintDebug("[VoxelDownSample] voxel_size <= 0.\n");
+		return output;
+	}
+	Eigen::Vector3d min_bound, max_bound;
+	Geometry3D::ComputeBounds(input.points_.data(), input.points_.size(),
+			min_bound, max_bound);
+	Eigen::Vector3d voxel_min_bound = voxel_origin != nullptr ?
+			*voxel_origin : Eigen::Vector3d(min_bound -
+			Eigen::Vector3d::Constant(voxel_size * 0.5));
+	if (voxel_size * std::numeric_limits<int>::max() <
+			(max_bound - voxel_min_bound).cwiseAbs().maxCoeff() ||
+			voxel_size * std::numeric_limits<int>::max() <
+			(min_bound - voxel_min_bound).cwiseAbs().maxCoeff()) {
+		PrintDebug("[VoxelDownSample] voxel_size is too small.\n");
+		return output;
+	}
+	std::vector<uint32_t> order;
+	std::vector<size_t> offsets;
+	SortPointsByVoxel(input, voxel_size, voxel_min_bound, min_bound,
+			max_bound, order, offsets);
+	int num_voxels = (int)offsets.size() - 1;
+	bool has_normals = input.HasNormals();
+	bool has_colors = input.HasColors();
+	bool has_attributes = false;
+	for (const auto &attribute : input.attributes_) {
+		has_attributes |= input.HasAttribute(attribute.GetName());
+	}
+	output->points_.resize(num_voxels);
+	if (has_normals) {
+		output->normals_.resize(num_voxels);
+	}
+	if (has_colors) {
+		output->colors_.resize(num_voxels);
+	}
+	bool has_trace = (point_to_voxel != nullptr);
+	std::vector<size_t> groups;
+	if (has_attributes || has_trace) {
+		groups.resize(input.points_.size());
+	}
+	// The points of a voxel are accumulated in increasing index order, so
+	// the averages do not depend on the number of threads.
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int v = 0; v < num_voxels; v++) {
+		AccumulatedPoint accpoint;
+		for (size_t j = offsets[v]; j < offsets[v + 1]; j++) {
+			accpoint.AddPoint(input, (int)order[j]);
+			if (has_attributes || has_trace) {
+				groups[order[j]] = (size_t)v;
+			}
+		}
+		output->points_[v] = accpoint.GetAveragePoint();
+		if (has_normals) {
+			output->normals_[v] = accpoint.GetAverageNormal();
+		}
+		if (has_colors) {
+			output->colors_[v] = accpoint.GetAverageColor();
+		}
+	}
+	if (has_attributes) {
+		for (const auto &attribute : input.attributes_) {
+			if (input.HasAttribute(attribute.GetName())) {
+				output->attributes_.push_back(attribute.Reduce(groups,
+						output->points_.size()));
+			}
+		}
+	}
+	if (has_trace) {
+		voxel_offsets->swap(offsets);
+		indices->assign(order.begin(), order.end());
+		point_to_voxel->swap(groups);
+	}
+	PrintDebug("Pointcloud down sampled from %d points to %d points.\n",
+			(int)input.points_.size(), (int)output->points_.size());
+	return output;
+}
+
 }	// unnamed namespace
 
 std::shared_ptr<PointCloud> SelectDownSample(const PointCloud &input,
@@ -93,10 +296,22 @@ std::shared_ptr<PointCloud> SelectDownSample(const PointCloud &input,
 	auto output = std::make_shared<PointCloud>();
 	bool has_normals = input.HasNormals();
 	bool has_colors = input.HasColors();
-	for (size_t i : indices) {
-		output->points_.push_back(input.points_[i]);
-		if (has_normals) output->normals_.push_back(input.normals_[i]);
-		if (has_colors) output->colors_.push_back(input.colors_[i]);
+	output->points_.resize(indices.size());
+	if (has_normals) output->normals_.resize(indices.size());
+	if (has_colors) output->colors_.resize(indices.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int k = 0; k < (int)indices.size(); k++) {
+		size_t i = indices[k];
+		output->points_[k] = input.points_[i];
+		if (has_normals) output->normals_[k] = input.normals_[i];
+		if (has_colors) output->colors_[k] = input.colors_[i];
+	}
+	for (const auto &attribute : input.attributes_) {
+		if (input.HasAttribute(attribute.GetName())) {
+			output->attributes_.push_back(attribute.Select(indices));
+		}
 	}
 	PrintDebug("Pointcloud down sampled from %d points to %d points.\n",
 			(int)input.points_.size(), (int)output->points_.size());
@@ -106,39 +321,92 @@ std::shared_ptr<PointCloud> SelectDownSample(const PointCloud &input,
 std::shared_ptr<PointCloud> VoxelDownSample(const PointCloud &input,
 		double voxel_size)
 {
-	auto output = std::make_shared<PointCloud>();
+	return VoxelDownSampleWithTrace(input, voxel_size, nullptr, nullptr,
+			nullptr, nullptr);
+}
+
+std::shared_ptr<PointCloud> VoxelDownSample(const PointCloud &input,
+		double voxel_size, const Eigen::Vector3d &voxel_origin)
+{
+	return VoxelDownSampleWithTrace(input, voxel_size, &voxel_origin, nullptr,
+			nullptr, nullptr);
+}
+
+std::shared_ptr<PointCloud> VoxelDownSampleAndTrace(const PointCloud &input,
+		double voxel_size, std::vector<size_t> &voxel_offsets,
+		std::vector<size_t> &indices, std::vector<size_t> &point_to_voxel)
+{
+	voxel_offsets.assign(1, 0);
+	indices.clear();
+	point_to_voxel.clear();
+	return VoxelDownSampleWithTrace(input, voxel_size, nullptr,
+			&voxel_offsets, &indices, &point_to_voxel);
+}
+
+std::shared_ptr<PointCloud> VoxelDownSampleAndTrace(const PointCloud &input,
+		double voxel_size, const Eigen::Vector3d &voxel_origin,
+		std::vector<size_t> &voxel_offsets, std::vector<size_t> &indices,
+		std::vector<size_t> &point_to_voxel)
+{
+	voxel_offsets.assign(1, 0);
+	indices.clear();
+	point_to_voxel.clear();
+	return VoxelDownSampleWithTrace(input, voxel_size, &voxel_origin,
+			&voxel_offsets, &indices, &point_to_voxel);
+}
+
+template<typename Scalar>
+std::shared_ptr<PointCloudT<Scalar>> VoxelDownSample(
+		const PointCloudT<Scalar> &input, double voxel_size)
+{
+	auto output = std::make_shared<PointCloudT<Scalar>>();
 	if (voxel_size <= 0.0) {
 		PrintDebug("[VoxelDownSample] voxel_size <= 0.\n");
 		return output;
 	}
+	Eigen::Vector3d min_bound, max_bound;
+	Geometry3D::ComputeBounds(input.points_.data(), input.points_.size(),
+			min_bound, max_bound);
 	Eigen::Vector3d voxel_size3 =
 			Eigen::Vector3d(voxel_size, voxel_size, voxel_size);
-	Eigen::Vector3d voxel_min_bound = input.GetMinBound() - voxel_size3 * 0.5;
-	Eigen::Vector3d voxel_max_bound = input.GetMaxBound() + voxel_size3 * 0.5;
+	Eigen::Vector3d voxel_min_bound = min_bound - voxel_size3 * 0.5;
+	Eigen::Vector3d voxel_max_bound = max_bound + voxel_size3 * 0.5;
 	if (voxel_size * std::numeric_limits<int>::max() <
 			(voxel_max_bound - voxel_min_bound).maxCoeff()) {
 		PrintDebug("[VoxelDownSample] voxel_size is too small.\n");
 		return output;
 	}
-	std::unordered_map<Eigen::Vector3i, AccumulatedPoint,
-			hash_eigen::hash<Eigen::Vector3i>> voxelindex_to_accpoint;
-	Eigen::Vector3d ref_coord;
-	Eigen::Vector3i voxel_index;
-	for (int i = 0; i < (int)input.points_.size(); i++) {
-		ref_coord = (input.points_[i] - voxel_min_bound) / voxel_size;
-		voxel_index << int(floor(ref_coord(0))),
-				int(floor(ref_coord(1))), int(floor(ref_coord(2)));
-		voxelindex_to_accpoint[voxel_index].AddPoint(input, i);
-	}
+	std::vector<uint32_t> order;
+	std::vector<size_t> voxel_offsets;
+	SortPointsByVoxel(input, voxel_size, voxel_min_bound, min_bound,
+			max_bound, order, voxel_offsets);
+	int num_voxels = (int)voxel_offsets.size() - 1;
 	bool has_normals = input.HasNormals();
 	bool has_colors = input.HasColors();
-	for (auto accpoint : voxelindex_to_accpoint) {
-		output->points_.push_back(accpoint.second.GetAveragePoint());
+	output->points_.resize(num_voxels);
+	if (has_normals) {
+		output->normals_.resize(num_voxels);
+	}
+	if (has_colors) {
+		output->colors_.resize(num_voxels);
+	}
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int v = 0; v < num_voxels; v++) {
+		AccumulatedPoint accpoint;
+		for (size_t j = voxel_offsets[v]; j < voxel_offsets[v + 1]; j++) {
+			accpoint.AddPoint(input, (int)order[j]);
+		}
+		output->points_[v] = accpoint.GetAveragePoint().
+				template cast<Scalar>();
 		if (has_normals) {
-			output->normals_.push_back(accpoint.second.GetAverageNormal());
+			output->normals_[v] = accpoint.GetAverageNormal().
+					template cast<Scalar>();
 		}
 		if (has_colors) {
-			output->colors_.push_back(accpoint.second.GetAverageColor());
+			output->colors_[v] = (accpoint.GetAverageColor().array() + 0.5).
+					template cast<uint8_t>();
 		}
 	}
 	PrintDebug("Pointcloud down sampled from %d points to %d points.\n",
@@ -146,6 +414,190 @@ std::shared_ptr<PointCloud> VoxelDownSample(const PointCloud &input,
 	return output;
 }
 
+template std::shared_ptr<PointCloudT<float>> VoxelDownSample(
+		const PointCloudT<float> &input, double voxel_size);
+
+std::shared_ptr<PointCloud> FarthestPointDownSample(const PointCloud &input,
+		size_t num_samples)
+{
+	size_t num_points = input.points_.size();
+	if (num_samples >= num_points) {
+		return std::make_shared<PointCloud>(input);
+	}
+	std::vector<size_t> indices;
+	if (num_samples == 0) {
+		return SelectDownSample(input, indices);
+	}
+
+	// The points are bucketed into a grid of about
+	// farthest_point_points_per_cell points per cell. After a sample is
+	// added, a cell is skipped if its bounding box is farther from the
+	// sample than its farthest point is from the previous samples, since
+	// none of its distances can decrease.
+	Eigen::Vector3d min_bound, max_bound;
+	Geometry3D::ComputeBounds(input.points_.data(), num_points, min_bound,
+			max_bound);
+	double extent = (max_bound - min_bound).maxCoeff();
+	double cells_per_axis = std::max(1.0, std::ceil(std::cbrt(
+			(double)num_points / farthest_point_points_per_cell)));
+	double cell_size = extent > 0.0 ? extent / cells_per_axis : 1.0;
+	std::vector<uint32_t> order;
+	std::vector<size_t> cell_offsets;
+	SortPointsByVoxel(input, cell_size, min_bound, min_bound, max_bound,
+			order, cell_offsets);
+	int num_cells = (int)cell_offsets.size() - 1;
+	std::vector<Eigen::Vector3d> points(num_points);
+	std::vector<double> distance2(num_points,
+			std::numeric_limits<double>::infinity());
+	std::vector<Eigen::Vector3d> cell_min(num_cells), cell_max(num_cells);
+	std::vector<double> cell_max_distance2(num_cells,
+			std::numeric_limits<double>::infinity());
+	std::vector<size_t> cell_farthest(num_cells);
+	size_t first = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int c = 0; c < num_cells; c++) {
+		cell_min[c] = cell_max[c] = input.points_[order[cell_offsets[c]]];
+		cell_farthest[c] = cell_offsets[c];
+		for (size_t j = cell_offsets[c]; j < cell_offsets[c + 1]; j++) {
+			points[j] = input.points_[order[j]];
+			cell_min[c] = cell_min[c].cwiseMin(points[j]);
+			cell_max[c] = cell_max[c].cwiseMax(points[j]);
+			if (order[j] == 0) {
+				first = j;
+			}
+		}
+	}
+
+	// The first sample is the first point of the input.
+	indices.reserve(num_samples);
+	size_t sample = first;
+	while (true) {
+		indices.push_back(order[sample]);
+		if (indices.size() == num_samples) {
+			break;
+		}
+		const Eigen::Vector3d sample_point = points[sample];
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for (int c = 0; c < num_cells; c++) {
+			Eigen::Vector3d gap = (cell_min[c] - sample_point).cwiseMax(
+					sample_point - cell_max[c]).cwiseMax(0.0);
+			if (gap.squaredNorm() >= cell_max_distance2[c]) {
+				continue;
+			}
+			double max_distance2 = -1.0;
+			for (size_t j = cell_offsets[c]; j < cell_offsets[c + 1]; j++) {
+				distance2[j] = std::min(distance2[j],
+						(points[j] - sample_point).squaredNorm());
+				if (distance2[j] > max_distance2) {
+					max_distance2 = distance2[j];
+					cell_farthest[c] = j;
+				}
+			}
+			cell_max_distance2[c] = max_distance2;
+		}
+		int farthest_cell = 0;
+		for (int c = 1; c < num_cells; c++) {
+			if (cell_max_distance2[c] > cell_max_distance2[farthest_cell]) {
+				farthest_cell = c;
+			}
+		}
+		sample = cell_farthest[farthest_cell];
+	}
+	std::sort(indices.begin(), indices.end());
+	return SelectDownSample(input, indices);
+}
+
+std::shared_ptr<PointCloud> PoissonDiskDownSample(const PointCloud &input,
+		double radius)
+{
+	std::vector<size_t> indices;
+	if (radius <= 0.0) {
+		PrintDebug("[PoissonDiskDownSample] radius <= 0.\n");
+		return SelectDownSample(input, indices);
+	}
+	Eigen::Vector3d min_bound, max_bound;
+	Geometry3D::ComputeBounds(input.points_.data(), input.points_.size(),
+			min_bound, max_bound);
+	if (radius * std::numeric_limits<int>::max() <
+			(max_bound - min_bound).maxCoeff()) {
+		PrintDebug("[PoissonDiskDownSample] radius is too small.\n");
+		return SelectDownSample(input, indices);
+	}
+
+	// With cells of size radius, the samples closer than radius to a point
+	// lie in the 27 cells around it. Distinct cells whose coordinates are
+	// equal modulo 3 are at least three cells apart, so none of them reads
+	// the samples another one writes. The cells are therefore processed in
+	// 27 phases, each phase in parallel, and the result does not depend on
+	// the number of threads.
+	std::vector<uint32_t> order;
+	std::vector<size_t> cell_offsets;
+	SortPointsByVoxel(input, radius, min_bound, min_bound, max_bound, order,
+			cell_offsets);
+	int num_cells = (int)cell_offsets.size() - 1;
+	std::vector<Eigen::Vector3i> cell_indices(num_cells);
+	std::unordered_map<Eigen::Vector3i, int,
+			hash_eigen::hash<Eigen::Vector3i>> cell_index_to_cell;
+	std::vector<std::vector<int>> phase_cells(27);
+	for (int c = 0; c < num_cells; c++) {
+		Eigen::Vector3d ref_coord = (input.points_[order[cell_offsets[c]]] -
+				min_bound) / radius;
+		cell_indices[c] = Eigen::Vector3i(int(floor(ref_coord(0))),
+				int(floor(ref_coord(1))), int(floor(ref_coord(2))));
+		cell_index_to_cell[cell_indices[c]] = c;
+		phase_cells[(cell_indices[c](0) % 3) * 9 +
+				(cell_indices[c](1) % 3) * 3 + cell_indices[c](2) % 3].
+				push_back(c);
+	}
+	double radius2 = radius * radius;
+	std::vector<std::vector<uint32_t>> cell_samples(num_cells);
+	for (const auto &cells : phase_cells) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 64)
+#endif
+		for (int k = 0; k < (int)cells.size(); k++) {
+			int c = cells[k];
+			std::vector<int> neighbor_cells;
+			for (int dx = -1; dx <= 1; dx++) {
+				for (int dy = -1; dy <= 1; dy++) {
+					for (int dz = -1; dz <= 1; dz++) {
+						auto itr = cell_index_to_cell.find(cell_indices[c] +
+								Eigen::Vector3i(dx, dy, dz));
+						if (itr != cell_index_to_cell.end()) {
+							neighbor_cells.push_back(itr->second);
+						}
+					}
+				}
+			}
+			for (size_t j = cell_offsets[c]; j < cell_offsets[c + 1]; j++) {
+				const Eigen::Vector3d &point = input.points_[order[j]];
+				bool is_free = true;
+				for (size_t n = 0; n < neighbor_cells.size() && is_free; n++) {
+					for (uint32_t sample : cell_samples[neighbor_cells[n]]) {
+						if ((input.points_[sample] - point).squaredNorm() <
+								radius2) {
+							is_free = false;
+							break;
+						}
+					}
+				}
+				if (is_free) {
+					cell_samples[c].push_back(order[j]);
+				}
+			}
+		}
+	}
+	for (const auto &samples : cell_samples) {
+		indices.insert(indices.end(), samples.begin(), samples.end());
+	}
+	std::sort(indices.begin(), indices.end());
+	return SelectDownSample(input, indices);
+}
+
 std::shared_ptr<PointCloud> UniformDownSample(const PointCloud &input,
 		size_t every_k_points)
 {
@@ -168,16 +620,39 @@ std::shared_ptr<PointCloud> CropPointCloud(const PointCloud &input,
 		PrintDebug("[CropPointCloud] Illegal boundary clipped all points.\n");
 		return std::make_shared<PointCloud>();
 	}
-	std::vector<size_t> indices;
-	for (size_t i = 0; i < input.points_.size(); i++) {
+	std::vector<uint8_t> is_inside(input.points_.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int i = 0; i < (int)input.points_.size(); i++) {
 		const auto &point = input.points_[i];
-		if (point(0) >= min_bound(0) && point(0) <= max_bound(0) &&
+		is_inside[i] = (point(0) >= min_bound(0) && point(0) <= max_bound(0) &&
 				point(1) >= min_bound(1) && point(1) <= max_bound(1) &&
-				point(2) >= min_bound(2) && point(2) <= max_bound(2)) {
-			indices.push_back(i);
-		}
+				point(2) >= min_bound(2) && point(2) <= max_bound(2)) ? 1 : 0;
 	}
-	return SelectDownSample(input, indices);
+	return SelectDownSample(input, GetNonZeroIndices(is_inside));
+}
+
+std::shared_ptr<PointCloud> CropPointCloud(const PointCloud &input,
+		const Eigen::Vector3d &center, const Eigen::Matrix3d &rotation,
+		const Eigen::Vector3d &extent)
+{
+	if (extent(0) < 0.0 || extent(1) < 0.0 || extent(2) < 0.0) {
+		PrintDebug("[CropPointCloud] Illegal extent clipped all points.\n");
+		return std::make_shared<PointCloud>();
+	}
+	const Eigen::Matrix3d rotation_inv = rotation.transpose();
+	const Eigen::Vector3d half_extent = extent * 0.5;
+	std::vector<uint8_t> is_inside(input.points_.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int i = 0; i < (int)input.points_.size(); i++) {
+		Eigen::Vector3d local = rotation_inv * (input.points_[i] - center);
+		is_inside[i] = (local.cwiseAbs().array() <=
+				half_extent.array()).all() ? 1 : 0;
+	}
+	return SelectDownSample(input, GetNonZeroIndices(is_inside));
 }
 
 }	// namespace three
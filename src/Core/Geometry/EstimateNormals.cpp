@@ -26,14 +26,22 @@
 
 #include "PointCloud.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
 #include <Eigen/Eigenvalues>
 #include <Core/Utility/Console.h>
+#include <Core/Utility/Helper.h>
 #include <Core/Geometry/KDTreeFlann.h>
+#include <Core/Geometry/PointCloudT.h>
 
 namespace three{
 
 namespace {
 
+const size_t normal_estimation_batch_size = 65536;
+
 double sqr(double x) { return x * x; }
 
 Eigen::Vector3d FastEigen3x3(const Eigen::Matrix3d &A)
@@ -77,28 +85,12 @@ Eigen::Vector3d FastEigen3x3(const Eigen::Matrix3d &A)
 	}
 }
 
-Eigen::Vector3d ComputeNormal(const PointCloud &cloud,
-		const std::vector<int> &indices)
+/// \param cumulants are the means of x, y, z, xx, xy, xz, yy, yz and zz over
+/// the neighborhood of a point.
+Eigen::Vector3d ComputeNormalFromCumulants(
+		const Eigen::Matrix<double, 9, 1> &cumulants)
 {
-	if (indices.size() == 0) {
-		return Eigen::Vector3d::Zero();
-	}
 	Eigen::Matrix3d covariance;
-	Eigen::Matrix<double, 9, 1> cumulants;
-	cumulants.setZero();
-	for (size_t i = 0; i < indices.size(); i++) {
-		const Eigen::Vector3d &point = cloud.points_[indices[i]];
-		cumulants(0) += point(0);
-		cumulants(1) += point(1);
-		cumulants(2) += point(2);
-		cumulants(3) += point(0) * point(0);
-		cumulants(4) += point(0) * point(1);
-		cumulants(5) += point(0) * point(2);
-		cumulants(6) += point(1) * point(1);
-		cumulants(7) += point(1) * point(2);
-		cumulants(8) += point(2) * point(2);
-	}
-	cumulants /= (double)indices.size();
 	covariance(0, 0) = cumulants(3) - cumulants(0) * cumulants(0);
 	covariance(1, 1) = cumulants(6) - cumulants(1) * cumulants(1);
 	covariance(2, 2) = cumulants(8) - cumulants(2) * cumulants(2);
@@ -115,27 +107,291 @@ Eigen::Vector3d ComputeNormal(const PointCloud &cloud,
 	//return solver.eigenvectors().col(0);
 }
 
+template<typename PointCloudType>
+Eigen::Vector3d ComputeNormal(const PointCloudType &cloud, const int *indices,
+		size_t num_indices)
+{
+	if (num_indices == 0) {
+		return Eigen::Vector3d::Zero();
+	}
+	Eigen::Matrix<double, 9, 1> cumulants;
+	cumulants.setZero();
+	for (size_t i = 0; i < num_indices; i++) {
+		const Eigen::Vector3d &point =
+				cloud.points_[indices[i]].template cast<double>();
+		cumulants(0) += point(0);
+		cumulants(1) += point(1);
+		cumulants(2) += point(2);
+		cumulants(3) += point(0) * point(0);
+		cumulants(4) += point(0) * point(1);
+		cumulants(5) += point(0) * point(2);
+		cumulants(6) += point(1) * point(1);
+		cumulants(7) += point(1) * point(2);
+		cumulants(8) += point(2) * point(2);
+	}
+	cumulants /= (double)num_indices;
+	return ComputeNormalFromCumulants(cumulants);
+}
+
+/// The queries of a batch refer to the points of a PointCloud; the points of
+/// a PointCloudT are converted to double in \param buffer.
+Eigen::Map<const Eigen::Matrix3Xd> GetQueryBatch(const PointCloud &cloud,
+		size_t begin, int batch_size, std::vector<double> &/*buffer*/)
+{
+	return Eigen::Map<const Eigen::Matrix3Xd>(
+			(const double *)(cloud.points_.data() + begin), 3, batch_size);
+}
+
+template<typename Scalar>
+Eigen::Map<const Eigen::Matrix3Xd> GetQueryBatch(
+		const PointCloudT<Scalar> &cloud, size_t begin, int batch_size,
+		std::vector<double> &buffer)
+{
+	buffer.resize(3 * batch_size);
+	Eigen::Map<Eigen::Matrix3Xd>(buffer.data(), 3, batch_size) =
+			Eigen::Map<const Eigen::Matrix<Scalar, 3, Eigen::Dynamic>>(
+			(const Scalar *)(cloud.points_.data() + begin), 3, batch_size).
+			template cast<double>();
+	return Eigen::Map<const Eigen::Matrix3Xd>(buffer.data(), 3, batch_size);
+}
+
+template<typename PointCloudType>
+bool EstimateNormalsInBatches(PointCloudType &cloud,
+		const KDTreeSearchParam &search_param)
+{
+	typedef typename std::decay<decltype(cloud.normals_[0])>::type
+			NormalType;
+	typedef typename NormalType::Scalar NormalScalar;
+	bool has_normal = cloud.HasNormals();
+	if (cloud.HasNormals() == false) {
+		cloud.normals_.resize(cloud.points_.size());
+	}
+	KDTreeFlann kdtree;
+	kdtree.SetGeometry(cloud);
+	// Neighbors are searched in batches to bound the memory of the neighbor
+	// lists while reusing their buffers across batches.
+	std::vector<int> indices;
+	std::vector<double> distance2;
+	std::vector<size_t> offsets;
+	std::vector<double> query_buffer;
+	for (size_t begin = 0; begin < cloud.points_.size();
+			begin += normal_estimation_batch_size) {
+		int batch_size = (int)std::min(normal_estimation_batch_size,
+				cloud.points_.size() - begin);
+		if (kdtree.SearchBatch(GetQueryBatch(cloud, begin, batch_size,
+				query_buffer), search_param, indices, distance2,
+				offsets) < 0) {
+			PrintDebug("[EstimateNormals] Neighbor search failed.\n");
+			if (has_normal == false) {
+				cloud.normals_.clear();
+			}
+			return false;
+		}
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for (int j = 0; j < batch_size; j++) {
+			size_t i = begin + j;
+			Eigen::Vector3d normal;
+			if (offsets[j + 1] - offsets[j] >= 3) {
+				normal = ComputeNormal(cloud, indices.data() + offsets[j],
+						offsets[j + 1] - offsets[j]);
+				if (normal.norm() == 0.0) {
+					if (has_normal) {
+						normal = cloud.normals_[i].template cast<double>();
+					} else {
+						normal = Eigen::Vector3d(0.0, 0.0, 1.0);
+					}
+				}
+				if (has_normal && normal.dot(
+						cloud.normals_[i].template cast<double>()) < 0.0) {
+					normal *= -1.0;
+				}
+				cloud.normals_[i] = normal.template cast<NormalScalar>();
+			} else {
+				cloud.normals_[i] = NormalType(0.0, 0.0, 1.0);
+			}
+		}
+	}
+
+	return true;
+}
+
 }	// unnamed namespace
 
 bool EstimateNormals(PointCloud &cloud,
 		const KDTreeSearchParam &search_param/* = KDTreeSearchParamKNN()*/)
 {
+	return EstimateNormalsInBatches(cloud, search_param);
+}
+
+template<typename Scalar>
+bool EstimateNormals(PointCloudT<Scalar> &cloud,
+		const KDTreeSearchParam &search_param/* = KDTreeSearchParamKNN()*/)
+{
+	return EstimateNormalsInBatches(cloud, search_param);
+}
+
+template bool EstimateNormals(PointCloudT<float> &cloud,
+		const KDTreeSearchParam &search_param);
+
+bool EstimateNormalsOrganized(PointCloud &cloud, int width, int height,
+		const std::vector<int> &pixel_indices, int window_radius/* = 3*/,
+		double depth_change_factor/* = 0.02*/)
+{
+	if (pixel_indices.size() != cloud.points_.size()) {
+		PrintDebug("[EstimateNormalsOrganized] Number of pixel indices does not match the number of points.\n");
+		return false;
+	}
+	if (width <= 0 || height <= 0 || window_radius < 1) {
+		PrintDebug("[EstimateNormalsOrganized] Illegal image size or window radius.\n");
+		return false;
+	}
+	// Point of each pixel, or -1 for pixels without a point
+	std::vector<int> pixel_points((size_t)width * height, -1);
+	for (size_t i = 0; i < pixel_indices.size(); i++) {
+		int pixel = pixel_indices[i];
+		if (pixel < 0 || (size_t)pixel >= pixel_points.size()) {
+			PrintDebug("[EstimateNormalsOrganized] Pixel index out of range.\n");
+			return false;
+		}
+		if (pixel_points[pixel] >= 0) {
+			PrintDebug("[EstimateNormalsOrganized] Duplicate pixel index.\n");
+			return false;
+		}
+		pixel_points[pixel] = (int)i;
+	}
 	bool has_normal = cloud.HasNormals();
 	if (cloud.HasNormals() == false) {
 		cloud.normals_.resize(cloud.points_.size());
 	}
-	KDTreeFlann kdtree;
-	kdtree.SetGeometry(cloud);
+	if (cloud.points_.empty()) {
+		return true;
+	}
+
+	// A valid pixel is on an edge if a 4-neighbor has no point or a depth
+	// (distance to the origin) that differs by more than depth_change_factor
+	// times the smaller depth. Windows without edge pixels lie on a single
+	// surface and use the integral images; the others are scanned pixel by
+	// pixel.
+	const bool detect_edges = depth_change_factor > 0.0;
+	std::vector<double> depths;
+	if (detect_edges) {
+		depths.resize(cloud.points_.size());
+		for (size_t i = 0; i < cloud.points_.size(); i++) {
+			depths[i] = cloud.points_[i].norm();
+		}
+	}
+	auto IsAcrossEdge = [&](int point, int r, int c) {
+		if (r < 0 || r >= height || c < 0 || c >= width) {
+			return false;
+		}
+		int neighbor = pixel_points[(size_t)r * width + c];
+		return neighbor < 0 || std::abs(depths[point] - depths[neighbor]) >
+				depth_change_factor * std::min(depths[point], depths[neighbor]);
+	};
+
+	// Integral images of the point count, the 9 cumulants and the edge pixel
+	// count, with a leading row and column of zeros. The points are centered
+	// at the first point so that the squares of large coordinates do not
+	// dominate the sums.
+	const int num_channels = 11;
+	const int stride = width + 1;
+	const Eigen::Vector3d center = cloud.points_[0];
+	auto SetCumulants = [&](const Eigen::Vector3d &point, double *cell) {
+		cell[0] = 1.0;
+		cell[1] = point(0);
+		cell[2] = point(1);
+		cell[3] = point(2);
+		cell[4] = point(0) * point(0);
+		cell[5] = point(0) * point(1);
+		cell[6] = point(0) * point(2);
+		cell[7] = point(1) * point(1);
+		cell[8] = point(1) * point(2);
+		cell[9] = point(2) * point(2);
+	};
+	std::vector<double> integral((size_t)stride * (height + 1) *
+			num_channels, 0.0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int i = 0; i < (int)cloud.points_.size(); i++) {
+		int r = pixel_indices[i] / width;
+		int c = pixel_indices[i] % width;
+		double *cell = integral.data() +
+				((size_t)(r + 1) * stride + c + 1) * num_channels;
+		SetCumulants(cloud.points_[i] - center, cell);
+		if (detect_edges && (IsAcrossEdge(i, r - 1, c) ||
+				IsAcrossEdge(i, r + 1, c) || IsAcrossEdge(i, r, c - 1) ||
+				IsAcrossEdge(i, r, c + 1))) {
+			cell[10] = 1.0;
+		}
+	}
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int r = 1; r <= height; r++) {
+		double *row = integral.data() + (size_t)r * stride * num_channels;
+		for (int c = 1; c <= width; c++) {
+			for (int k = 0; k < num_channels; k++) {
+				row[c * num_channels + k] += row[(c - 1) * num_channels + k];
+			}
+		}
+	}
+	// The column sums run along the rows so that each thread reads and writes
+	// contiguous memory.
+	const int row_size = stride * num_channels;
+	for (int r = 2; r <= height; r++) {
+		double *row = integral.data() + (size_t)r * row_size;
+		const double *previous_row = row - row_size;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for (int k = num_channels; k < row_size; k++) {
+			row[k] += previous_row[k];
+		}
+	}
+
+	typedef Eigen::Matrix<double, num_channels, 1> Cell;
+	typedef Eigen::Map<const Cell> ConstCellMap;
 #ifdef _OPENMP
 #pragma omp parallel for schedule(static)
 #endif
 	for (int i = 0; i < (int)cloud.points_.size(); i++) {
-		std::vector<int> indices;
-		std::vector<double> distance2;
+		int r = pixel_indices[i] / width;
+		int c = pixel_indices[i] % width;
+		int r0 = std::max(r - window_radius, 0);
+		int r1 = std::min(r + window_radius, height - 1) + 1;
+		int c0 = std::max(c - window_radius, 0);
+		int c1 = std::min(c + window_radius, width - 1) + 1;
+		auto cell = [&](int row, int col) {
+			return ConstCellMap(integral.data() +
+					((size_t)row * stride + col) * num_channels);
+		};
+		Cell sums = cell(r1, c1) - cell(r0, c1) - cell(r1, c0) + cell(r0, c0);
+		if (sums(10) > 0.0) {
+			// Only the pixels whose depth is within depth_change_factor of
+			// the depth of the point per pixel of distance are on its surface.
+			sums.setZero();
+			Cell point_cell = Cell::Zero();
+			for (int row = r0; row < r1; row++) {
+				for (int col = c0; col < c1; col++) {
+					int neighbor = pixel_points[(size_t)row * width + col];
+					int distance = std::max(std::abs(row - r),
+							std::abs(col - c));
+					if (neighbor >= 0 && std::abs(depths[neighbor] -
+							depths[i]) <= depth_change_factor * depths[i] *
+							distance) {
+						SetCumulants(cloud.points_[neighbor] - center,
+								point_cell.data());
+						sums += point_cell;
+					}
+				}
+			}
+		}
 		Eigen::Vector3d normal;
-		if (kdtree.Search(cloud.points_[i], search_param, indices,
-				distance2) >= 3) {
-			normal = ComputeNormal(cloud, indices);
+		if (sums(0) >= 3.0) {
+			normal = ComputeNormalFromCumulants(sums.segment<9>(1) / sums(0));
 			if (normal.norm() == 0.0) {
 				if (has_normal) {
 					normal = cloud.normals_[i];
@@ -151,7 +407,6 @@ bool EstimateNormals(PointCloud &cloud,
 			cloud.normals_[i] = Eigen::Vector3d(0.0, 0.0, 1.0);
 		}
 	}
-
 	return true;
 }
 
@@ -203,4 +458,186 @@ bool OrientNormalsTowardsCameraLocation(PointCloud &cloud,
 	return true;
 }
 
+bool OrientNormalsConsistentTangentPlane(PointCloud &cloud, int k/* = 10*/)
+{
+	if (cloud.HasNormals() == false) {
+		PrintDebug("[OrientNormalsConsistentTangentPlane] No normals in the PointCloud. Call EstimateNormals() first.\n");
+		return false;
+	}
+	if (k < 1) {
+		PrintDebug("[OrientNormalsConsistentTangentPlane] Illegal input parameters, k must be positive.\n");
+		return false;
+	}
+	size_t num_points = cloud.points_.size();
+	if (num_points < 2) {
+		return true;
+	}
+	int num_neighbors = (int)std::min((size_t)k, num_points - 1);
+	if (num_points * num_neighbors >= (size_t)UINT32_MAX) {
+		PrintDebug("[OrientNormalsConsistentTangentPlane] Too many points.\n");
+		return false;
+	}
+
+	// The k nearest neighbors of every point, excluding the point itself.
+	std::vector<int> neighbors(num_points * num_neighbors);
+	KDTreeFlann kdtree;
+	kdtree.SetGeometry(cloud);
+	std::vector<int> indices;
+	std::vector<double> distance2;
+	std::vector<size_t> offsets;
+	for (size_t begin = 0; begin < num_points;
+			begin += normal_estimation_batch_size) {
+		int batch_size = (int)std::min(normal_estimation_batch_size,
+				num_points - begin);
+		if (kdtree.SearchBatch(Eigen::Map<const Eigen::Matrix3Xd>(
+				(const double *)(cloud.points_.data() + begin), 3,
+				batch_size), KDTreeSearchParamKNN(num_neighbors + 1),
+				indices, distance2, offsets) < 0) {
+			PrintDebug("[OrientNormalsConsistentTangentPlane] Neighbor search failed.\n");
+			return false;
+		}
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for (int j = 0; j < batch_size; j++) {
+			size_t i = begin + j;
+			int *point_neighbors = neighbors.data() + i * num_neighbors;
+			int n = 0;
+			for (size_t m = offsets[j]; m < offsets[j + 1] &&
+					n < num_neighbors; m++) {
+				if (indices[m] != (int)i) {
+					point_neighbors[n++] = indices[m];
+				}
+			}
+			for (; n < num_neighbors; n++) {
+				point_neighbors[n] = (int)i;
+			}
+		}
+	}
+
+	// Each edge of the symmetric neighbor graph is kept once: i -> j is
+	// dropped if j > i and i is also a neighbor of j.
+	std::vector<uint8_t> keep(neighbors.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int i = 0; i < (int)num_points; i++) {
+		for (int n = 0; n < num_neighbors; n++) {
+			size_t e = (size_t)i * num_neighbors + n;
+			int j = neighbors[e];
+			bool duplicate = (j == i);
+			if (j > i) {
+				const int *begin = neighbors.data() + (size_t)j * num_neighbors;
+				duplicate = std::find(begin, begin + num_neighbors, i) !=
+						begin + num_neighbors;
+			}
+			keep[e] = duplicate ? 0 : 1;
+		}
+	}
+	std::vector<size_t> edges = GetNonZeroIndices(keep);
+	std::vector<uint8_t>().swap(keep);
+
+	// Kruskal's algorithm on the edges sorted by 1 - |n_i . n_j|. The
+	// weights are non-negative floats, whose bit patterns sort like integers.
+	std::vector<uint64_t> keys(edges.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int e = 0; e < (int)edges.size(); e++) {
+		size_t i = edges[e] / num_neighbors;
+		size_t j = (size_t)neighbors[edges[e]];
+		float weight = (float)(1.0 - std::abs(
+				cloud.normals_[i].dot(cloud.normals_[j])));
+		weight = std::max(weight, 0.0f);
+		uint32_t bits;
+		std::memcpy(&bits, &weight, sizeof(bits));
+		keys[e] = bits;
+	}
+	std::vector<uint32_t> order;
+	RadixSortKeys(keys, order, 32);
+	std::vector<uint64_t>().swap(keys);
+
+	std::vector<uint32_t> parent(num_points);
+	std::vector<uint32_t> rank(num_points, 0);
+	for (size_t i = 0; i < num_points; i++) {
+		parent[i] = (uint32_t)i;
+	}
+	auto find_root = [&parent](uint32_t i) {
+		while (parent[i] != i) {
+			parent[i] = parent[parent[i]];
+			i = parent[i];
+		}
+		return i;
+	};
+	std::vector<std::pair<uint32_t, uint32_t>> tree_edges;
+	tree_edges.reserve(num_points - 1);
+	for (size_t m = 0; m < order.size() &&
+			tree_edges.size() + 1 < num_points; m++) {
+		size_t e = edges[order[m]];
+		uint32_t i = (uint32_t)(e / num_neighbors);
+		uint32_t j = (uint32_t)neighbors[e];
+		uint32_t root_i = find_root(i);
+		uint32_t root_j = find_root(j);
+		if (root_i == root_j) {
+			continue;
+		}
+		if (rank[root_i] < rank[root_j]) {
+			std::swap(root_i, root_j);
+		}
+		parent[root_j] = root_i;
+		if (rank[root_i] == rank[root_j]) {
+			rank[root_i]++;
+		}
+		tree_edges.push_back(std::make_pair(i, j));
+	}
+	std::vector<size_t>().swap(edges);
+	std::vector<uint32_t>().swap(order);
+	std::vector<int>().swap(neighbors);
+
+	// Adjacency lists of the spanning forest, then a breadth first traversal
+	// from the first point of each tree flips every normal that disagrees
+	// with the normal of its parent.
+	std::vector<uint32_t> adjacency_offsets(num_points + 1, 0);
+	for (const auto &edge : tree_edges) {
+		adjacency_offsets[edge.first + 1]++;
+		adjacency_offsets[edge.second + 1]++;
+	}
+	for (size_t i = 0; i < num_points; i++) {
+		adjacency_offsets[i + 1] += adjacency_offsets[i];
+	}
+	std::vector<uint32_t> adjacency(adjacency_offsets[num_points]);
+	std::vector<uint32_t> fill(adjacency_offsets.begin(),
+			adjacency_offsets.end() - 1);
+	for (const auto &edge : tree_edges) {
+		adjacency[fill[edge.first]++] = edge.second;
+		adjacency[fill[edge.second]++] = edge.first;
+	}
+	std::vector<uint8_t> visited(num_points, 0);
+	std::vector<uint32_t> queue;
+	queue.reserve(num_points);
+	for (size_t root = 0; root < num_points; root++) {
+		if (visited[root]) {
+			continue;
+		}
+		visited[root] = 1;
+		queue.push_back((uint32_t)root);
+		for (size_t q = queue.size() - 1; q < queue.size(); q++) {
+			uint32_t i = queue[q];
+			for (uint32_t a = adjacency_offsets[i];
+					a < adjacency_offsets[i + 1]; a++) {
+				uint32_t j = adjacency[a];
+				if (visited[j]) {
+					continue;
+				}
+				visited[j] = 1;
+				if (cloud.normals_[i].dot(cloud.normals_[j]) < 0.0) {
+					cloud.normals_[j] *= -1.0;
+				}
+				queue.push_back(j);
+			}
+		}
+	}
+	return true;
+}
+
 }	// namespace three
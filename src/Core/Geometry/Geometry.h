@@ -37,6 +37,8 @@ public:
 		GEOMETRY_LINESET = 2,
 		GEOMETRY_TRIANGLEMESH = 3,
 		GEOMETRY_IMAGE = 4,
+		GEOMETRY_POINTCLOUDF = 5,
+		GEOMETRY_OCTREE = 6,
 	};
 
 public:
@@ -0,0 +1,121 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+
+#include "Geometry3D.h"
+
+namespace three {
+
+template<typename Scalar>
+void Geometry3D::ComputeBounds(const Eigen::Matrix<Scalar, 3, 1> *points,
+		size_t num_points, Eigen::Vector3d &min_bound,
+		Eigen::Vector3d &max_bound)
+{
+	typedef Eigen::Matrix<Scalar, 3, 1> Vector3;
+	if (num_points == 0) {
+		min_bound.setZero();
+		max_bound.setZero();
+		return;
+	}
+	Vector3 global_min = points[0];
+	Vector3 global_max = points[0];
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+	{
+		Vector3 local_min = points[0];
+		Vector3 local_max = points[0];
+#ifdef _OPENMP
+#pragma omp for nowait schedule(static)
+#endif
+		for (int i = 0; i < (int)num_points; i++) {
+			local_min = local_min.cwiseMin(points[i]);
+			local_max = local_max.cwiseMax(points[i]);
+		}
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+		{
+			global_min = global_min.cwiseMin(local_min);
+			global_max = global_max.cwiseMax(local_max);
+		}
+	}
+	min_bound = global_min.template cast<double>();
+	max_bound = global_max.template cast<double>();
+}
+
+template<typename Scalar>
+void Geometry3D::TransformPoints(const Eigen::Matrix4d &transformation,
+		Eigen::Matrix<Scalar, 3, 1> *points, size_t num_points)
+{
+	// Only the first three rows of the homogeneous product are kept, so the
+	// 4x4 product reduces to a 3x3 product and a translation.
+	const Eigen::Matrix<Scalar, 3, 3> rotation =
+			transformation.block<3, 3>(0, 0).cast<Scalar>();
+	const Eigen::Matrix<Scalar, 3, 1> translation =
+			transformation.block<3, 1>(0, 3).cast<Scalar>();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int i = 0; i < (int)num_points; i++) {
+		points[i] = rotation * points[i] + translation;
+	}
+}
+
+template<typename Scalar>
+void Geometry3D::TransformNormals(const Eigen::Matrix4d &transformation,
+		Eigen::Matrix<Scalar, 3, 1> *normals, size_t num_normals)
+{
+	const Eigen::Matrix<Scalar, 3, 3> rotation =
+			transformation.block<3, 3>(0, 0).cast<Scalar>();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int i = 0; i < (int)num_normals; i++) {
+		normals[i] = rotation * normals[i];
+	}
+}
+
+template void Geometry3D::ComputeBounds(const Eigen::Vector3d *points,
+		size_t num_points, Eigen::Vector3d &min_bound,
+		Eigen::Vector3d &max_bound);
+template void Geometry3D::ComputeBounds(const Eigen::Vector3f *points,
+		size_t num_points, Eigen::Vector3d &min_bound,
+		Eigen::Vector3d &max_bound);
+template void Geometry3D::TransformPoints(
+		const Eigen::Matrix4d &transformation, Eigen::Vector3d *points,
+		size_t num_points);
+template void Geometry3D::TransformPoints(
+		const Eigen::Matrix4d &transformation, Eigen::Vector3f *points,
+		size_t num_points);
+template void Geometry3D::TransformNormals(
+		const Eigen::Matrix4d &transformation, Eigen::Vector3d *normals,
+		size_t num_normals);
+template void Geometry3D::TransformNormals(
+		const Eigen::Matrix4d &transformation, Eigen::Vector3f *normals,
+		size_t num_normals);
+
+}	// namespace three
@@ -26,6 +26,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <Eigen/Core>
 #include <Core/Geometry/Geometry.h>
 
@@ -45,6 +46,24 @@ public:
 	virtual Eigen::Vector3d GetMinBound() const = 0;
 	virtual Eigen::Vector3d GetMaxBound() const = 0;
 	virtual void Transform(const Eigen::Matrix4d &transformation) = 0;
+
+	/// Computes the bounds of \param num_points points in a single parallel
+	/// pass. An empty range yields zero bounds.
+	template<typename Scalar>
+	static void ComputeBounds(const Eigen::Matrix<Scalar, 3, 1> *points,
+			size_t num_points, Eigen::Vector3d &min_bound,
+			Eigen::Vector3d &max_bound);
+
+protected:
+
+	/// Applies the rigid part of \param transformation (R * p + t) to points
+	/// and the rotation alone to normals, in parallel.
+	template<typename Scalar>
+	static void TransformPoints(const Eigen::Matrix4d &transformation,
+			Eigen::Matrix<Scalar, 3, 1> *points, size_t num_points);
+	template<typename Scalar>
+	static void TransformNormals(const Eigen::Matrix4d &transformation,
+			Eigen::Matrix<Scalar, 3, 1> *normals, size_t num_normals);
 };
 
 }	// namespace three
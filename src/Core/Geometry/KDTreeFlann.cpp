@@ -24,6 +24,7 @@
 // IN THE SOFTWARE.
 // ----------------------------------------------------------------------------
 
+
 #ifdef _MSC_VER
 #pragma warning(push)
 #pragma warning(disable: 4267)
@@ -31,28 +32,419 @@
 
 #include "KDTreeFlann.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include <list>
+#include <mutex>
+#include <cstring>
+#include <limits>
 #include <flann/flann.hpp>
+#include <Core/Geometry/BruteForceIndex.h>
+#include <Core/Geometry/KDTreeNative.h>
+#include <Core/Geometry/NeighborSearchBatch.h>
 #include <Core/Geometry/PointCloud.h>
+#include <Core/Geometry/PointCloudT.h>
 #include <Core/Geometry/TriangleMesh.h>
 #include <Core/Utility/Console.h>
+#include <Core/Utility/MappedFile.h>
 
 namespace three{
 
-KDTreeFlann::KDTreeFlann()
+namespace {
+
+KDTreeFlann::Precision global_default_precision = KDTreeFlann::PRECISION_DOUBLE;
+
+class KDTreeFlannCacheEntry
+{
+public:
+	const Geometry *geometry_;
+	const double *points_;
+	std::shared_ptr<const KDTreeFlann> kdtree_;
+};
+
+/// Header of the files written by KDTreeFlann::Save(): signature, version,
+/// dimension, dataset size, content, index type, data fingerprint and number
+/// of removed points of a flann index.
+const uint64_t kdtree_file_signature = 0x4545525444443345ULL;	// "E3DDTREE"
+const uint64_t kdtree_file_version = 1;
+const int kdtree_file_header_size = 8;
+
+enum KDTreeFileContent {
+	KDTREE_FILE_NATIVE_DOUBLE = 0,
+	KDTREE_FILE_NATIVE_FLOAT = 1,
+	KDTREE_FILE_FLANN_DOUBLE = 2,
+	KDTREE_FILE_FLANN_FLOAT = 3,
+	KDTREE_FILE_BRUTE_FORCE_DOUBLE = 4,
+	KDTREE_FILE_BRUTE_FORCE_FLOAT = 5,
+};
+
+std::list<KDTreeFlannCacheEntry> global_kdtree_cache;
+size_t global_kdtree_cache_capacity = 16;
+std::mutex global_kdtree_cache_mutex;
+
+bool GetGeometryPoints(const Geometry &geometry, const double *&points,
+		size_t &num_points)
+{
+	switch (geometry.GetGeometryType()) {
+	case Geometry::GEOMETRY_POINTCLOUD:
+		points = (const double *)((const PointCloud &)geometry).points_.data();
+		num_points = ((const PointCloud &)geometry).points_.size();
+		return true;
+	case Geometry::GEOMETRY_TRIANGLEMESH:
+		points = (const double *)((const TriangleMesh &)geometry).vertices_.
+				data();
+		num_points = ((const TriangleMesh &)geometry).vertices_.size();
+		return true;
+	case Geometry::GEOMETRY_IMAGE:
+	case Geometry::GEOMETRY_UNSPECIFIED:
+	default:
+		return false;
+	}
+}
+
+size_t GetBruteForceThreshold(size_t dimension)
+{
+	if (dimension == 3) {
+		return KDTreeFlann::BRUTE_FORCE_THRESHOLD_3D;
+	}
+	return KDTreeFlann::BRUTE_FORCE_THRESHOLD;
+}
+
+/// Fingerprints of buffers of doubles are used to detect whether the data an
+/// index was built on has been modified. The buffer is hashed in fixed-size
+/// blocks and the block hashes are chained in order, so the result does not
+/// depend on the thread count. The chain over the complete blocks is kept
+/// with the index, so that appending data only hashes the new blocks.
+const size_t fingerprint_block_size = 65536;
+
+uint64_t HashFingerprintBlock(const double *data, size_t size)
 {
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < size; i++) {
+		uint64_t word;
+		memcpy(&word, data + i, sizeof(word));
+		hash = (hash ^ word) * 1099511628211ULL;
+	}
+	return hash;
 }
 
-KDTreeFlann::KDTreeFlann(const Eigen::MatrixXd &data)
+uint64_t ChainFingerprint(uint64_t state, uint64_t hash)
+{
+	return state ^ (hash + 0x9e3779b97f4a7c15ULL + (state << 6) +
+			(state >> 2));
+}
+
+/// Function to chain the complete blocks of the first \param size values of
+/// \param data that follow the first \param num_blocks blocks into
+/// \param state. \param num_blocks is advanced past them.
+void ChainFingerprintBlocks(const double *data, size_t size,
+		size_t &num_blocks, uint64_t &state)
+{
+	size_t end_block = size / fingerprint_block_size;
+	if (end_block <= num_blocks) {
+		return;
+	}
+	std::vector<uint64_t> block_hashes(end_block - num_blocks);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int b = 0; b < (int)block_hashes.size(); b++) {
+		block_hashes[b] = HashFingerprintBlock(data + (num_blocks + b) *
+				fingerprint_block_size, fingerprint_block_size);
+	}
+	for (uint64_t hash : block_hashes) {
+		state = ChainFingerprint(state, hash);
+	}
+	num_blocks = end_block;
+}
+
+/// Function to finish the fingerprint of the first \param size values of
+/// \param data from the chain of its first \param num_blocks blocks
+uint64_t FinishFingerprint(const double *data, size_t size,
+		size_t num_blocks, uint64_t state)
+{
+	size_t begin = num_blocks * fingerprint_block_size;
+	return ChainFingerprint(ChainFingerprint(state, HashFingerprintBlock(
+			data + begin, size - begin)), (uint64_t)size);
+}
+
+uint64_t ComputeDataFingerprint(const double *data, size_t size)
+{
+	size_t num_blocks = 0;
+	uint64_t state = 0;
+	ChainFingerprintBlocks(data, size, num_blocks, state);
+	return FinishFingerprint(data, size, num_blocks, state);
+}
+
+/// Function to return a query given in double precision for an index of
+/// either precision. It is converted into \param query_buffer if the index is
+/// built on floats.
+template<typename Scalar>
+const Scalar *ConvertQuery(const double *query, size_t dimension,
+		std::vector<Scalar> &query_buffer);
+
+template<>
+const double *ConvertQuery<double>(const double *query,
+		size_t /*dimension*/, std::vector<double> & /*query_buffer*/)
+{
+	return query;
+}
+
+template<>
+const float *ConvertQuery<float>(const double *query, size_t dimension,
+		std::vector<float> &query_buffer)
+{
+	query_buffer.resize(dimension);
+	for (size_t i = 0; i < dimension; i++) {
+		query_buffer[i] = (float)query[i];
+	}
+	return query_buffer.data();
+}
+
+/// Buffers of the helpers below that run a single flann query on an index of
+/// either precision. A double precision index reads the query and writes the
+/// distances in place. A float index converts them through buffers kept per
+/// thread, so that repeated searches do not allocate.
+template<typename Scalar>
+struct FlannQueryBuffer;
+
+template<>
+struct FlannQueryBuffer<double>
+{
+	static double *GetQuery(const double *query, size_t /*dimension*/) {
+		return (double *)query;
+	}
+	static double *GetDistances(std::vector<double> &distance2, size_t size) {
+		distance2.resize(size);
+		return distance2.data();
+	}
+	static void SetDistances(const double * /*dists*/, size_t k,
+			std::vector<double> &distance2) {
+		distance2.resize(k);
+	}
+};
+
+template<>
+struct FlannQueryBuffer<float>
+{
+	static float *GetQuery(const double *query, size_t dimension) {
+		static thread_local std::vector<float> query_buffer;
+		query_buffer.resize(dimension);
+		for (size_t i = 0; i < dimension; i++) {
+			query_buffer[i] = (float)query[i];
+		}
+		return query_buffer.data();
+	}
+	static float *GetDistances(std::vector<double> & /*distance2*/,
+			size_t size) {
+		static thread_local std::vector<float> dists_buffer;
+		dists_buffer.resize(size);
+		return dists_buffer.data();
+	}
+	static void SetDistances(const float *dists, size_t k,
+			std::vector<double> &distance2) {
+		distance2.assign(dists, dists + k);
+	}
+};
+
+template<typename Scalar>
+int FlannSearchKNN(flann::Index<flann::L2<Scalar>> &index,
+		const double *query, size_t dimension, int knn, int checks,
+		std::vector<int> &indices, std::vector<double> &distance2)
+{
+	typedef FlannQueryBuffer<Scalar> Buffer;
+	flann::Matrix<Scalar> query_flann(Buffer::GetQuery(query, dimension), 1,
+			dimension);
+	indices.resize(knn);
+	Scalar *dists = Buffer::GetDistances(distance2, knn);
+	flann::Matrix<int> indices_flann(indices.data(), query_flann.rows, knn);
+	flann::Matrix<Scalar> dists_flann(dists, query_flann.rows, knn);
+	int k = index.knnSearch(query_flann, indices_flann, dists_flann, knn,
+			flann::SearchParams(checks, 0.0));
+	indices.resize(k);
+	Buffer::SetDistances(dists, k, distance2);
+	return k;
+}
+
+template<typename Scalar>
+int FlannSearchRadius(flann::Index<flann::L2<Scalar>> &index,
+		const double *query, size_t dimension, double radius, int checks,
+		std::vector<int> &indices, std::vector<double> &distance2)
+{
+	flann::Matrix<Scalar> query_flann(FlannQueryBuffer<Scalar>::GetQuery(
+			query, dimension), 1, dimension);
+	flann::SearchParams param(checks, 0.0);
+	param.max_neighbors = -1;
+	std::vector<std::vector<int>> indices_vec(1);
+	std::vector<std::vector<Scalar>> dists_vec(1);
+	int k = index.radiusSearch(query_flann, indices_vec, dists_vec,
+			float(radius * radius), param);
+	indices = indices_vec[0];
+	distance2.assign(dists_vec[0].begin(), dists_vec[0].end());
+	return k;
+}
+
+template<typename Scalar>
+int FlannSearchHybrid(flann::Index<flann::L2<Scalar>> &index,
+		const double *query, size_t dimension, double radius, int max_nn,
+		int checks, std::vector<int> &indices, std::vector<double> &distance2)
+{
+	typedef FlannQueryBuffer<Scalar> Buffer;
+	flann::Matrix<Scalar> query_flann(Buffer::GetQuery(query, dimension), 1,
+			dimension);
+	flann::SearchParams param(checks, 0.0);
+	param.max_neighbors = max_nn;
+	indices.resize(max_nn);
+	Scalar *dists = Buffer::GetDistances(distance2, max_nn);
+	flann::Matrix<int> indices_flann(indices.data(), query_flann.rows, max_nn);
+	flann::Matrix<Scalar> dists_flann(dists, query_flann.rows, max_nn);
+	int k = index.radiusSearch(query_flann, indices_flann, dists_flann,
+			float(radius * radius), param);
+	indices.resize(k);
+	Buffer::SetDistances(dists, k, distance2);
+	return k;
+}
+
+/// Function to write the points of a flann index in index order: the points
+/// it was built on, followed by the ones added since.
+template<typename Scalar>
+bool WriteFlannData(FILE *file, size_t &offset,
+		const flann::Matrix<Scalar> &dataset,
+		const std::vector<std::vector<Scalar>> &data_added)
+{
+	if (WriteMappedFileBlock(file, offset, dataset.ptr(), dataset.rows *
+			dataset.cols * sizeof(Scalar)) == false) {
+		return false;
+	}
+	for (const auto &added : data_added) {
+		if (fwrite(added.data(), sizeof(Scalar), added.size(), file) <
+				added.size()) {
+			return false;
+		}
+		offset += added.size() * sizeof(Scalar);
+	}
+	return true;
+}
+
+flann::IndexParams GetFlannIndexParams(KDTreeFlann::IndexType index_type)
+{
+	switch (index_type) {
+	case KDTreeFlann::INDEX_KDTREE_RANDOMIZED:
+		return flann::KDTreeIndexParams(4);
+	case KDTreeFlann::INDEX_KMEANS_HIERARCHICAL:
+		return flann::KMeansIndexParams(32, 11);
+	case KDTreeFlann::INDEX_KDTREE_SINGLE:
+	default:
+		return flann::KDTreeSingleIndexParams(15);
+	}
+}
+
+/// Searcher running the queries of a batch on a flann index. Every thread
+/// uses its own copy. flann's std::vector<size_t> interface is used because
+/// it resizes the per-query result vectors in place and thus allocates only
+/// during warm-up.
+template<typename Scalar>
+class FlannBatchSearcher
+{
+public:
+	FlannBatchSearcher(flann::Index<flann::L2<Scalar>> &index,
+			KDTreeSearchParam::SearchType search_type, int knn,
+			double radius, int checks) : index_(index),
+			search_type_(search_type), knn_(knn),
+			radius2_(float(radius * radius)), param_(checks, 0.0),
+			indices_vec_(1), dists_vec_(1) {
+		param_.max_neighbors = knn;
+	}
+
+public:
+	void Search(const double *query, size_t dimension,
+			std::vector<int> &indices, std::vector<double> &distance2) {
+		flann::Matrix<Scalar> query_flann((Scalar *)ConvertQuery(query,
+				dimension, query_buffer_), 1, dimension);
+		if (knn_ == 0) {
+			return;
+		} else if (search_type_ == KDTreeSearchParam::SEARCH_KNN) {
+			index_.knnSearch(query_flann, indices_vec_, dists_vec_, knn_,
+					param_);
+		} else {
+			index_.radiusSearch(query_flann, indices_vec_, dists_vec_,
+					radius2_, param_);
+		}
+		indices.insert(indices.end(), indices_vec_[0].begin(),
+				indices_vec_[0].end());
+		distance2.insert(distance2.end(), dists_vec_[0].begin(),
+				dists_vec_[0].end());
+	}
+
+private:
+	flann::Index<flann::L2<Scalar>> &index_;
+	KDTreeSearchParam::SearchType search_type_;
+	int knn_;
+	float radius2_;
+	flann::SearchParams param_;
+	std::vector<std::vector<size_t>> indices_vec_;
+	std::vector<std::vector<Scalar>> dists_vec_;
+	std::vector<Scalar> query_buffer_;
+};
+
+/// Searcher running the queries of a batch on a KDTreeNative or a
+/// BruteForceIndex
+template<typename Index>
+class NativeBatchSearcher
+{
+public:
+	NativeBatchSearcher(const Index &index,
+			KDTreeSearchParam::SearchType search_type, int knn,
+			double radius) : index_(index), search_type_(search_type),
+			knn_(knn), radius_(radius) {}
+
+public:
+	void Search(const double *query, size_t /*dimension*/,
+			std::vector<int> &indices, std::vector<double> &distance2) {
+		if (knn_ == 0) {
+			return;
+		} else if (search_type_ == KDTreeSearchParam::SEARCH_KNN) {
+			index_.SearchKNN(query, knn_, indices_, distance2_);
+		} else if (search_type_ == KDTreeSearchParam::SEARCH_RADIUS) {
+			index_.SearchRadius(query, radius_, indices_, distance2_);
+		} else {
+			index_.SearchHybrid(query, radius_, knn_, indices_, distance2_);
+		}
+		indices.insert(indices.end(), indices_.begin(), indices_.end());
+		distance2.insert(distance2.end(), distance2_.begin(),
+				distance2_.end());
+	}
+
+private:
+	const Index &index_;
+	KDTreeSearchParam::SearchType search_type_;
+	int knn_;
+	double radius_;
+	std::vector<int> indices_;
+	std::vector<double> distance2_;
+};
+
+}	// unnamed namespace
+
+KDTreeFlann::KDTreeFlann() : precision_(global_default_precision)
+{
+}
+
+KDTreeFlann::KDTreeFlann(const Eigen::MatrixXd &data) :
+		precision_(global_default_precision)
 {
 	SetMatrixData(data);
 }
 
-KDTreeFlann::KDTreeFlann(const Geometry &geometry)
+KDTreeFlann::KDTreeFlann(const Geometry &geometry) :
+		precision_(global_default_precision)
 {
 	SetGeometry(geometry);
 }
 
-KDTreeFlann::KDTreeFlann(const Feature &feature)
+KDTreeFlann::KDTreeFlann(const Feature &feature) :
+		precision_(global_default_precision)
 {
 	SetFeature(feature);
 }
@@ -61,29 +453,292 @@ KDTreeFlann::~KDTreeFlann()
 {
 }
 
+void KDTreeFlann::SetDefaultPrecision(Precision precision)
+{
+	global_default_precision = precision;
+}
+
+KDTreeFlann::Precision KDTreeFlann::GetDefaultPrecision()
+{
+	return global_default_precision;
+}
+
 bool KDTreeFlann::SetMatrixData(const Eigen::MatrixXd &data)
 {
 	return SetRawData(Eigen::Map<const Eigen::MatrixXd>(
-			data.data(), data.rows(), data.cols()));
+			data.data(), data.rows(), data.cols()), true);
 }
 
-bool KDTreeFlann::SetGeometry(const Geometry &geometry)
+bool KDTreeFlann::SetGeometry(const Geometry &geometry,
+		bool copy_data/* = true*/)
 {
-	switch (geometry.GetGeometryType()) {
-	case Geometry::GEOMETRY_POINTCLOUD:
-		return SetRawData(Eigen::Map<const Eigen::MatrixXd>(
-				(const double *)((const PointCloud &)geometry).points_.data(),
-				3, ((const PointCloud &)geometry).points_.size()));
-	case Geometry::GEOMETRY_TRIANGLEMESH:
-		return SetRawData(Eigen::Map<const Eigen::MatrixXd>(
-				(const double *)((const TriangleMesh &)geometry).vertices_.
-				data(), 3, ((const TriangleMesh &)geometry).vertices_.size()));
-	case Geometry::GEOMETRY_IMAGE:
-	case Geometry::GEOMETRY_UNSPECIFIED:
-	default:
+	if (geometry.GetGeometryType() == Geometry::GEOMETRY_POINTCLOUDF) {
+		// Single precision points are converted, the index keeps the copy.
+		const auto &cloud = (const PointCloudf &)geometry;
+		Eigen::Matrix3Xd points = Eigen::Map<const Eigen::Matrix3Xf>(
+				(const float *)cloud.points_.data(), 3,
+				cloud.points_.size()).cast<double>();
+		return SetRawData(Eigen::Map<const Eigen::MatrixXd>(points.data(), 3,
+				points.cols()), true);
+	}
+	const double *points;
+	size_t num_points;
+	if (GetGeometryPoints(geometry, points, num_points) == false) {
 		PrintDebug("[KDTreeFlann::SetGeometry] Unsupported Geometry type.\n");
 		return false;
 	}
+	return SetRawData(Eigen::Map<const Eigen::MatrixXd>(points, 3,
+			num_points), copy_data);
+}
+
+bool KDTreeFlann::AddPoints(const Eigen::MatrixXd &data)
+{
+	return AddRawData(Eigen::Map<const Eigen::MatrixXd>(data.data(),
+			data.rows(), data.cols()));
+}
+
+bool KDTreeFlann::AddPoints(const Geometry &geometry)
+{
+	const double *points;
+	size_t num_points;
+	if (GetGeometryPoints(geometry, points, num_points) == false) {
+		PrintDebug("[KDTreeFlann::AddPoints] Unsupported Geometry type.\n");
+		return false;
+	}
+	if (num_points < dataset_size_) {
+		PrintDebug("[KDTreeFlann::AddPoints] Geometry has fewer points than the index.\n");
+		return false;
+	}
+	if (data_pointer_ != nullptr) {
+		// The index refers to the buffer it was built on, which appending to
+		// the geometry usually frees. The existing points are copied from the
+		// current buffer, so it must still hold them unchanged. This is only
+		// checked on the first update, which copies them anyway.
+		if (ComputeDataFingerprint(points, 3 * dataset_size_) !=
+				data_fingerprint_) {
+			PrintDebug("[KDTreeFlann::AddPoints] Indexed points have been modified.\n");
+			return false;
+		}
+		if (native_index_) {
+			native_index_->SetExternalData(points);
+		}
+		data_pointer_ = points;
+	}
+	if (AddRawData(Eigen::Map<const Eigen::MatrixXd>(points +
+			3 * dataset_size_, 3, num_points - dataset_size_)) == false) {
+		return false;
+	}
+	// Only the blocks of the appended points are hashed.
+	ChainFingerprintBlocks(points, 3 * num_points, fingerprint_num_blocks_,
+			fingerprint_state_);
+	data_fingerprint_ = FinishFingerprint(points, 3 * num_points,
+			fingerprint_num_blocks_, fingerprint_state_);
+	return true;
+}
+
+bool KDTreeFlann::RemovePoints(const std::vector<int> &indices)
+{
+	if (!HasIndex()) {
+		PrintDebug("[KDTreeFlann::RemovePoints] No index.\n");
+		return false;
+	}
+	for (int index : indices) {
+		if (index < 0 || (size_t)index >= dataset_size_) {
+			PrintDebug("[KDTreeFlann::RemovePoints] Index out of range.\n");
+			return false;
+		}
+	}
+	if (brute_force_index_) {
+		return brute_force_index_->RemovePoints(indices.data(),
+				indices.size());
+	}
+	if (brute_force_index_float_) {
+		return brute_force_index_float_->RemovePoints(indices.data(),
+				indices.size());
+	}
+	if (native_index_) {
+		return native_index_->RemovePoints(indices.data(), indices.size());
+	}
+	if (native_index_float_) {
+		return native_index_float_->RemovePoints(indices.data(),
+				indices.size());
+	}
+	flann_removed_indices_.insert(flann_removed_indices_.end(),
+			indices.begin(), indices.end());
+	for (int index : indices) {
+		if (flann_index_float_) {
+			flann_index_float_->removePoint((size_t)index);
+		} else {
+			flann_index_->removePoint((size_t)index);
+		}
+	}
+	return true;
+}
+
+bool KDTreeFlann::Save(const std::string &filename) const
+{
+	if (!HasIndex()) {
+		PrintDebug("[KDTreeFlann::Save] No index.\n");
+		return false;
+	}
+	FILE *file = fopen(filename.c_str(), "wb");
+	if (file == NULL) {
+		PrintDebug("[KDTreeFlann::Save] Unable to open file %s.\n",
+				filename.c_str());
+		return false;
+	}
+	uint64_t content = brute_force_index_ ? KDTREE_FILE_BRUTE_FORCE_DOUBLE :
+			brute_force_index_float_ ? KDTREE_FILE_BRUTE_FORCE_FLOAT :
+			native_index_ ? KDTREE_FILE_NATIVE_DOUBLE :
+			native_index_float_ ? KDTREE_FILE_NATIVE_FLOAT :
+			flann_index_float_ ? KDTREE_FILE_FLANN_FLOAT :
+			KDTREE_FILE_FLANN_DOUBLE;
+	uint64_t header[kdtree_file_header_size] = {kdtree_file_signature,
+			kdtree_file_version, dimension_, dataset_size_, content,
+			(uint64_t)index_type_, data_fingerprint_,
+			flann_removed_indices_.size()};
+	size_t offset = 0;
+	bool success = WriteMappedFileBlock(file, offset, header, sizeof(header));
+	if (brute_force_index_) {
+		success = success && brute_force_index_->Write(file, offset);
+	} else if (brute_force_index_float_) {
+		success = success && brute_force_index_float_->Write(file, offset);
+	} else if (native_index_) {
+		success = success && native_index_->Write(file, offset);
+	} else if (native_index_float_) {
+		success = success && native_index_float_->Write(file, offset);
+	} else if (flann_index_float_) {
+		success = success && WriteFlannData(file, offset,
+				*flann_dataset_float_, data_float_added_);
+	} else {
+		success = success && WriteFlannData(file, offset, *flann_dataset_,
+				data_added_);
+	}
+	success = success && WriteMappedFileBlock(file, offset,
+			flann_removed_indices_.data(),
+			flann_removed_indices_.size() * sizeof(int));
+	if (fclose(file) != 0 || success == false) {
+		PrintDebug("[KDTreeFlann::Save] Failed to write file %s.\n",
+				filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool KDTreeFlann::Load(const std::string &filename)
+{
+	ClearIndex();
+	std::unique_ptr<MappedFile> mapped_file(new MappedFile);
+	if (mapped_file->Open(filename) == false) {
+		PrintDebug("[KDTreeFlann::Load] Unable to open file %s.\n",
+				filename.c_str());
+		return false;
+	}
+	const char *file_data = mapped_file->GetData();
+	size_t file_size = mapped_file->GetSize();
+	size_t offset = 0;
+	uint64_t header[kdtree_file_header_size];
+	const char *header_data = ReadMappedFileBlock(file_data, file_size,
+			offset, sizeof(header));
+	if (header_data != nullptr) {
+		memcpy(header, header_data, sizeof(header));
+	}
+	if (header_data == nullptr || header[0] != kdtree_file_signature ||
+			header[1] != kdtree_file_version || header[2] == 0 ||
+			header[3] == 0 || header[3] >
+			(uint64_t)std::numeric_limits<int>::max() ||
+			header[4] > KDTREE_FILE_BRUTE_FORCE_FLOAT ||
+			header[5] > INDEX_KMEANS_HIERARCHICAL || (header[4] <
+			KDTREE_FILE_FLANN_DOUBLE && header[2] != 3)) {
+		PrintDebug("[KDTreeFlann::Load] Invalid file %s.\n",
+				filename.c_str());
+		return false;
+	}
+	dimension_ = (size_t)header[2];
+	dataset_size_ = (size_t)header[3];
+	index_type_ = (IndexType)header[5];
+	// The chain of block hashes is not saved; the first AddPoints() hashes
+	// all points again.
+	data_fingerprint_ = header[6];
+	precision_ = (header[4] == KDTREE_FILE_NATIVE_FLOAT ||
+			header[4] == KDTREE_FILE_FLANN_FLOAT ||
+			header[4] == KDTREE_FILE_BRUTE_FORCE_FLOAT) ? PRECISION_FLOAT :
+			PRECISION_DOUBLE;
+	bool success = false;
+	if (header[4] == KDTREE_FILE_BRUTE_FORCE_DOUBLE) {
+		brute_force_index_.reset(new BruteForceIndex<double>);
+		success = brute_force_index_->Read(file_data, file_size, offset) &&
+				brute_force_index_->Size() == dataset_size_ &&
+				brute_force_index_->GetDimension() == dimension_;
+	} else if (header[4] == KDTREE_FILE_BRUTE_FORCE_FLOAT) {
+		brute_force_index_float_.reset(new BruteForceIndex<float>);
+		success = brute_force_index_float_->Read(file_data, file_size,
+				offset) && brute_force_index_float_->Size() == dataset_size_ &&
+				brute_force_index_float_->GetDimension() == dimension_;
+	} else if (header[4] == KDTREE_FILE_NATIVE_DOUBLE) {
+		native_index_.reset(new KDTreeNative<3, double>);
+		success = native_index_->Read(file_data, file_size, offset) &&
+				native_index_->Size() == dataset_size_;
+	} else if (header[4] == KDTREE_FILE_NATIVE_FLOAT) {
+		native_index_float_.reset(new KDTreeNative<3, float>);
+		success = native_index_float_->Read(file_data, file_size, offset) &&
+				native_index_float_->Size() == dataset_size_;
+	} else {
+		// flann indices cannot be used in place; they are rebuilt on the
+		// mapped points.
+		size_t scalar_size = precision_ == PRECISION_FLOAT ? sizeof(float) :
+				sizeof(double);
+		const char *data = dimension_ > file_size ? nullptr :
+				ReadMappedFileArray(file_data, file_size, offset,
+				dataset_size_, dimension_ * scalar_size);
+		if (data != nullptr && precision_ == PRECISION_FLOAT) {
+			flann_dataset_float_.reset(new flann::Matrix<float>((float *)data,
+					dataset_size_, dimension_));
+			flann_index_float_.reset(new flann::Index<flann::L2<float>>(
+					*flann_dataset_float_, GetFlannIndexParams(index_type_)));
+			flann_index_float_->buildIndex();
+			success = true;
+		} else if (data != nullptr) {
+			flann_dataset_.reset(new flann::Matrix<double>((double *)data,
+					dataset_size_, dimension_));
+			flann_index_.reset(new flann::Index<flann::L2<double>>(
+					*flann_dataset_, GetFlannIndexParams(index_type_)));
+			flann_index_->buildIndex();
+			success = true;
+		}
+	}
+	const char *removed = ReadMappedFileArray(file_data, file_size, offset,
+			header[7], sizeof(int));
+	if (success == false || removed == nullptr) {
+		ClearIndex();
+		PrintDebug("[KDTreeFlann::Load] Invalid file %s.\n",
+				filename.c_str());
+		return false;
+	}
+	mapped_file_ = std::move(mapped_file);
+	if (header[7] > 0) {
+		std::vector<int> removed_indices((size_t)header[7]);
+		memcpy(removed_indices.data(), removed,
+				removed_indices.size() * sizeof(int));
+		RemovePoints(removed_indices);
+	}
+	return true;
+}
+
+bool KDTreeFlann::IsUpToDate(const Geometry &geometry) const
+{
+	const double *points;
+	size_t num_points;
+	if (!HasIndex() || GetGeometryPoints(geometry, points, num_points) ==
+			false || dimension_ != 3 || dataset_size_ != num_points) {
+		return false;
+	}
+	if (data_pointer_ != nullptr && data_pointer_ != points) {
+		// A reference index is only valid on the buffer it was built on.
+		return false;
+	}
+	return data_fingerprint_ == ComputeDataFingerprint(points,
+			3 * num_points);
 }
 
 bool KDTreeFlann::SetFeature(const Feature &feature)
@@ -108,6 +763,11 @@ int KDTreeFlann::Search(const T &query, const KDTreeSearchParam &param,
 				((const KDTreeSearchParamHybrid &)param).radius_,
 				((const KDTreeSearchParamHybrid &)param).max_nn_,
 				indices, distance2);
+	case KDTreeSearchParam::SEARCH_APPROXIMATE_KNN:
+		return SearchApproximateKNN(query,
+				((const KDTreeSearchParamApproximateKNN &)param).knn_,
+				((const KDTreeSearchParamApproximateKNN &)param).checks_,
+				indices, distance2);
 	default:
 		return -1;
 	}
@@ -121,21 +781,31 @@ int KDTreeFlann::SearchKNN(const T &query, int knn, std::vector<int> &indices,
 	// This is optimized code for heavily repeated search.
 	// Other flann::Index::knnSearch() implementations lose performance due to
 	// memory allocation/deallocation.
-	if (data_.empty() || dataset_size_ <= 0 ||
-			query.rows() != dimension_ || knn < 0)
-	{
+	if (!HasIndex() || (size_t)query.rows() != dimension_ || knn < 0) {
 		return -1;
 	}
-	flann::Matrix<double> query_flann((double *)query.data(), 1, dimension_);
-	indices.resize(knn);
-	distance2.resize(knn);
-	flann::Matrix<int> indices_flann(indices.data(), query_flann.rows, knn);
-	flann::Matrix<double> dists_flann(distance2.data(), query_flann.rows, knn);
-	int k = flann_index_->knnSearch(query_flann, indices_flann, dists_flann,
-			knn, flann::SearchParams(-1, 0.0));
-	indices.resize(k);
-	distance2.resize(k);
-	return k;
+	if (brute_force_index_) {
+		return brute_force_index_->SearchKNN(query.data(), knn, indices,
+				distance2);
+	}
+	if (brute_force_index_float_) {
+		return brute_force_index_float_->SearchKNN(query.data(), knn,
+				indices, distance2);
+	}
+	if (native_index_) {
+		return native_index_->SearchKNN(query.data(), knn, indices,
+				distance2);
+	}
+	if (native_index_float_) {
+		return native_index_float_->SearchKNN(query.data(), knn, indices,
+				distance2);
+	}
+	if (flann_index_float_) {
+		return FlannSearchKNN(*flann_index_float_, query.data(), dimension_,
+				knn, GetFlannChecks(-1), indices, distance2);
+	}
+	return FlannSearchKNN(*flann_index_, query.data(), dimension_, knn,
+			GetFlannChecks(-1), indices, distance2);
 }
 
 template<typename T>
@@ -146,19 +816,31 @@ int KDTreeFlann::SearchRadius(const T &query, double radius,
 	// Since max_nn is not given, we let flann to do its own memory management.
 	// Other flann::Index::radiusSearch() implementations lose performance due
 	// to memory management and CPU caching.
-	if (data_.empty() || dataset_size_ <= 0 || query.rows() != dimension_) {
+	if (!HasIndex() || (size_t)query.rows() != dimension_) {
 		return -1;
 	}
-	flann::Matrix<double> query_flann((double *)query.data(), 1, dimension_);
-	flann::SearchParams param(-1, 0.0);
-	param.max_neighbors = -1;
-	std::vector<std::vector<int>> indices_vec(1);
-	std::vector<std::vector<double>> dists_vec(1);
-	int k = flann_index_->radiusSearch(query_flann, indices_vec, dists_vec,
-			float(radius * radius), param);
-	indices = indices_vec[0];
-	distance2 = dists_vec[0];
-	return k;
+	if (brute_force_index_) {
+		return brute_force_index_->SearchRadius(query.data(), radius,
+				indices, distance2);
+	}
+	if (brute_force_index_float_) {
+		return brute_force_index_float_->SearchRadius(query.data(), radius,
+				indices, distance2);
+	}
+	if (native_index_) {
+		return native_index_->SearchRadius(query.data(), radius, indices,
+				distance2);
+	}
+	if (native_index_float_) {
+		return native_index_float_->SearchRadius(query.data(), radius,
+				indices, distance2);
+	}
+	if (flann_index_float_) {
+		return FlannSearchRadius(*flann_index_float_, query.data(),
+				dimension_, radius, GetFlannChecks(-1), indices, distance2);
+	}
+	return FlannSearchRadius(*flann_index_, query.data(), dimension_, radius,
+			GetFlannChecks(-1), indices, distance2);
 }
 
 template<typename T>
@@ -169,44 +851,457 @@ int KDTreeFlann::SearchHybrid(const T &query, double radius, int max_nn,
 	// It is also the recommended setting for search.
 	// Other flann::Index::radiusSearch() implementations lose performance due
 	// to memory allocation/deallocation.
-	if (data_.empty() || dataset_size_ <= 0 || query.rows() != dimension_ ||
-			max_nn < 0) {
+	if (!HasIndex() || (size_t)query.rows() != dimension_ || max_nn < 0) {
 		return -1;
 	}
-	flann::Matrix<double> query_flann((double *)query.data(), 1, dimension_);
-	flann::SearchParams param(-1, 0.0);
-	param.max_neighbors = max_nn;
-	indices.resize(max_nn);
-	distance2.resize(max_nn);
-	flann::Matrix<int> indices_flann(indices.data(), query_flann.rows, max_nn);
-	flann::Matrix<double> dists_flann(distance2.data(), query_flann.rows,
-			max_nn);
-	int k = flann_index_->radiusSearch(query_flann, indices_flann, dists_flann,
-			float(radius * radius), param);
-	indices.resize(k);
-	distance2.resize(k);
-	return k;
+	if (brute_force_index_) {
+		return brute_force_index_->SearchHybrid(query.data(), radius, max_nn,
+				indices, distance2);
+	}
+	if (brute_force_index_float_) {
+		return brute_force_index_float_->SearchHybrid(query.data(), radius,
+				max_nn, indices, distance2);
+	}
+	if (native_index_) {
+		return native_index_->SearchHybrid(query.data(), radius, max_nn,
+				indices, distance2);
+	}
+	if (native_index_float_) {
+		return native_index_float_->SearchHybrid(query.data(), radius,
+				max_nn, indices, distance2);
+	}
+	if (flann_index_float_) {
+		return FlannSearchHybrid(*flann_index_float_, query.data(),
+				dimension_, radius, max_nn, GetFlannChecks(-1), indices,
+				distance2);
+	}
+	return FlannSearchHybrid(*flann_index_, query.data(), dimension_, radius,
+			max_nn, GetFlannChecks(-1), indices, distance2);
+}
+
+template<typename T>
+int KDTreeFlann::SearchApproximateKNN(const T &query, int knn, int checks,
+		std::vector<int> &indices, std::vector<double> &distance2) const
+{
+	// The native 3D tree and the exhaustive search are exact and fast, they
+	// ignore the checks budget.
+	if (native_index_ || native_index_float_ || brute_force_index_ ||
+			brute_force_index_float_) {
+		return SearchKNN(query, knn, indices, distance2);
+	}
+	if (!HasIndex() || (size_t)query.rows() != dimension_ || knn < 0) {
+		return -1;
+	}
+	if (flann_index_float_) {
+		return FlannSearchKNN(*flann_index_float_, query.data(), dimension_,
+				knn, GetFlannChecks(checks), indices, distance2);
+	}
+	return FlannSearchKNN(*flann_index_, query.data(), dimension_, knn,
+			GetFlannChecks(checks), indices, distance2);
+}
+
+template<typename T>
+int KDTreeFlann::SearchBatch(const T &queries, const KDTreeSearchParam &param,
+		std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const
+{
+	switch (param.GetSearchType()) {
+	case KDTreeSearchParam::SEARCH_KNN:
+		return SearchKNNBatch(queries,
+				((const KDTreeSearchParamKNN &)param).knn_, indices,
+				distance2, offsets);
+	case KDTreeSearchParam::SEARCH_RADIUS:
+		return SearchRadiusBatch(queries,
+				((const KDTreeSearchParamRadius &)param).radius_, indices,
+				distance2, offsets);
+	case KDTreeSearchParam::SEARCH_HYBRID:
+		return SearchHybridBatch(queries,
+				((const KDTreeSearchParamHybrid &)param).radius_,
+				((const KDTreeSearchParamHybrid &)param).max_nn_,
+				indices, distance2, offsets);
+	case KDTreeSearchParam::SEARCH_APPROXIMATE_KNN:
+		return SearchApproximateKNNBatch(queries,
+				((const KDTreeSearchParamApproximateKNN &)param).knn_,
+				((const KDTreeSearchParamApproximateKNN &)param).checks_,
+				indices, distance2, offsets);
+	default:
+		return -1;
+	}
+	return -1;
+}
+
+template<typename T>
+int KDTreeFlann::SearchKNNBatch(const T &queries, int knn,
+		std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const
+{
+	if (knn < 0) {
+		return -1;
+	}
+	return SearchBatchRaw(Eigen::Map<const Eigen::MatrixXd>(queries.data(),
+			queries.rows(), queries.cols()), KDTreeSearchParam::SEARCH_KNN,
+			knn, 0.0, -1, indices, distance2, offsets);
+}
+
+template<typename T>
+int KDTreeFlann::SearchRadiusBatch(const T &queries, double radius,
+		std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const
+{
+	return SearchBatchRaw(Eigen::Map<const Eigen::MatrixXd>(queries.data(),
+			queries.rows(), queries.cols()), KDTreeSearchParam::SEARCH_RADIUS,
+			-1, radius, -1, indices, distance2, offsets);
+}
+
+template<typename T>
+int KDTreeFlann::SearchHybridBatch(const T &queries, double radius,
+		int max_nn, std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const
+{
+	if (max_nn < 0) {
+		return -1;
+	}
+	return SearchBatchRaw(Eigen::Map<const Eigen::MatrixXd>(queries.data(),
+			queries.rows(), queries.cols()), KDTreeSearchParam::SEARCH_HYBRID,
+			max_nn, radius, -1, indices, distance2, offsets);
+}
+
+template<typename T>
+int KDTreeFlann::SearchApproximateKNNBatch(const T &queries, int knn,
+		int checks, std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const
+{
+	if (knn < 0) {
+		return -1;
+	}
+	return SearchBatchRaw(Eigen::Map<const Eigen::MatrixXd>(queries.data(),
+			queries.rows(), queries.cols()), KDTreeSearchParam::SEARCH_KNN,
+			knn, 0.0, checks, indices, distance2, offsets);
+}
+
+int KDTreeFlann::SearchBatchRaw(
+		const Eigen::Map<const Eigen::MatrixXd> &queries,
+		KDTreeSearchParam::SearchType search_type, int knn, double radius,
+		int checks, std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const
+{
+	if (!HasIndex() || (size_t)queries.rows() != dimension_) {
+		return -1;
+	}
+	if (brute_force_index_) {
+		return SearchBatchParallel(NativeBatchSearcher<
+				BruteForceIndex<double>>(*brute_force_index_, search_type,
+				knn, radius), queries, indices, distance2, offsets);
+	}
+	if (brute_force_index_float_) {
+		return SearchBatchParallel(NativeBatchSearcher<
+				BruteForceIndex<float>>(*brute_force_index_float_,
+				search_type, knn, radius), queries, indices, distance2,
+				offsets);
+	}
+	if (native_index_) {
+		return SearchBatchParallel(NativeBatchSearcher<
+				KDTreeNative<3, double>>(*native_index_, search_type, knn,
+				radius), queries, indices, distance2, offsets);
+	}
+	if (native_index_float_) {
+		return SearchBatchParallel(NativeBatchSearcher<
+				KDTreeNative<3, float>>(*native_index_float_, search_type,
+				knn, radius), queries, indices, distance2, offsets);
+	}
+	if (flann_index_float_) {
+		return SearchBatchParallel(FlannBatchSearcher<float>(
+				*flann_index_float_, search_type, knn, radius,
+				GetFlannChecks(checks)), queries, indices, distance2,
+				offsets);
+	}
+	return SearchBatchParallel(FlannBatchSearcher<double>(*flann_index_,
+			search_type, knn, radius, GetFlannChecks(checks)), queries,
+			indices, distance2, offsets);
+}
+
+int KDTreeFlann::GetFlannChecks(int checks) const
+{
+	// flann's exact search on a randomized kd-forest only uses the first
+	// tree (and complains about it). Allowing as many checks as there are
+	// points makes the best-bin-first search visit all the leaves instead.
+	if (checks < 0 && index_type_ == INDEX_KDTREE_RANDOMIZED) {
+		return (int)std::min(dataset_size_,
+				(size_t)std::numeric_limits<int>::max());
+	}
+	return checks;
+}
+
+bool KDTreeFlann::HasIndex() const
+{
+	if (dataset_size_ <= 0) {
+		return false;
+	}
+	return brute_force_index_ || brute_force_index_float_ ||
+			native_index_ || native_index_float_ || flann_index_float_ ||
+			flann_index_;
+}
+
+void KDTreeFlann::ClearIndex()
+{
+	dimension_ = 0;
+	dataset_size_ = 0;
+	fingerprint_num_blocks_ = 0;
+	fingerprint_state_ = 0;
+	data_.clear();
+	data_.shrink_to_fit();
+	flann_index_.reset();
+	flann_dataset_.reset();
+	data_float_.clear();
+	data_float_.shrink_to_fit();
+	flann_index_float_.reset();
+	flann_dataset_float_.reset();
+	data_added_.clear();
+	data_float_added_.clear();
+	flann_removed_indices_.clear();
+	native_index_.reset();
+	native_index_float_.reset();
+	brute_force_index_.reset();
+	brute_force_index_float_.reset();
+	data_pointer_ = nullptr;
+	mapped_file_.reset();
 }
 
-bool KDTreeFlann::SetRawData(const Eigen::Map<const Eigen::MatrixXd> &data)
+bool KDTreeFlann::SetRawData(const Eigen::Map<const Eigen::MatrixXd> &data,
+		bool copy_data)
 {
+	ClearIndex();
 	dimension_ = data.rows();
 	dataset_size_ = data.cols();
 	if (dimension_ == 0 || dataset_size_ == 0) {
 		PrintDebug("[KDTreeFlann::SetRawData] Failed due to no data.\n");
 		return false;
 	}
-	data_.resize(dataset_size_ * dimension_);
-	memcpy(data_.data(), data.data(),
-			dataset_size_ * dimension_ * sizeof(double));
-	flann_dataset_.reset(new flann::Matrix<double>((double *)data_.data(),
-			dataset_size_, dimension_));
-	flann_index_.reset(new flann::Index<flann::L2<double>>(*flann_dataset_,
-		flann::KDTreeSingleIndexParams(15)));
-	flann_index_->buildIndex();
+	fingerprint_num_blocks_ = 0;
+	fingerprint_state_ = 0;
+	ChainFingerprintBlocks(data.data(), dataset_size_ * dimension_,
+			fingerprint_num_blocks_, fingerprint_state_);
+	data_fingerprint_ = FinishFingerprint(data.data(),
+			dataset_size_ * dimension_, fingerprint_num_blocks_,
+			fingerprint_state_);
+	if (dataset_size_ <= GetBruteForceThreshold(dimension_)) {
+		// Small datasets are searched exhaustively, which beats a tree
+		// descent for a few hundred points. The points are always copied
+		// into the blocked layout of the exhaustive search.
+		bool success;
+		if (precision_ == PRECISION_FLOAT) {
+			brute_force_index_float_.reset(new BruteForceIndex<float>);
+			success = brute_force_index_float_->Build(data.data(),
+					dimension_, dataset_size_);
+		} else {
+			brute_force_index_.reset(new BruteForceIndex<double>);
+			success = brute_force_index_->Build(data.data(), dimension_,
+					dataset_size_);
+		}
+		if (success == false) {
+			brute_force_index_.reset();
+			brute_force_index_float_.reset();
+			PrintDebug("[KDTreeFlann::SetRawData] Failed to build index.\n");
+			return false;
+		}
+	} else if (dimension_ == 3) {
+		// 3D data is indexed by the native tree; it stores the points in
+		// leaf order (or refers to the input buffer), so no flann dataset
+		// is needed.
+		bool success;
+		if (precision_ == PRECISION_FLOAT) {
+			native_index_float_.reset(new KDTreeNative<3, float>);
+			success = native_index_float_->Build(data.data(), dataset_size_);
+		} else {
+			native_index_.reset(new KDTreeNative<3, double>);
+			success = native_index_->Build(data.data(), dataset_size_,
+					copy_data);
+			if (copy_data == false) {
+				data_pointer_ = data.data();
+			}
+		}
+		if (success == false) {
+			native_index_.reset();
+			native_index_float_.reset();
+			PrintDebug("[KDTreeFlann::SetRawData] Failed to build index.\n");
+			return false;
+		}
+	} else if (precision_ == PRECISION_FLOAT) {
+		data_float_.resize(dataset_size_ * dimension_);
+		Eigen::Map<Eigen::MatrixXf>(data_float_.data(), dimension_,
+				dataset_size_) = data.cast<float>();
+		flann_dataset_float_.reset(new flann::Matrix<float>(
+				(float *)data_float_.data(), dataset_size_, dimension_));
+		flann_index_float_.reset(new flann::Index<flann::L2<float>>(
+				*flann_dataset_float_, GetFlannIndexParams(index_type_)));
+		flann_index_float_->buildIndex();
+	} else {
+		// Only geometries, which are 3D, can be referred to without a copy,
+		// so flann indices always copy their data.
+		data_.resize(dataset_size_ * dimension_);
+		memcpy(data_.data(), data.data(),
+				dataset_size_ * dimension_ * sizeof(double));
+		flann_dataset_.reset(new flann::Matrix<double>((double *)data_.data(),
+				dataset_size_, dimension_));
+		flann_index_.reset(new flann::Index<flann::L2<double>>(
+				*flann_dataset_, GetFlannIndexParams(index_type_)));
+		flann_index_->buildIndex();
+	}
 	return true;
 }
 
+bool KDTreeFlann::AddRawData(const Eigen::Map<const Eigen::MatrixXd> &data)
+{
+	if (!HasIndex()) {
+		return SetRawData(data, true);
+	}
+	if ((size_t)data.rows() != dimension_) {
+		PrintDebug("[KDTreeFlann::AddPoints] Dimension mismatch.\n");
+		return false;
+	}
+	size_t num_points = data.cols();
+	if (num_points == 0) {
+		return true;
+	}
+	if ((brute_force_index_ || brute_force_index_float_) &&
+			dataset_size_ + num_points > GetBruteForceThreshold(dimension_)) {
+		// The dataset outgrows the exhaustive search: rebuild a tree on all
+		// points, keeping the indices of the removed ones removed.
+		std::vector<double> points;
+		std::vector<char> removed;
+		if (brute_force_index_) {
+			brute_force_index_->GetPoints(points);
+			removed = brute_force_index_->GetRemoved();
+		} else {
+			brute_force_index_float_->GetPoints(points);
+			removed = brute_force_index_float_->GetRemoved();
+		}
+		points.insert(points.end(), data.data(), data.data() +
+				num_points * dimension_);
+		std::vector<int> removed_indices;
+		for (size_t i = 0; i < removed.size(); i++) {
+			if (removed[i]) {
+				removed_indices.push_back((int)i);
+			}
+		}
+		if (SetRawData(Eigen::Map<const Eigen::MatrixXd>(points.data(),
+				dimension_, points.size() / dimension_), true) == false) {
+			return false;
+		}
+		return removed_indices.empty() || RemovePoints(removed_indices);
+	}
+	bool success = true;
+	if (brute_force_index_) {
+		success = brute_force_index_->AddPoints(data.data(), num_points);
+	} else if (brute_force_index_float_) {
+		success = brute_force_index_float_->AddPoints(data.data(),
+				num_points);
+	} else if (native_index_) {
+		success = native_index_->AddPoints(data.data(), num_points);
+		data_pointer_ = nullptr;
+	} else if (native_index_float_) {
+		success = native_index_float_->AddPoints(data.data(), num_points);
+	} else if (flann_index_float_) {
+		data_float_added_.push_back(std::vector<float>(num_points *
+				dimension_));
+		std::vector<float> &added = data_float_added_.back();
+		Eigen::Map<Eigen::MatrixXf>(added.data(), dimension_, num_points) =
+				data.cast<float>();
+		flann_index_float_->addPoints(flann::Matrix<float>(added.data(),
+				num_points, dimension_));
+	} else {
+		data_added_.push_back(std::vector<double>(data.data(), data.data() +
+				num_points * dimension_));
+		std::vector<double> &added = data_added_.back();
+		flann_index_->addPoints(flann::Matrix<double>(added.data(),
+				num_points, dimension_));
+	}
+	if (success == false) {
+		PrintDebug("[KDTreeFlann::AddPoints] Failed to add points.\n");
+		return false;
+	}
+	dataset_size_ += num_points;
+	return true;
+}
+
+std::shared_ptr<const KDTreeFlann> GetKDTreeFlannFromCache(
+		const Geometry &geometry)
+{
+	const double *points;
+	size_t num_points;
+	if (GetGeometryPoints(geometry, points, num_points) == false) {
+		PrintDebug("[GetKDTreeFlannFromCache] Unsupported Geometry type.\n");
+		return std::make_shared<KDTreeFlann>();
+	}
+	KDTreeFlann::Precision precision = KDTreeFlann::GetDefaultPrecision();
+	auto IsSameEntry = [&](const KDTreeFlannCacheEntry &entry) {
+		return entry.geometry_ == &geometry && entry.points_ == points &&
+				entry.kdtree_->GetPrecision() == precision;
+	};
+	// The lock only guards the list. Validating a cached tree scans the
+	// points and building one takes much longer, so both run unlocked and
+	// callers searching different geometries do not wait for each other.
+	std::shared_ptr<const KDTreeFlann> cached;
+	{
+		std::lock_guard<std::mutex> lock(global_kdtree_cache_mutex);
+		for (const auto &entry : global_kdtree_cache) {
+			if (IsSameEntry(entry)) {
+				cached = entry.kdtree_;
+				break;
+			}
+		}
+	}
+	if (cached && cached->IsUpToDate(geometry)) {
+		// Move the entry to the front so it is evicted last, unless it has
+		// been evicted or replaced in the meantime.
+		std::lock_guard<std::mutex> lock(global_kdtree_cache_mutex);
+		for (auto itr = global_kdtree_cache.begin();
+				itr != global_kdtree_cache.end(); itr++) {
+			if (itr->kdtree_ == cached) {
+				global_kdtree_cache.splice(global_kdtree_cache.begin(),
+						global_kdtree_cache, itr);
+				break;
+			}
+		}
+		return cached;
+	}
+	auto kdtree = std::make_shared<KDTreeFlann>();
+	if (kdtree->SetGeometry(geometry, false) == false) {
+		return kdtree;
+	}
+	std::lock_guard<std::mutex> lock(global_kdtree_cache_mutex);
+	if (global_kdtree_cache_capacity == 0) {
+		return kdtree;
+	}
+	// A stale entry, or one inserted by another caller during the build, is
+	// replaced by the new tree.
+	global_kdtree_cache.remove_if(IsSameEntry);
+	KDTreeFlannCacheEntry entry;
+	entry.geometry_ = &geometry;
+	entry.points_ = points;
+	entry.kdtree_ = kdtree;
+	global_kdtree_cache.push_front(entry);
+	while (global_kdtree_cache.size() > global_kdtree_cache_capacity) {
+		global_kdtree_cache.pop_back();
+	}
+	return kdtree;
+}
+
+void SetKDTreeFlannCacheCapacity(size_t capacity)
+{
+	std::lock_guard<std::mutex> lock(global_kdtree_cache_mutex);
+	global_kdtree_cache_capacity = capacity;
+	while (global_kdtree_cache.size() > global_kdtree_cache_capacity) {
+		global_kdtree_cache.pop_back();
+	}
+}
+
+void ClearKDTreeFlannCache()
+{
+	std::lock_guard<std::mutex> lock(global_kdtree_cache_mutex);
+	global_kdtree_cache.clear();
+}
+
 template int KDTreeFlann::Search<Eigen::Vector3d>(const Eigen::Vector3d &query,
 		const three::KDTreeSearchParam &param, std::vector<int> &indices,
 		std::vector<double> &distance2) const;
@@ -219,6 +1314,9 @@ template int KDTreeFlann::SearchRadius<Eigen::Vector3d>(
 template int KDTreeFlann::SearchHybrid<Eigen::Vector3d>(
 		const Eigen::Vector3d &query, double radius, int max_nn,
 		std::vector<int> &indices, std::vector<double> &distance2) const;
+template int KDTreeFlann::SearchApproximateKNN<Eigen::Vector3d>(
+		const Eigen::Vector3d &query, int knn, int checks, std::vector<int> &indices,
+		std::vector<double> &distance2) const;
 
 template int KDTreeFlann::Search<Eigen::VectorXd>(const Eigen::VectorXd &query,
 		const three::KDTreeSearchParam &param, std::vector<int> &indices,
@@ -232,6 +1330,71 @@ template int KDTreeFlann::SearchRadius<Eigen::VectorXd>(
 template int KDTreeFlann::SearchHybrid<Eigen::VectorXd>(
 		const Eigen::VectorXd &query, double radius, int max_nn,
 		std::vector<int> &indices, std::vector<double> &distance2) const;
+template int KDTreeFlann::SearchApproximateKNN<Eigen::VectorXd>(
+		const Eigen::VectorXd &query, int knn, int checks, std::vector<int> &indices,
+		std::vector<double> &distance2) const;
+
+template int KDTreeFlann::SearchBatch<Eigen::Matrix3Xd>(
+		const Eigen::Matrix3Xd &queries, const three::KDTreeSearchParam &param,
+		std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const;
+template int KDTreeFlann::SearchKNNBatch<Eigen::Matrix3Xd>(
+		const Eigen::Matrix3Xd &queries, int knn, std::vector<int> &indices,
+		std::vector<double> &distance2, std::vector<size_t> &offsets) const;
+template int KDTreeFlann::SearchRadiusBatch<Eigen::Matrix3Xd>(
+		const Eigen::Matrix3Xd &queries, double radius,
+		std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const;
+template int KDTreeFlann::SearchHybridBatch<Eigen::Matrix3Xd>(
+		const Eigen::Matrix3Xd &queries, double radius, int max_nn,
+		std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const;
+template int KDTreeFlann::SearchApproximateKNNBatch<Eigen::Matrix3Xd>(
+		const Eigen::Matrix3Xd &queries, int knn, int checks,
+		std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const;
+
+template int KDTreeFlann::SearchBatch<Eigen::Map<const Eigen::Matrix3Xd>>(
+		const Eigen::Map<const Eigen::Matrix3Xd> &queries,
+		const three::KDTreeSearchParam &param, std::vector<int> &indices,
+		std::vector<double> &distance2, std::vector<size_t> &offsets) const;
+template int KDTreeFlann::SearchKNNBatch<Eigen::Map<const Eigen::Matrix3Xd>>(
+		const Eigen::Map<const Eigen::Matrix3Xd> &queries, int knn,
+		std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const;
+template int KDTreeFlann::SearchRadiusBatch<Eigen::Map<const Eigen::Matrix3Xd>>(
+		const Eigen::Map<const Eigen::Matrix3Xd> &queries, double radius,
+		std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const;
+template int KDTreeFlann::SearchHybridBatch<Eigen::Map<const Eigen::Matrix3Xd>>(
+		const Eigen::Map<const Eigen::Matrix3Xd> &queries, double radius,
+		int max_nn, std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const;
+template int KDTreeFlann::SearchApproximateKNNBatch<
+		Eigen::Map<const Eigen::Matrix3Xd>>(
+		const Eigen::Map<const Eigen::Matrix3Xd> &queries, int knn,
+		int checks, std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const;
+
+template int KDTreeFlann::SearchBatch<Eigen::MatrixXd>(
+		const Eigen::MatrixXd &queries, const three::KDTreeSearchParam &param,
+		std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const;
+template int KDTreeFlann::SearchKNNBatch<Eigen::MatrixXd>(
+		const Eigen::MatrixXd &queries, int knn, std::vector<int> &indices,
+		std::vector<double> &distance2, std::vector<size_t> &offsets) const;
+template int KDTreeFlann::SearchRadiusBatch<Eigen::MatrixXd>(
+		const Eigen::MatrixXd &queries, double radius,
+		std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const;
+template int KDTreeFlann::SearchHybridBatch<Eigen::MatrixXd>(
+		const Eigen::MatrixXd &queries, double radius, int max_nn,
+		std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const;
+template int KDTreeFlann::SearchApproximateKNNBatch<Eigen::MatrixXd>(
+		const Eigen::MatrixXd &queries, int knn, int checks,
+		std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const;
 
 }	// namespace three
 
@@ -28,6 +28,8 @@
 
 #include <vector>
 #include <memory>
+#include <string>
+#include <cstdint>
 #include <Eigen/Core>
 
 #include <Core/Geometry/Geometry.h>
@@ -42,8 +44,41 @@ template <typename T> class Index;
 
 namespace three {
 
+template<int Dim, typename Scalar> class KDTreeNative;
+template<typename Scalar> class BruteForceIndex;
+class MappedFile;
+
 class KDTreeFlann
 {
+public:
+	/// Scalar type of the copy of the data the index is built on. A single
+	/// precision index halves the memory of the copy; queries are still given
+	/// in double precision and converted on the fly.
+	enum Precision {
+		PRECISION_DOUBLE = 0,
+		PRECISION_FLOAT = 1,
+	};
+
+	/// Datasets of at most this many points are searched exhaustively (see
+	/// BruteForceIndex) instead of building a tree. Trees on 3D points are
+	/// fast to build and search even for small sets, so their threshold is
+	/// lower than the one for higher-dimensional data such as features.
+	static const size_t BRUTE_FORCE_THRESHOLD_3D = 64;
+	static const size_t BRUTE_FORCE_THRESHOLD = 256;
+
+	/// Type of the flann index built on data that is not 3-dimensional,
+	/// e.g. features (3D data always uses an exact native kd-tree).
+	/// Exact single kd-trees can degrade towards linear search in high
+	/// dimensions; the randomized kd-forest (4 trees) and the hierarchical
+	/// k-means tree (branching 32) answer KDTreeSearchParamApproximateKNN
+	/// queries by visiting a bounded number of leaves instead. The single
+	/// tree is the default since it is still faster on typical FPFH.
+	enum IndexType {
+		INDEX_KDTREE_SINGLE = 0,
+		INDEX_KDTREE_RANDOMIZED = 1,
+		INDEX_KMEANS_HIERARCHICAL = 2,
+	};
+
 public:
 	KDTreeFlann();
 	KDTreeFlann(const Eigen::MatrixXd &data);
@@ -54,10 +89,65 @@ public:
 	KDTreeFlann &operator=(const KDTreeFlann &) = delete;
 
 public:
+	/// Function to set the precision used by KDTreeFlann objects that are
+	/// created afterwards, including the ones built internally by normal
+	/// estimation, feature computation and registration.
+	static void SetDefaultPrecision(Precision precision);
+	static Precision GetDefaultPrecision();
+
+	/// The precision takes effect the next time data is set.
+	void SetPrecision(Precision precision) { precision_ = precision; }
+	Precision GetPrecision() const { return precision_; }
+
+	/// The index type takes effect the next time data is set.
+	void SetIndexType(IndexType index_type) { index_type_ = index_type; }
+	IndexType GetIndexType() const { return index_type_; }
+
 	bool SetMatrixData(const Eigen::MatrixXd &data);
-	bool SetGeometry(const Geometry &geometry);
+	/// Function to build the index on the points of \param geometry.
+	/// If \param copy_data is false, a double precision index refers to the
+	/// points of the geometry instead of copying them. In that case the
+	/// geometry must outlive the index and must not be modified while the
+	/// index is in use. A single precision index always copies the data, and
+	/// so does an index on a PointCloudf.
+	bool SetGeometry(const Geometry &geometry, bool copy_data = true);
 	bool SetFeature(const Feature &feature);
 
+	/// Functions to update the index incrementally, e.g. when scans are
+	/// appended to a growing map. AddPoints(geometry) indexes the points
+	/// appended to \param geometry since the index was built or last
+	/// updated; AddPoints(data) appends the columns of \param data. New
+	/// points get the indices following the existing ones and removed points
+	/// keep theirs, so results stay consistent with an append-only point
+	/// cloud. 3D indices only build trees on the new points and merge them
+	/// with the recent ones (see KDTreeNative); other indices use flann's
+	/// incremental insertion. An index referring to the points of a geometry
+	/// switches to a copy on the first update. AddPoints(geometry) reads the
+	/// indexed points from the current buffer of the geometry, which the
+	/// append may have reallocated, and fails if they have been modified.
+	bool AddPoints(const Eigen::MatrixXd &data);
+	bool AddPoints(const Geometry &geometry);
+	/// Removed points are no longer returned by searches.
+	bool RemovePoints(const std::vector<int> &indices);
+
+	/// Function to save the index, including its data and tree structure,
+	/// to \param filename in a binary format meant to be memory-mapped.
+	bool Save(const std::string &filename) const;
+
+	/// Function to load an index saved by Save(). 3D indices are memory-
+	/// mapped and used in place, so loading is nearly instant; the pages are
+	/// read on demand and shared by all processes loading the same file. The
+	/// file must not be modified while the index is in use. For other
+	/// (flann) indices the data is mapped and the tree is rebuilt. The
+	/// precision and index type are the ones of the saved index.
+	bool Load(const std::string &filename);
+
+	/// Function to check whether the index has been built on the current
+	/// points of \param geometry, i.e. the points have not been modified or
+	/// reallocated since. This scans the points once, which is much cheaper
+	/// than rebuilding the index.
+	bool IsUpToDate(const Geometry &geometry) const;
+
 	template<typename T>
 	int Search(const T &query, const KDTreeSearchParam &param,
 			std::vector<int> &indices, std::vector<double> &distance2) const;
@@ -74,15 +164,92 @@ public:
 	int SearchHybrid(const T &query, double radius, int max_nn,
 			std::vector<int> &indices, std::vector<double> &distance2) const;
 
+	template<typename T>
+	int SearchApproximateKNN(const T &query, int knn, int checks,
+			std::vector<int> &indices, std::vector<double> &distance2) const;
+
+	/// Batched search functions. Each column of \param queries is a query.
+	/// Results are returned in a compressed (CSR) layout: the neighbors of
+	/// query i are indices[offsets[i]] ... indices[offsets[i + 1] - 1], with
+	/// squared distances stored at the same positions in distance2. The
+	/// queries are processed in parallel and the output vectors are reused,
+	/// so passing the same vectors to successive calls avoids reallocation.
+	/// Return the total number of neighbors found, or -1 if the search fails.
+	template<typename T>
+	int SearchBatch(const T &queries, const KDTreeSearchParam &param,
+			std::vector<int> &indices, std::vector<double> &distance2,
+			std::vector<size_t> &offsets) const;
+
+	template<typename T>
+	int SearchKNNBatch(const T &queries, int knn, std::vector<int> &indices,
+			std::vector<double> &distance2, std::vector<size_t> &offsets) const;
+
+	template<typename T>
+	int SearchRadiusBatch(const T &queries, double radius,
+			std::vector<int> &indices, std::vector<double> &distance2,
+			std::vector<size_t> &offsets) const;
+
+	template<typename T>
+	int SearchHybridBatch(const T &queries, double radius, int max_nn,
+			std::vector<int> &indices, std::vector<double> &distance2,
+			std::vector<size_t> &offsets) const;
+
+	template<typename T>
+	int SearchApproximateKNNBatch(const T &queries, int knn, int checks,
+			std::vector<int> &indices, std::vector<double> &distance2,
+			std::vector<size_t> &offsets) const;
+
 private:
-	bool SetRawData(const Eigen::Map<const Eigen::MatrixXd> &data);
+	bool HasIndex() const;
+	void ClearIndex();
+	int GetFlannChecks(int checks) const;
+	bool SetRawData(const Eigen::Map<const Eigen::MatrixXd> &data,
+			bool copy_data);
+	bool AddRawData(const Eigen::Map<const Eigen::MatrixXd> &data);
+	int SearchBatchRaw(const Eigen::Map<const Eigen::MatrixXd> &queries,
+			KDTreeSearchParam::SearchType search_type, int knn, double radius,
+			int checks, std::vector<int> &indices,
+			std::vector<double> &distance2,
+			std::vector<size_t> &offsets) const;
 
 protected:
 	std::vector<double> data_;
 	std::unique_ptr<flann::Matrix<double>> flann_dataset_;
 	std::unique_ptr<flann::Index<flann::L2<double>>> flann_index_;
+	std::vector<float> data_float_;
+	std::unique_ptr<flann::Matrix<float>> flann_dataset_float_;
+	std::unique_ptr<flann::Index<flann::L2<float>>> flann_index_float_;
+	std::vector<std::vector<double>> data_added_;	// flann keeps pointers
+	std::vector<std::vector<float>> data_float_added_;
+	std::vector<int> flann_removed_indices_;
+	std::unique_ptr<MappedFile> mapped_file_;
+	std::unique_ptr<KDTreeNative<3, double>> native_index_;
+	std::unique_ptr<KDTreeNative<3, float>> native_index_float_;
+	std::unique_ptr<BruteForceIndex<double>> brute_force_index_;
+	std::unique_ptr<BruteForceIndex<float>> brute_force_index_float_;
+	const double *data_pointer_ = nullptr;	// input data if not copied
+	Precision precision_ = PRECISION_DOUBLE;
+	IndexType index_type_ = INDEX_KDTREE_SINGLE;
 	size_t dimension_ = 0;
 	size_t dataset_size_ = 0;
+	uint64_t data_fingerprint_ = 0;
+	// Chain of the hashes of the complete fingerprint blocks, see AddPoints()
+	size_t fingerprint_num_blocks_ = 0;
+	uint64_t fingerprint_state_ = 0;
 };
 
+/// Function to get a KDTreeFlann built on the points of \param geometry
+/// without copying them. Recently used trees are cached and returned again as
+/// long as the points of the geometry are unchanged; a tree is rebuilt when
+/// the points have been modified. The geometry must outlive the returned tree.
+std::shared_ptr<const KDTreeFlann> GetKDTreeFlannFromCache(
+		const Geometry &geometry);
+
+/// Function to set the maximum number of trees kept by
+/// GetKDTreeFlannFromCache(). A capacity of 0 disables caching.
+void SetKDTreeFlannCacheCapacity(size_t capacity);
+
+/// Function to release all trees kept by GetKDTreeFlannFromCache()
+void ClearKDTreeFlannCache();
+
 }	// namespace three
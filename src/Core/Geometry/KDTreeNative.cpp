@@ -0,0 +1,631 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+
+#include "KDTreeNative.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <Core/Geometry/NeighborSearchBatch.h>
+#include <Core/Utility/MappedFile.h>
+
+namespace three{
+
+namespace {
+
+/// Below this size the tree is built on a single thread.
+const int parallel_build_threshold = 65536;
+
+}	// unnamed namespace
+
+template<int Dim, typename Scalar>
+bool KDTreeNative<Dim, Scalar>::Build(const double *points,
+		size_t num_points, bool copy_data/* = true*/)
+{
+	Clear();
+	if (num_points == 0 ||
+			num_points > (size_t)std::numeric_limits<int>::max()) {
+		return false;
+	}
+	copy_data = copy_data || std::is_same<Scalar, double>::value == false;
+	BuildBlock(points, (int)num_points, copy_data);
+	if (copy_data == false) {
+		external_data_ = reinterpret_cast<const Scalar *>(points);
+	}
+	num_indices_ = num_points;
+	UpdateArrays();
+	return true;
+}
+
+template<int Dim, typename Scalar>
+void KDTreeNative<Dim, Scalar>::Clear()
+{
+	nodes_.clear();
+	nodes_.shrink_to_fit();
+	point_indices_.clear();
+	point_indices_.shrink_to_fit();
+	data_.clear();
+	data_.shrink_to_fit();
+	external_data_ = nullptr;
+	blocks_.clear();
+	removed_.clear();
+	removed_.shrink_to_fit();
+	num_removed_stored_ = 0;
+	num_indices_ = 0;
+	UpdateArrays();
+}
+
+template<int Dim, typename Scalar>
+bool KDTreeNative<Dim, Scalar>::AddPoints(const double *points,
+		size_t num_points)
+{
+	if (num_points == 0) {
+		return true;
+	}
+	if (num_indices_ + num_points >
+			(size_t)std::numeric_limits<int>::max()) {
+		return false;
+	}
+	CopyArrays();
+	size_t first_block = blocks_.size();
+	size_t merged_size = num_points;
+	while (first_block > 0 && GetBlockEnd(first_block - 1) -
+			blocks_[first_block - 1].point_begin_ <= merged_size) {
+		first_block--;
+		merged_size += GetBlockEnd(first_block) -
+				blocks_[first_block].point_begin_;
+	}
+	MergeBlocks(first_block, points, num_points);
+	return true;
+}
+
+template<int Dim, typename Scalar>
+bool KDTreeNative<Dim, Scalar>::RemovePoints(const int *indices,
+		size_t num_indices)
+{
+	for (size_t i = 0; i < num_indices; i++) {
+		if (indices[i] < 0 || (size_t)indices[i] >= num_indices_) {
+			return false;
+		}
+	}
+	if (num_indices == 0) {
+		return true;
+	}
+	if (removed_.empty()) {
+		removed_.resize(num_indices_, 0);
+	}
+	for (size_t i = 0; i < num_indices; i++) {
+		if (removed_[indices[i]] == 0) {
+			removed_[indices[i]] = 1;
+			num_removed_stored_++;
+		}
+	}
+	if (num_removed_stored_ * 2 > num_stored_) {
+		CopyArrays();
+		MergeBlocks(0, nullptr, 0);
+	}
+	return true;
+}
+
+template<int Dim, typename Scalar>
+void KDTreeNative<Dim, Scalar>::BuildBlock(const double *points,
+		int num_points, bool copy_data)
+{
+	// The new block is appended to the storage. Its point indices refer to
+	// \param points until the caller maps them to the final indices.
+	int point_begin = (int)point_indices_.size();
+	int point_end = point_begin + num_points;
+	int node_begin = (int)nodes_.size();
+	point_indices_.resize(point_end);
+	for (int i = 0; i < num_points; i++) {
+		point_indices_[point_begin + i] = i;
+	}
+	std::map<size_t, size_t> memo;
+	nodes_.resize(node_begin + CountNodes(num_points, memo));
+
+	// The upper levels are split on one thread; the subtrees below
+	// parallel_depth are independent and are built in parallel.
+	int parallel_depth = 0;
+#ifdef _OPENMP
+	int num_threads = omp_get_max_threads();
+	if (num_threads > 1 && num_points >= parallel_build_threshold) {
+		while ((1 << parallel_depth) < 4 * num_threads) {
+			parallel_depth++;
+		}
+	}
+#endif
+	std::vector<std::tuple<int, int, int>> deferred;
+	BuildNode(points, node_begin, point_begin, point_end, 0, parallel_depth,
+			memo, parallel_depth > 0 ? &deferred : nullptr);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int t = 0; t < (int)deferred.size(); t++) {
+		std::map<size_t, size_t> memo_private;
+		BuildNode(points, std::get<0>(deferred[t]), std::get<1>(deferred[t]),
+				std::get<2>(deferred[t]), 0, 0, memo_private, nullptr);
+	}
+
+	if (copy_data) {
+		data_.resize((size_t)point_end * Dim);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for (int i = point_begin; i < point_end; i++) {
+			const double *point = points + (size_t)point_indices_[i] * Dim;
+			for (int k = 0; k < Dim; k++) {
+				data_[(size_t)i * Dim + k] = (Scalar)point[k];
+			}
+		}
+	}
+	Block block;
+	block.node_begin_ = node_begin;
+	block.point_begin_ = point_begin;
+	blocks_.push_back(block);
+}
+
+template<int Dim, typename Scalar>
+void KDTreeNative<Dim, Scalar>::MergeBlocks(size_t first_block,
+		const double *points, size_t num_points)
+{
+	// Gathers the points of the blocks from first_block on that have not
+	// been removed, followed by the new points, and rebuilds them as one
+	// block. The points are stored (copied) as Scalar, so converting them
+	// back to double is exact.
+	size_t point_begin = first_block < blocks_.size() ?
+			blocks_[first_block].point_begin_ : point_indices_.size();
+	size_t node_begin = first_block < blocks_.size() ?
+			blocks_[first_block].node_begin_ : nodes_.size();
+	std::vector<double> merged_points;
+	std::vector<int> merged_indices;
+	merged_points.reserve((point_indices_.size() - point_begin + num_points) *
+			Dim);
+	merged_indices.reserve(point_indices_.size() - point_begin + num_points);
+	for (size_t i = point_begin; i < point_indices_.size(); i++) {
+		int index = point_indices_[i];
+		if (removed_.empty() == false && removed_[index] != 0) {
+			num_removed_stored_--;
+			continue;
+		}
+		merged_indices.push_back(index);
+		for (int k = 0; k < Dim; k++) {
+			merged_points.push_back((double)data_[i * Dim + k]);
+		}
+	}
+	for (size_t i = 0; i < num_points; i++) {
+		merged_indices.push_back((int)(num_indices_ + i));
+		for (int k = 0; k < Dim; k++) {
+			merged_points.push_back(points[i * Dim + k]);
+		}
+	}
+	num_indices_ += num_points;
+	if (removed_.empty() == false) {
+		removed_.resize(num_indices_, 0);
+	}
+
+	blocks_.resize(first_block);
+	nodes_.resize(node_begin);
+	point_indices_.resize(point_begin);
+	data_.resize(point_begin * Dim);
+	if (merged_indices.empty() == false) {
+		BuildBlock(merged_points.data(), (int)merged_indices.size(), true);
+		for (size_t i = point_begin; i < point_indices_.size(); i++) {
+			point_indices_[i] = merged_indices[point_indices_[i]];
+		}
+	}
+	UpdateArrays();
+}
+
+template<int Dim, typename Scalar>
+void KDTreeNative<Dim, Scalar>::UpdateArrays()
+{
+	node_array_ = nodes_.data();
+	point_array_ = point_indices_.data();
+	data_array_ = data_.data();
+	num_nodes_ = nodes_.size();
+	num_stored_ = point_indices_.size();
+}
+
+template<int Dim, typename Scalar>
+void KDTreeNative<Dim, Scalar>::CopyArrays()
+{
+	// Makes the tree own its arrays (and a copy of its points) before it is
+	// modified.
+	if (external_data_ != nullptr || data_array_ != data_.data()) {
+		std::vector<Scalar> data(num_stored_ * Dim);
+		for (size_t i = 0; i < num_stored_; i++) {
+			const Scalar *point = GetPoint((int)i);
+			for (int k = 0; k < Dim; k++) {
+				data[i * Dim + k] = point[k];
+			}
+		}
+		data_.swap(data);
+		external_data_ = nullptr;
+	}
+	if (node_array_ != nodes_.data()) {
+		nodes_.assign(node_array_, node_array_ + num_nodes_);
+	}
+	if (point_array_ != point_indices_.data()) {
+		point_indices_.assign(point_array_, point_array_ + num_stored_);
+	}
+	UpdateArrays();
+}
+
+template<int Dim, typename Scalar>
+bool KDTreeNative<Dim, Scalar>::Write(FILE *file, size_t &offset) const
+{
+	uint64_t header[9] = {(uint64_t)Dim, sizeof(Scalar), sizeof(Node),
+			num_indices_, num_stored_, num_nodes_, blocks_.size(),
+			removed_.size(), num_removed_stored_};
+	if (WriteMappedFileBlock(file, offset, header, sizeof(header)) == false ||
+			WriteMappedFileBlock(file, offset, blocks_.data(),
+			blocks_.size() * sizeof(Block)) == false ||
+			WriteMappedFileBlock(file, offset, node_array_,
+			num_nodes_ * sizeof(Node)) == false ||
+			WriteMappedFileBlock(file, offset, point_array_,
+			num_stored_ * sizeof(int)) == false) {
+		return false;
+	}
+	if (external_data_ == nullptr) {
+		if (WriteMappedFileBlock(file, offset, data_array_,
+				num_stored_ * Dim * sizeof(Scalar)) == false) {
+			return false;
+		}
+	} else {
+		// Points of a tree referring to its input are written in leaf order.
+		if (WriteMappedFileBlock(file, offset, nullptr, 0) == false) {
+			return false;
+		}
+		for (size_t i = 0; i < num_stored_; i++) {
+			if (fwrite(GetPoint((int)i), sizeof(Scalar), Dim, file) < Dim) {
+				return false;
+			}
+		}
+		offset += num_stored_ * Dim * sizeof(Scalar);
+	}
+	return WriteMappedFileBlock(file, offset, removed_.data(),
+			removed_.size());
+}
+
+template<int Dim, typename Scalar>
+bool KDTreeNative<Dim, Scalar>::Read(const char *file_data,
+		size_t file_size, size_t &offset)
+{
+	Clear();
+	uint64_t header[9];
+	const char *data = ReadMappedFileBlock(file_data, file_size, offset,
+			sizeof(header));
+	if (data == nullptr) {
+		return false;
+	}
+	memcpy(header, data, sizeof(header));
+	if (header[0] != (uint64_t)Dim || header[1] != sizeof(Scalar) ||
+			header[2] != sizeof(Node) ||
+			header[3] > (uint64_t)std::numeric_limits<int>::max() ||
+			header[4] > header[3] || header[7] > header[3] ||
+			header[8] > header[4] ||
+			header[5] > (uint64_t)std::numeric_limits<int>::max()) {
+		return false;
+	}
+	size_t num_blocks = (size_t)header[6];
+	const char *blocks = ReadMappedFileArray(file_data, file_size, offset,
+			header[6], sizeof(Block));
+	const char *nodes = ReadMappedFileArray(file_data, file_size, offset,
+			header[5], sizeof(Node));
+	const char *point_indices = ReadMappedFileArray(file_data, file_size,
+			offset, header[4], sizeof(int));
+	const char *points = ReadMappedFileArray(file_data, file_size, offset,
+			header[4], Dim * sizeof(Scalar));
+	const char *removed = ReadMappedFileArray(file_data, file_size, offset,
+			header[7], 1);
+	if (blocks == nullptr || nodes == nullptr || point_indices == nullptr ||
+			points == nullptr || removed == nullptr ||
+			(uintptr_t)nodes % alignof(Node) != 0 ||
+			(uintptr_t)point_indices % alignof(int) != 0 ||
+			(uintptr_t)points % alignof(Scalar) != 0) {
+		return false;
+	}
+	blocks_.resize(num_blocks);
+	memcpy(blocks_.data(), blocks, num_blocks * sizeof(Block));
+	removed_.assign(removed, removed + header[7]);
+	num_indices_ = (size_t)header[3];
+	num_removed_stored_ = (size_t)header[8];
+	node_array_ = reinterpret_cast<const Node *>(nodes);
+	point_array_ = reinterpret_cast<const int *>(point_indices);
+	data_array_ = reinterpret_cast<const Scalar *>(points);
+	num_nodes_ = (size_t)header[5];
+	num_stored_ = (size_t)header[4];
+	if (IsValid() == false) {
+		Clear();
+		return false;
+	}
+	return true;
+}
+
+template<int Dim, typename Scalar>
+bool KDTreeNative<Dim, Scalar>::IsValid() const
+{
+	// Everything that is later used as an array index is checked, so that a
+	// corrupt file fails to load instead of causing out of bounds reads.
+	if ((removed_.empty() == false && removed_.size() != num_indices_) ||
+			(removed_.empty() && num_removed_stored_ > 0)) {
+		return false;
+	}
+	for (size_t b = 0; b < blocks_.size(); b++) {
+		const Block &block = blocks_[b];
+		if (block.node_begin_ < 0 || (size_t)block.node_begin_ >=
+				num_nodes_ || block.point_begin_ < 0 ||
+				(size_t)block.point_begin_ > num_stored_ || (b == 0 &&
+				(block.node_begin_ != 0 || block.point_begin_ != 0)) ||
+				(b > 0 && (block.node_begin_ <= blocks_[b - 1].node_begin_ ||
+				block.point_begin_ < blocks_[b - 1].point_begin_))) {
+			return false;
+		}
+	}
+	for (size_t i = 0; i < num_nodes_; i++) {
+		const Node &node = node_array_[i];
+		if (node.begin_ < 0 || node.begin_ > node.end_ ||
+				(size_t)node.end_ > num_stored_) {
+			return false;
+		}
+		if (node.right_ == 0) {
+			if (node.end_ - node.begin_ > LeafSize) {
+				return false;
+			}
+		} else if (node.right_ <= (int)i + 1 ||
+				(size_t)node.right_ >= num_nodes_ || node.split_dim_ < 0 ||
+				node.split_dim_ >= Dim) {
+			// Children follow their parent, which also rules out cycles.
+			return false;
+		}
+	}
+	for (size_t i = 0; i < num_stored_; i++) {
+		if (point_array_[i] < 0 || (size_t)point_array_[i] >= num_indices_) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template<int Dim, typename Scalar>
+int KDTreeNative<Dim, Scalar>::SearchKNN(const double *query, int knn,
+		std::vector<int> &indices, std::vector<double> &distance2) const
+{
+	if (num_indices_ == 0 || knn < 0) {
+		return -1;
+	}
+	indices.resize(knn);
+	distance2.resize(knn);
+	if (knn > 0) {
+		KNNResultSet result(indices.data(), distance2.data(), knn,
+				std::numeric_limits<double>::max());
+		SearchBlocks(result, query);
+		knn = result.count_;
+	}
+	indices.resize(knn);
+	distance2.resize(knn);
+	return knn;
+}
+
+template<int Dim, typename Scalar>
+int KDTreeNative<Dim, Scalar>::SearchRadius(const double *query,
+		double radius, std::vector<int> &indices,
+		std::vector<double> &distance2) const
+{
+	if (num_indices_ == 0) {
+		return -1;
+	}
+	indices.clear();
+	distance2.clear();
+	RadiusResultSet result(indices, distance2, radius * radius);
+	SearchBlocks(result, query);
+	SortNeighborsByDistance(indices.data(), distance2.data(),
+			(int)indices.size());
+	return (int)indices.size();
+}
+
+template<int Dim, typename Scalar>
+int KDTreeNative<Dim, Scalar>::SearchHybrid(const double *query,
+		double radius, int max_nn, std::vector<int> &indices,
+		std::vector<double> &distance2) const
+{
+	if (num_indices_ == 0 || max_nn < 0) {
+		return -1;
+	}
+	indices.resize(max_nn);
+	distance2.resize(max_nn);
+	if (max_nn > 0) {
+		KNNResultSet result(indices.data(), distance2.data(), max_nn,
+				radius * radius);
+		SearchBlocks(result, query);
+		max_nn = result.count_;
+	}
+	indices.resize(max_nn);
+	distance2.resize(max_nn);
+	return max_nn;
+}
+
+template<int Dim, typename Scalar>
+size_t KDTreeNative<Dim, Scalar>::CountNodes(size_t num_points,
+		std::map<size_t, size_t> &memo) const
+{
+	if (num_points <= LeafSize) {
+		return 1;
+	}
+	auto itr = memo.find(num_points);
+	if (itr != memo.end()) {
+		return itr->second;
+	}
+	size_t count = 1 + CountNodes(num_points / 2, memo) +
+			CountNodes(num_points - num_points / 2, memo);
+	memo[num_points] = count;
+	return count;
+}
+
+template<int Dim, typename Scalar>
+void KDTreeNative<Dim, Scalar>::BuildNode(const double *points, int node_id,
+		int begin, int end, int depth, int parallel_depth,
+		std::map<size_t, size_t> &memo,
+		std::vector<std::tuple<int, int, int>> *deferred)
+{
+	Node &node = nodes_[node_id];
+	node.begin_ = begin;
+	node.end_ = end;
+	node.right_ = 0;
+	node.split_dim_ = 0;
+	node.split_value_ = 0;
+	if (end - begin <= LeafSize) {
+		return;
+	}
+	if (deferred != nullptr && depth == parallel_depth) {
+		deferred->push_back(std::make_tuple(node_id, begin, end));
+		return;
+	}
+
+	// split at the median of the dimension with the largest extent
+	double min_bound[Dim], max_bound[Dim];
+	for (int k = 0; k < Dim; k++) {
+		min_bound[k] = max_bound[k] = points[(size_t)point_indices_[begin] *
+				Dim + k];
+	}
+	for (int i = begin + 1; i < end; i++) {
+		const double *point = points + (size_t)point_indices_[i] * Dim;
+		for (int k = 0; k < Dim; k++) {
+			min_bound[k] = std::min(min_bound[k], point[k]);
+			max_bound[k] = std::max(max_bound[k], point[k]);
+		}
+	}
+	int split_dim = 0;
+	for (int k = 1; k < Dim; k++) {
+		if (max_bound[k] - min_bound[k] >
+				max_bound[split_dim] - min_bound[split_dim]) {
+			split_dim = k;
+		}
+	}
+	int mid = begin + (end - begin) / 2;
+	std::nth_element(point_indices_.begin() + begin,
+			point_indices_.begin() + mid, point_indices_.begin() + end,
+			[points, split_dim](int a, int b) {
+				return points[(size_t)a * Dim + split_dim] <
+						points[(size_t)b * Dim + split_dim];
+			});
+	node.split_dim_ = split_dim;
+	node.split_value_ = (Scalar)points[(size_t)point_indices_[mid] * Dim +
+			split_dim];
+	node.right_ = node_id + 1 + (int)CountNodes(mid - begin, memo);
+	BuildNode(points, node_id + 1, begin, mid, depth + 1, parallel_depth,
+			memo, deferred);
+	BuildNode(points, node.right_, mid, end, depth + 1, parallel_depth,
+			memo, deferred);
+}
+
+template<int Dim, typename Scalar>
+template<typename ResultSet>
+void KDTreeNative<Dim, Scalar>::SearchBlocks(ResultSet &result,
+		const double *query) const
+{
+	Scalar query_scalar[Dim];
+	double offsets[Dim];
+	for (int k = 0; k < Dim; k++) {
+		query_scalar[k] = (Scalar)query[k];
+		offsets[k] = 0.0;
+	}
+	for (const Block &block : blocks_) {
+		SearchLevel(result, query_scalar, block.node_begin_, 0.0, offsets);
+	}
+}
+
+template<int Dim, typename Scalar>
+template<typename ResultSet>
+void KDTreeNative<Dim, Scalar>::SearchLevel(ResultSet &result,
+		const Scalar *query, int node_id, double mindist2,
+		double *offsets) const
+{
+	const Node &node = node_array_[node_id];
+	if (node.right_ == 0) {
+		// Distances of the whole bucket are computed first; the loop has a
+		// fixed inner dimension and no branches so it vectorizes well.
+		Scalar dists[LeafSize];
+		int count = node.end_ - node.begin_;
+		if (external_data_ == nullptr) {
+			const Scalar *points = data_array_ + (size_t)node.begin_ * Dim;
+			for (int i = 0; i < count; i++) {
+				Scalar d = 0;
+				for (int k = 0; k < Dim; k++) {
+					Scalar diff = query[k] - points[i * Dim + k];
+					d += diff * diff;
+				}
+				dists[i] = d;
+			}
+		} else {
+			for (int i = 0; i < count; i++) {
+				const Scalar *point = GetPoint(node.begin_ + i);
+				Scalar d = 0;
+				for (int k = 0; k < Dim; k++) {
+					Scalar diff = query[k] - point[k];
+					d += diff * diff;
+				}
+				dists[i] = d;
+			}
+		}
+		for (int i = 0; i < count; i++) {
+			if ((double)dists[i] < result.WorstDistance()) {
+				int index = point_array_[node.begin_ + i];
+				if (num_removed_stored_ == 0 || removed_[index] == 0) {
+					result.AddPoint((double)dists[i], index);
+				}
+			}
+		}
+		return;
+	}
+
+	// Visit the child containing the query first. The other child is only
+	// visited if its incrementally updated distance bound is small enough.
+	int dim = node.split_dim_;
+	double diff = (double)query[dim] - (double)node.split_value_;
+	int near_id = diff < 0.0 ? node_id + 1 : node.right_;
+	int far_id = diff < 0.0 ? node.right_ : node_id + 1;
+	SearchLevel(result, query, near_id, mindist2, offsets);
+	double old_offset = offsets[dim];
+	double far_mindist2 = mindist2 - old_offset * old_offset + diff * diff;
+	if (far_mindist2 < result.WorstDistance()) {
+		offsets[dim] = diff;
+		SearchLevel(result, query, far_id, far_mindist2, offsets);
+		offsets[dim] = old_offset;
+	}
+}
+
+template class KDTreeNative<3, double>;
+template class KDTreeNative<3, float>;
+
+}	// namespace three
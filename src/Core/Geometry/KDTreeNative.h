@@ -0,0 +1,186 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+#include <map>
+#include <tuple>
+
+namespace three {
+
+/// Class of a kd-tree for points of a small, compile-time dimension (e.g. 3D
+/// point clouds). It replaces flann's generic runtime-dimension tree for this
+/// case:
+/// - nodes are stored in a flat array in depth-first order, so the left child
+///   of a node is the next node and only the right child index is stored;
+/// - every leaf is a bucket of up to LeafSize points that are contiguous in
+///   memory, so the distances in a leaf are computed in a tight fixed-size
+///   loop the compiler can unroll and vectorize;
+/// - the tree is built by splitting at the median of the widest dimension
+///   with std::nth_element, and the lower subtrees are built in parallel.
+/// Points are read as double tuples and stored as Scalar. With copy_data the
+/// points are copied in leaf order; otherwise (Scalar = double only) the tree
+/// refers to the input buffer and only stores a permutation of the indices.
+/// Search results are sorted by distance and match KDTreeFlann's semantics.
+/// The tree can be updated incrementally with the logarithmic method: the
+/// points are kept in a sequence of blocks, each indexed by its own static
+/// subtree, whose sizes decrease geometrically. All blocks are searched with
+/// a shared result set, so the extra blocks cost little.
+template<int Dim, typename Scalar>
+class KDTreeNative
+{
+public:
+	static const int LeafSize = 16;
+
+public:
+	KDTreeNative() {}
+	~KDTreeNative() {}
+	KDTreeNative(const KDTreeNative &) = delete;
+	KDTreeNative &operator=(const KDTreeNative &) = delete;
+
+public:
+	/// Function to build the tree on \param num_points points stored as
+	/// consecutive Dim-tuples in \param points
+	bool Build(const double *points, size_t num_points,
+			bool copy_data = true);
+	void Clear();
+	/// Function to return the number of point indices, including removed ones
+	size_t Size() const { return num_indices_; }
+
+	/// Function to add \param num_points points stored as consecutive
+	/// Dim-tuples in \param points. They get the indices Size() ...
+	/// Size() + num_points - 1. The new points form a block that is merged
+	/// with the trailing blocks as long as these are not larger, so every
+	/// point is rebuilt O(log n) times and adding m points costs
+	/// O(m log n) amortized instead of a full rebuild. A tree referring to
+	/// its input buffer copies the points first.
+	bool AddPoints(const double *points, size_t num_points);
+
+	/// Function to make a tree that refers to its input buffer read the same
+	/// points from \param points instead, e.g. after the buffer has been
+	/// reallocated. A tree that owns its points ignores it.
+	void SetExternalData(const double *points) {
+		if (external_data_ != nullptr) {
+			external_data_ = reinterpret_cast<const Scalar *>(points);
+		}
+	}
+
+	/// Function to remove points from the search results. Indices are not
+	/// reused. Removed points are dropped from the storage when their block
+	/// is merged, or all at once when they exceed half of the stored points.
+	bool RemovePoints(const int *indices, size_t num_indices);
+
+	/// Function to append the tree, including its points, to \param file,
+	/// whose current size \param offset is advanced past the tree.
+	/// The arrays are aligned to 64 bytes from the beginning of the file.
+	bool Write(FILE *file, size_t &offset) const;
+
+	/// Function to use a tree written by Write() that has been mapped into
+	/// memory at \param file_data; the tree starts at \param offset, which
+	/// is advanced past it. The arrays are used in place, without copying,
+	/// so the memory must outlive the tree. The tree copies them only if it
+	/// is modified. Fails if a node, block or point index is out of range.
+	bool Read(const char *file_data, size_t file_size, size_t &offset);
+
+	/// Search functions. The query is a Dim-tuple. The output vectors are
+	/// resized, so reusing them across queries avoids memory allocation.
+	/// Return the number of neighbors found.
+	int SearchKNN(const double *query, int knn, std::vector<int> &indices,
+			std::vector<double> &distance2) const;
+	int SearchRadius(const double *query, double radius,
+			std::vector<int> &indices, std::vector<double> &distance2) const;
+	int SearchHybrid(const double *query, double radius, int max_nn,
+			std::vector<int> &indices, std::vector<double> &distance2) const;
+
+private:
+	class Node
+	{
+	public:
+		int begin_;
+		int end_;
+		int right_;			// index of the right child, 0 for a leaf
+		int split_dim_;
+		Scalar split_value_;
+	};
+
+	class Block
+	{
+	public:
+		int node_begin_;
+		int point_begin_;
+	};
+
+	size_t GetBlockEnd(size_t block) const {
+		return block + 1 < blocks_.size() ?
+				(size_t)blocks_[block + 1].point_begin_ : num_stored_;
+	}
+	void UpdateArrays();
+	void CopyArrays();
+	bool IsValid() const;
+	void BuildBlock(const double *points, int num_points, bool copy_data);
+	void MergeBlocks(size_t first_block, const double *points,
+			size_t num_points);
+	template<typename ResultSet>
+	void SearchBlocks(ResultSet &result, const double *query) const;
+
+	size_t CountNodes(size_t num_points,
+			std::map<size_t, size_t> &memo) const;
+	void BuildNode(const double *points, int node_id, int begin, int end,
+			int depth, int parallel_depth, std::map<size_t, size_t> &memo,
+			std::vector<std::tuple<int, int, int>> *deferred);
+	template<typename ResultSet>
+	void SearchLevel(ResultSet &result, const Scalar *query, int node_id,
+			double mindist2, double *offsets) const;
+	const Scalar *GetPoint(int i) const {
+		return external_data_ != nullptr ?
+				external_data_ + (size_t)point_array_[i] * Dim :
+				data_array_ + (size_t)i * Dim;
+	}
+
+private:
+	std::vector<Node> nodes_;
+	std::vector<int> point_indices_;
+	std::vector<Scalar> data_;
+	const Scalar *external_data_ = nullptr;
+
+	// The arrays searched; they point to the vectors above, or to mapped
+	// memory after Read().
+	const Node *node_array_ = nullptr;
+	const int *point_array_ = nullptr;
+	const Scalar *data_array_ = nullptr;
+	size_t num_nodes_ = 0;
+	size_t num_stored_ = 0;
+	std::vector<Block> blocks_;
+	std::vector<char> removed_;			// per index, empty if none removed
+	size_t num_removed_stored_ = 0;		// removed but still in a block
+	size_t num_indices_ = 0;
+};
+
+}	// namespace three
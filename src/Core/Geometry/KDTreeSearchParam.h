@@ -35,6 +35,7 @@ public:
 		SEARCH_KNN = 0,
 		SEARCH_RADIUS = 1,
 		SEARCH_HYBRID = 2,
+		SEARCH_APPROXIMATE_KNN = 3,
 	};
 
 public:
@@ -79,4 +80,20 @@ public:
 	int max_nn_;
 };
 
+/// Parameter of an approximate KNN search. At most checks_ leaves of the
+/// index are visited per query (-1 for unlimited, i.e. exact search). The
+/// budget only takes effect on the approximate indices of KDTreeFlann
+/// (KDTreeFlann::INDEX_KDTREE_RANDOMIZED and INDEX_KMEANS_HIERARCHICAL); the
+/// other indices answer it with an exact KNN search.
+class KDTreeSearchParamApproximateKNN : public KDTreeSearchParam
+{
+public:
+	KDTreeSearchParamApproximateKNN(int knn = 1, int checks = 128) :
+			KDTreeSearchParam(SEARCH_APPROXIMATE_KNN), knn_(knn),
+			checks_(checks) {}
+public:
+	int knn_;
+	int checks_;
+};
+
 }	// namespace three
@@ -0,0 +1,150 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+
+#include "PointCloud.h"
+
+#include <cmath>
+#include <Eigen/Eigenvalues>
+#include <Core/Utility/Console.h>
+#include <Core/Utility/Helper.h>
+#include <Core/Geometry/KDTreeFlann.h>
+#include <Core/Geometry/NeighborSearchBatch.h>
+
+namespace three{
+
+std::vector<size_t> ComputeISSKeypoints(const PointCloud &input,
+		double salient_radius/* = 0.0*/, double non_max_radius/* = 0.0*/,
+		double gamma_21/* = 0.975*/, double gamma_32/* = 0.975*/,
+		int min_neighbors/* = 5*/)
+{
+	std::vector<size_t> keypoints;
+	if (input.HasPoints() == false) {
+		return keypoints;
+	}
+	size_t num_points = input.points_.size();
+	auto get_point = [&](size_t i) { return input.points_[i]; };
+	KDTreeFlann kdtree(input);
+	if (salient_radius <= 0.0 || non_max_radius <= 0.0) {
+		// The default radii are multiples of the cloud resolution, the mean
+		// distance between nearest neighbors.
+		std::vector<double> nn_distances(num_points, 0.0);
+		if (ForEachNeighborhood(kdtree, KDTreeSearchParamKNN(2), num_points,
+				get_point, [&](size_t q, const int *, const double *distance2,
+				size_t num_neighbors) {
+			if (num_neighbors > 1) {
+				nn_distances[q] = std::sqrt(distance2[1]);
+			}
+		}) == false) {
+			PrintDebug("[ComputeISSKeypoints] Neighbor search failed.\n");
+			return keypoints;
+		}
+		double resolution = 0.0;
+		for (double d : nn_distances) {
+			resolution += d;
+		}
+		resolution /= (double)num_points;
+		if (resolution == 0.0) {
+			PrintDebug("[ComputeISSKeypoints] Cannot estimate the resolution of the point cloud.\n");
+			return keypoints;
+		}
+		if (salient_radius <= 0.0) {
+			salient_radius = 6.0 * resolution;
+		}
+		if (non_max_radius <= 0.0) {
+			non_max_radius = 4.0 * resolution;
+		}
+	}
+
+	// The saliency of a point is the smallest eigenvalue of the scatter
+	// matrix of its neighborhood. Points whose eigenvalues are too similar
+	// to define a stable frame are no candidates (saliency 0).
+	std::vector<double> saliency(num_points, 0.0);
+	if (ForEachNeighborhood(kdtree, KDTreeSearchParamRadius(salient_radius),
+			num_points, get_point, [&](size_t q, const int *indices,
+			const double *, size_t num_neighbors) {
+		if ((int)num_neighbors < min_neighbors || num_neighbors < 3) {
+			return;
+		}
+		Eigen::Vector3d mean = Eigen::Vector3d::Zero();
+		for (size_t k = 0; k < num_neighbors; k++) {
+			mean += input.points_[indices[k]];
+		}
+		mean /= (double)num_neighbors;
+		Eigen::Matrix3d covariance = Eigen::Matrix3d::Zero();
+		for (size_t k = 0; k < num_neighbors; k++) {
+			Eigen::Vector3d d = input.points_[indices[k]] - mean;
+			covariance += d * d.transpose();
+		}
+		covariance /= (double)num_neighbors;
+		Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver;
+		solver.computeDirect(covariance, Eigen::EigenvaluesOnly);
+		// eigenvalues in increasing order: lambda_3, lambda_2, lambda_1
+		const Eigen::Vector3d &lambda = solver.eigenvalues();
+		if (lambda(2) > 0.0 && lambda(1) > 0.0 && lambda(0) > 0.0 &&
+				lambda(1) / lambda(2) < gamma_21 &&
+				lambda(0) / lambda(1) < gamma_32) {
+			saliency[q] = lambda(0);
+		}
+	}) == false) {
+		PrintDebug("[ComputeISSKeypoints] Neighbor search failed.\n");
+		return keypoints;
+	}
+
+	// Non-maximum suppression: a candidate is a keypoint if no other point
+	// within non_max_radius is more salient; ties go to the lower index.
+	std::vector<uint8_t> is_candidate(num_points);
+	for (size_t i = 0; i < num_points; i++) {
+		is_candidate[i] = saliency[i] > 0.0 ? 1 : 0;
+	}
+	std::vector<size_t> candidates = GetNonZeroIndices(is_candidate);
+	std::vector<uint8_t> is_keypoint(candidates.size(), 0);
+	if (ForEachNeighborhood(kdtree, KDTreeSearchParamRadius(non_max_radius),
+			candidates.size(), [&](size_t q) {
+			return input.points_[candidates[q]]; }, [&](size_t q,
+			const int *indices, const double *, size_t num_neighbors) {
+		size_t i = candidates[q];
+		for (size_t k = 0; k < num_neighbors; k++) {
+			size_t j = (size_t)indices[k];
+			if (saliency[j] > saliency[i] ||
+					(saliency[j] == saliency[i] && j < i)) {
+				return;
+			}
+		}
+		is_keypoint[q] = 1;
+	}) == false) {
+		PrintDebug("[ComputeISSKeypoints] Neighbor search failed.\n");
+		return keypoints;
+	}
+	for (size_t q = 0; q < candidates.size(); q++) {
+		if (is_keypoint[q]) {
+			keypoints.push_back(candidates[q]);
+		}
+	}
+	return keypoints;
+}
+
+}	// namespace three
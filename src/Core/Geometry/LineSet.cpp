@@ -46,22 +46,12 @@ Eigen::Vector3d LineSet::GetMinBound() const
 	if (!HasPoints()) {
 		return Eigen::Vector3d(0.0, 0.0, 0.0);
 	}
-	auto itr_x0 = std::min_element(point_set_[0].begin(), point_set_[0].end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(0) < b(0); });
-	auto itr_y0 = std::min_element(point_set_[0].begin(), point_set_[0].end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(1) < b(1); });
-	auto itr_z0 = std::min_element(point_set_[0].begin(), point_set_[0].end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(2) < b(2); });
-	auto itr_x1 = std::min_element(point_set_[1].begin(), point_set_[1].end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(0) < b(0); });
-	auto itr_y1 = std::min_element(point_set_[1].begin(), point_set_[1].end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(1) < b(1); });
-	auto itr_z1 = std::min_element(point_set_[1].begin(), point_set_[1].end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(2) < b(2); });
-	return Eigen::Vector3d(
-			std::min((*itr_x0)(0), (*itr_x1)(0)),
-			std::min((*itr_y0)(1), (*itr_y1)(1)),
-			std::min((*itr_z0)(2), (*itr_z1)(2)));
+	Eigen::Vector3d min_bound0, max_bound0, min_bound1, max_bound1;
+	ComputeBounds(point_set_[0].data(), point_set_[0].size(), min_bound0,
+			max_bound0);
+	ComputeBounds(point_set_[1].data(), point_set_[1].size(), min_bound1,
+			max_bound1);
+	return min_bound0.cwiseMin(min_bound1);
 }
 
 Eigen::Vector3d LineSet::GetMaxBound() const
@@ -69,36 +59,20 @@ Eigen::Vector3d LineSet::GetMaxBound() const
 	if (!HasPoints()) {
 		return Eigen::Vector3d(0.0, 0.0, 0.0);
 	}
-	auto itr_x0 = std::max_element(point_set_[0].begin(), point_set_[0].end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(0) < b(0); });
-	auto itr_y0 = std::max_element(point_set_[0].begin(), point_set_[0].end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(1) < b(1); });
-	auto itr_z0 = std::max_element(point_set_[0].begin(), point_set_[0].end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(2) < b(2); });
-	auto itr_x1 = std::max_element(point_set_[1].begin(), point_set_[1].end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(0) < b(0); });
-	auto itr_y1 = std::max_element(point_set_[1].begin(), point_set_[1].end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(1) < b(1); });
-	auto itr_z1 = std::max_element(point_set_[1].begin(), point_set_[1].end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(2) < b(2); });
-	return Eigen::Vector3d(
-			std::max((*itr_x0)(0), (*itr_x1)(0)),
-			std::max((*itr_y0)(1), (*itr_y1)(1)),
-			std::max((*itr_z0)(2), (*itr_z1)(2)));
+	Eigen::Vector3d min_bound0, max_bound0, min_bound1, max_bound1;
+	ComputeBounds(point_set_[0].data(), point_set_[0].size(), min_bound0,
+			max_bound0);
+	ComputeBounds(point_set_[1].data(), point_set_[1].size(), min_bound1,
+			max_bound1);
+	return max_bound0.cwiseMax(max_bound1);
 }
 
 void LineSet::Transform(const Eigen::Matrix4d &transformation)
 {
-	for (auto &point : point_set_[0]) {
-		Eigen::Vector4d new_point = transformation * Eigen::Vector4d(
-				point(0), point(1), point(2), 1.0);
-		point = new_point.block<3, 1>(0, 0);
-	}
-	for (auto &point : point_set_[1]) {
-		Eigen::Vector4d new_point = transformation * Eigen::Vector4d(
-				point(0), point(1), point(2), 1.0);
-		point = new_point.block<3, 1>(0, 0);
-	}
+	TransformPoints(transformation, point_set_[0].data(),
+			point_set_[0].size());
+	TransformPoints(transformation, point_set_[1].data(),
+			point_set_[1].size());
 }
 
 LineSet &LineSet::operator+=(const LineSet &lineset)
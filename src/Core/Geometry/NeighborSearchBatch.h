@@ -0,0 +1,272 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <Eigen/Core>
+#include <Core/Geometry/KDTreeSearchParam.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace three {
+
+/// Default number of queries searched at once by SearchNeighborsInBatches.
+const size_t neighbor_search_batch_size = 65536;
+
+/// Function to sort two parallel arrays of neighbors by distance without
+/// extra memory.
+inline void SortNeighborsByDistance(int *indices, double *distance2, int n)
+{
+	// quicksort on the larger partitions, insertion sort on the small ones
+	while (n > 16) {
+		double pivot = distance2[n / 2];
+		int i = 0, j = n - 1;
+		while (i <= j) {
+			while (distance2[i] < pivot) i++;
+			while (distance2[j] > pivot) j--;
+			if (i <= j) {
+				std::swap(distance2[i], distance2[j]);
+				std::swap(indices[i], indices[j]);
+				i++;
+				j--;
+			}
+		}
+		if (j + 1 < n - i) {
+			SortNeighborsByDistance(indices, distance2, j + 1);
+			indices += i;
+			distance2 += i;
+			n -= i;
+		} else {
+			SortNeighborsByDistance(indices + i, distance2 + i, n - i);
+			n = j + 1;
+		}
+	}
+	for (int i = 1; i < n; i++) {
+		double d = distance2[i];
+		int index = indices[i];
+		int j = i;
+		while (j > 0 && distance2[j - 1] > d) {
+			distance2[j] = distance2[j - 1];
+			indices[j] = indices[j - 1];
+			j--;
+		}
+		distance2[j] = d;
+		indices[j] = index;
+	}
+}
+
+/// Result set keeping the (at most) capacity nearest neighbors closer than
+/// max_distance2, sorted by distance.
+class KNNResultSet
+{
+public:
+	KNNResultSet(int *indices, double *distance2, int capacity,
+			double max_distance2) : indices_(indices), distance2_(distance2),
+			capacity_(capacity), count_(0), worst_(max_distance2) {}
+
+public:
+	double WorstDistance() const { return worst_; }
+	void AddPoint(double d, int index) {
+		int i = count_ < capacity_ ? count_++ : capacity_ - 1;
+		while (i > 0 && distance2_[i - 1] > d) {
+			distance2_[i] = distance2_[i - 1];
+			indices_[i] = indices_[i - 1];
+			i--;
+		}
+		distance2_[i] = d;
+		indices_[i] = index;
+		if (count_ == capacity_) {
+			worst_ = distance2_[capacity_ - 1];
+		}
+	}
+
+public:
+	int *indices_;
+	double *distance2_;
+	int capacity_;
+	int count_;
+	double worst_;
+};
+
+/// Result set keeping all neighbors closer than max_distance2, unsorted.
+class RadiusResultSet
+{
+public:
+	RadiusResultSet(std::vector<int> &indices, std::vector<double> &distance2,
+			double max_distance2) : indices_(indices), distance2_(distance2),
+			worst_(max_distance2) {}
+
+public:
+	double WorstDistance() const { return worst_; }
+	void AddPoint(double d, int index) {
+		indices_.push_back(index);
+		distance2_.push_back(d);
+	}
+
+public:
+	std::vector<int> &indices_;
+	std::vector<double> &distance2_;
+	double worst_;
+};
+
+/// Function to run a batch of neighbor queries in parallel and return the
+/// results in the compressed (CSR) layout used by the SearchBatch functions
+/// of the search indices. Each column of \param queries is a query.
+/// \param searcher is copied once per thread, so it can hold reusable search
+/// buffers. It must provide
+///     void Search(const double *query, size_t dimension,
+///             std::vector<int> &indices, std::vector<double> &distance2);
+/// which appends the neighbors of one query to the given vectors.
+/// Return the total number of neighbors found.
+template<typename Searcher>
+int SearchBatchParallel(const Searcher &searcher,
+		const Eigen::Map<const Eigen::MatrixXd> &queries,
+		std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets)
+{
+	// Every thread searches a contiguous block of queries into its own
+	// buffers, which are then concatenated in query order.
+	int num_queries = (int)queries.cols();
+	size_t dimension = (size_t)queries.rows();
+	offsets.resize(num_queries + 1);
+	offsets[0] = 0;
+	if (num_queries == 0) {
+		indices.clear();
+		distance2.clear();
+		return 0;
+	}
+	int num_threads = 1;
+#ifdef _OPENMP
+	num_threads = omp_get_max_threads();
+#endif
+	std::vector<int> thread_begin(num_threads, num_queries);
+	std::vector<std::vector<int>> thread_indices(num_threads);
+	std::vector<std::vector<double>> thread_distance2(num_threads);
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads)
+#endif
+	{
+		int thread_id = 0;
+#ifdef _OPENMP
+		thread_id = omp_get_thread_num();
+#endif
+		auto &indices_private = thread_indices[thread_id];
+		auto &distance2_private = thread_distance2[thread_id];
+		Searcher searcher_private(searcher);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+		for (int i = 0; i < num_queries; i++) {
+			if (thread_begin[thread_id] == num_queries) {
+				thread_begin[thread_id] = i;
+			}
+			size_t num_found = indices_private.size();
+			searcher_private.Search(queries.col(i).data(), dimension,
+					indices_private, distance2_private);
+			offsets[i + 1] = indices_private.size() - num_found;
+		}
+	}
+	for (int i = 0; i < num_queries; i++) {
+		offsets[i + 1] += offsets[i];
+	}
+	indices.resize(offsets[num_queries]);
+	distance2.resize(offsets[num_queries]);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(num_threads)
+#endif
+	for (int t = 0; t < num_threads; t++) {
+		if (thread_begin[t] < num_queries) {
+			std::copy(thread_indices[t].begin(), thread_indices[t].end(),
+					indices.begin() + offsets[thread_begin[t]]);
+			std::copy(thread_distance2[t].begin(), thread_distance2[t].end(),
+					distance2.begin() + offsets[thread_begin[t]]);
+		}
+	}
+	return (int)offsets[num_queries];
+}
+
+/// Function to search the neighbors of \param num_queries 3D queries with
+/// the SearchBatch function of \param index in batches of \param batch_size,
+/// so that only one batch of neighbor lists is held at a time.
+/// \param get_query(q) returns query q as an Eigen::Vector3d, and
+/// \param process(begin, indices, distance2, offsets) is called once per
+/// batch with the compressed results of the queries begin, begin + 1, ...
+/// The result vectors may be modified by process.
+/// Return false if a search fails.
+template<typename Index, typename GetQuery, typename ProcessBatch>
+bool SearchNeighborsInBatches(const Index &index,
+		const KDTreeSearchParam &param, size_t num_queries,
+		GetQuery get_query, ProcessBatch process,
+		size_t batch_size = neighbor_search_batch_size)
+{
+	Eigen::Matrix3Xd queries;
+	std::vector<int> indices;
+	std::vector<double> distance2;
+	std::vector<size_t> offsets;
+	for (size_t begin = 0; begin < num_queries; begin += batch_size) {
+		int num_batch = (int)std::min(batch_size, num_queries - begin);
+		queries.resize(3, num_batch);
+		for (int j = 0; j < num_batch; j++) {
+			queries.col(j) = get_query(begin + j);
+		}
+		if (index.SearchBatch(queries, param, indices, distance2,
+				offsets) < 0) {
+			return false;
+		}
+		process(begin, indices, distance2, offsets);
+	}
+	return true;
+}
+
+/// Function to search the neighbors of \param num_queries 3D queries in
+/// batches, see SearchNeighborsInBatches, and to call
+/// \param f(q, indices, distance2, num_neighbors) for each query q, in
+/// parallel within a batch.
+/// Return false if a search fails.
+template<typename Index, typename GetQuery, typename Func>
+bool ForEachNeighborhood(const Index &index, const KDTreeSearchParam &param,
+		size_t num_queries, GetQuery get_query, Func f)
+{
+	return SearchNeighborsInBatches(index, param, num_queries, get_query,
+			[&](size_t begin, const std::vector<int> &indices,
+			const std::vector<double> &distance2,
+			const std::vector<size_t> &offsets) {
+		int num_batch = (int)offsets.size() - 1;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for (int j = 0; j < num_batch; j++) {
+			f(begin + j, indices.data() + offsets[j],
+					distance2.data() + offsets[j], offsets[j + 1] - offsets[j]);
+		}
+	});
+}
+
+}	// namespace three
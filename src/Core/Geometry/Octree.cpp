@@ -0,0 +1,483 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+
+#include "Octree.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <Core/Geometry/PointCloud.h>
+#include <Core/Utility/Console.h>
+#include <Core/Utility/Helper.h>
+
+namespace three{
+
+namespace {
+
+const int octree_max_depth = 21;
+
+/// Spreads the lowest 21 bits of \param a so that there are two zero bits
+/// between consecutive bits.
+uint64_t SplitBy3(uint32_t a)
+{
+	uint64_t x = a & 0x1fffff;
+	x = (x | x << 32) & 0x1f00000000ffffull;
+	x = (x | x << 16) & 0x1f0000ff0000ffull;
+	x = (x | x << 8) & 0x100f00f00f00f00full;
+	x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+	x = (x | x << 2) & 0x1249249249249249ull;
+	return x;
+}
+
+/// Relation of a node's bounds to a query region
+enum NodeRelation {
+	NODE_OUTSIDE = 0,
+	NODE_INTERSECTS = 1,
+	NODE_INSIDE = 2,
+};
+
+NodeRelation GetBoxRelation(const OctreeNode &node,
+		const Eigen::Vector3d &min_bound, const Eigen::Vector3d &max_bound)
+{
+	if ((node.max_bound_.array() < min_bound.array()).any() ||
+			(node.min_bound_.array() > max_bound.array()).any()) {
+		return NODE_OUTSIDE;
+	}
+	if ((node.min_bound_.array() >= min_bound.array()).all() &&
+			(node.max_bound_.array() <= max_bound.array()).all()) {
+		return NODE_INSIDE;
+	}
+	return NODE_INTERSECTS;
+}
+
+/// The frustum planes (a, b, c, d) of a view projection matrix, with
+/// a * x + b * y + c * z + d >= 0 inside the frustum.
+std::array<Eigen::Vector4d, 6> GetFrustumPlanes(
+		const Eigen::Matrix4d &view_projection)
+{
+	std::array<Eigen::Vector4d, 6> planes;
+	for (int k = 0; k < 3; k++) {
+		planes[2 * k] = (view_projection.row(3) +
+				view_projection.row(k)).transpose();
+		planes[2 * k + 1] = (view_projection.row(3) -
+				view_projection.row(k)).transpose();
+	}
+	return planes;
+}
+
+bool IsInsideFrustum(const std::array<Eigen::Vector4d, 6> &planes,
+		const Eigen::Vector3d &point)
+{
+	for (const auto &plane : planes) {
+		if (plane.head<3>().dot(point) + plane(3) < 0.0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+NodeRelation GetFrustumRelation(const OctreeNode &node,
+		const std::array<Eigen::Vector4d, 6> &planes)
+{
+	NodeRelation relation = NODE_INSIDE;
+	for (const auto &plane : planes) {
+		// The corners of the bounds farthest along and against the normal
+		Eigen::Vector3d positive, negative;
+		for (int k = 0; k < 3; k++) {
+			positive(k) = plane(k) >= 0.0 ? node.max_bound_(k) :
+					node.min_bound_(k);
+			negative(k) = plane(k) >= 0.0 ? node.min_bound_(k) :
+					node.max_bound_(k);
+		}
+		if (plane.head<3>().dot(positive) + plane(3) < 0.0) {
+			return NODE_OUTSIDE;
+		}
+		if (plane.head<3>().dot(negative) + plane(3) < 0.0) {
+			relation = NODE_INTERSECTS;
+		}
+	}
+	return relation;
+}
+
+/// Collects the points of the nodes classified as inside and the points of
+/// intersected leaves that pass \param IsInside.
+template<typename GetRelation, typename IsInside>
+int QueryPoints(const Octree &octree, GetRelation get_relation,
+		IsInside is_inside, std::vector<size_t> &indices)
+{
+	indices.clear();
+	if (octree.nodes_.empty()) {
+		return 0;
+	}
+	std::vector<int> stack(1, 0);
+	while (!stack.empty()) {
+		const OctreeNode &node = octree.nodes_[stack.back()];
+		stack.pop_back();
+		NodeRelation relation = get_relation(node);
+		if (relation == NODE_INSIDE) {
+			indices.insert(indices.end(),
+					octree.indices_.begin() + node.point_begin_,
+					octree.indices_.begin() + node.point_end_);
+		} else if (relation == NODE_INTERSECTS) {
+			if (node.IsLeaf()) {
+				for (size_t i = node.point_begin_; i < node.point_end_; i++) {
+					if (is_inside(octree.points_[i])) {
+						indices.push_back(octree.indices_[i]);
+					}
+				}
+			} else {
+				for (int k = 0; k < 8; k++) {
+					if (node.children_[k] >= 0) {
+						stack.push_back(node.children_[k]);
+					}
+				}
+			}
+		}
+	}
+	std::sort(indices.begin(), indices.end());
+	return (int)indices.size();
+}
+
+}	// unnamed namespace
+
+void Octree::Clear()
+{
+	nodes_.clear();
+	level_offsets_.clear();
+	points_.clear();
+	colors_.clear();
+	indices_.clear();
+	origin_.setZero();
+	size_ = 0.0;
+	max_depth_ = 0;
+	max_leaf_size_ = 1;
+}
+
+bool Octree::IsEmpty() const
+{
+	return !HasPoints();
+}
+
+Eigen::Vector3d Octree::GetMinBound() const
+{
+	if (nodes_.empty()) {
+		return Eigen::Vector3d(0.0, 0.0, 0.0);
+	}
+	return nodes_[0].min_bound_;
+}
+
+Eigen::Vector3d Octree::GetMaxBound() const
+{
+	if (nodes_.empty()) {
+		return Eigen::Vector3d(0.0, 0.0, 0.0);
+	}
+	return nodes_[0].max_bound_;
+}
+
+void Octree::Transform(const Eigen::Matrix4d &transformation)
+{
+	TransformPoints(transformation, points_.data(), points_.size());
+	Build();
+}
+
+bool Octree::ConvertFromPointCloud(const PointCloud &cloud, int max_depth,
+		size_t max_leaf_size/* = 1*/)
+{
+	if (max_depth < 0 || max_depth > octree_max_depth) {
+		PrintDebug("[Octree] max_depth must be in [0, %d].\n",
+				octree_max_depth);
+		return false;
+	}
+	if (max_leaf_size == 0) {
+		PrintDebug("[Octree] max_leaf_size must be positive.\n");
+		return false;
+	}
+	Clear();
+	points_ = cloud.points_;
+	if (cloud.HasColors()) {
+		colors_ = cloud.colors_;
+	}
+	indices_.resize(points_.size());
+	for (size_t i = 0; i < indices_.size(); i++) {
+		indices_[i] = i;
+	}
+	max_depth_ = max_depth;
+	max_leaf_size_ = max_leaf_size;
+	Build();
+	return true;
+}
+
+void Octree::Build()
+{
+	size_t num_points = points_.size();
+	nodes_.clear();
+	level_offsets_.assign(1, 0);
+	if (num_points == 0) {
+		return;
+	}
+	Eigen::Vector3d min_bound, max_bound;
+	ComputeBounds(points_.data(), num_points, min_bound, max_bound);
+	origin_ = min_bound;
+	size_ = (max_bound - min_bound).maxCoeff();
+	if (size_ <= 0.0) {
+		size_ = 1.0;
+	}
+
+	// The points are sorted by the Morton code of their cell at max_depth_,
+	// so that the points of every node are contiguous and the children of a
+	// node split its range in octant order.
+	int max_cell = (1 << max_depth_) - 1;
+	double scale = (double)(1 << max_depth_) / size_;
+	std::vector<uint64_t> keys(num_points);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int i = 0; i < (int)num_points; i++) {
+		Eigen::Vector3d ref_coord = (points_[i] - origin_) * scale;
+		uint64_t key = 0;
+		for (int k = 0; k < 3; k++) {
+			int cell = std::min(std::max(int(floor(ref_coord(k))), 0),
+					max_cell);
+			key |= SplitBy3((uint32_t)cell) << k;
+		}
+		keys[i] = key;
+	}
+	std::vector<uint32_t> order;
+	RadixSortKeys(keys, order, 3 * max_depth_);
+	bool has_colors = HasColors();
+	std::vector<Eigen::Vector3d> sorted_points(num_points);
+	std::vector<Eigen::Vector3d> sorted_colors(has_colors ? num_points : 0);
+	std::vector<size_t> sorted_indices(num_points);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int i = 0; i < (int)num_points; i++) {
+		sorted_points[i] = points_[order[i]];
+		if (has_colors) {
+			sorted_colors[i] = colors_[order[i]];
+		}
+		sorted_indices[i] = indices_[order[i]];
+	}
+	points_.swap(sorted_points);
+	colors_.swap(sorted_colors);
+	indices_.swap(sorted_indices);
+
+	// The tree is built one level at a time: the children of each node are
+	// found by binary search on the octant digit of the keys, counted, and
+	// allocated after the nodes of the level. Nodes of at most
+	// max_leaf_size_ points are not subdivided.
+	OctreeNode root;
+	std::fill(root.children_, root.children_ + 8, -1);
+	root.depth_ = 0;
+	root.point_begin_ = 0;
+	root.point_end_ = num_points;
+	nodes_.push_back(root);
+	level_offsets_.push_back(1);
+	for (int depth = 0; depth < max_depth_; depth++) {
+		size_t level_begin = level_offsets_[depth];
+		int num_level_nodes = (int)(level_offsets_[depth + 1] - level_begin);
+		int shift = 3 * (max_depth_ - 1 - depth);
+		std::vector<std::array<size_t, 9>> splits(num_level_nodes);
+		std::vector<size_t> child_offsets(num_level_nodes + 1, 0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for (int i = 0; i < num_level_nodes; i++) {
+			const OctreeNode &node = nodes_[level_begin + i];
+			if (node.GetNumPoints() <= max_leaf_size_) {
+				continue;
+			}
+			auto begin = keys.begin() + node.point_begin_;
+			auto end = keys.begin() + node.point_end_;
+			for (int k = 0; k <= 8; k++) {
+				splits[i][k] = std::partition_point(begin, end,
+						[&](uint64_t key) {
+					return (int)((key >> shift) & 7) < k;
+				}) - keys.begin();
+			}
+			for (int k = 0; k < 8; k++) {
+				if (splits[i][k + 1] > splits[i][k]) {
+					child_offsets[i + 1]++;
+				}
+			}
+		}
+		for (int i = 0; i < num_level_nodes; i++) {
+			child_offsets[i + 1] += child_offsets[i];
+		}
+		size_t level_end = level_begin + num_level_nodes;
+		nodes_.resize(level_end + child_offsets[num_level_nodes]);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for (int i = 0; i < num_level_nodes; i++) {
+			OctreeNode &node = nodes_[level_begin + i];
+			if (node.GetNumPoints() <= max_leaf_size_) {
+				continue;
+			}
+			size_t child = level_end + child_offsets[i];
+			for (int k = 0; k < 8; k++) {
+				if (splits[i][k + 1] > splits[i][k]) {
+					OctreeNode &child_node = nodes_[child];
+					std::fill(child_node.children_, child_node.children_ + 8,
+							-1);
+					child_node.depth_ = depth + 1;
+					child_node.point_begin_ = splits[i][k];
+					child_node.point_end_ = splits[i][k + 1];
+					node.children_[k] = (int)child;
+					child++;
+				}
+			}
+		}
+		level_offsets_.push_back(nodes_.size());
+	}
+
+	// The aggregates are computed from the points of the leaves and from the
+	// children of the other nodes.
+	for (int depth = max_depth_; depth >= 0; depth--) {
+		size_t level_begin = level_offsets_[depth];
+		int num_level_nodes = (int)(level_offsets_[depth + 1] - level_begin);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for (int i = 0; i < num_level_nodes; i++) {
+			OctreeNode &node = nodes_[level_begin + i];
+			Eigen::Vector3d point_sum(0.0, 0.0, 0.0);
+			Eigen::Vector3d color_sum(0.0, 0.0, 0.0);
+			node.min_bound_ = node.max_bound_ = points_[node.point_begin_];
+			if (node.IsLeaf()) {
+				for (size_t j = node.point_begin_; j < node.point_end_; j++) {
+					point_sum += points_[j];
+					if (has_colors) {
+						color_sum += colors_[j];
+					}
+					node.min_bound_ = node.min_bound_.cwiseMin(points_[j]);
+					node.max_bound_ = node.max_bound_.cwiseMax(points_[j]);
+				}
+			} else {
+				for (int k = 0; k < 8; k++) {
+					if (node.children_[k] < 0) {
+						continue;
+					}
+					const OctreeNode &child = nodes_[node.children_[k]];
+					double weight = (double)child.GetNumPoints();
+					point_sum += child.centroid_ * weight;
+					color_sum += child.color_ * weight;
+					node.min_bound_ = node.min_bound_.cwiseMin(
+							child.min_bound_);
+					node.max_bound_ = node.max_bound_.cwiseMax(
+							child.max_bound_);
+				}
+			}
+			node.centroid_ = point_sum / (double)node.GetNumPoints();
+			node.color_ = color_sum / (double)node.GetNumPoints();
+		}
+	}
+}
+
+int Octree::QueryBox(const Eigen::Vector3d &min_bound,
+		const Eigen::Vector3d &max_bound, std::vector<size_t> &indices) const
+{
+	return QueryPoints(*this, [&](const OctreeNode &node) {
+		return GetBoxRelation(node, min_bound, max_bound);
+	}, [&](const Eigen::Vector3d &point) {
+		return (point.array() >= min_bound.array()).all() &&
+				(point.array() <= max_bound.array()).all();
+	}, indices);
+}
+
+int Octree::QueryFrustum(const Eigen::Matrix4d &view_projection,
+		std::vector<size_t> &indices) const
+{
+	auto planes = GetFrustumPlanes(view_projection);
+	return QueryPoints(*this, [&](const OctreeNode &node) {
+		return GetFrustumRelation(node, planes);
+	}, [&](const Eigen::Vector3d &point) {
+		return IsInsideFrustum(planes, point);
+	}, indices);
+}
+
+int Octree::QueryFrustumNodes(const Eigen::Matrix4d &view_projection,
+		int depth, std::vector<int> &nodes) const
+{
+	nodes.clear();
+	if (nodes_.empty()) {
+		return 0;
+	}
+	if (depth < 0 || depth > max_depth_) {
+		PrintDebug("[QueryFrustumNodes] depth must be in [0, %d].\n",
+				max_depth_);
+		return 0;
+	}
+	auto planes = GetFrustumPlanes(view_projection);
+	std::vector<int> stack(1, 0);
+	while (!stack.empty()) {
+		int index = stack.back();
+		stack.pop_back();
+		const OctreeNode &node = nodes_[index];
+		NodeRelation relation = GetFrustumRelation(node, planes);
+		if (relation == NODE_OUTSIDE) {
+			continue;
+		}
+		if (node.depth_ == depth || node.IsLeaf()) {
+			nodes.push_back(index);
+			continue;
+		}
+		for (int k = 0; k < 8; k++) {
+			if (node.children_[k] >= 0) {
+				stack.push_back(node.children_[k]);
+			}
+		}
+	}
+	std::sort(nodes.begin(), nodes.end());
+	return (int)nodes.size();
+}
+
+std::shared_ptr<PointCloud> Octree::ExtractLevelOfDetail(int depth) const
+{
+	auto output = std::make_shared<PointCloud>();
+	if (nodes_.empty()) {
+		return output;
+	}
+	if (depth < 0 || depth > max_depth_) {
+		PrintDebug("[ExtractLevelOfDetail] depth must be in [0, %d].\n",
+				max_depth_);
+		return output;
+	}
+	// The levels above depth only contribute their leaves.
+	for (size_t i = 0; i < level_offsets_[depth + 1]; i++) {
+		const OctreeNode &node = nodes_[i];
+		if (node.depth_ == depth || node.IsLeaf()) {
+			output->points_.push_back(node.centroid_);
+			if (HasColors()) {
+				output->colors_.push_back(node.color_);
+			}
+		}
+	}
+	return output;
+}
+
+}	// namespace three
@@ -0,0 +1,153 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <Eigen/Core>
+#include <Core/Geometry/Geometry3D.h>
+
+namespace three {
+
+class PointCloud;
+
+class OctreeNode
+{
+public:
+	bool IsLeaf() const {
+		for (int k = 0; k < 8; k++) {
+			if (children_[k] >= 0) return false;
+		}
+		return true;
+	}
+
+	size_t GetNumPoints() const { return point_end_ - point_begin_; }
+
+public:
+	/// Index in Octree::nodes_ of the child in each octant, or -1 if the
+	/// octant is empty. Bit 0 of the octant selects the upper half in x,
+	/// bit 1 in y and bit 2 in z.
+	int children_[8];
+	int depth_;
+	/// The points of the node are points_[point_begin_], ...,
+	/// points_[point_end_ - 1] of the Octree.
+	size_t point_begin_;
+	size_t point_end_;
+	/// Tight bounds, centroid and average color of the points of the node
+	Eigen::Vector3d min_bound_;
+	Eigen::Vector3d max_bound_;
+	Eigen::Vector3d centroid_;
+	Eigen::Vector3d color_;
+};
+
+/// Octree over the points of a point cloud. A node is subdivided until it
+/// holds at most max_leaf_size_ points or reaches max_depth_, so leaves can
+/// be at any depth. The nodes are stored level by level, so the nodes at
+/// depth d are nodes_[level_offsets_[d]], ..., nodes_[level_offsets_[d + 1]
+/// - 1]. The points are stored in Morton order together with their index in
+/// the source point cloud.
+class Octree : public Geometry3D
+{
+public:
+	Octree() : Geometry3D(GEOMETRY_OCTREE) {}
+	~Octree() override {}
+
+public:
+	void Clear() override;
+	bool IsEmpty() const override;
+	Eigen::Vector3d GetMinBound() const override;
+	Eigen::Vector3d GetMaxBound() const override;
+	/// The cells are axis-aligned, so the tree is rebuilt on the transformed
+	/// points.
+	void Transform(const Eigen::Matrix4d &transformation) override;
+
+public:
+	bool HasPoints() const {
+		return points_.size() > 0;
+	}
+
+	bool HasColors() const {
+		return points_.size() > 0 && colors_.size() == points_.size();
+	}
+
+	/// Function to build the tree over the points of \param cloud, down to
+	/// \param max_depth (at most 21) levels below the root. Nodes of at most
+	/// \param max_leaf_size points are leaves.
+	bool ConvertFromPointCloud(const PointCloud &cloud, int max_depth,
+			size_t max_leaf_size = 1);
+
+	/// Function to find the points inside the box [\param min_bound,
+	/// \param max_bound]. \param indices are the indices of the points in the
+	/// source point cloud, in increasing order.
+	/// Return the number of points found.
+	int QueryBox(const Eigen::Vector3d &min_bound,
+			const Eigen::Vector3d &max_bound,
+			std::vector<size_t> &indices) const;
+
+	/// Function to find the points inside the view frustum of
+	/// \param view_projection, the product of an OpenGL projection matrix and
+	/// a view matrix. A point is inside if its clip coordinates are within
+	/// [-w, w]. Return the number of points found.
+	int QueryFrustum(const Eigen::Matrix4d &view_projection,
+			std::vector<size_t> &indices) const;
+
+	/// Function to find the nodes at \param depth, and the leaves above it,
+	/// whose bounds intersect the view frustum of \param view_projection,
+	/// e.g. to draw only the visible part of a level of detail.
+	/// \param nodes are indices in nodes_.
+	int QueryFrustumNodes(const Eigen::Matrix4d &view_projection, int depth,
+			std::vector<int> &nodes) const;
+
+	/// Function to extract the level of detail at \param depth: one point per
+	/// node at that depth or leaf above it, at the centroid of the node and
+	/// with its average color.
+	std::shared_ptr<PointCloud> ExtractLevelOfDetail(int depth) const;
+
+protected:
+	void Build();
+
+public:
+	std::vector<OctreeNode> nodes_;
+	std::vector<size_t> level_offsets_;
+	std::vector<Eigen::Vector3d> points_;
+	std::vector<Eigen::Vector3d> colors_;
+	std::vector<size_t> indices_;
+	/// The root cell is the cube of side size_ whose minimum corner is
+	/// origin_.
+	Eigen::Vector3d origin_ = Eigen::Vector3d::Zero();
+	double size_ = 0.0;
+	int max_depth_ = 0;
+	size_t max_leaf_size_ = 1;
+};
+
+/// Factory function to create an octree from a point cloud
+/// (OctreeFactory.cpp)
+std::shared_ptr<Octree> CreateOctreeFromPointCloud(const PointCloud &cloud,
+		int max_depth, size_t max_leaf_size = 1);
+
+}	// namespace three
@@ -0,0 +1,148 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+
+#include "PointCloud.h"
+
+#include <algorithm>
+#include <cmath>
+#include <Core/Utility/Console.h>
+#include <Core/Geometry/KDTreeFlann.h>
+#include <Core/Geometry/NeighborSearchBatch.h>
+
+namespace three{
+
+namespace {
+
+/// Searches the neighbors of all points of \param cloud and calls
+/// \param f(i, indices, distance2, num_neighbors) for each point i, see
+/// ForEachNeighborhood. Returns false if a search fails.
+template<typename Func>
+bool ForEachPointNeighborhood(const PointCloud &cloud,
+		const KDTreeSearchParam &search_param, Func f)
+{
+	KDTreeFlann kdtree(cloud);
+	return ForEachNeighborhood(kdtree, search_param, cloud.points_.size(),
+			[&](size_t i) { return cloud.points_[i]; }, f);
+}
+
+/// Returns the indices of all points of \param cloud, so that a filter that
+/// cannot run keeps the point cloud unchanged.
+std::vector<size_t> GetAllIndices(const PointCloud &cloud)
+{
+	std::vector<size_t> indices(cloud.points_.size());
+	for (size_t i = 0; i < indices.size(); i++) {
+		indices[i] = i;
+	}
+	return indices;
+}
+
+}	// unnamed namespace
+
+std::vector<size_t> RemoveStatisticalOutliers(const PointCloud &cloud,
+		int nb_neighbors, double std_ratio)
+{
+	std::vector<size_t> inliers;
+	if (nb_neighbors < 1 || std_ratio <= 0.0) {
+		PrintWarning("[RemoveStatisticalOutliers] Illegal input parameters, nb_neighbors and std_ratio must be positive. All points are kept.\n");
+		return GetAllIndices(cloud);
+	}
+	if (cloud.HasPoints() == false) {
+		return inliers;
+	}
+	// The query point is its own nearest neighbor, so one more neighbor is
+	// searched and the first one is skipped.
+	std::vector<double> avg_distances(cloud.points_.size());
+	if (ForEachPointNeighborhood(cloud, KDTreeSearchParamKNN(nb_neighbors + 1),
+			[&](size_t i, const int *, const double *distance2,
+			size_t num_neighbors) {
+		double sum = 0.0;
+		for (size_t k = 1; k < num_neighbors; k++) {
+			sum += std::sqrt(distance2[k]);
+		}
+		avg_distances[i] = num_neighbors > 1 ?
+				sum / (double)(num_neighbors - 1) : 0.0;
+	}) == false) {
+		PrintWarning("[RemoveStatisticalOutliers] Neighbor search failed. All points are kept.\n");
+		return GetAllIndices(cloud);
+	}
+	double mean = 0.0, sq_sum = 0.0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) reduction(+:mean, sq_sum)
+#endif
+	for (int i = 0; i < (int)avg_distances.size(); i++) {
+		mean += avg_distances[i];
+		sq_sum += avg_distances[i] * avg_distances[i];
+	}
+	double num_points = (double)avg_distances.size();
+	mean /= num_points;
+	double std_dev = num_points > 1.0 ? std::sqrt(std::max(0.0,
+			(sq_sum - num_points * mean * mean) / (num_points - 1.0))) : 0.0;
+	double threshold = mean + std_ratio * std_dev;
+	for (size_t i = 0; i < avg_distances.size(); i++) {
+		if (avg_distances[i] <= threshold) {
+			inliers.push_back(i);
+		}
+	}
+	PrintDebug("[RemoveStatisticalOutliers] %d of %d points are outliers.\n",
+			(int)(cloud.points_.size() - inliers.size()),
+			(int)cloud.points_.size());
+	return inliers;
+}
+
+std::vector<size_t> RemoveRadiusOutliers(const PointCloud &cloud,
+		int nb_points, double radius)
+{
+	std::vector<size_t> inliers;
+	if (nb_points < 1 || radius <= 0.0) {
+		PrintWarning("[RemoveRadiusOutliers] Illegal input parameters, nb_points and radius must be positive. All points are kept.\n");
+		return GetAllIndices(cloud);
+	}
+	if (cloud.HasPoints() == false) {
+		return inliers;
+	}
+	// Counting stops at nb_points neighbors besides the query point itself.
+	std::vector<uint8_t> is_inlier(cloud.points_.size());
+	if (ForEachPointNeighborhood(cloud, KDTreeSearchParamHybrid(radius,
+			nb_points + 1), [&](size_t i, const int *, const double *,
+			size_t num_neighbors) {
+		is_inlier[i] = (num_neighbors > (size_t)nb_points) ? 1 : 0;
+	}) == false) {
+		PrintWarning("[RemoveRadiusOutliers] Neighbor search failed. All points are kept.\n");
+		return GetAllIndices(cloud);
+	}
+	for (size_t i = 0; i < is_inlier.size(); i++) {
+		if (is_inlier[i]) {
+			inliers.push_back(i);
+		}
+	}
+	PrintDebug("[RemoveRadiusOutliers] %d of %d points are outliers.\n",
+			(int)(cloud.points_.size() - inliers.size()),
+			(int)cloud.points_.size());
+	return inliers;
+}
+
+}	// namespace three
@@ -0,0 +1,291 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+
+#include "PointAttribute.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace three{
+
+namespace {
+
+template<typename T>
+struct AttributeValueType {};
+
+template<> struct AttributeValueType<int8_t> {
+	static const PointAttribute::ValueType value = PointAttribute::VALUE_INT8;
+};
+template<> struct AttributeValueType<uint8_t> {
+	static const PointAttribute::ValueType value = PointAttribute::VALUE_UINT8;
+};
+template<> struct AttributeValueType<int16_t> {
+	static const PointAttribute::ValueType value = PointAttribute::VALUE_INT16;
+};
+template<> struct AttributeValueType<uint16_t> {
+	static const PointAttribute::ValueType value =
+			PointAttribute::VALUE_UINT16;
+};
+template<> struct AttributeValueType<int32_t> {
+	static const PointAttribute::ValueType value = PointAttribute::VALUE_INT32;
+};
+template<> struct AttributeValueType<uint32_t> {
+	static const PointAttribute::ValueType value =
+			PointAttribute::VALUE_UINT32;
+};
+template<> struct AttributeValueType<float> {
+	static const PointAttribute::ValueType value = PointAttribute::VALUE_FLOAT;
+};
+template<> struct AttributeValueType<double> {
+	static const PointAttribute::ValueType value =
+			PointAttribute::VALUE_DOUBLE;
+};
+
+template<typename T>
+double ReadValue(const uint8_t *data)
+{
+	T value;
+	memcpy(&value, data, sizeof(T));
+	return (double)value;
+}
+
+template<typename T>
+void WriteValue(uint8_t *data, double value)
+{
+	if (std::numeric_limits<T>::is_integer) {
+		if (std::isnan(value)) {
+			value = 0.0;
+		}
+		value = std::min((double)std::numeric_limits<T>::max(), std::max(
+				(double)std::numeric_limits<T>::lowest(), std::round(value)));
+	}
+	T typed_value = (T)value;
+	memcpy(data, &typed_value, sizeof(T));
+}
+
+}	// unnamed namespace
+
+PointAttribute::PointAttribute(const std::string &name, ValueType value_type,
+		size_t size/* = 0*/) : name_(name), value_type_(value_type),
+		reduction_type_(value_type == VALUE_FLOAT ||
+		value_type == VALUE_DOUBLE ? REDUCTION_AVERAGE : REDUCTION_MAJORITY)
+{
+	Resize(size);
+}
+
+size_t PointAttribute::GetValueSize() const
+{
+	switch (value_type_) {
+	case VALUE_INT8:
+	case VALUE_UINT8:
+		return 1;
+	case VALUE_INT16:
+	case VALUE_UINT16:
+		return 2;
+	case VALUE_INT32:
+	case VALUE_UINT32:
+	case VALUE_FLOAT:
+		return 4;
+	case VALUE_DOUBLE:
+	default:
+		return 8;
+	}
+}
+
+template<typename T>
+T *PointAttribute::GetData()
+{
+	if (AttributeValueType<T>::value != value_type_) {
+		return nullptr;
+	}
+	return (T *)data_.data();
+}
+
+template<typename T>
+const T *PointAttribute::GetData() const
+{
+	if (AttributeValueType<T>::value != value_type_) {
+		return nullptr;
+	}
+	return (const T *)data_.data();
+}
+
+double PointAttribute::GetValue(size_t index) const
+{
+	const uint8_t *data = data_.data() + index * GetValueSize();
+	switch (value_type_) {
+	case VALUE_INT8:
+		return ReadValue<int8_t>(data);
+	case VALUE_UINT8:
+		return ReadValue<uint8_t>(data);
+	case VALUE_INT16:
+		return ReadValue<int16_t>(data);
+	case VALUE_UINT16:
+		return ReadValue<uint16_t>(data);
+	case VALUE_INT32:
+		return ReadValue<int32_t>(data);
+	case VALUE_UINT32:
+		return ReadValue<uint32_t>(data);
+	case VALUE_FLOAT:
+		return ReadValue<float>(data);
+	case VALUE_DOUBLE:
+	default:
+		return ReadValue<double>(data);
+	}
+}
+
+void PointAttribute::SetValue(size_t index, double value)
+{
+	uint8_t *data = data_.data() + index * GetValueSize();
+	switch (value_type_) {
+	case VALUE_INT8:
+		WriteValue<int8_t>(data, value);
+		break;
+	case VALUE_UINT8:
+		WriteValue<uint8_t>(data, value);
+		break;
+	case VALUE_INT16:
+		WriteValue<int16_t>(data, value);
+		break;
+	case VALUE_UINT16:
+		WriteValue<uint16_t>(data, value);
+		break;
+	case VALUE_INT32:
+		WriteValue<int32_t>(data, value);
+		break;
+	case VALUE_UINT32:
+		WriteValue<uint32_t>(data, value);
+		break;
+	case VALUE_FLOAT:
+		WriteValue<float>(data, value);
+		break;
+	case VALUE_DOUBLE:
+	default:
+		WriteValue<double>(data, value);
+		break;
+	}
+}
+
+void PointAttribute::Append(const PointAttribute &attribute)
+{
+	if (attribute.value_type_ == value_type_) {
+		// The size is read before resizing, so that an attribute can be
+		// appended to itself.
+		size_t old_size = data_.size();
+		size_t add_size = attribute.data_.size();
+		data_.resize(old_size + add_size);
+		memcpy(data_.data() + old_size, attribute.data_.data(), add_size);
+	} else {
+		size_t old_size = Size();
+		Resize(old_size + attribute.Size());
+		for (size_t i = 0; i < attribute.Size(); i++) {
+			SetValue(old_size + i, attribute.GetValue(i));
+		}
+	}
+}
+
+PointAttribute PointAttribute::Select(const std::vector<size_t> &indices) const
+{
+	PointAttribute selected(name_, value_type_, indices.size());
+	selected.reduction_type_ = reduction_type_;
+	size_t value_size = GetValueSize();
+	for (size_t i = 0; i < indices.size(); i++) {
+		memcpy(selected.data_.data() + i * value_size,
+				data_.data() + indices[i] * value_size, value_size);
+	}
+	return selected;
+}
+
+PointAttribute PointAttribute::Reduce(const std::vector<size_t> &groups,
+		size_t num_groups) const
+{
+	PointAttribute reduced(name_, value_type_, num_groups);
+	reduced.reduction_type_ = reduction_type_;
+	size_t num_values = std::min(groups.size(), Size());
+	if (reduction_type_ == REDUCTION_AVERAGE) {
+		std::vector<double> sums(num_groups, 0.0);
+		std::vector<size_t> counts(num_groups, 0);
+		for (size_t i = 0; i < num_values; i++) {
+			sums[groups[i]] += GetValue(i);
+			counts[groups[i]]++;
+		}
+		for (size_t g = 0; g < num_groups; g++) {
+			if (counts[g] > 0) {
+				reduced.SetValue(g, sums[g] / (double)counts[g]);
+			}
+		}
+	} else {
+		// Sorting by group and value turns the values of a group into runs
+		// of equal values; the longest run wins, ties go to the smallest
+		// value.
+		std::vector<std::pair<size_t, double>> group_values(num_values);
+		for (size_t i = 0; i < num_values; i++) {
+			group_values[i] = std::make_pair(groups[i], GetValue(i));
+		}
+		std::sort(group_values.begin(), group_values.end());
+		size_t best_count = 0;
+		for (size_t begin = 0, end; begin < num_values; begin = end) {
+			end = begin + 1;
+			while (end < num_values && group_values[end] ==
+					group_values[begin]) {
+				end++;
+			}
+			if (begin == 0 || group_values[begin].first !=
+					group_values[begin - 1].first) {
+				best_count = 0;
+			}
+			if (end - begin > best_count) {
+				best_count = end - begin;
+				reduced.SetValue(group_values[begin].first,
+						group_values[begin].second);
+			}
+		}
+	}
+	return reduced;
+}
+
+template int8_t *PointAttribute::GetData<int8_t>();
+template uint8_t *PointAttribute::GetData<uint8_t>();
+template int16_t *PointAttribute::GetData<int16_t>();
+template uint16_t *PointAttribute::GetData<uint16_t>();
+template int32_t *PointAttribute::GetData<int32_t>();
+template uint32_t *PointAttribute::GetData<uint32_t>();
+template float *PointAttribute::GetData<float>();
+template double *PointAttribute::GetData<double>();
+template const int8_t *PointAttribute::GetData<int8_t>() const;
+template const uint8_t *PointAttribute::GetData<uint8_t>() const;
+template const int16_t *PointAttribute::GetData<int16_t>() const;
+template const uint16_t *PointAttribute::GetData<uint16_t>() const;
+template const int32_t *PointAttribute::GetData<int32_t>() const;
+template const uint32_t *PointAttribute::GetData<uint32_t>() const;
+template const float *PointAttribute::GetData<float>() const;
+template const double *PointAttribute::GetData<double>() const;
+
+}	// namespace three
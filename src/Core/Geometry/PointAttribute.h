@@ -0,0 +1,114 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace three {
+
+/// A named per-point attribute of a PointCloud, e.g. lidar intensity, ring
+/// id, timestamp or semantic label. The values are stored in a contiguous
+/// array of the value type of the attribute, one value per point.
+class PointAttribute
+{
+public:
+	enum ValueType {
+		VALUE_INT8 = 0,
+		VALUE_UINT8 = 1,
+		VALUE_INT16 = 2,
+		VALUE_UINT16 = 3,
+		VALUE_INT32 = 4,
+		VALUE_UINT32 = 5,
+		VALUE_FLOAT = 6,
+		VALUE_DOUBLE = 7,
+	};
+
+	/// How the values of points merged into one (e.g. by VoxelDownSample)
+	/// are combined
+	enum ReductionType {
+		REDUCTION_AVERAGE = 0,
+		REDUCTION_MAJORITY = 1,
+	};
+
+public:
+	PointAttribute() {}
+	/// Integer attributes (ids, labels) are reduced by majority vote, floating
+	/// point attributes by average.
+	PointAttribute(const std::string &name, ValueType value_type,
+			size_t size = 0);
+
+public:
+	const std::string &GetName() const { return name_; }
+	ValueType GetValueType() const { return value_type_; }
+	size_t GetValueSize() const;
+	ReductionType GetReductionType() const { return reduction_type_; }
+	void SetReductionType(ReductionType reduction_type) {
+		reduction_type_ = reduction_type;
+	}
+
+	size_t Size() const { return data_.size() / GetValueSize(); }
+	void Resize(size_t size) { data_.resize(size * GetValueSize(), 0); }
+	void Clear() { data_.clear(); }
+
+	/// Typed access to the values; returns nullptr if T does not match the
+	/// value type.
+	template<typename T>
+	T *GetData();
+	template<typename T>
+	const T *GetData() const;
+	/// The values as bytes in native byte order, e.g. for binary IO
+	const uint8_t *GetRawData() const { return data_.data(); }
+
+	/// Values converted from and to double. Integer values are rounded and
+	/// clamped to the range of the value type.
+	double GetValue(size_t index) const;
+	void SetValue(size_t index, double value);
+
+	/// Appends the values of \param attribute, converting them if the value
+	/// types differ.
+	void Append(const PointAttribute &attribute);
+
+	/// Returns the values of the points \param indices
+	PointAttribute Select(const std::vector<size_t> &indices) const;
+
+	/// Returns one value for each of \param num_groups groups, combining the
+	/// values of the points of a group as given by the reduction type. Point i
+	/// belongs to group \param groups[i].
+	PointAttribute Reduce(const std::vector<size_t> &groups,
+			size_t num_groups) const;
+
+private:
+	std::string name_;
+	ValueType value_type_ = VALUE_DOUBLE;
+	ReductionType reduction_type_ = REDUCTION_AVERAGE;
+	std::vector<uint8_t> data_;
+};
+
+}	// namespace three
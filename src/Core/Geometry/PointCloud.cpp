@@ -37,6 +37,7 @@ void PointCloud::Clear()
 	points_.clear();
 	normals_.clear();
 	colors_.clear();
+	attributes_.clear();
 }
 
 bool PointCloud::IsEmpty() const
@@ -46,44 +47,22 @@ bool PointCloud::IsEmpty() const
 
 Eigen::Vector3d PointCloud::GetMinBound() const
 {
-	if (!HasPoints()) {
-		return Eigen::Vector3d(0.0, 0.0, 0.0);
-	}
-	auto itr_x = std::min_element(points_.begin(), points_.end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(0) < b(0); });
-	auto itr_y = std::min_element(points_.begin(), points_.end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(1) < b(1); });
-	auto itr_z = std::min_element(points_.begin(), points_.end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(2) < b(2); });
-	return Eigen::Vector3d((*itr_x)(0), (*itr_y)(1), (*itr_z)(2));
+	Eigen::Vector3d min_bound, max_bound;
+	ComputeBounds(points_.data(), points_.size(), min_bound, max_bound);
+	return min_bound;
 }
 
 Eigen::Vector3d PointCloud::GetMaxBound() const
 {
-	if (!HasPoints()) {
-		return Eigen::Vector3d(0.0, 0.0, 0.0);
-	}
-	auto itr_x = std::max_element(points_.begin(), points_.end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(0) < b(0); });
-	auto itr_y = std::max_element(points_.begin(), points_.end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(1) < b(1); });
-	auto itr_z = std::max_element(points_.begin(), points_.end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(2) < b(2); });
-	return Eigen::Vector3d((*itr_x)(0), (*itr_y)(1), (*itr_z)(2));
+	Eigen::Vector3d min_bound, max_bound;
+	ComputeBounds(points_.data(), points_.size(), min_bound, max_bound);
+	return max_bound;
 }
 
 void PointCloud::Transform(const Eigen::Matrix4d &transformation)
 {
-	for (auto &point : points_) {
-		Eigen::Vector4d new_point = transformation * Eigen::Vector4d(
-				point(0), point(1), point(2), 1.0);
-		point = new_point.block<3, 1>(0, 0);
-	}
-	for (auto &normal : normals_) {
-		Eigen::Vector4d new_normal = transformation * Eigen::Vector4d(
-				normal(0), normal(1), normal(2), 0.0);
-		normal = new_normal.block<3, 1>(0, 0);
-	}
+	TransformPoints(transformation, points_.data(), points_.size());
+	TransformNormals(transformation, normals_.data(), normals_.size());
 }
 
 PointCloud &PointCloud::operator+=(const PointCloud &cloud)
@@ -108,12 +87,76 @@ PointCloud &PointCloud::operator+=(const PointCloud &cloud)
 	} else {
 		colors_.clear();
 	}
+	// Attributes are kept if both point clouds have them.
+	if (HasPoints()) {
+		std::vector<PointAttribute> attributes;
+		for (const auto &attribute : attributes_) {
+			if (HasAttribute(attribute.GetName()) &&
+					cloud.HasAttribute(attribute.GetName())) {
+				attributes.push_back(attribute);
+				attributes.back().Append(
+						*cloud.GetAttribute(attribute.GetName()));
+			}
+		}
+		attributes_ = std::move(attributes);
+	} else {
+		attributes_.clear();
+		for (const auto &attribute : cloud.attributes_) {
+			if (cloud.HasAttribute(attribute.GetName())) {
+				attributes_.push_back(attribute);
+			}
+		}
+	}
 	points_.resize(new_vert_num);
 	for (size_t i = 0; i < add_vert_num; i++)
 		points_[old_vert_num + i] = cloud.points_[i];
 	return (*this);
 }
 
+PointAttribute *PointCloud::GetAttribute(const std::string &name)
+{
+	for (auto &attribute : attributes_) {
+		if (attribute.GetName() == name) {
+			return &attribute;
+		}
+	}
+	return nullptr;
+}
+
+const PointAttribute *PointCloud::GetAttribute(const std::string &name) const
+{
+	for (const auto &attribute : attributes_) {
+		if (attribute.GetName() == name) {
+			return &attribute;
+		}
+	}
+	return nullptr;
+}
+
+PointAttribute &PointCloud::AddAttribute(const std::string &name,
+		PointAttribute::ValueType value_type)
+{
+	PointAttribute *attribute = GetAttribute(name);
+	if (attribute == nullptr) {
+		attributes_.push_back(PointAttribute(name, value_type,
+				points_.size()));
+		return attributes_.back();
+	}
+	*attribute = PointAttribute(name, value_type, points_.size());
+	return *attribute;
+}
+
+bool PointCloud::RemoveAttribute(const std::string &name)
+{
+	for (auto itr = attributes_.begin(); itr != attributes_.end(); itr++) {
+		if (itr->GetName() == name) {
+			attributes_.erase(itr);
+			return true;
+		}
+	}
+	return false;
+}
+
 PointCloud PointCloud::operator+(const PointCloud &cloud) const
 {
 	return (PointCloud(*this) += cloud);
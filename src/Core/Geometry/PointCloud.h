@@ -32,6 +32,7 @@
 #include <Eigen/Core>
 #include <Core/Geometry/Geometry3D.h>
 #include <Core/Geometry/KDTreeSearchParam.h>
+#include <Core/Geometry/PointAttribute.h>
 
 namespace three {
 
@@ -82,10 +83,29 @@ public:
 		}
 	}
 
+	bool HasAttribute(const std::string &name) const {
+		const PointAttribute *attribute = GetAttribute(name);
+		return points_.size() > 0 && attribute != nullptr &&
+				attribute->Size() == points_.size();
+	}
+
+	/// Returns nullptr if the point cloud has no attribute \param name
+	PointAttribute *GetAttribute(const std::string &name);
+	const PointAttribute *GetAttribute(const std::string &name) const;
+
+	/// Adds a zero-initialized attribute with one value per point, replacing
+	/// any attribute of the same name.
+	PointAttribute &AddAttribute(const std::string &name,
+			PointAttribute::ValueType value_type);
+	bool RemoveAttribute(const std::string &name);
+
 public:
 	std::vector<Eigen::Vector3d> points_;
 	std::vector<Eigen::Vector3d> normals_;
 	std::vector<Eigen::Vector3d> colors_;
+	/// Custom per-point attributes, carried through selection, voxel down
+	/// sampling, merging and PLY/PCD IO
+	std::vector<PointAttribute> attributes_;
 };
 
 /// Factory function to create a pointcloud from a file (PointCloudFactory.cpp)
@@ -106,6 +126,20 @@ std::shared_ptr<PointCloud> CreatePointCloudFromDepthImage(
 		double depth_scale = 1000.0, double depth_trunc = 1000.0,
 		int stride = 1);
 
+/// Factory function to create a pointcloud with normals from a depth image and
+/// a camera model (PointCloudFactory.cpp)
+/// The points are the same as those of CreatePointCloudFromDepthImage. The
+/// normals are estimated on the (strided) pixel grid with
+/// EstimateNormalsOrganized over a window of \param normal_window_radius
+/// pixels, in the camera frame so that depth edges are detected, and oriented
+/// towards the camera.
+/// Return an empty pointcloud if the conversion fails.
+std::shared_ptr<PointCloud> CreatePointCloudWithNormalsFromDepthImage(
+		const Image &depth, const PinholeCameraIntrinsic &intrinsic,
+		const Eigen::Matrix4d &extrinsic = Eigen::Matrix4d::Identity(),
+		double depth_scale = 1000.0, double depth_trunc = 1000.0,
+		int stride = 1, int normal_window_radius = 3);
+
 /// Factory function to create a pointcloud from an RGB-D image and a camera
 /// model (PointCloudFactory.cpp)
 /// Return an empty pointcloud if the conversion fails.
@@ -125,17 +159,62 @@ std::shared_ptr<PointCloud> SelectDownSample(const PointCloud &input,
 std::shared_ptr<PointCloud> VoxelDownSample(const PointCloud &input,
 		double voxel_size);
 
+/// Function to downsample input pointcloud with a voxel grid whose voxel
+/// (0, 0, 0) starts at \param voxel_origin, so that pieces of a point cloud
+/// can be down sampled on the same grid.
+std::shared_ptr<PointCloud> VoxelDownSample(const PointCloud &input,
+		double voxel_size, const Eigen::Vector3d &voxel_origin);
+
+/// Function to downsample input pointcloud with a voxel grid, as
+/// VoxelDownSample, and to trace which input points are merged into each
+/// output point. The input points of output point v are
+/// indices[voxel_offsets[v]], ..., indices[voxel_offsets[v + 1] - 1] in
+/// increasing order, and \param point_to_voxel maps each input point to its
+/// output point.
+std::shared_ptr<PointCloud> VoxelDownSampleAndTrace(const PointCloud &input,
+		double voxel_size, std::vector<size_t> &voxel_offsets,
+		std::vector<size_t> &indices, std::vector<size_t> &point_to_voxel);
+
+/// Function to downsample input pointcloud with a voxel grid starting at
+/// \param voxel_origin and to trace the merged points, see
+/// VoxelDownSampleAndTrace above.
+std::shared_ptr<PointCloud> VoxelDownSampleAndTrace(const PointCloud &input,
+		double voxel_size, const Eigen::Vector3d &voxel_origin,
+		std::vector<size_t> &voxel_offsets, std::vector<size_t> &indices,
+		std::vector<size_t> &point_to_voxel);
+
 /// Function to downsample input pointcloud into output pointcloud uniformly
 /// \param every_k_points indicates the sample rate.
 std::shared_ptr<PointCloud> UniformDownSample(const PointCloud &input,
 		size_t every_k_points);
 
+/// Function to select \param num_samples points by farthest point sampling:
+/// starting from the first point, the point farthest from all selected points
+/// is selected next. The selected points keep their input order.
+std::shared_ptr<PointCloud> FarthestPointDownSample(const PointCloud &input,
+		size_t num_samples);
+
+/// Function to select a subset of the points in which no two points are
+/// closer than \param radius and every input point is within \param radius
+/// of a selected point (Poisson disk sampling). The selected points keep
+/// their input order.
+std::shared_ptr<PointCloud> PoissonDiskDownSample(const PointCloud &input,
+		double radius);
+
 /// Function to crop input pointcloud into output pointcloud
 /// All points with coordinates less than \param min_bound or larger than
 /// \param max_bound are clipped.
 std::shared_ptr<PointCloud> CropPointCloud(const PointCloud &input,
 		const Eigen::Vector3d &min_bound, const Eigen::Vector3d &max_bound);
 
+/// Function to crop input pointcloud with an oriented bounding box
+/// The box is centered at \param center, its axes are the columns of
+/// \param rotation and its side lengths are \param extent. Points outside
+/// the box are clipped.
+std::shared_ptr<PointCloud> CropPointCloud(const PointCloud &input,
+		const Eigen::Vector3d &center, const Eigen::Matrix3d &rotation,
+		const Eigen::Vector3d &extent);
+
 /// Function to compute the normals of a point cloud
 /// \param cloud is the input point cloud. It also stores the output normals.
 /// Normals are oriented with respect to the input point cloud if normals exist
@@ -143,6 +222,23 @@ std::shared_ptr<PointCloud> CropPointCloud(const PointCloud &input,
 bool EstimateNormals(PointCloud &cloud,
 		const KDTreeSearchParam &search_param = KDTreeSearchParamKNN());
 
+/// Function to compute the normals of an organized point cloud, e.g. one
+/// sampled from a depth image. Point i lies at pixel \param pixel_indices[i]
+/// (row * width + column) of a \param width x \param height grid. The
+/// covariance of a point is computed over the points in the
+/// (2 * window_radius + 1)^2 pixel window around it from integral images, in
+/// constant time per point and without a KDTree.
+/// Windows that cross a depth edge, where the depths (distances to the origin)
+/// of neighboring pixels differ by more than \param depth_change_factor times
+/// the depth, or that contain pixels without a point, are scanned instead and
+/// only keep the pixels on the surface of the point. This assumes that the
+/// points are in the camera frame; 0 disables the test.
+/// Normals are oriented with respect to the input point cloud if normals exist
+/// in the input.
+bool EstimateNormalsOrganized(PointCloud &cloud, int width, int height,
+		const std::vector<int> &pixel_indices, int window_radius = 3,
+		double depth_change_factor = 0.02);
+
 /// Function to orient the normals of a point cloud
 /// \param cloud is the input point cloud. It must have normals.
 /// Normals are oriented with respect to \param orientation_reference.
@@ -156,6 +252,14 @@ bool OrientNormalsToAlignWithDirection(PointCloud &cloud,
 bool OrientNormalsTowardsCameraLocation(PointCloud &cloud,
 		const Eigen::Vector3d &camera_location = Eigen::Vector3d::Zero());
 
+/// Function to orient the normals of a point cloud consistently
+/// \param cloud is the input point cloud. It must have normals.
+/// Orientation is propagated along a minimum spanning tree of the \param k
+/// nearest neighbor graph with edge weights 1 - |n_i . n_j|, so that it
+/// crosses regions of low curvature first. The normal of the first point of
+/// each connected component keeps its orientation.
+bool OrientNormalsConsistentTangentPlane(PointCloud &cloud, int k = 10);
+
 /// Function to compute the ponit to point distances between point clouds
 /// \param distances is the output distance. It has the same size as the number
 /// of point in \param source.
@@ -176,4 +280,33 @@ std::vector<double> ComputePointCloudMahalanobisDistance(
 std::vector<double> ComputePointCloudNearestNeighborDistance(
 		const PointCloud &input);
 
+/// Function to find the points that are not statistical outliers. A point is
+/// an outlier if the average distance to its \param nb_neighbors nearest
+/// neighbors exceeds the mean of these averages over the point cloud by more
+/// than \param std_ratio standard deviations.
+/// Returns the indices of the inliers, which SelectDownSample extracts.
+/// Illegal parameters keep all points, so that the filter is skipped.
+std::vector<size_t> RemoveStatisticalOutliers(const PointCloud &cloud,
+		int nb_neighbors, double std_ratio);
+
+/// Function to find the points that have at least \param nb_points other
+/// points within \param radius. Returns the indices of these inliers, or of
+/// all points if the parameters are illegal.
+std::vector<size_t> RemoveRadiusOutliers(const PointCloud &cloud,
+		int nb_points, double radius);
+
+/// Function to detect Intrinsic Shape Signatures keypoints (Zhong 2009,
+/// Keypoint.cpp). A point is a candidate if the eigenvalues
+/// lambda_1 >= lambda_2 >= lambda_3 of the scatter matrix of its at least
+/// \param min_neighbors neighbors within \param salient_radius satisfy
+/// lambda_2 / lambda_1 < \param gamma_21 and lambda_3 / lambda_2 <
+/// \param gamma_32. Candidates whose lambda_3 is the largest within
+/// \param non_max_radius are keypoints. Radii of 0 default to 6 and 4 times
+/// the mean nearest neighbor distance.
+/// Returns the indices of the keypoints, e.g. for ComputeFPFHFeature.
+std::vector<size_t> ComputeISSKeypoints(const PointCloud &input,
+		double salient_radius = 0.0, double non_max_radius = 0.0,
+		double gamma_21 = 0.975, double gamma_32 = 0.975,
+		int min_neighbors = 5);
+
 }	// namespace three
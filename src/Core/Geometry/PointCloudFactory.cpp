@@ -39,9 +39,11 @@ namespace {
 
 std::shared_ptr<PointCloud> CreatePointCloudFromFloatDepthImage(
 		const Image &depth, const PinholeCameraIntrinsic &intrinsic,
-		const Eigen::Matrix4d &extrinsic, int stride)
+		const Eigen::Matrix4d &extrinsic, int stride,
+		std::vector<int> *pixel_indices = nullptr)
 {
 	auto pointcloud = std::make_shared<PointCloud>();
+	int grid_width = (depth.width_ + stride - 1) / stride;
 	Eigen::Matrix4d camera_pose = extrinsic.inverse();
 	auto focal_length = intrinsic.GetFocalLength();
 	auto principal_point = intrinsic.GetPrincipalPoint();
@@ -57,6 +59,10 @@ std::shared_ptr<PointCloud> CreatePointCloudFromFloatDepthImage(
 				Eigen::Vector4d point = camera_pose *
 						Eigen::Vector4d(x, y, z, 1.0);
 				pointcloud->points_.push_back(point.block<3, 1>(0, 0));
+				if (pixel_indices != nullptr) {
+					pixel_indices->push_back(
+							(i / stride) * grid_width + j / stride);
+				}
 			}
 		}
 	}
@@ -127,6 +133,37 @@ std::shared_ptr<PointCloud> CreatePointCloudFromDepthImage(
 	return std::make_shared<PointCloud>();
 }
 
+std::shared_ptr<PointCloud> CreatePointCloudWithNormalsFromDepthImage(
+		const Image &depth, const PinholeCameraIntrinsic &intrinsic,
+		const Eigen::Matrix4d &extrinsic/* = Eigen::Matrix4d::Identity()*/,
+		double depth_scale/* = 1000.0*/, double depth_trunc/* = 1000.0*/,
+		int stride/* = 1*/, int normal_window_radius/* = 3*/)
+{
+	if (depth.num_of_channels_ != 1 || (depth.bytes_per_channel_ != 2 &&
+			depth.bytes_per_channel_ != 4)) {
+		PrintDebug("[CreatePointCloudWithNormalsFromDepthImage] Unsupported image format.\n");
+		return std::make_shared<PointCloud>();
+	}
+	std::shared_ptr<Image> float_depth;
+	if (depth.bytes_per_channel_ == 2) {
+		float_depth = ConvertDepthToFloatImage(depth, depth_scale,
+				depth_trunc);
+	}
+	std::vector<int> pixel_indices;
+	auto pointcloud = CreatePointCloudFromFloatDepthImage(
+			float_depth ? *float_depth : depth, intrinsic,
+			Eigen::Matrix4d::Identity(), stride, &pixel_indices);
+	if (EstimateNormalsOrganized(*pointcloud,
+			(depth.width_ + stride - 1) / stride,
+			(depth.height_ + stride - 1) / stride, pixel_indices,
+			normal_window_radius) == false) {
+		return std::make_shared<PointCloud>();
+	}
+	OrientNormalsTowardsCameraLocation(*pointcloud);
+	pointcloud->Transform(extrinsic.inverse());
+	return pointcloud;
+}
+
 std::shared_ptr<PointCloud> CreatePointCloudFromRGBDImage(
 		const RGBDImage &image, const PinholeCameraIntrinsic &intrinsic,
 		const Eigen::Matrix4d &extrinsic/* = Eigen::Matrix4d::Identity()*/)
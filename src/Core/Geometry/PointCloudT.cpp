@@ -0,0 +1,185 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+
+#include "PointCloudT.h"
+
+#include <algorithm>
+#include <cmath>
+#include <Core/Geometry/PointCloud.h>
+
+namespace three{
+
+namespace {
+
+uint8_t ColorToUInt8(double color)
+{
+	return (uint8_t)std::round(std::min(1.0, std::max(0.0, color)) * 255.0);
+}
+
+}	// unnamed namespace
+
+template<typename Scalar>
+void PointCloudT<Scalar>::Clear()
+{
+	points_.clear();
+	normals_.clear();
+	colors_.clear();
+}
+
+template<typename Scalar>
+bool PointCloudT<Scalar>::IsEmpty() const
+{
+	return !HasPoints();
+}
+
+template<typename Scalar>
+Eigen::Vector3d PointCloudT<Scalar>::GetMinBound() const
+{
+	Eigen::Vector3d min_bound, max_bound;
+	this->ComputeBounds(points_.data(), points_.size(), min_bound,
+			max_bound);
+	return min_bound;
+}
+
+template<typename Scalar>
+Eigen::Vector3d PointCloudT<Scalar>::GetMaxBound() const
+{
+	Eigen::Vector3d min_bound, max_bound;
+	this->ComputeBounds(points_.data(), points_.size(), min_bound,
+			max_bound);
+	return max_bound;
+}
+
+template<typename Scalar>
+void PointCloudT<Scalar>::Transform(const Eigen::Matrix4d &transformation)
+{
+	this->TransformPoints(transformation, points_.data(), points_.size());
+	this->TransformNormals(transformation, normals_.data(), normals_.size());
+}
+
+template<typename Scalar>
+PointCloudT<Scalar> &PointCloudT<Scalar>::operator+=(const PointCloudT &cloud)
+{
+	// We do not use std::vector::insert to combine std::vector because it will
+	// crash if the pointcloud is added to itself.
+	if (cloud.IsEmpty()) return (*this);
+	size_t old_vert_num = points_.size();
+	size_t add_vert_num = cloud.points_.size();
+	size_t new_vert_num = old_vert_num + add_vert_num;
+	if ((!HasPoints() || HasNormals()) && cloud.HasNormals()) {
+		normals_.resize(new_vert_num);
+		for (size_t i = 0; i < add_vert_num; i++)
+			normals_[old_vert_num + i] = cloud.normals_[i];
+	} else {
+		normals_.clear();
+	}
+	if ((!HasPoints() || HasColors()) && cloud.HasColors()) {
+		colors_.resize(new_vert_num);
+		for (size_t i = 0; i < add_vert_num; i++)
+			colors_[old_vert_num + i] = cloud.colors_[i];
+	} else {
+		colors_.clear();
+	}
+	points_.resize(new_vert_num);
+	for (size_t i = 0; i < add_vert_num; i++)
+		points_[old_vert_num + i] = cloud.points_[i];
+	return (*this);
+}
+
+template<typename Scalar>
+PointCloudT<Scalar> PointCloudT<Scalar>::operator+(
+		const PointCloudT &cloud) const
+{
+	return (PointCloudT(*this) += cloud);
+}
+
+template<typename Scalar>
+void PointCloudT<Scalar>::PaintUniformColor(const Eigen::Vector3d &color)
+{
+	colors_.assign(points_.size(), Color(ColorToUInt8(color(0)),
+			ColorToUInt8(color(1)), ColorToUInt8(color(2))));
+}
+
+template<typename Scalar>
+std::shared_ptr<PointCloudT<Scalar>> CreatePointCloudTFromPointCloud(
+		const PointCloud &cloud)
+{
+	auto output = std::make_shared<PointCloudT<Scalar>>();
+	output->points_.resize(cloud.points_.size());
+	for (size_t i = 0; i < cloud.points_.size(); i++) {
+		output->points_[i] = cloud.points_[i].cast<Scalar>();
+	}
+	if (cloud.HasNormals()) {
+		output->normals_.resize(cloud.normals_.size());
+		for (size_t i = 0; i < cloud.normals_.size(); i++) {
+			output->normals_[i] = cloud.normals_[i].cast<Scalar>();
+		}
+	}
+	if (cloud.HasColors()) {
+		output->colors_.resize(cloud.colors_.size());
+		for (size_t i = 0; i < cloud.colors_.size(); i++) {
+			const Eigen::Vector3d &color = cloud.colors_[i];
+			output->colors_[i] = typename PointCloudT<Scalar>::Color(
+					ColorToUInt8(color(0)), ColorToUInt8(color(1)),
+					ColorToUInt8(color(2)));
+		}
+	}
+	return output;
+}
+
+template<typename Scalar>
+std::shared_ptr<PointCloud> CreatePointCloudFromPointCloudT(
+		const PointCloudT<Scalar> &cloud)
+{
+	auto output = std::make_shared<PointCloud>();
+	output->points_.resize(cloud.points_.size());
+	for (size_t i = 0; i < cloud.points_.size(); i++) {
+		output->points_[i] = cloud.points_[i].template cast<double>();
+	}
+	if (cloud.HasNormals()) {
+		output->normals_.resize(cloud.normals_.size());
+		for (size_t i = 0; i < cloud.normals_.size(); i++) {
+			output->normals_[i] = cloud.normals_[i].template cast<double>();
+		}
+	}
+	if (cloud.HasColors()) {
+		output->colors_.resize(cloud.colors_.size());
+		for (size_t i = 0; i < cloud.colors_.size(); i++) {
+			output->colors_[i] = cloud.colors_[i].template cast<double>() /
+					255.0;
+		}
+	}
+	return output;
+}
+
+template class PointCloudT<float>;
+template std::shared_ptr<PointCloudT<float>> CreatePointCloudTFromPointCloud(
+		const PointCloud &cloud);
+template std::shared_ptr<PointCloud> CreatePointCloudFromPointCloudT(
+		const PointCloudT<float> &cloud);
+
+}	// namespace three
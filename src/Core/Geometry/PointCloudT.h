@@ -0,0 +1,126 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <Eigen/Core>
+#include <Core/Geometry/Geometry3D.h>
+#include <Core/Geometry/KDTreeSearchParam.h>
+
+namespace three {
+
+class PointCloud;
+
+/// Point cloud storing points and normals as packed Scalar triplets and
+/// colors as 8-bit RGB triplets, each attribute in its own contiguous buffer.
+/// With Scalar = float (PointCloudf) a point with normal and color takes 27
+/// bytes instead of the 72 bytes of PointCloud. The buffers have the layout
+/// OpenGL vertex arrays expect, so the renderer uploads them as they are.
+/// Colors are in [0, 255]; conversions to and from PointCloud map them to
+/// [0, 1].
+template<typename Scalar>
+class PointCloudT : public Geometry3D
+{
+public:
+	typedef Eigen::Matrix<Scalar, 3, 1> Vector3;
+	typedef Eigen::Matrix<uint8_t, 3, 1> Color;
+
+public:
+	PointCloudT() : Geometry3D(GEOMETRY_POINTCLOUDF) {};
+	~PointCloudT() override {};
+
+public:
+	void Clear() override;
+	bool IsEmpty() const override;
+	Eigen::Vector3d GetMinBound() const override;
+	Eigen::Vector3d GetMaxBound() const override;
+	void Transform(const Eigen::Matrix4d &transformation) override;
+
+public:
+	PointCloudT &operator+=(const PointCloudT &cloud);
+	PointCloudT operator+(const PointCloudT &cloud) const;
+
+public:
+	bool HasPoints() const {
+		return points_.size() > 0;
+	}
+
+	bool HasNormals() const {
+		return points_.size() > 0 && normals_.size() == points_.size();
+	}
+
+	bool HasColors() const {
+		return points_.size() > 0 && colors_.size() == points_.size();
+	}
+
+	void NormalizeNormals() {
+		for (size_t i = 0; i < normals_.size(); i++) {
+			normals_[i].normalize();
+		}
+	}
+
+	/// \param color is an RGB color in [0, 1] as used by PointCloud
+	void PaintUniformColor(const Eigen::Vector3d &color);
+
+public:
+	std::vector<Vector3> points_;
+	std::vector<Vector3> normals_;
+	std::vector<Color> colors_;
+};
+
+typedef PointCloudT<float> PointCloudf;
+
+/// Factory function to create a PointCloudT from a PointCloud
+/// (PointCloudT.cpp). Points and normals are rounded to Scalar and colors are
+/// quantized to 8 bits.
+template<typename Scalar>
+std::shared_ptr<PointCloudT<Scalar>> CreatePointCloudTFromPointCloud(
+		const PointCloud &cloud);
+
+/// Factory function to create a PointCloud from a PointCloudT
+/// (PointCloudT.cpp)
+template<typename Scalar>
+std::shared_ptr<PointCloud> CreatePointCloudFromPointCloudT(
+		const PointCloudT<Scalar> &cloud);
+
+/// Function to downsample a PointCloudT with a voxel grid (DownSample.cpp)
+/// The points are averaged in double precision, see VoxelDownSample for
+/// PointCloud.
+template<typename Scalar>
+std::shared_ptr<PointCloudT<Scalar>> VoxelDownSample(
+		const PointCloudT<Scalar> &input, double voxel_size);
+
+/// Function to compute the normals of a PointCloudT (EstimateNormals.cpp)
+/// See EstimateNormals for PointCloud.
+template<typename Scalar>
+bool EstimateNormals(PointCloudT<Scalar> &cloud,
+		const KDTreeSearchParam &search_param = KDTreeSearchParamKNN());
+
+}	// namespace three
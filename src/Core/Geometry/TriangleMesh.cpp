@@ -48,50 +48,27 @@ bool TriangleMesh::IsEmpty() const
 
 Eigen::Vector3d TriangleMesh::GetMinBound() const
 {
-	if (!HasVertices()) {
-		return Eigen::Vector3d(0.0, 0.0, 0.0);
-	}
-	auto itr_x = std::min_element(vertices_.begin(), vertices_.end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(0) < b(0); });
-	auto itr_y = std::min_element(vertices_.begin(), vertices_.end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(1) < b(1); });
-	auto itr_z = std::min_element(vertices_.begin(), vertices_.end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(2) < b(2); });
-	return Eigen::Vector3d((*itr_x)(0), (*itr_y)(1), (*itr_z)(2));
+	Eigen::Vector3d min_bound, max_bound;
+	ComputeBounds(vertices_.data(), vertices_.size(), min_bound,
+			max_bound);
+	return min_bound;
 }
 
 Eigen::Vector3d TriangleMesh::GetMaxBound() const
 {
-	if (!HasVertices()) {
-		return Eigen::Vector3d(0.0, 0.0, 0.0);
-	}
-	auto itr_x = std::max_element(vertices_.begin(), vertices_.end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(0) < b(0); });
-	auto itr_y = std::max_element(vertices_.begin(), vertices_.end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(1) < b(1); });
-	auto itr_z = std::max_element(vertices_.begin(), vertices_.end(),
-		[](Eigen::Vector3d a, Eigen::Vector3d b) { return a(2) < b(2); });
-	return Eigen::Vector3d((*itr_x)(0), (*itr_y)(1), (*itr_z)(2));
+	Eigen::Vector3d min_bound, max_bound;
+	ComputeBounds(vertices_.data(), vertices_.size(), min_bound,
+			max_bound);
+	return max_bound;
 }
 
 void TriangleMesh::Transform(const Eigen::Matrix4d &transformation)
 {
-	for (auto &vertex : vertices_) {
-		Eigen::Vector4d new_point = transformation * Eigen::Vector4d(
-				vertex(0), vertex(1), vertex(2), 1.0);
-		vertex = new_point.block<3, 1>(0, 0);
-	}
-	for (auto &vertex_normal : vertex_normals_) {
-		Eigen::Vector4d new_normal = transformation * Eigen::Vector4d(
-				vertex_normal(0), vertex_normal(1), vertex_normal(2), 0.0);
-		vertex_normal = new_normal.block<3, 1>(0, 0);
-	}
-	for (auto &triangle_normal : triangle_normals_) {
-		Eigen::Vector4d new_normal = transformation * Eigen::Vector4d(
-				triangle_normal(0), triangle_normal(1),
-				triangle_normal(2), 0.0);
-		triangle_normal = new_normal.block<3, 1>(0, 0);
-	}
+	TransformPoints(transformation, vertices_.data(), vertices_.size());
+	TransformNormals(transformation, vertex_normals_.data(),
+			vertex_normals_.size());
+	TransformNormals(transformation, triangle_normals_.data(),
+			triangle_normals_.size());
 }
 
 TriangleMesh &TriangleMesh::operator+=(const TriangleMesh &mesh)
@@ -0,0 +1,517 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+
+#include "VoxelHashIndex.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <Core/Geometry/PointCloud.h>
+#include <Core/Geometry/TriangleMesh.h>
+#include <Core/Geometry/NeighborSearchBatch.h>
+#include <Core/Utility/Console.h>
+
+namespace three{
+
+/// Class that runs the searches on a VoxelHashIndex. It keeps a candidate
+/// buffer that is reused across queries; the batched search uses one copy per
+/// thread.
+class VoxelHashIndex::VoxelSearcher
+{
+public:
+	VoxelSearcher(const VoxelHashIndex &index,
+			KDTreeSearchParam::SearchType search_type, int knn,
+			double radius) : index_(index), search_type_(search_type),
+			knn_(knn), radius_(radius) {}
+
+public:
+	/// Function to append the neighbors of \param query to the vectors
+	/// The batched search only runs 3D queries.
+	void Search(const double *query, size_t /*dimension*/,
+			std::vector<int> &indices, std::vector<double> &distance2) {
+		Eigen::Vector3d q(query[0], query[1], query[2]);
+		candidates_.clear();
+		int num_results;
+		if (search_type_ == KDTreeSearchParam::SEARCH_KNN) {
+			CollectKNN(q);
+			num_results = std::min(knn_, (int)candidates_.size());
+		} else {
+			if (search_type_ == KDTreeSearchParam::SEARCH_HYBRID) {
+				if (knn_ > 0) {
+					CollectRadius(q, knn_);
+				}
+				num_results = std::min(knn_, (int)candidates_.size());
+			} else {
+				CollectRadius(q, -1);
+				num_results = (int)candidates_.size();
+			}
+		}
+		std::partial_sort(candidates_.begin(), candidates_.begin() +
+				num_results, candidates_.end());
+		for (int i = 0; i < num_results; i++) {
+			indices.push_back(candidates_[i].second);
+			distance2.push_back(candidates_[i].first);
+		}
+	}
+
+private:
+	void CollectVoxel(const Eigen::Vector3d &query, const Eigen::Vector3i &v,
+			double &radius2, int max_nn) {
+		const VoxelEntry *voxel = index_.FindVoxel(v);
+		if (voxel == nullptr) {
+			return;
+		}
+		for (int i = voxel->begin_; i < voxel->end_; i++) {
+			double d = (index_.points_[i] - query).squaredNorm();
+			if (d < radius2) {
+				candidates_.push_back(std::make_pair(d,
+						index_.point_indices_[i]));
+				if (max_nn > 0 && (int)candidates_.size() >=
+						(max_nn == 1 ? 1 : 2 * max_nn)) {
+					// Only the max_nn nearest candidates are kept, and the
+					// search radius shrinks to the farthest of them.
+					std::nth_element(candidates_.begin(),
+							candidates_.begin() + max_nn - 1,
+							candidates_.end());
+					candidates_.resize(max_nn);
+					radius2 = candidates_[max_nn - 1].first;
+				}
+			}
+		}
+	}
+
+	void CollectRadius(const Eigen::Vector3d &query, int max_nn) {
+		// Only the voxels overlapping the bounding box of the search sphere
+		// are probed: at most 8 when radius <= voxel_size. The voxel of the
+		// query is probed first; with max_nn the radius shrinks as neighbors
+		// are found, and voxels farther than the radius are skipped.
+		Eigen::Vector3i lo = index_.GetVoxelIndex(query -
+				Eigen::Vector3d::Constant(radius_)).cwiseMax(
+				index_.min_voxel_);
+		Eigen::Vector3i hi = index_.GetVoxelIndex(query +
+				Eigen::Vector3d::Constant(radius_)).cwiseMin(
+				index_.max_voxel_);
+		Eigen::Vector3i center = index_.GetVoxelIndex(query);
+		double radius2 = radius_ * radius_;
+		bool has_center = (center.array() >= lo.array()).all() &&
+				(center.array() <= hi.array()).all();
+		if (has_center) {
+			CollectVoxel(query, center, radius2, max_nn);
+		}
+		Eigen::Vector3i v;
+		for (v(0) = lo(0); v(0) <= hi(0); v(0)++) {
+			for (v(1) = lo(1); v(1) <= hi(1); v(1)++) {
+				for (v(2) = lo(2); v(2) <= hi(2); v(2)++) {
+					if (has_center && v == center) {
+						continue;
+					}
+					Eigen::Vector3d voxel_min = v.cast<double>() *
+							index_.voxel_size_;
+					Eigen::Vector3d voxel_max = voxel_min +
+							Eigen::Vector3d::Constant(index_.voxel_size_);
+					double d = (voxel_min - query).cwiseMax(query -
+							voxel_max).cwiseMax(0.0).squaredNorm();
+					if (d < radius2) {
+						CollectVoxel(query, v, radius2, max_nn);
+					}
+				}
+			}
+		}
+	}
+
+	void CollectKNN(const Eigen::Vector3d &query) {
+		// Probes shells of voxels of growing size around the query until
+		// the k-th candidate is closer than any voxel that is not probed yet.
+		// Shells are clipped to the occupied voxel range, and the shells
+		// that do not reach it at all are skipped.
+		double inf = std::numeric_limits<double>::infinity();
+		Eigen::Vector3i center = index_.GetVoxelIndex(query);
+		int first_shell = std::max(0, std::max(
+				(index_.min_voxel_ - center).maxCoeff(),
+				(center - index_.max_voxel_).maxCoeff()));
+		for (int s = first_shell; ; s++) {
+			Eigen::Vector3i lo = center - Eigen::Vector3i::Constant(s);
+			Eigen::Vector3i hi = center + Eigen::Vector3i::Constant(s);
+			Eigen::Vector3i lo_clip = lo.cwiseMax(index_.min_voxel_);
+			Eigen::Vector3i hi_clip = hi.cwiseMin(index_.max_voxel_);
+			Eigen::Vector3i v;
+			for (v(0) = lo_clip(0); v(0) <= hi_clip(0); v(0)++) {
+				for (v(1) = lo_clip(1); v(1) <= hi_clip(1); v(1)++) {
+					if (v(0) == lo(0) || v(0) == hi(0) || v(1) == lo(1) ||
+							v(1) == hi(1)) {
+						for (v(2) = lo_clip(2); v(2) <= hi_clip(2); v(2)++) {
+							CollectVoxel(query, v, inf, -1);
+						}
+					} else {
+						// inside the shell only the two z-faces are new
+						v(2) = lo(2);
+						if (v(2) >= lo_clip(2)) {
+							CollectVoxel(query, v, inf, -1);
+						}
+						v(2) = hi(2);
+						if (v(2) <= hi_clip(2)) {
+							CollectVoxel(query, v, inf, -1);
+						}
+					}
+				}
+			}
+			if ((lo.array() <= index_.min_voxel_.array()).all() &&
+					(hi.array() >= index_.max_voxel_.array()).all()) {
+				return;
+			}
+			if ((int)candidates_.size() >= knn_) {
+				Eigen::Vector3d lo_bound = lo.cast<double>() *
+						index_.voxel_size_;
+				Eigen::Vector3d hi_bound = (hi.cast<double>() +
+						Eigen::Vector3d::Ones()) * index_.voxel_size_;
+				double bound = std::min((query - lo_bound).minCoeff(),
+						(hi_bound - query).minCoeff());
+				std::nth_element(candidates_.begin(), candidates_.begin() +
+						knn_ - 1, candidates_.end());
+				if (candidates_[knn_ - 1].first <= bound * bound) {
+					return;
+				}
+			}
+		}
+	}
+
+private:
+	const VoxelHashIndex &index_;
+	KDTreeSearchParam::SearchType search_type_;
+	int knn_;
+	double radius_;
+	std::vector<std::pair<double, int>> candidates_;
+};
+
+VoxelHashIndex::VoxelHashIndex()
+{
+}
+
+VoxelHashIndex::VoxelHashIndex(const Geometry &geometry, double voxel_size)
+{
+	SetGeometry(geometry, voxel_size);
+}
+
+VoxelHashIndex::~VoxelHashIndex()
+{
+}
+
+bool VoxelHashIndex::SetGeometry(const Geometry &geometry, double voxel_size)
+{
+	table_.clear();
+	points_.clear();
+	point_indices_.clear();
+	voxel_size_ = voxel_size;
+	const std::vector<Eigen::Vector3d> *points;
+	switch (geometry.GetGeometryType()) {
+	case Geometry::GEOMETRY_POINTCLOUD:
+		points = &((const PointCloud &)geometry).points_;
+		break;
+	case Geometry::GEOMETRY_TRIANGLEMESH:
+		points = &((const TriangleMesh &)geometry).vertices_;
+		break;
+	case Geometry::GEOMETRY_IMAGE:
+	case Geometry::GEOMETRY_UNSPECIFIED:
+	default:
+		PrintDebug("[VoxelHashIndex::SetGeometry] Unsupported Geometry type.\n");
+		return false;
+	}
+	if (voxel_size <= 0.0) {
+		PrintDebug("[VoxelHashIndex::SetGeometry] voxel_size <= 0.\n");
+		return false;
+	}
+	if (points->empty()) {
+		PrintDebug("[VoxelHashIndex::SetGeometry] Failed due to no data.\n");
+		return false;
+	}
+
+	int num_points = (int)points->size();
+	std::vector<Eigen::Vector3i> voxel_index(num_points);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int i = 0; i < num_points; i++) {
+		voxel_index[i] = GetVoxelIndex((*points)[i]);
+	}
+	min_voxel_ = max_voxel_ = voxel_index[0];
+	for (int i = 1; i < num_points; i++) {
+		min_voxel_ = min_voxel_.cwiseMin(voxel_index[i]);
+		max_voxel_ = max_voxel_.cwiseMax(voxel_index[i]);
+	}
+	Eigen::Matrix<int64_t, 3, 1> extent = (max_voxel_ - min_voxel_).cast<
+			int64_t>() + Eigen::Matrix<int64_t, 3, 1>::Ones();
+	if ((double)extent(0) * (double)extent(1) * (double)extent(2) >= 4e18) {
+		PrintDebug("[VoxelHashIndex::SetGeometry] Too many voxels.\n");
+		return false;
+	}
+	stride_y_ = extent(2);
+	stride_x_ = extent(1) * extent(2);
+
+	// Counting sort of the points by voxel: the points of a voxel end up
+	// contiguous in points_, so probing a voxel reads a single memory block.
+	// While counting, begin_ of a table entry holds the voxel id.
+	std::vector<int> voxel_id(num_points);
+	std::vector<int> voxel_count;
+	table_bits_ = 10;
+	VoxelEntry empty_entry = {-1, 0, 0};
+	table_.assign((size_t)1 << table_bits_, empty_entry);
+	for (int i = 0; i < num_points; i++) {
+		int64_t key = GetVoxelKey(voxel_index[i]);
+		size_t slot = FindTableSlot(key);
+		if (table_[slot].key_ == -1) {
+			if (2 * (voxel_count.size() + 1) > table_.size()) {
+				// keep the load factor below 0.5
+				std::vector<VoxelEntry> old_table;
+				old_table.swap(table_);
+				table_bits_++;
+				table_.assign((size_t)1 << table_bits_, empty_entry);
+				for (const auto &entry : old_table) {
+					if (entry.key_ != -1) {
+						table_[FindTableSlot(entry.key_)] = entry;
+					}
+				}
+				slot = FindTableSlot(key);
+			}
+			table_[slot].key_ = key;
+			table_[slot].begin_ = (int)voxel_count.size();
+			voxel_count.push_back(0);
+		}
+		voxel_id[i] = table_[slot].begin_;
+		voxel_count[voxel_id[i]]++;
+	}
+	std::vector<int> voxel_begin(voxel_count.size() + 1, 0);
+	for (size_t i = 0; i < voxel_count.size(); i++) {
+		voxel_begin[i + 1] = voxel_begin[i] + voxel_count[i];
+	}
+	for (auto &entry : table_) {
+		if (entry.key_ != -1) {
+			int id = entry.begin_;
+			entry.begin_ = voxel_begin[id];
+			entry.end_ = voxel_begin[id + 1];
+		}
+	}
+	points_.resize(num_points);
+	point_indices_.resize(num_points);
+	for (int i = 0; i < num_points; i++) {
+		int pos = voxel_begin[voxel_id[i]]++;
+		points_[pos] = (*points)[i];
+		point_indices_[pos] = i;
+	}
+	return true;
+}
+
+int64_t VoxelHashIndex::GetVoxelKey(const Eigen::Vector3i &voxel) const
+{
+	return (int64_t)(voxel(0) - min_voxel_(0)) * stride_x_ +
+			(int64_t)(voxel(1) - min_voxel_(1)) * stride_y_ +
+			(int64_t)(voxel(2) - min_voxel_(2));
+}
+
+size_t VoxelHashIndex::FindTableSlot(int64_t key) const
+{
+	// Fibonacci hashing of the key followed by linear probing. Returns the
+	// slot holding key, or the empty slot where it would be inserted.
+	size_t slot = (size_t)(((uint64_t)key * 0x9e3779b97f4a7c15ULL) >>
+			(64 - table_bits_));
+	while (table_[slot].key_ != key && table_[slot].key_ != -1) {
+		slot = (slot + 1) & (table_.size() - 1);
+	}
+	return slot;
+}
+
+const VoxelHashIndex::VoxelEntry *VoxelHashIndex::FindVoxel(
+		const Eigen::Vector3i &voxel) const
+{
+	if ((voxel.array() < min_voxel_.array()).any() ||
+			(voxel.array() > max_voxel_.array()).any()) {
+		return nullptr;
+	}
+	const VoxelEntry &entry = table_[FindTableSlot(GetVoxelKey(voxel))];
+	return entry.key_ == -1 ? nullptr : &entry;
+}
+
+Eigen::Vector3i VoxelHashIndex::GetVoxelIndex(
+		const Eigen::Vector3d &point) const
+{
+	Eigen::Vector3d scaled = point / voxel_size_;
+	return Eigen::Vector3i(int(std::floor(scaled(0))),
+			int(std::floor(scaled(1))), int(std::floor(scaled(2))));
+}
+
+int VoxelHashIndex::Search(const Eigen::Vector3d &query,
+		const KDTreeSearchParam &param, std::vector<int> &indices,
+		std::vector<double> &distance2) const
+{
+	switch (param.GetSearchType()) {
+	case KDTreeSearchParam::SEARCH_KNN:
+		return SearchKNN(query, ((const KDTreeSearchParamKNN &)param).knn_,
+				indices, distance2);
+	case KDTreeSearchParam::SEARCH_RADIUS:
+		return SearchRadius(query,
+				((const KDTreeSearchParamRadius &)param).radius_, indices,
+				distance2);
+	case KDTreeSearchParam::SEARCH_HYBRID:
+		return SearchHybrid(query,
+				((const KDTreeSearchParamHybrid &)param).radius_,
+				((const KDTreeSearchParamHybrid &)param).max_nn_,
+				indices, distance2);
+	case KDTreeSearchParam::SEARCH_APPROXIMATE_KNN:
+		return SearchKNN(query,
+				((const KDTreeSearchParamApproximateKNN &)param).knn_,
+				indices, distance2);
+	default:
+		return -1;
+	}
+	return -1;
+}
+
+int VoxelHashIndex::SearchKNN(const Eigen::Vector3d &query, int knn,
+		std::vector<int> &indices, std::vector<double> &distance2) const
+{
+	if (points_.empty() || knn < 0) {
+		return -1;
+	}
+	indices.clear();
+	distance2.clear();
+	if (knn > 0) {
+		VoxelSearcher(*this, KDTreeSearchParam::SEARCH_KNN, knn, 0.0).Search(
+				query.data(), 3, indices, distance2);
+	}
+	return (int)indices.size();
+}
+
+int VoxelHashIndex::SearchRadius(const Eigen::Vector3d &query, double radius,
+		std::vector<int> &indices, std::vector<double> &distance2) const
+{
+	if (points_.empty()) {
+		return -1;
+	}
+	indices.clear();
+	distance2.clear();
+	VoxelSearcher(*this, KDTreeSearchParam::SEARCH_RADIUS, -1, radius).Search(
+			query.data(), 3, indices, distance2);
+	return (int)indices.size();
+}
+
+int VoxelHashIndex::SearchHybrid(const Eigen::Vector3d &query, double radius,
+		int max_nn, std::vector<int> &indices,
+		std::vector<double> &distance2) const
+{
+	if (points_.empty() || max_nn < 0) {
+		return -1;
+	}
+	indices.clear();
+	distance2.clear();
+	VoxelSearcher(*this, KDTreeSearchParam::SEARCH_HYBRID, max_nn, radius).
+			Search(query.data(), 3, indices, distance2);
+	return (int)indices.size();
+}
+
+template<typename T>
+int VoxelHashIndex::SearchBatch(const T &queries,
+		const KDTreeSearchParam &param, std::vector<int> &indices,
+		std::vector<double> &distance2, std::vector<size_t> &offsets) const
+{
+	return SearchBatchRaw(Eigen::Map<const Eigen::MatrixXd>(queries.data(),
+			queries.rows(), queries.cols()), param, indices, distance2,
+			offsets);
+}
+
+template<typename T>
+int VoxelHashIndex::SearchHybridBatch(const T &queries, double radius,
+		int max_nn, std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const
+{
+	return SearchBatchRaw(Eigen::Map<const Eigen::MatrixXd>(queries.data(),
+			queries.rows(), queries.cols()), KDTreeSearchParamHybrid(radius,
+			max_nn), indices, distance2, offsets);
+}
+
+int VoxelHashIndex::SearchBatchRaw(
+		const Eigen::Map<const Eigen::MatrixXd> &queries,
+		const KDTreeSearchParam &param, std::vector<int> &indices,
+		std::vector<double> &distance2, std::vector<size_t> &offsets) const
+{
+	if (points_.empty() || queries.rows() != 3) {
+		return -1;
+	}
+	switch (param.GetSearchType()) {
+	case KDTreeSearchParam::SEARCH_KNN:
+		if (((const KDTreeSearchParamKNN &)param).knn_ < 0) {
+			return -1;
+		}
+		return SearchBatchParallel(VoxelSearcher(*this,
+				KDTreeSearchParam::SEARCH_KNN,
+				((const KDTreeSearchParamKNN &)param).knn_, 0.0), queries,
+				indices, distance2, offsets);
+	case KDTreeSearchParam::SEARCH_APPROXIMATE_KNN:
+		if (((const KDTreeSearchParamApproximateKNN &)param).knn_ < 0) {
+			return -1;
+		}
+		return SearchBatchParallel(VoxelSearcher(*this,
+				KDTreeSearchParam::SEARCH_KNN,
+				((const KDTreeSearchParamApproximateKNN &)param).knn_, 0.0),
+				queries, indices, distance2, offsets);
+	case KDTreeSearchParam::SEARCH_RADIUS:
+		return SearchBatchParallel(VoxelSearcher(*this,
+				KDTreeSearchParam::SEARCH_RADIUS, -1,
+				((const KDTreeSearchParamRadius &)param).radius_), queries,
+				indices, distance2, offsets);
+	case KDTreeSearchParam::SEARCH_HYBRID:
+		if (((const KDTreeSearchParamHybrid &)param).max_nn_ < 0) {
+			return -1;
+		}
+		return SearchBatchParallel(VoxelSearcher(*this,
+				KDTreeSearchParam::SEARCH_HYBRID,
+				((const KDTreeSearchParamHybrid &)param).max_nn_,
+				((const KDTreeSearchParamHybrid &)param).radius_), queries,
+				indices, distance2, offsets);
+	default:
+		return -1;
+	}
+	return -1;
+}
+
+template int VoxelHashIndex::SearchBatch<Eigen::Matrix3Xd>(
+		const Eigen::Matrix3Xd &queries, const three::KDTreeSearchParam &param,
+		std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const;
+template int VoxelHashIndex::SearchHybridBatch<Eigen::Matrix3Xd>(
+		const Eigen::Matrix3Xd &queries, double radius, int max_nn,
+		std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const;
+template int VoxelHashIndex::SearchBatch<Eigen::Map<const Eigen::Matrix3Xd>>(
+		const Eigen::Map<const Eigen::Matrix3Xd> &queries,
+		const three::KDTreeSearchParam &param, std::vector<int> &indices,
+		std::vector<double> &distance2, std::vector<size_t> &offsets) const;
+template int VoxelHashIndex::SearchHybridBatch<
+		Eigen::Map<const Eigen::Matrix3Xd>>(
+		const Eigen::Map<const Eigen::Matrix3Xd> &queries, double radius,
+		int max_nn, std::vector<int> &indices, std::vector<double> &distance2,
+		std::vector<size_t> &offsets) const;
+
+}	// namespace three
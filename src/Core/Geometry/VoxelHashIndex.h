@@ -0,0 +1,124 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <Eigen/Core>
+
+#include <Core/Geometry/Geometry.h>
+#include <Core/Geometry/KDTreeSearchParam.h>
+
+namespace three {
+
+/// Class of a spatial hash grid for fixed-radius neighbor search on 3D points.
+/// Points are bucketed into cubic voxels of voxel_size. A radius search with
+/// radius <= voxel_size only probes the 27 voxels around the query, with no
+/// tree traversal, which makes it faster than KDTreeFlann for the small fixed
+/// radius of ICP correspondence search. Larger radii and KNN searches are
+/// supported by probing more voxels, but a kd-tree is preferable for them.
+/// The search functions have the same semantics as those of KDTreeFlann:
+/// neighbors are strictly closer than the radius and sorted by distance.
+class VoxelHashIndex
+{
+public:
+	VoxelHashIndex();
+	VoxelHashIndex(const Geometry &geometry, double voxel_size);
+	~VoxelHashIndex();
+	VoxelHashIndex(const VoxelHashIndex &) = delete;
+	VoxelHashIndex &operator=(const VoxelHashIndex &) = delete;
+
+public:
+	/// Function to build the index on the points of \param geometry.
+	/// The points are copied, the geometry can be modified afterwards.
+	bool SetGeometry(const Geometry &geometry, double voxel_size);
+	double GetVoxelSize() const { return voxel_size_; }
+
+	int Search(const Eigen::Vector3d &query, const KDTreeSearchParam &param,
+			std::vector<int> &indices, std::vector<double> &distance2) const;
+
+	int SearchKNN(const Eigen::Vector3d &query, int knn,
+			std::vector<int> &indices, std::vector<double> &distance2) const;
+
+	int SearchRadius(const Eigen::Vector3d &query, double radius,
+			std::vector<int> &indices, std::vector<double> &distance2) const;
+
+	int SearchHybrid(const Eigen::Vector3d &query, double radius, int max_nn,
+			std::vector<int> &indices, std::vector<double> &distance2) const;
+
+	/// Batched search functions, see KDTreeFlann::SearchBatch()
+	template<typename T>
+	int SearchBatch(const T &queries, const KDTreeSearchParam &param,
+			std::vector<int> &indices, std::vector<double> &distance2,
+			std::vector<size_t> &offsets) const;
+
+	template<typename T>
+	int SearchHybridBatch(const T &queries, double radius, int max_nn,
+			std::vector<int> &indices, std::vector<double> &distance2,
+			std::vector<size_t> &offsets) const;
+
+private:
+	class VoxelSearcher;
+
+	/// Entry of the voxel hash table. The points of the voxel are
+	/// points_[begin_] ... points_[end_ - 1]; empty slots have key_ -1.
+	class VoxelEntry
+	{
+	public:
+		int64_t key_;
+		int begin_;
+		int end_;
+	};
+
+	Eigen::Vector3i GetVoxelIndex(const Eigen::Vector3d &point) const;
+	int64_t GetVoxelKey(const Eigen::Vector3i &voxel) const;
+	size_t FindTableSlot(int64_t key) const;
+	/// Function to get the entry of \param voxel, nullptr if it is empty
+	const VoxelEntry *FindVoxel(const Eigen::Vector3i &voxel) const;
+	int SearchBatchRaw(const Eigen::Map<const Eigen::MatrixXd> &queries,
+			const KDTreeSearchParam &param, std::vector<int> &indices,
+			std::vector<double> &distance2,
+			std::vector<size_t> &offsets) const;
+
+protected:
+	double voxel_size_ = 0.0;
+	/// Range of the occupied voxels. A voxel is keyed by its linear index in
+	/// this range.
+	Eigen::Vector3i min_voxel_;
+	Eigen::Vector3i max_voxel_;
+	int64_t stride_x_ = 0;
+	int64_t stride_y_ = 0;
+	/// Open addressing hash table (linear probing) with 2^table_bits_ slots
+	std::vector<VoxelEntry> table_;
+	int table_bits_ = 0;
+	/// Copy of the points sorted by voxel, and their original indices
+	std::vector<Eigen::Vector3d> points_;
+	std::vector<int> point_indices_;
+};
+
+}	// namespace three
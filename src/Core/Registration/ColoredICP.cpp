@@ -41,6 +41,7 @@ namespace {
 
 const double default_lambda_geometric = 0.968;
 const int max_neighbors_for_gradient_approximation = 30;
+const size_t color_gradient_batch_size = 65536;
 
 class PointCloudForColoredICP : public PointCloud {
 public:
@@ -85,51 +86,62 @@ std::shared_ptr<PointCloudForColoredICP>
 	size_t n_points = output->points_.size();
 	output->color_gradient_.resize(n_points, Eigen::Vector3d::Zero());
 
-	for (auto k = 0; k < n_points; k++) {
-		const Eigen::Vector3d &vt = output->points_[k];
-		const Eigen::Vector3d &nt = output->normals_[k];
-		double it = (output->colors_[k](0) + output->colors_[k](1)
-				+ output->colors_[k](2)) / 3.0;
-
-		std::vector<int> point_idx;
-		std::vector<double> point_squared_distance;
-
-		if (tree.SearchHybrid(vt, search_param.radius_,
-				search_param.max_nn_, point_idx, point_squared_distance) >= 3) {
-			// approximate image gradient of vt's tangential plane
-			size_t nn = point_idx.size();
-			Eigen::MatrixXd A(nn, 3);
-			Eigen::MatrixXd b(nn, 1);
-			A.setZero();
-			b.setZero();
-			for (auto i = 1; i < nn; i++) {
-				int P_adj_idx = point_idx[i];
-				Eigen::Vector3d vt_adj = output->points_[P_adj_idx];
-				Eigen::Vector3d vt_proj =
-						vt_adj - (vt_adj - vt).dot(nt) * nt;
-				double it_adj = (output->colors_[P_adj_idx](0)
-						+ output->colors_[P_adj_idx](1)
-						+ output->colors_[P_adj_idx](2)) / 3.0;
-				A(i - 1, 0) = (vt_proj(0) - vt(0));
-				A(i - 1, 1) = (vt_proj(1) - vt(1));
-				A(i - 1, 2) = (vt_proj(2) - vt(2));
-				b(i - 1, 0) = (it_adj - it);
-			}
-			// adds orthogonal constraint
-			A(nn - 1, 0) = (nn - 1) * nt(0);
-			A(nn - 1, 1) = (nn - 1) * nt(1);
-			A(nn - 1, 2) = (nn - 1) * nt(2);
-			b(nn - 1, 0) = 0;
-			// solving linear equation
-			bool is_success;
-			Eigen::MatrixXd x;
-			std::tie(is_success, x) = SolveLinearSystem(
-				A.transpose() * A, A.transpose() * b);
-			if (is_success) {
-				output->color_gradient_[k] = x;
-				// std::cout << x(0) << std::endl;
-				// std::cout << x(1) << std::endl;
-				// std::cout << x(2) << std::endl;
+	std::vector<int> point_idx_batch;
+	std::vector<double> point_squared_distance_batch;
+	std::vector<size_t> offsets;
+	for (size_t begin = 0; begin < n_points;
+			begin += color_gradient_batch_size) {
+		int batch_size = (int)std::min(color_gradient_batch_size,
+				n_points - begin);
+		tree.SearchHybridBatch(Eigen::Map<const Eigen::Matrix3Xd>(
+				(const double *)(output->points_.data() + begin), 3,
+				batch_size), search_param.radius_, search_param.max_nn_,
+				point_idx_batch, point_squared_distance_batch, offsets);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for (int j = 0; j < batch_size; j++) {
+			size_t k = begin + j;
+			const Eigen::Vector3d &vt = output->points_[k];
+			const Eigen::Vector3d &nt = output->normals_[k];
+			double it = (output->colors_[k](0) + output->colors_[k](1)
+					+ output->colors_[k](2)) / 3.0;
+
+			size_t nn = offsets[j + 1] - offsets[j];
+			const int *point_idx = point_idx_batch.data() + offsets[j];
+
+			if (nn >= 3) {
+				// approximate image gradient of vt's tangential plane
+				Eigen::MatrixXd A(nn, 3);
+				Eigen::MatrixXd b(nn, 1);
+				A.setZero();
+				b.setZero();
+				for (auto i = 1; i < nn; i++) {
+					int P_adj_idx = point_idx[i];
+					Eigen::Vector3d vt_adj = output->points_[P_adj_idx];
+					Eigen::Vector3d vt_proj =
+							vt_adj - (vt_adj - vt).dot(nt) * nt;
+					double it_adj = (output->colors_[P_adj_idx](0)
+							+ output->colors_[P_adj_idx](1)
+							+ output->colors_[P_adj_idx](2)) / 3.0;
+					A(i - 1, 0) = (vt_proj(0) - vt(0));
+					A(i - 1, 1) = (vt_proj(1) - vt(1));
+					A(i - 1, 2) = (vt_proj(2) - vt(2));
+					b(i - 1, 0) = (it_adj - it);
+				}
+				// adds orthogonal constraint
+				A(nn - 1, 0) = (nn - 1) * nt(0);
+				A(nn - 1, 1) = (nn - 1) * nt(1);
+				A(nn - 1, 2) = (nn - 1) * nt(2);
+				b(nn - 1, 0) = 0;
+				// solving linear equation
+				bool is_success;
+				Eigen::MatrixXd x;
+				std::tie(is_success, x) = SolveLinearSystem(
+					A.transpose() * A, A.transpose() * b);
+				if (is_success) {
+					output->color_gradient_[k] = x;
+				}
 			}
 		}
 	}
@@ -26,15 +26,23 @@
 
 #include "Feature.h"
 
+#include <algorithm>
+#include <cmath>
 #include <Eigen/Dense>
 #include <Core/Utility/Console.h>
+#include <Core/Utility/Helper.h>
 #include <Core/Geometry/PointCloud.h>
 #include <Core/Geometry/KDTreeFlann.h>
+#include <Core/Geometry/NeighborSearchBatch.h>
 
 namespace three {
 
 namespace {
 
+/// Batch size of the searches that do not keep their neighbor lists, small
+/// enough for the search buffers not to matter next to the result.
+const size_t compact_feature_batch_size = 8192;
+
 Eigen::Vector4d ComputePairFeatures(const Eigen::Vector3d &p1,
 		const Eigen::Vector3d &n1, const Eigen::Vector3d &p2,
 		const Eigen::Vector3d &n2)
@@ -49,7 +57,9 @@ Eigen::Vector4d ComputePairFeatures(const Eigen::Vector3d &p1,
 	auto n2_copy = n2;
 	double angle1 = n1_copy.dot(dp2p1) / result(3);
 	double angle2 = n2_copy.dot(dp2p1) / result(3);
-	if (acos(fabs(angle1)) > acos(fabs(angle2))) {
+	// acos is decreasing, so comparing the cosines picks the same source
+	// point as comparing the angles without evaluating acos.
+	if (fabs(angle1) < fabs(angle2)) {
 		n1_copy = n2;
 		n2_copy = n1;
 		dp2p1 *= -1.0;
@@ -69,91 +79,357 @@ Eigen::Vector4d ComputePairFeatures(const Eigen::Vector3d &p1,
 	return result;
 }
 
-std::shared_ptr<Feature> ComputeSPFHFeature(const PointCloud &input,
-		const KDTreeFlann &kdtree, const KDTreeSearchParam &search_param)
+inline int HistogramBin(double value)
 {
-	auto feature = std::make_shared<Feature>();
-	feature->Resize(33, (int)input.points_.size());
+	int h_index = (int)(floor(value));
+	if (h_index < 0) h_index = 0;
+	if (h_index >= 11) h_index = 10;
+	return h_index;
+}
+
+/// Searches the neighbors of the points \param query_indices in batches and
+/// calls \param process(begin, neighbors, offsets) once per batch: the
+/// neighbors of query_indices[begin + j] are
+/// neighbors[offsets[j] .. offsets[j + 1]). The first neighbor of each search
+/// result, the query point itself, is dropped. Only one batch of
+/// \param batch_size neighbor lists is held at a time.
+/// Returns false if a search fails.
+template <typename ProcessBatch>
+bool SearchNeighborBatches(const PointCloud &input, const KDTreeFlann &kdtree,
+		const KDTreeSearchParam &search_param,
+		const std::vector<size_t> &query_indices, size_t batch_size,
+		ProcessBatch process)
+{
+	return SearchNeighborsInBatches(kdtree, search_param,
+			query_indices.size(), [&](size_t q) {
+			return input.points_[query_indices[q]]; }, [&](size_t begin,
+			std::vector<int> &indices, const std::vector<double> &,
+			std::vector<size_t> &offsets) {
+		// Drop the self entries in place; offsets[j] is read before it is
+		// overwritten by the compacted start of list j.
+		size_t num_queries = offsets.size() - 1;
+		size_t size = 0, start = offsets[0];
+		for (size_t j = 0; j < num_queries; j++) {
+			size_t end = offsets[j + 1];
+			offsets[j] = size;
+			for (size_t k = start + 1; k < end; k++) {
+				indices[size++] = indices[k];
+			}
+			start = end;
+		}
+		offsets[num_queries] = size;
+		process(begin, indices, offsets);
+	}, batch_size);
+}
+
+/// SPFH histogram of point \param i with the \param num_neighbors points
+/// \param neighbors; each of the three angle groups sums to 100 unless the
+/// point has no neighbors.
+void ComputeSPFHHistogram(const PointCloud &input, size_t i,
+		const int *neighbors, size_t num_neighbors, double histogram[33])
+{
+	std::fill(histogram, histogram + 33, 0.0);
+	if (num_neighbors == 0) {
+		return;
+	}
+	// only compute SPFH feature when a point has neighbors
+	const auto &point = input.points_[i];
+	const auto &normal = input.normals_[i];
+	double hist_incr = 100.0 / (double)num_neighbors;
+	for (size_t k = 0; k < num_neighbors; k++) {
+		auto pf = ComputePairFeatures(point, normal,
+				input.points_[neighbors[k]], input.normals_[neighbors[k]]);
+		histogram[HistogramBin(11 * (pf(0) + M_PI) / (2.0 * M_PI))] +=
+				hist_incr;
+		histogram[HistogramBin(11 * (pf(1) + 1.0) * 0.5) + 11] += hist_incr;
+		histogram[HistogramBin(11 * (pf(2) + 1.0) * 0.5) + 22] += hist_incr;
+	}
+}
+
+/// Weighted sum of the SPFH histograms of the neighbors of point \param i,
+/// normalized to 100 per angle group; FPFH adds the SPFH of the point itself.
+/// \param get_spfh(n) returns the 33 SPFH values of point n in any linear
+/// unit, which the normalization cancels.
+template <typename GetSPFH>
+void ComputeNeighborSPFHSum(const PointCloud &input, size_t i,
+		const int *neighbors, size_t num_neighbors, GetSPFH get_spfh,
+		double histogram[33])
+{
+	std::fill(histogram, histogram + 33, 0.0);
+	double sum[3] = {0.0, 0.0, 0.0};
+	for (size_t k = 0; k < num_neighbors; k++) {
+		double dist = (input.points_[neighbors[k]] -
+				input.points_[i]).squaredNorm();
+		if (dist == 0.0)
+			continue;
+		double weight = 1.0 / dist;
+		const auto *neighbor_spfh = get_spfh(neighbors[k]);
+		for (int h = 0; h < 33; h++) {
+			histogram[h] += neighbor_spfh[h] * weight;
+		}
+	}
+	for (int h = 0; h < 33; h++) {
+		sum[h / 11] += histogram[h];
+	}
+	for (int h = 0; h < 3; h++)
+		if (sum[h] != 0.0) sum[h] = 100.0 / sum[h];
+	for (int h = 0; h < 33; h++) {
+		histogram[h] *= sum[h / 11];
+	}
+}
+
+/// Function to check \param indices and to assign every described point its
+/// first position in \param indices, -1 for the other points.
+/// \return false if an index is out of range.
+bool GetDescribedPositions(const PointCloud &input,
+		const std::vector<size_t> &indices, std::vector<int> &spfh_position)
+{
+	size_t num_points = input.points_.size();
+	spfh_position.assign(num_points, -1);
+	for (size_t e = 0; e < indices.size(); e++) {
+		if (indices[e] >= num_points) {
+			PrintDebug("[ComputeFPFHFeature] Index out of range.\n");
+			return false;
+		}
+		if (spfh_position[indices[e]] < 0) {
+			spfh_position[indices[e]] = (int)e;
+		}
+	}
+	return true;
+}
+
+inline void EncodeSPFHValue(double value, double, float &code)
+{
+	code = (float)value;
+}
+
+inline void EncodeSPFHValue(double value, double scale, uint16_t &code)
+{
+	code = (uint16_t)std::min(std::round(value / scale), 65535.0);
+}
+
+/// Function to compute the FPFH histograms of the points \param indices in
+/// batches, without keeping neighbor lists. \param spfh_position holds the
+/// first position in indices of every described point, -1 for the others,
+/// and is overwritten. The SPFH histograms of the described points and of
+/// their neighbors are stored as SPFHCode values of \param spfh_scale, then
+/// \param store(e, fpfh) is called in parallel with the 33 FPFH values of
+/// every point indices[e] that has neighbors. A subset of points is searched
+/// up to three times, all points twice.
+/// Returns false if a search fails.
+template <typename SPFHCode, typename StoreFPFH>
+bool ComputeFPFHInBatches(const PointCloud &input,
+		const KDTreeSearchParam &search_param,
+		const std::vector<size_t> &indices, std::vector<int> &spfh_position,
+		double spfh_scale, StoreFPFH store)
+{
+	size_t num_points = input.points_.size();
+	KDTreeFlann kdtree(input);
+	std::vector<size_t> spfh_points;
+	for (size_t e = 0; e < indices.size(); e++) {
+		if (spfh_position[indices[e]] == (int)e) {
+			spfh_points.push_back(indices[e]);
+		}
+	}
+	for (size_t m = 0; m < spfh_points.size(); m++) {
+		spfh_position[spfh_points[m]] = (int)m;
+	}
+	if (spfh_points.size() < num_points) {
+		// A subset of points first marks the neighbors whose SPFH it needs.
+		std::vector<uint8_t> is_missing(num_points, 0);
+		if (SearchNeighborBatches(input, kdtree, search_param, indices,
+				compact_feature_batch_size, [&](size_t,
+				const std::vector<int> &neighbors,
+				const std::vector<size_t> &offsets) {
+			for (size_t k = 0; k < offsets.back(); k++) {
+				if (spfh_position[neighbors[k]] < 0) {
+					is_missing[neighbors[k]] = 1;
+				}
+			}
+		}) == false) {
+			return false;
+		}
+		std::vector<size_t> missing = GetNonZeroIndices(is_missing);
+		for (size_t m = 0; m < missing.size(); m++) {
+			spfh_position[missing[m]] = (int)spfh_points.size();
+			spfh_points.push_back(missing[m]);
+		}
+	}
+	std::vector<SPFHCode> spfh(33 * spfh_points.size());
+	if (SearchNeighborBatches(input, kdtree, search_param, spfh_points,
+			compact_feature_batch_size, [&](size_t begin,
+			const std::vector<int> &neighbors,
+			const std::vector<size_t> &offsets) {
 #ifdef _OPENMP
 #pragma omp parallel for schedule(static)
 #endif
-	for (int i = 0; i < (int)input.points_.size(); i++) {
-		const auto &point = input.points_[i];
-		const auto &normal = input.normals_[i];
-		std::vector<int> indices;
-		std::vector<double> distance2;
-		if (kdtree.Search(point, search_param, indices, distance2) > 1) {
-			// only compute SPFH feature when a point has neighbors
-			double hist_incr = 100.0 / (double)(indices.size() - 1);
-			for (size_t k = 1; k < indices.size(); k++) {
-				// skip the point itself, compute histogram
-				auto pf = ComputePairFeatures(point, normal,
-						input.points_[indices[k]], input.normals_[indices[k]]);
-				int h_index = (int)(floor(11 * (pf(0) + M_PI) / (2.0 * M_PI)));
-				if (h_index < 0) h_index = 0;
-				if (h_index >= 11) h_index = 10;
-				feature->data_(h_index, i) += hist_incr;
-				h_index = (int)(floor(11 * (pf(1) + 1.0) * 0.5));
-				if (h_index < 0) h_index = 0;
-				if (h_index >= 11) h_index = 10;
-				feature->data_(h_index + 11, i) += hist_incr;
-				h_index = (int)(floor(11 * (pf(2) + 1.0) * 0.5));
-				if (h_index < 0) h_index = 0;
-				if (h_index >= 11) h_index = 10;
-				feature->data_(h_index + 22, i) += hist_incr;
+		for (int j = 0; j < (int)offsets.size() - 1; j++) {
+			double histogram[33];
+			ComputeSPFHHistogram(input, spfh_points[begin + j],
+					neighbors.data() + offsets[j], offsets[j + 1] -
+					offsets[j], histogram);
+			SPFHCode *codes = spfh.data() + (begin + j) * 33;
+			for (int h = 0; h < 33; h++) {
+				EncodeSPFHValue(histogram[h], spfh_scale, codes[h]);
 			}
 		}
+	}) == false) {
+		return false;
 	}
-	return feature;
+	std::vector<size_t>().swap(spfh_points);
+	auto get_spfh = [&](int n) {
+		return spfh.data() + (size_t)spfh_position[n] * 33;
+	};
+	return SearchNeighborBatches(input, kdtree, search_param, indices,
+			compact_feature_batch_size, [&](size_t begin,
+			const std::vector<int> &neighbors,
+			const std::vector<size_t> &offsets) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for (int j = 0; j < (int)offsets.size() - 1; j++) {
+			if (offsets[j + 1] == offsets[j]) {
+				continue;
+			}
+			size_t i = indices[begin + j];
+			double histogram[33];
+			ComputeNeighborSPFHSum(input, i, neighbors.data() + offsets[j],
+					offsets[j + 1] - offsets[j], get_spfh, histogram);
+			const SPFHCode *own_spfh = get_spfh((int)i);
+			for (int h = 0; h < 33; h++) {
+				// The commented line is the fpfh function in the paper.
+				// But according to PCL implementation, it is skipped.
+				// Our initial test shows that the full fpfh function in
+				// the paper seems to be better than PCL implementation.
+				// Further test required.
+				histogram[h] += own_spfh[h] * spfh_scale;
+			}
+			store(begin + j, histogram);
+		}
+	});
 }
 
 }	// unnamed namespace
 
 std::shared_ptr<Feature> ComputeFPFHFeature(const PointCloud &input,
 		const KDTreeSearchParam &search_param/* = KDTreeSearchParamKNN()*/)
+{
+	std::vector<size_t> indices(input.points_.size());
+	for (size_t i = 0; i < indices.size(); i++) {
+		indices[i] = i;
+	}
+	return ComputeFPFHFeature(input, search_param, indices);
+}
+
+std::shared_ptr<Feature> ComputeFPFHFeature(const PointCloud &input,
+		const KDTreeSearchParam &search_param,
+		const std::vector<size_t> &indices)
 {
 	auto feature = std::make_shared<Feature>();
-	feature->Resize(33, (int)input.points_.size());
+	feature->Resize(33, (int)indices.size());
 	if (input.HasNormals() == false) {
 		PrintDebug("[ComputeFPFHFeature] Failed because input point cloud has no normal.\n");
 		return feature;
 	}
-	KDTreeFlann kdtree(input);
-	auto spfh = ComputeSPFHFeature(input, kdtree, search_param);
+	std::vector<int> spfh_position;
+	if (GetDescribedPositions(input, indices, spfh_position) == false) {
+		return feature;
+	}
+	if (indices.empty()) {
+		return feature;
+	}
+	if (ComputeFPFHInBatches<float>(input, search_param, indices,
+			spfh_position, 1.0, [&](size_t e, const double fpfh[33]) {
+		for (int h = 0; h < 33; h++) {
+			feature->data_(h, e) = fpfh[h];
+		}
+	}) == false) {
+		PrintDebug("[ComputeFPFHFeature] Neighbor search failed.\n");
+	}
+	return feature;
+}
+
+std::shared_ptr<QuantizedFeature> ComputeQuantizedFPFHFeature(
+		const PointCloud &input,
+		const KDTreeSearchParam &search_param/* = KDTreeSearchParamKNN()*/)
+{
+	std::vector<size_t> indices(input.points_.size());
+	for (size_t i = 0; i < indices.size(); i++) {
+		indices[i] = i;
+	}
+	return ComputeQuantizedFPFHFeature(input, search_param, indices);
+}
+
+std::shared_ptr<QuantizedFeature> ComputeQuantizedFPFHFeature(
+		const PointCloud &input, const KDTreeSearchParam &search_param,
+		const std::vector<size_t> &indices)
+{
+	// Every FPFH value lies in [0, 200]: each angle group of the own SPFH and
+	// of the normalized neighbor sum adds up to 100.
+	auto feature = std::make_shared<QuantizedFeature>();
+	feature->Resize(33, (int)indices.size());
+	feature->scale_ = 200.0 / 255.0;
+	if (input.HasNormals() == false) {
+		PrintDebug("[ComputeFPFHFeature] Failed because input point cloud has no normal.\n");
+		return feature;
+	}
+	std::vector<int> spfh_position;
+	if (GetDescribedPositions(input, indices, spfh_position) == false) {
+		return feature;
+	}
+	if (indices.empty()) {
+		return feature;
+	}
+	// SPFH histograms are stored as 16-bit codes of [0, 100].
+	double inv_scale = 1.0 / feature->scale_;
+	if (ComputeFPFHInBatches<uint16_t>(input, search_param, indices,
+			spfh_position, 100.0 / 65535.0, [&](size_t e,
+			const double fpfh[33]) {
+		uint8_t *codes = feature->data_.data() + e * 33;
+		for (int h = 0; h < 33; h++) {
+			codes[h] = (uint8_t)std::min(std::round(fpfh[h] * inv_scale),
+					255.0);
+		}
+	}) == false) {
+		PrintDebug("[ComputeFPFHFeature] Neighbor search failed.\n");
+	}
+	return feature;
+}
+
+std::shared_ptr<QuantizedFeature> QuantizeFeature(const Feature &feature,
+		double min_value/* = 0.0*/, double max_value/* = 0.0*/)
+{
+	auto quantized = std::make_shared<QuantizedFeature>();
+	quantized->Resize((int)feature.Dimension(), (int)feature.Num());
+	if (feature.data_.size() == 0) {
+		return quantized;
+	}
+	if (max_value <= min_value) {
+		min_value = feature.data_.minCoeff();
+		max_value = feature.data_.maxCoeff();
+	}
+	quantized->offset_ = min_value;
+	quantized->scale_ = max_value > min_value ?
+			(max_value - min_value) / 255.0 : 1.0;
+	double inv_scale = 1.0 / quantized->scale_;
+	const double *values = feature.data_.data();
+	uint8_t *codes = quantized->data_.data();
 #ifdef _OPENMP
 #pragma omp parallel for schedule(static)
 #endif
-	for (int i = 0; i < (int)input.points_.size(); i++) {
-		const auto &point = input.points_[i];
-		std::vector<int> indices;
-		std::vector<double> distance2;
-		if (kdtree.Search(point, search_param, indices, distance2) > 1) {
-			double sum[3] = {0.0, 0.0, 0.0};
-			for (size_t k = 1; k < indices.size(); k++) {
-				// skip the point itself
-				double dist = distance2[k];
-				if (dist == 0.0)
-					continue;
-				for (int j = 0; j < 33; j++) {
-					double val = spfh->data_(j, indices[k]) / dist;
-					sum[j / 11] += val;
-					feature->data_(j, i) += val;
-				}
-			}
-			for (int j = 0; j < 3; j++)
-				if (sum[j] != 0.0) sum[j] = 100.0 / sum[j];
-			for (int j = 0; j < 33; j++) {
-				feature->data_(j, i) *= sum[j / 11];
-				// The commented line is the fpfh function in the paper.
-				// But according to PCL implementation, it is skipped.
-				// Our initial test shows that the full fpfh function in the
-				// paper seems to be better than PCL implementation. Further
-				// test required.
-				feature->data_(j, i) += spfh->data_(j, i);
-			}
-		}
+	for (int k = 0; k < (int)feature.data_.size(); k++) {
+		double code = std::round((values[k] - min_value) * inv_scale);
+		codes[k] = (uint8_t)std::min(std::max(code, 0.0), 255.0);
 	}
-	return feature;
+	return quantized;
+}
+
+std::shared_ptr<Feature> DequantizeFeature(const QuantizedFeature &feature)
+{
+	auto dequantized = std::make_shared<Feature>();
+	dequantized->data_ = (feature.data_.cast<double>() * feature.scale_).
+			array() + feature.offset_;
+	return dequantized;
 }
 
 }	// namespace three
@@ -26,6 +26,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <memory>
 #include <Eigen/Core>
@@ -46,8 +47,83 @@ public:
 	Eigen::MatrixXd data_;
 };
 
+/// Compact copy of a Feature with every value quantized to 8 bits, a quarter
+/// of a float and an eighth of a double. Value d of feature i is
+/// offset_ + scale_ * data_(d, i). Features quantized with the same scale_
+/// and offset_ are compared on their integer codes directly.
+class QuantizedFeature
+{
+public:
+	void Resize(int dim, int n) { data_.resize(dim, n); data_.setZero(); }
+	size_t Dimension() const { return data_.rows(); }
+	size_t Num() const { return data_.cols(); }
+	bool HasSameQuantization(const QuantizedFeature &other) const {
+		return scale_ == other.scale_ && offset_ == other.offset_;
+	}
+
+public:
+	double scale_ = 1.0;
+	double offset_ = 0.0;
+	Eigen::Matrix<uint8_t, Eigen::Dynamic, Eigen::Dynamic> data_;
+};
+
+/// Function to compute the squared Euclidean distance between the codes
+/// \param a and \param b of two quantized features of \param dimension
+/// values. Multiplied by scale_^2 it is the distance of the values if both
+/// features share their quantization.
+inline uint32_t SquaredCodeDistance(const uint8_t *a, const uint8_t *b,
+		size_t dimension)
+{
+	// A plain integer loop, which the compiler vectorizes.
+	uint32_t distance2 = 0;
+	for (size_t d = 0; d < dimension; d++) {
+		int diff = (int)a[d] - (int)b[d];
+		distance2 += (uint32_t)(diff * diff);
+	}
+	return distance2;
+}
+
 /// Function to compute FPFH feature for a point cloud
+/// Neighbor lists are searched in bounded batches instead of being kept and
+/// SPFH histograms are stored in single precision, so the memory is
+/// dominated by the 264 bytes per point of the result. Use
+/// ComputeQuantizedFPFHFeature to bound the memory of large point clouds.
 std::shared_ptr<Feature> ComputeFPFHFeature(const PointCloud &input,
 		const KDTreeSearchParam &search_param = KDTreeSearchParamKNN());
 
+/// Function to compute FPFH feature for the points \param indices of a point
+/// cloud, e.g. keypoints from ComputeISSKeypoints. Column k of the feature
+/// describes point indices[k]; neighborhoods are searched in the full point
+/// cloud. To register with these features, pass SelectDownSample(input,
+/// indices) as point cloud so that RANSAC samples only described points.
+std::shared_ptr<Feature> ComputeFPFHFeature(const PointCloud &input,
+		const KDTreeSearchParam &search_param,
+		const std::vector<size_t> &indices);
+
+/// Function to compute FPFH feature for a point cloud as a QuantizedFeature
+/// with the range [0, 200] of FPFH values, for large point clouds. As in
+/// ComputeFPFHFeature neighbor lists are not kept, and SPFH histograms are
+/// stored as 16 bits, so the memory is dominated by the 33 bytes per point
+/// of the result.
+std::shared_ptr<QuantizedFeature> ComputeQuantizedFPFHFeature(
+		const PointCloud &input,
+		const KDTreeSearchParam &search_param = KDTreeSearchParamKNN());
+
+/// Function to compute the quantized FPFH feature for the points
+/// \param indices of a point cloud, see ComputeFPFHFeature
+std::shared_ptr<QuantizedFeature> ComputeQuantizedFPFHFeature(
+		const PointCloud &input, const KDTreeSearchParam &search_param,
+		const std::vector<size_t> &indices);
+
+/// Function to quantize a Feature to 8 bits per value
+/// Values are clamped to [\param min_value, \param max_value]; if max_value
+/// is not larger than min_value the range of the feature values is used.
+/// Features that are matched against each other should be quantized with
+/// the same range, e.g. [0, 200] for FPFH.
+std::shared_ptr<QuantizedFeature> QuantizeFeature(const Feature &feature,
+		double min_value = 0.0, double max_value = 0.0);
+
+/// Function to convert a QuantizedFeature back to double values
+std::shared_ptr<Feature> DequantizeFeature(const QuantizedFeature &feature);
+
 }	// namespace three
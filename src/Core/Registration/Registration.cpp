@@ -24,77 +24,103 @@
 // IN THE SOFTWARE.
 // ----------------------------------------------------------------------------
 
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable: 4267)
+#endif
+
 #include "Registration.h"
 
 #include <cstdlib>
 #include <ctime>
+#include <cstring>
+#include <flann/flann.hpp>
 
 #include <Core/Utility/Console.h>
 #include <Core/Geometry/PointCloud.h>
 #include <Core/Geometry/KDTreeFlann.h>
+#include <Core/Geometry/VoxelHashIndex.h>
 #include <Core/Registration/Feature.h>
 
 namespace three {
 
 namespace {
 
+/// Buffers of the correspondence search, reused across the evaluations of a
+/// registration so that evaluating a transformation does not allocate.
+class CorrespondenceSearchBuffer
+{
+public:
+	Eigen::Matrix3Xd points;
+	std::vector<int> indices;
+	std::vector<double> dists;
+	std::vector<size_t> offsets;
+};
+
+Eigen::Map<const Eigen::Matrix3Xd> GetPointMatrix(const PointCloud &cloud)
+{
+	return Eigen::Map<const Eigen::Matrix3Xd>(
+			(const double *)cloud.points_.data(), 3, cloud.points_.size());
+}
+
+/// Function to transform the points of \param source into \param buffer
+/// without copying the rest of the point cloud
+Eigen::Map<const Eigen::Matrix3Xd> TransformPoints(const PointCloud &source,
+		const Eigen::Matrix4d &transformation,
+		CorrespondenceSearchBuffer &buffer)
+{
+	buffer.points.resize(3, source.points_.size());
+	buffer.points.noalias() = transformation.block<3, 3>(0, 0) *
+			GetPointMatrix(source);
+	buffer.points.colwise() += transformation.block<3, 1>(0, 3);
+	return Eigen::Map<const Eigen::Matrix3Xd>(buffer.points.data(), 3,
+			buffer.points.cols());
+}
+
+template<typename SearchIndex>
 RegistrationResult GetRegistrationResultAndCorrespondences(
-		const PointCloud &source, const PointCloud &target,
-		const KDTreeFlann &target_kdtree, double max_correspondence_distance,
-		const Eigen::Matrix4d &transformation)
+		const Eigen::Map<const Eigen::Matrix3Xd> &source_points,
+		const SearchIndex &target_index, double max_correspondence_distance,
+		const Eigen::Matrix4d &transformation,
+		CorrespondenceSearchBuffer &buffer)
 {
 	RegistrationResult result(transformation);
 	if (max_correspondence_distance <= 0.0) {
 		return std::move(result);
 	}
 
-	double error2 = 0.0;
+	const auto &indices = buffer.indices;
+	const auto &dists = buffer.dists;
+	const auto &offsets = buffer.offsets;
+	if (target_index.SearchHybridBatch(source_points,
+			max_correspondence_distance, 1, buffer.indices, buffer.dists,
+			buffer.offsets) < 0) {
+		return std::move(result);
+	}
 
-#ifdef _OPENMP
-#pragma omp parallel
-	{
-#endif
-		double error2_private = 0.0;
-		CorrespondenceSet correspondence_set_private;
-#ifdef _OPENMP
-#pragma omp for nowait
-#endif
-		for (int i = 0; i < (int)source.points_.size(); i++) {
-			std::vector<int> indices(1);
-			std::vector<double> dists(1);
-			const auto &point = source.points_[i];
-			if (target_kdtree.SearchHybrid(point, max_correspondence_distance, 1,
-					indices, dists) > 0) {
-				error2_private += dists[0];
-				correspondence_set_private.push_back(
-						Eigen::Vector2i(i, indices[0]));
-			}
-		}
-#ifdef _OPENMP
-#pragma omp critical
-#endif
-		{
-			for (int i = 0; i < correspondence_set_private.size(); i++) {
-				result.correspondence_set_.push_back(
-						correspondence_set_private[i]);
-			}
-			error2 += error2_private;
+	double error2 = 0.0;
+	result.correspondence_set_.reserve(indices.size());
+	for (int i = 0; i < (int)source_points.cols(); i++) {
+		if (offsets[i + 1] > offsets[i]) {
+			error2 += dists[offsets[i]];
+			result.correspondence_set_.push_back(
+					Eigen::Vector2i(i, indices[offsets[i]]));
 		}
-#ifdef _OPENMP
 	}
-#endif
 
 	if (result.correspondence_set_.empty()) {
 		result.fitness_ = 0.0;
 		result.inlier_rmse_ = 0.0;
 	} else {
 		size_t corres_number = result.correspondence_set_.size();
-		result.fitness_ = (double)corres_number / (double)source.points_.size();
+		result.fitness_ = (double)corres_number / (double)source_points.cols();
 		result.inlier_rmse_ = std::sqrt(error2 / (double)corres_number);
 	}
 	return std::move(result);
 }
 
+/// The source points are transformed on the fly, only for the
+/// correspondences.
 RegistrationResult EvaluateRANSACBasedOnCorrespondence(const PointCloud &source,
 		const PointCloud &target, const CorrespondenceSet &corres,
 		double max_correspondence_distance,
@@ -104,9 +130,11 @@ RegistrationResult EvaluateRANSACBasedOnCorrespondence(const PointCloud &source,
 	double error2 = 0.0;
 	int good = 0;
 	double max_dis2 = max_correspondence_distance * max_correspondence_distance;
+	const Eigen::Matrix3d rotation = transformation.block<3, 3>(0, 0);
+	const Eigen::Vector3d translation = transformation.block<3, 1>(0, 3);
 	for (const auto &c : corres) {
-		double dis2 =
-				(source.points_[c[0]] - target.points_[c[1]]).squaredNorm();
+		double dis2 = (rotation * source.points_[c[0]] + translation -
+				target.points_[c[1]]).squaredNorm();
 		if (dis2 < max_dis2) {
 			good++;
 			error2 += dis2;
@@ -122,42 +150,24 @@ RegistrationResult EvaluateRANSACBasedOnCorrespondence(const PointCloud &source,
 	return result;
 }
 
-}	// unnamed namespace
-
-RegistrationResult EvaluateRegistration(const PointCloud &source,
-		const PointCloud &target, double max_correspondence_distance,
-		const Eigen::Matrix4d &transformation/* = Eigen::Matrix4d::Identity()*/)
-{
-	KDTreeFlann kdtree;
-	kdtree.SetGeometry(target);
-	PointCloud pcd = source;
-	if (transformation.isIdentity() == false) {
-		pcd.Transform(transformation);
-	}
-	return GetRegistrationResultAndCorrespondences(pcd, target,
-			kdtree, max_correspondence_distance, transformation);
-}
-
-RegistrationResult RegistrationICP(const PointCloud &source,
-		const PointCloud &target, double max_correspondence_distance,
-		const Eigen::Matrix4d &init/* = Eigen::Matrix4d::Identity()*/,
-		const TransformationEstimation &estimation
-		/* = TransformationEstimationPointToPoint(false)*/,
-		const ICPConvergenceCriteria &criteria/* = ICPConvergenceCriteria()*/)
+template<typename SearchIndex>
+RegistrationResult RegistrationICPWithIndex(const PointCloud &source,
+		const PointCloud &target, const SearchIndex &target_index,
+		double max_correspondence_distance, const Eigen::Matrix4d &init,
+		const TransformationEstimation &estimation,
+		const ICPConvergenceCriteria &criteria)
 {
-	if (max_correspondence_distance <= 0.0) {
-		return RegistrationResult(init);
-	}
 	Eigen::Matrix4d transformation = init;
-	KDTreeFlann kdtree;
-	kdtree.SetGeometry(target);
+	// The working copy is made once and transformed in place; estimations
+	// such as the one of colored ICP read more than the points.
 	PointCloud pcd = source;
 	if (init.isIdentity() == false) {
 		pcd.Transform(init);
 	}
+	CorrespondenceSearchBuffer buffer;
 	RegistrationResult result;
-	result = GetRegistrationResultAndCorrespondences(
-			pcd, target, kdtree, max_correspondence_distance, transformation);
+	result = GetRegistrationResultAndCorrespondences(GetPointMatrix(pcd),
+			target_index, max_correspondence_distance, transformation, buffer);
 	for (int i = 0; i < criteria.max_iteration_; i++) {
 		PrintDebug("ICP Iteration #%d: Fitness %.4f, RMSE %.4f\n", i,
 				result.fitness_, result.inlier_rmse_);
@@ -165,9 +175,10 @@ RegistrationResult RegistrationICP(const PointCloud &source,
 				pcd, target, result.correspondence_set_);
 		transformation = update * transformation;
 		pcd.Transform(update);
-		RegistrationResult backup = result;
-		result = GetRegistrationResultAndCorrespondences(pcd,
-				target, kdtree, max_correspondence_distance, transformation);
+		RegistrationResult backup = std::move(result);
+		result = GetRegistrationResultAndCorrespondences(GetPointMatrix(pcd),
+				target_index, max_correspondence_distance, transformation,
+				buffer);
 		if (std::abs(backup.fitness_ - result.fitness_) <
 				criteria.relative_fitness_ && std::abs(backup.inlier_rmse_ -
 				result.inlier_rmse_) < criteria.relative_rmse_) {
@@ -177,6 +188,149 @@ RegistrationResult RegistrationICP(const PointCloud &source,
 	return result;
 }
 
+/// flann distance on the 8-bit codes of quantized features. Leaf visits
+/// compare whole features with SquaredCodeDistance. The float result is
+/// exact for features of up to 258 values.
+struct QuantizedFeatureL2
+{
+	typedef bool is_kdtree_distance;
+	typedef uint8_t ElementType;
+	typedef float ResultType;
+
+	template <typename Iterator1, typename Iterator2>
+	ResultType operator()(Iterator1 a, Iterator2 b, size_t size,
+			ResultType /*worst_dist*/ = -1) const {
+		return Distance(&a[0], &b[0], size);
+	}
+
+	template <typename U, typename V>
+	ResultType accum_dist(const U &a, const V &b, int) const {
+		ResultType diff = (ResultType)a - (ResultType)b;
+		return diff * diff;
+	}
+
+private:
+	static ResultType Distance(const uint8_t *a, const uint8_t *b,
+			size_t size) {
+		return (ResultType)SquaredCodeDistance(a, b, size);
+	}
+
+	// Only instantiated, never called, by the flann index types that keep
+	// cluster centers in floating point.
+	template <typename T, typename U>
+	static ResultType Distance(const T *a, const U *b, size_t size) {
+		ResultType distance2 = 0;
+		for (size_t d = 0; d < size; d++) {
+			ResultType diff = (ResultType)a[d] - (ResultType)b[d];
+			distance2 += diff * diff;
+		}
+		return distance2;
+	}
+};
+
+/// Function to find, for every feature \param query_indices[q] of
+/// \param queries, the nearest feature of \param feature by exact kd-tree
+/// search on the 8-bit codes, so both features should share their
+/// quantization.
+/// \return false if the dimensions differ or a query index is out of range.
+bool SearchNearestQuantizedFeatures(const QuantizedFeature &feature,
+		const QuantizedFeature &queries, const std::vector<int> &query_indices,
+		std::vector<int> &nearest)
+{
+	nearest.assign(query_indices.size(), -1);
+	if (feature.Dimension() != queries.Dimension()) {
+		PrintDebug("[SearchNearestQuantizedFeatures] Dimensions do not match.\n");
+		return false;
+	}
+	for (int index : query_indices) {
+		if (index < 0 || (size_t)index >= queries.Num()) {
+			PrintDebug("[SearchNearestQuantizedFeatures] Query index out of range.\n");
+			return false;
+		}
+	}
+	size_t dimension = feature.Dimension();
+	if (feature.Num() == 0 || query_indices.empty() || dimension == 0) {
+		return true;
+	}
+	// The codes of a feature are contiguous, so they form the row-major
+	// dataset flann expects without a copy.
+	flann::Matrix<uint8_t> dataset((uint8_t *)feature.data_.data(),
+			feature.Num(), dimension);
+	flann::Index<QuantizedFeatureL2> index(dataset,
+			flann::KDTreeSingleIndexParams(15));
+	index.buildIndex();
+	std::vector<uint8_t> query_codes(query_indices.size() * dimension);
+	for (size_t q = 0; q < query_indices.size(); q++) {
+		memcpy(query_codes.data() + q * dimension,
+				queries.data_.data() + (size_t)query_indices[q] * dimension,
+				dimension);
+	}
+	std::vector<float> distance2(query_indices.size());
+	const int chunk_size = 1024;
+	int num_chunks = ((int)query_indices.size() + chunk_size - 1) /
+			chunk_size;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int c = 0; c < num_chunks; c++) {
+		size_t begin = (size_t)c * chunk_size;
+		size_t rows = std::min((size_t)chunk_size,
+				query_indices.size() - begin);
+		flann::Matrix<uint8_t> query_flann(query_codes.data() +
+				begin * dimension, rows, dimension);
+		flann::Matrix<int> indices_flann(nearest.data() + begin, rows, 1);
+		flann::Matrix<float> dists_flann(distance2.data() + begin, rows, 1);
+		index.knnSearch(query_flann, indices_flann, dists_flann, 1,
+				flann::SearchParams(-1, 0.0));
+	}
+	return true;
+}
+
+}	// unnamed namespace
+
+RegistrationResult EvaluateRegistration(const PointCloud &source,
+		const PointCloud &target, double max_correspondence_distance,
+		const Eigen::Matrix4d &transformation/* = Eigen::Matrix4d::Identity()*/,
+		CorrespondenceSearchMethod search_method
+		/* = CORRESPONDENCE_SEARCH_KDTREE*/)
+{
+	CorrespondenceSearchBuffer buffer;
+	Eigen::Map<const Eigen::Matrix3Xd> points = transformation.isIdentity() ?
+			GetPointMatrix(source) : TransformPoints(source, transformation,
+			buffer);
+	if (search_method == CORRESPONDENCE_SEARCH_VOXELHASH &&
+			max_correspondence_distance > 0.0) {
+		VoxelHashIndex index(target, max_correspondence_distance);
+		return GetRegistrationResultAndCorrespondences(points, index,
+				max_correspondence_distance, transformation, buffer);
+	}
+	auto kdtree = GetKDTreeFlannFromCache(target);
+	return GetRegistrationResultAndCorrespondences(points, *kdtree,
+			max_correspondence_distance, transformation, buffer);
+}
+
+RegistrationResult RegistrationICP(const PointCloud &source,
+		const PointCloud &target, double max_correspondence_distance,
+		const Eigen::Matrix4d &init/* = Eigen::Matrix4d::Identity()*/,
+		const TransformationEstimation &estimation
+		/* = TransformationEstimationPointToPoint(false)*/,
+		const ICPConvergenceCriteria &criteria/* = ICPConvergenceCriteria()*/,
+		CorrespondenceSearchMethod search_method
+		/* = CORRESPONDENCE_SEARCH_KDTREE*/)
+{
+	if (max_correspondence_distance <= 0.0) {
+		return RegistrationResult(init);
+	}
+	if (search_method == CORRESPONDENCE_SEARCH_VOXELHASH) {
+		VoxelHashIndex index(target, max_correspondence_distance);
+		return RegistrationICPWithIndex(source, target, index,
+				max_correspondence_distance, init, estimation, criteria);
+	}
+	auto kdtree = GetKDTreeFlannFromCache(target);
+	return RegistrationICPWithIndex(source, target, *kdtree,
+			max_correspondence_distance, init, estimation, criteria);
+}
+
 RegistrationResult RegistrationRANSACBasedOnCorrespondence(
 		const PointCloud &source, const PointCloud &target,
 		const CorrespondenceSet &corres, double max_correspondence_distance,
@@ -200,9 +354,7 @@ RegistrationResult RegistrationRANSACBasedOnCorrespondence(
 		}
 		transformation = estimation.ComputeTransformation(source,
 				target, ransac_corres);
-		PointCloud pcd = source;
-		pcd.Transform(transformation);
-		auto this_result = EvaluateRANSACBasedOnCorrespondence(pcd, target,
+		auto this_result = EvaluateRANSACBasedOnCorrespondence(source, target,
 				corres, max_correspondence_distance, transformation);
 		if (this_result.fitness_ > result.fitness_ ||
 				(this_result.fitness_ == result.fitness_ &&
@@ -224,7 +376,9 @@ RegistrationResult RegistrationRANSACBasedOnFeatureMatching(
 		int ransac_n/* = 4*/, const std::vector<std::reference_wrapper<const
 		CorrespondenceChecker>> &checkers/* = {}*/,
 		const RANSACConvergenceCriteria &criteria
-		/* = RANSACConvergenceCriteria()*/)
+		/* = RANSACConvergenceCriteria()*/,
+		KDTreeFlann::IndexType index_type/* = INDEX_KDTREE_SINGLE*/,
+		int checks/* = -1*/)
 {
 	if (ransac_n < 3 || max_correspondence_distance <= 0.0) {
 		return RegistrationResult();
@@ -235,15 +389,20 @@ RegistrationResult RegistrationRANSACBasedOnFeatureMatching(
 	bool finished_validation = false;
 	int num_similar_features = 1;
 	std::vector<std::vector<int>> similar_features(source.points_.size());
+	// The trees are shared by all threads since searching is read-only.
+	auto kdtree_ptr = GetKDTreeFlannFromCache(target);
+	const KDTreeFlann &kdtree = *kdtree_ptr;
+	KDTreeFlann kdtree_feature;
+	kdtree_feature.SetIndexType(index_type);
+	kdtree_feature.SetFeature(target_feature);
 
 #ifdef _OPENMP
 #pragma omp parallel
 {
 #endif
 	CorrespondenceSet ransac_corres(ransac_n);
-	KDTreeFlann kdtree(target);
-	KDTreeFlann kdtree_feature(target_feature);
 	RegistrationResult result_private;
+	CorrespondenceSearchBuffer buffer;
 	unsigned int seed_number;
 #ifdef _OPENMP
 		// each thread has different seed_number
@@ -266,9 +425,9 @@ RegistrationResult RegistrationRANSACBasedOnFeatureMatching(
 				int source_sample_id = std::rand() % (int)source.points_.size();
 				if (similar_features[source_sample_id].empty()) {
 					std::vector<int> indices(num_similar_features);
-					kdtree_feature.SearchKNN(Eigen::VectorXd(
+					kdtree_feature.SearchApproximateKNN(Eigen::VectorXd(
 							source_feature.data_.col(source_sample_id)),
-							num_similar_features, indices, dists);
+							num_similar_features, checks, indices, dists);
 #ifdef _OPENMP
 #pragma omp critical
 #endif
@@ -305,15 +464,13 @@ RegistrationResult RegistrationRANSACBasedOnFeatureMatching(
 				}
 			}
 			if (check == false) continue;
-			PointCloud pcd = source;
-			pcd.Transform(transformation);
 			auto this_result = GetRegistrationResultAndCorrespondences(
-					pcd, target, kdtree, max_correspondence_distance,
-					transformation);
+					TransformPoints(source, transformation, buffer), kdtree,
+					max_correspondence_distance, transformation, buffer);
 			if (this_result.fitness_ > result_private.fitness_ ||
 					(this_result.fitness_ == result_private.fitness_ &&
 					this_result.inlier_rmse_ < result_private.inlier_rmse_)) {
-				result_private = this_result;
+				result_private = std::move(this_result);
 			}
 #ifdef _OPENMP
 #pragma omp critical
@@ -344,15 +501,153 @@ RegistrationResult RegistrationRANSACBasedOnFeatureMatching(
 	return result;
 }
 
+CorrespondenceSet ComputeCorrespondencesFromFeatures(
+		const Feature &source_feature, const Feature &target_feature,
+		bool mutual_filter/* = true*/,
+		KDTreeFlann::IndexType index_type/* = INDEX_KDTREE_SINGLE*/,
+		int checks/* = -1*/)
+{
+	CorrespondenceSet corres;
+	if (source_feature.Num() == 0 || target_feature.Num() == 0 ||
+			source_feature.Dimension() != target_feature.Dimension()) {
+		PrintDebug("[ComputeCorrespondencesFromFeatures] Invalid features.\n");
+		return corres;
+	}
+	std::vector<int> indices;
+	std::vector<double> dists;
+	std::vector<size_t> offsets;
+	KDTreeFlann target_kdtree;
+	target_kdtree.SetIndexType(index_type);
+	target_kdtree.SetFeature(target_feature);
+	if (target_kdtree.SearchApproximateKNNBatch(source_feature.data_, 1,
+			checks, indices, dists, offsets) < 0) {
+		return corres;
+	}
+	int source_num = (int)source_feature.Num();
+	std::vector<int> source_to_target(source_num, -1);
+	for (int i = 0; i < source_num; i++) {
+		if (offsets[i + 1] > offsets[i]) {
+			source_to_target[i] = indices[offsets[i]];
+		}
+	}
+	if (mutual_filter == false) {
+		for (int i = 0; i < source_num; i++) {
+			if (source_to_target[i] >= 0) {
+				corres.push_back(Eigen::Vector2i(i, source_to_target[i]));
+			}
+		}
+		return corres;
+	}
+
+	// Only the target features that are matched by some source feature need
+	// to be searched back.
+	std::vector<int> matched_targets;
+	std::vector<bool> is_matched(target_feature.Num(), false);
+	for (int i = 0; i < source_num; i++) {
+		int t = source_to_target[i];
+		if (t >= 0 && !is_matched[t]) {
+			is_matched[t] = true;
+			matched_targets.push_back(t);
+		}
+	}
+	Eigen::MatrixXd target_queries(target_feature.Dimension(),
+			matched_targets.size());
+	for (size_t j = 0; j < matched_targets.size(); j++) {
+		target_queries.col(j) = target_feature.data_.col(matched_targets[j]);
+	}
+	KDTreeFlann source_kdtree;
+	source_kdtree.SetIndexType(index_type);
+	source_kdtree.SetFeature(source_feature);
+	if (source_kdtree.SearchApproximateKNNBatch(target_queries, 1, checks,
+			indices, dists, offsets) < 0) {
+		return corres;
+	}
+	std::vector<int> target_to_source(target_feature.Num(), -1);
+	for (size_t j = 0; j < matched_targets.size(); j++) {
+		if (offsets[j + 1] > offsets[j]) {
+			target_to_source[matched_targets[j]] = indices[offsets[j]];
+		}
+	}
+	for (int i = 0; i < source_num; i++) {
+		int t = source_to_target[i];
+		if (t >= 0 && target_to_source[t] == i) {
+			corres.push_back(Eigen::Vector2i(i, t));
+		}
+	}
+	return corres;
+}
+
+CorrespondenceSet ComputeCorrespondencesFromFeatures(
+		const QuantizedFeature &source_feature,
+		const QuantizedFeature &target_feature, bool mutual_filter/* = true*/)
+{
+	CorrespondenceSet corres;
+	if (source_feature.Num() == 0 || target_feature.Num() == 0 ||
+			source_feature.Dimension() != target_feature.Dimension()) {
+		PrintDebug("[ComputeCorrespondencesFromFeatures] Invalid features.\n");
+		return corres;
+	}
+	if (source_feature.HasSameQuantization(target_feature) == false) {
+		// Integer codes of different scales are not comparable.
+		return ComputeCorrespondencesFromFeatures(
+				*DequantizeFeature(source_feature),
+				*DequantizeFeature(target_feature), mutual_filter);
+	}
+	int source_num = (int)source_feature.Num();
+	std::vector<int> source_indices(source_num);
+	for (int i = 0; i < source_num; i++) {
+		source_indices[i] = i;
+	}
+	std::vector<int> source_to_target;
+	SearchNearestQuantizedFeatures(target_feature, source_feature,
+			source_indices, source_to_target);
+	if (mutual_filter == false) {
+		for (int i = 0; i < source_num; i++) {
+			if (source_to_target[i] >= 0) {
+				corres.push_back(Eigen::Vector2i(i, source_to_target[i]));
+			}
+		}
+		return corres;
+	}
+
+	// Only the target features that are matched by some source feature need
+	// to be searched back.
+	std::vector<int> matched_targets;
+	std::vector<bool> is_matched(target_feature.Num(), false);
+	for (int i = 0; i < source_num; i++) {
+		int t = source_to_target[i];
+		if (t >= 0 && !is_matched[t]) {
+			is_matched[t] = true;
+			matched_targets.push_back(t);
+		}
+	}
+	std::vector<int> nearest_sources;
+	SearchNearestQuantizedFeatures(source_feature, target_feature,
+			matched_targets, nearest_sources);
+	std::vector<int> target_to_source(target_feature.Num(), -1);
+	for (size_t j = 0; j < matched_targets.size(); j++) {
+		target_to_source[matched_targets[j]] = nearest_sources[j];
+	}
+	for (int i = 0; i < source_num; i++) {
+		int t = source_to_target[i];
+		if (t >= 0 && target_to_source[t] == i) {
+			corres.push_back(Eigen::Vector2i(i, t));
+		}
+	}
+	return corres;
+}
+
 Eigen::Matrix6d GetInformationMatrixFromPointClouds(
 		const PointCloud &source, const PointCloud &target,
 		double max_correspondence_distance,
 		const Eigen::Matrix4d &transformation)
 {
 	RegistrationResult result;
-	KDTreeFlann target_kdtree(target);
-	result = GetRegistrationResultAndCorrespondences(source, target,
-			target_kdtree, max_correspondence_distance, transformation);
+	CorrespondenceSearchBuffer buffer;
+	auto target_kdtree = GetKDTreeFlannFromCache(target);
+	result = GetRegistrationResultAndCorrespondences(GetPointMatrix(source),
+			*target_kdtree, max_correspondence_distance, transformation,
+			buffer);
 
 	// write q^*
 	// see http://redwood-data.org/indoor/registration.html
@@ -401,3 +696,7 @@ Eigen::Matrix6d GetInformationMatrixFromPointClouds(
 }
 
 }	// namespace three
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
@@ -30,6 +30,7 @@
 #include <tuple>
 #include <Eigen/Core>
 
+#include <Core/Geometry/KDTreeFlann.h>
 #include <Core/Registration/CorrespondenceChecker.h>
 #include <Core/Registration/TransformationEstimation.h>
 #include <Core/Utility/Eigen.h>
@@ -38,6 +39,16 @@ namespace three {
 
 class PointCloud;
 class Feature;
+class QuantizedFeature;
+
+/// Spatial index used to search the correspondences in ICP and evaluation.
+/// The voxel hash index is built with voxel size max_correspondence_distance
+/// and answers each query by probing the neighboring voxels only; it is faster
+/// than the kd-tree when the correspondence distance is small.
+enum CorrespondenceSearchMethod {
+	CORRESPONDENCE_SEARCH_KDTREE = 0,
+	CORRESPONDENCE_SEARCH_VOXELHASH = 1,
+};
 
 /// Class that defines the convergence criteria of ICP
 /// ICP algorithm stops if the relative change of fitness and rmse hit
@@ -96,7 +107,9 @@ public:
 /// Function for evaluation
 RegistrationResult EvaluateRegistration(const PointCloud &source,
 		const PointCloud &target, double max_correspondence_distance,
-		const Eigen::Matrix4d &transformation = Eigen::Matrix4d::Identity());
+		const Eigen::Matrix4d &transformation = Eigen::Matrix4d::Identity(),
+		CorrespondenceSearchMethod search_method =
+		CORRESPONDENCE_SEARCH_KDTREE);
 
 /// Functions for ICP registration
 RegistrationResult RegistrationICP(const PointCloud &source,
@@ -104,7 +117,9 @@ RegistrationResult RegistrationICP(const PointCloud &source,
 		const Eigen::Matrix4d &init = Eigen::Matrix4d::Identity(),
 		const TransformationEstimation &estimation =
 		TransformationEstimationPointToPoint(false),
-		const ICPConvergenceCriteria &criteria = ICPConvergenceCriteria());
+		const ICPConvergenceCriteria &criteria = ICPConvergenceCriteria(),
+		CorrespondenceSearchMethod search_method =
+		CORRESPONDENCE_SEARCH_KDTREE);
 
 /// Function for global RANSAC registration based on a given set of
 /// correspondences
@@ -117,6 +132,9 @@ RegistrationResult RegistrationRANSACBasedOnCorrespondence(
 		RANSACConvergenceCriteria());
 
 /// Function for global RANSAC registration based on feature matching
+/// The target features are indexed with \param index_type and every feature
+/// query visits at most \param checks leaves (-1 for exact search), see
+/// ComputeCorrespondencesFromFeatures.
 RegistrationResult RegistrationRANSACBasedOnFeatureMatching(
 		const PointCloud &source, const PointCloud &target,
 		const Feature &source_feature, const Feature &target_feature,
@@ -126,7 +144,30 @@ RegistrationResult RegistrationRANSACBasedOnFeatureMatching(
 		int ransac_n = 4,
 		const std::vector<std::reference_wrapper<const CorrespondenceChecker>> &
 		checkers = {}, const RANSACConvergenceCriteria &criteria =
-		RANSACConvergenceCriteria());
+		RANSACConvergenceCriteria(), KDTreeFlann::IndexType index_type =
+		KDTreeFlann::INDEX_KDTREE_SINGLE, int checks = -1);
+
+/// Function to compute correspondences between two point clouds by nearest
+/// neighbor search in feature space: source point i is matched to the target
+/// point with the nearest feature. If \param mutual_filter is true, a pair is
+/// only kept if the source feature is also the nearest of all source features
+/// to the target feature. The features are indexed with \param index_type and
+/// every query visits at most \param checks leaves (-1 for exact search).
+/// The approximate indices are opt-in: on FPFH features of smooth surfaces
+/// the exact single kd-tree measured faster, so it stays the default.
+CorrespondenceSet ComputeCorrespondencesFromFeatures(
+		const Feature &source_feature, const Feature &target_feature,
+		bool mutual_filter = true, KDTreeFlann::IndexType index_type =
+		KDTreeFlann::INDEX_KDTREE_SINGLE, int checks = -1);
+
+/// Function to compute correspondences between two point clouds by exact
+/// nearest neighbor search on quantized features, with the same mutual filter
+/// as above. If both features share their quantization an exact kd-tree
+/// searches the 8-bit codes directly, comparing them with
+/// SquaredCodeDistance; otherwise the dequantized values are matched.
+CorrespondenceSet ComputeCorrespondencesFromFeatures(
+		const QuantizedFeature &source_feature,
+		const QuantizedFeature &target_feature, bool mutual_filter = true);
 
 /// Function for computing information matrix from RegistrationResult
 Eigen::Matrix6d GetInformationMatrixFromPointClouds(
@@ -26,8 +26,22 @@
 
 #include "Helper.h"
 
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace three {
 
+namespace {
+
+const int radix_sort_digit_bits = 11;
+const size_t radix_sort_num_digits = (size_t)1 << radix_sort_digit_bits;
+const size_t radix_sort_parallel_threshold = 65536;
+const size_t compaction_parallel_threshold = 65536;
+
+}	// unnamed namespace
+
 void SplitString(std::vector<std::string> &tokens, const std::string &str,
 		const std::string &delimiters/* = " "*/, bool trim_empty_str/* = true*/)
 {
@@ -42,4 +56,112 @@ void SplitString(std::vector<std::string> &tokens, const std::string &str,
 	}
 }
 
+void RadixSortKeys(std::vector<uint64_t> &keys, std::vector<uint32_t> &order,
+		int num_key_bits/* = 64*/)
+{
+	size_t num_keys = keys.size();
+	order.resize(num_keys);
+	for (size_t i = 0; i < num_keys; i++) {
+		order[i] = (uint32_t)i;
+	}
+	int num_passes = (std::min(std::max(num_key_bits, 0), 64) +
+			radix_sort_digit_bits - 1) / radix_sort_digit_bits;
+	if (num_keys <= 1 || num_passes == 0) {
+		return;
+	}
+
+	// Each pass counts the digits of contiguous blocks of keys, so that the
+	// blocks can be scattered in parallel while keeping the sort stable.
+	int num_blocks = 1;
+#ifdef _OPENMP
+	if (num_keys >= radix_sort_parallel_threshold) {
+		num_blocks = omp_get_max_threads();
+	}
+#endif
+	std::vector<size_t> block_begin(num_blocks + 1);
+	for (int b = 0; b <= num_blocks; b++) {
+		block_begin[b] = num_keys * b / num_blocks;
+	}
+	std::vector<size_t> histograms(num_blocks * radix_sort_num_digits);
+	std::vector<uint64_t> keys_buffer(num_keys);
+	std::vector<uint32_t> order_buffer(num_keys);
+	for (int pass = 0; pass < num_passes; pass++) {
+		int shift = pass * radix_sort_digit_bits;
+		std::fill(histograms.begin(), histograms.end(), 0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) num_threads(num_blocks)
+#endif
+		for (int b = 0; b < num_blocks; b++) {
+			size_t *histogram = histograms.data() + b * radix_sort_num_digits;
+			for (size_t i = block_begin[b]; i < block_begin[b + 1]; i++) {
+				histogram[(keys[i] >> shift) & (radix_sort_num_digits - 1)]++;
+			}
+		}
+		size_t offset = 0;
+		for (size_t d = 0; d < radix_sort_num_digits; d++) {
+			for (int b = 0; b < num_blocks; b++) {
+				size_t count = histograms[b * radix_sort_num_digits + d];
+				histograms[b * radix_sort_num_digits + d] = offset;
+				offset += count;
+			}
+		}
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) num_threads(num_blocks)
+#endif
+		for (int b = 0; b < num_blocks; b++) {
+			size_t *histogram = histograms.data() + b * radix_sort_num_digits;
+			for (size_t i = block_begin[b]; i < block_begin[b + 1]; i++) {
+				size_t position = histogram[(keys[i] >> shift) &
+						(radix_sort_num_digits - 1)]++;
+				keys_buffer[position] = keys[i];
+				order_buffer[position] = order[i];
+			}
+		}
+		keys.swap(keys_buffer);
+		order.swap(order_buffer);
+	}
+}
+
+std::vector<size_t> GetNonZeroIndices(const std::vector<uint8_t> &mask)
+{
+	size_t num_entries = mask.size();
+	int num_blocks = 1;
+#ifdef _OPENMP
+	if (num_entries >= compaction_parallel_threshold) {
+		num_blocks = omp_get_max_threads();
+	}
+#endif
+	std::vector<size_t> block_begin(num_blocks + 1);
+	for (int b = 0; b <= num_blocks; b++) {
+		block_begin[b] = num_entries * b / num_blocks;
+	}
+	std::vector<size_t> block_offsets(num_blocks + 1, 0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) num_threads(num_blocks)
+#endif
+	for (int b = 0; b < num_blocks; b++) {
+		size_t count = 0;
+		for (size_t i = block_begin[b]; i < block_begin[b + 1]; i++) {
+			count += (mask[i] != 0);
+		}
+		block_offsets[b + 1] = count;
+	}
+	for (int b = 0; b < num_blocks; b++) {
+		block_offsets[b + 1] += block_offsets[b];
+	}
+	std::vector<size_t> indices(block_offsets[num_blocks]);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) num_threads(num_blocks)
+#endif
+	for (int b = 0; b < num_blocks; b++) {
+		size_t offset = block_offsets[b];
+		for (size_t i = block_begin[b]; i < block_begin[b + 1]; i++) {
+			if (mask[i] != 0) {
+				indices[offset++] = i;
+			}
+		}
+	}
+	return indices;
+}
+
 }	// namespace three
@@ -26,6 +26,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <tuple>
 #include <functional>
 #include <vector>
@@ -116,4 +117,17 @@ struct hash : std::unary_function<T, size_t> {
 void SplitString(std::vector<std::string> &tokens, const std::string &str,
 		const std::string &delimiters = " ", bool trim_empty_str = true);
 
+/// Function to sort 64-bit keys with a parallel, stable LSD radix sort.
+/// Only the lowest \param num_key_bits bits of the keys are compared; the
+/// higher bits must be zero. On return \param keys is sorted and
+/// \param order holds the original position of each sorted key, so equal
+/// keys keep their original order.
+void RadixSortKeys(std::vector<uint64_t> &keys, std::vector<uint32_t> &order,
+		int num_key_bits = 64);
+
+/// Function to return the positions of the non-zero entries of \param mask in
+/// increasing order. The output is counted with a parallel prefix sum and
+/// written in parallel without reallocation.
+std::vector<size_t> GetNonZeroIndices(const std::vector<uint8_t> &mask);
+
 }	// namespace three
@@ -0,0 +1,162 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+
+#include "MappedFile.h"
+
+#ifdef WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <Core/Utility/Console.h>
+
+namespace three{
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string &filename)
+{
+	Close();
+#ifdef WINDOWS
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ,
+			FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		PrintDebug("[MappedFile] Unable to open file %s.\n",
+				filename.c_str());
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(file, &size) == 0 || size.QuadPart == 0) {
+		CloseHandle(file);
+		PrintDebug("[MappedFile] Empty file %s.\n", filename.c_str());
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0,
+			NULL);
+	void *data = mapping == NULL ? NULL :
+			MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == NULL) {
+		if (mapping != NULL) {
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		PrintDebug("[MappedFile] Unable to map file %s.\n", filename.c_str());
+		return false;
+	}
+	file_handle_ = file;
+	mapping_handle_ = mapping;
+	size_ = (size_t)size.QuadPart;
+	data_ = (const char *)data;
+#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		PrintDebug("[MappedFile] Unable to open file %s.\n",
+				filename.c_str());
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) == -1 || info.st_size == 0) {
+		close(fd);
+		PrintDebug("[MappedFile] Empty file %s.\n", filename.c_str());
+		return false;
+	}
+	void *data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd,
+			0);
+	// The mapping stays valid after the descriptor is closed.
+	close(fd);
+	if (data == MAP_FAILED) {
+		PrintDebug("[MappedFile] Unable to map file %s.\n", filename.c_str());
+		return false;
+	}
+	size_ = (size_t)info.st_size;
+	data_ = (const char *)data;
+#endif
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data_ == nullptr) {
+		return;
+	}
+#ifdef WINDOWS
+	UnmapViewOfFile(data_);
+	CloseHandle((HANDLE)mapping_handle_);
+	CloseHandle((HANDLE)file_handle_);
+	file_handle_ = nullptr;
+	mapping_handle_ = nullptr;
+#else
+	munmap((void *)data_, size_);
+#endif
+	data_ = nullptr;
+	size_ = 0;
+}
+
+bool WriteMappedFileBlock(FILE *file, size_t &offset, const void *data,
+		size_t size)
+{
+	const char padding[MAPPED_FILE_ALIGNMENT] = {0};
+	size_t padding_size = (MAPPED_FILE_ALIGNMENT - offset %
+			MAPPED_FILE_ALIGNMENT) % MAPPED_FILE_ALIGNMENT;
+	if (fwrite(padding, 1, padding_size, file) < padding_size ||
+			(size > 0 && fwrite(data, 1, size, file) < size)) {
+		return false;
+	}
+	offset += padding_size + size;
+	return true;
+}
+
+const char *ReadMappedFileBlock(const char *file_data, size_t file_size,
+		size_t &offset, size_t size)
+{
+	size_t begin = (offset + MAPPED_FILE_ALIGNMENT - 1) /
+			MAPPED_FILE_ALIGNMENT * MAPPED_FILE_ALIGNMENT;
+	if (begin > file_size || size > file_size - begin) {
+		return nullptr;
+	}
+	offset = begin + size;
+	return file_data + begin;
+}
+
+const char *ReadMappedFileArray(const char *file_data, size_t file_size,
+		size_t &offset, uint64_t count, size_t element_size)
+{
+	if (element_size != 0 && count > file_size / element_size) {
+		return nullptr;
+	}
+	return ReadMappedFileBlock(file_data, file_size, offset,
+			(size_t)count * element_size);
+}
+
+}	// namespace three
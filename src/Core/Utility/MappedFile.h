@@ -0,0 +1,85 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace three {
+
+/// Class of a read-only memory mapping of a whole file. The pages are loaded
+/// on demand and are shared by all processes mapping the same file.
+class MappedFile
+{
+public:
+	MappedFile() {}
+	~MappedFile();
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+public:
+	bool Open(const std::string &filename);
+	void Close();
+	bool IsOpen() const { return data_ != nullptr; }
+	const char *GetData() const { return data_; }
+	size_t GetSize() const { return size_; }
+
+private:
+	const char *data_ = nullptr;
+	size_t size_ = 0;
+#ifdef WINDOWS
+	void *file_handle_ = nullptr;
+	void *mapping_handle_ = nullptr;
+#endif
+};
+
+/// Blocks of a file meant to be mapped are aligned to this many bytes from
+/// the beginning of the file, so that they can be used in place.
+const size_t MAPPED_FILE_ALIGNMENT = 64;
+
+/// Function to write \param size bytes at \param data to \param file as an
+/// aligned block. \param offset is the current size of the file; it is
+/// advanced past the block.
+bool WriteMappedFileBlock(FILE *file, size_t &offset, const void *data,
+		size_t size);
+
+/// Function to return the block of \param size bytes written at
+/// \param offset by WriteMappedFileBlock() in the mapped file, or nullptr if
+/// the file is too short. \param offset is advanced past the block.
+const char *ReadMappedFileBlock(const char *file_data, size_t file_size,
+		size_t &offset, size_t size);
+
+/// Function to return the block of \param count elements of
+/// \param element_size bytes, like ReadMappedFileBlock(). Counts read from a
+/// corrupt file that would overflow the size return nullptr.
+const char *ReadMappedFileArray(const char *file_data, size_t file_size,
+		size_t &offset, uint64_t count, size_t element_size);
+
+}	// namespace three
@@ -1327,7 +1327,7 @@ static int oascii_int32(p_ply ply, double value) {
 
 static int oascii_uint32(p_ply ply, double value) {
     if (value > PLY_UINT32_MAX || value < 0) return 0;
-    return fprintf(ply->fp, "%d", (t_ply_uint32) value) > 0;
+    return fprintf(ply->fp, "%u", (t_ply_uint32) value) > 0;
 }
 
 static int oascii_float32(p_ply ply, double value) {
@@ -41,4 +41,15 @@ bool WriteFeature(const std::string &filename, const Feature &feature)
 	return WriteFeatureToBIN(filename, feature);
 }
 
+bool ReadFeature(const std::string &filename, QuantizedFeature &feature)
+{
+	return ReadFeatureFromBIN(filename, feature);
+}
+
+bool WriteFeature(const std::string &filename,
+		const QuantizedFeature &feature)
+{
+	return WriteFeatureToBIN(filename, feature);
+}
+
 }	// namespace three
@@ -39,8 +39,25 @@ bool ReadFeature(const std::string &filename, Feature &feature);
 /// \return If the write function is successful.
 bool WriteFeature(const std::string &filename, const Feature &feature);
 
+/// The general entrance for reading a QuantizedFeature from a file
+/// \return If the read function is successful.
+bool ReadFeature(const std::string &filename, QuantizedFeature &feature);
+
+/// The general entrance for writing a QuantizedFeature to a file
+/// \return If the write function is successful.
+bool WriteFeature(const std::string &filename,
+		const QuantizedFeature &feature);
+
+/// A BIN file holds either double values or 8-bit quantized values; reading
+/// it into the other kind of feature converts the values.
 bool ReadFeatureFromBIN(const std::string &filename, Feature &feature);
 
 bool WriteFeatureToBIN(const std::string &filename, const Feature &feature);
 
+bool ReadFeatureFromBIN(const std::string &filename,
+		QuantizedFeature &feature);
+
+bool WriteFeatureToBIN(const std::string &filename,
+		const QuantizedFeature &feature);
+
 }	// namespace three
@@ -100,4 +100,39 @@ bool WritePointCloud(const std::string &filename, const PointCloud &pointcloud,
 	return success;
 }
 
+bool ReadPointCloud(const std::string &filename, PointCloudf &pointcloud)
+{
+	std::string filename_ext =
+			filesystem::GetFileExtensionInLowerCase(filename);
+	if (filename_ext == "ply") {
+		bool success = ReadPointCloudfFromPLY(filename, pointcloud);
+		PrintDebug("Read PointCloud: %d vertices.\n",
+				(int)pointcloud.points_.size());
+		return success;
+	}
+	PointCloud converted;
+	if (ReadPointCloud(filename, converted) == false) {
+		return false;
+	}
+	pointcloud = *CreatePointCloudTFromPointCloud<float>(converted);
+	return true;
+}
+
+bool WritePointCloud(const std::string &filename,
+		const PointCloudf &pointcloud, bool write_ascii/* = false*/,
+		bool compressed/* = false*/)
+{
+	std::string filename_ext =
+			filesystem::GetFileExtensionInLowerCase(filename);
+	if (filename_ext == "ply") {
+		bool success = WritePointCloudfToPLY(filename, pointcloud,
+				write_ascii, compressed);
+		PrintDebug("Write PointCloud: %d vertices.\n",
+				(int)pointcloud.points_.size());
+		return success;
+	}
+	return WritePointCloud(filename, *CreatePointCloudFromPointCloudT(
+			pointcloud), write_ascii, compressed);
+}
+
 }	// namespace three
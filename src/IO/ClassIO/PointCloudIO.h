@@ -28,6 +28,7 @@
 
 #include <string>
 #include <Core/Geometry/PointCloud.h>
+#include <Core/Geometry/PointCloudT.h>
 
 namespace three {
 
@@ -44,6 +45,18 @@ bool ReadPointCloud(const std::string &filename, PointCloud &pointcloud);
 bool WritePointCloud(const std::string &filename, const PointCloud &pointcloud,
 		bool write_ascii = false, bool compressed = false);
 
+/// The general entrance for reading a PointCloudf from a file
+/// PLY files are read directly in single precision; other formats are read
+/// into a PointCloud and converted.
+bool ReadPointCloud(const std::string &filename, PointCloudf &pointcloud);
+
+/// The general entrance for writing a PointCloudf to a file
+/// PLY files are written directly in single precision; other formats are
+/// written from a converted PointCloud.
+bool WritePointCloud(const std::string &filename,
+		const PointCloudf &pointcloud, bool write_ascii = false,
+		bool compressed = false);
+
 bool ReadPointCloudFromXYZ(const std::string &filename, PointCloud &pointcloud);
 
 bool WritePointCloudToXYZ(const std::string &filename,
@@ -72,6 +85,13 @@ bool WritePointCloudToPLY(const std::string &filename,
 		const PointCloud &pointcloud, bool write_ascii = false,
 		bool compressed = false);
 
+bool ReadPointCloudfFromPLY(const std::string &filename,
+		PointCloudf &pointcloud);
+
+bool WritePointCloudfToPLY(const std::string &filename,
+		const PointCloudf &pointcloud, bool write_ascii = false,
+		bool compressed = false);
+
 bool ReadPointCloudFromPCD(const std::string &filename, PointCloud &pointcloud);
 
 bool WritePointCloudToPCD(const std::string &filename,
@@ -34,6 +34,20 @@ namespace three{
 
 namespace {
 
+/// Quantized features are stored after this tag ("QFT8" in the file), which
+/// no row count of a double feature file reaches: the tag, rows and cols as
+/// uint32, scale and offset as double, then the codes column by column.
+const uint32_t quantized_feature_bin_tag = 0x38544651;
+
+bool IsQuantizedFeatureBINFile(FILE *file)
+{
+	uint32_t tag;
+	bool is_quantized = fread(&tag, sizeof(uint32_t), 1, file) == 1 &&
+			tag == quantized_feature_bin_tag;
+	fseek(file, 0, SEEK_SET);
+	return is_quantized;
+}
+
 bool ReadMatrixXdFromBINFile(FILE *file, Eigen::MatrixXd &mat)
 {
 	uint32_t rows, cols;
@@ -72,6 +86,44 @@ bool WriteMatrixXdToBINFile(FILE *file, const Eigen::MatrixXd &mat)
 	return true;
 }
 
+bool ReadQuantizedFeatureFromBINFile(FILE *file, QuantizedFeature &feature)
+{
+	uint32_t header[3];
+	if (fread(header, sizeof(uint32_t), 3, file) < 3 ||
+			fread(&feature.scale_, sizeof(double), 1, file) < 1 ||
+			fread(&feature.offset_, sizeof(double), 1, file) < 1) {
+		PrintWarning("Read BIN failed: unexpected EOF.\n");
+		return false;
+	}
+	uint32_t rows = header[1], cols = header[2];
+	feature.data_.resize(rows, cols);
+	if (fread(feature.data_.data(), sizeof(uint8_t), (size_t)rows * cols,
+			file) < (size_t)rows * cols) {
+		PrintWarning("Read BIN failed: unexpected EOF.\n");
+		return false;
+	}
+	return true;
+}
+
+bool WriteQuantizedFeatureToBINFile(FILE *file,
+		const QuantizedFeature &feature)
+{
+	uint32_t header[3] = {quantized_feature_bin_tag,
+			(uint32_t)feature.data_.rows(), (uint32_t)feature.data_.cols()};
+	if (fwrite(header, sizeof(uint32_t), 3, file) < 3 ||
+			fwrite(&feature.scale_, sizeof(double), 1, file) < 1 ||
+			fwrite(&feature.offset_, sizeof(double), 1, file) < 1) {
+		PrintWarning("Write BIN failed: unexpected error.\n");
+		return false;
+	}
+	size_t size = (size_t)header[1] * header[2];
+	if (fwrite(feature.data_.data(), sizeof(uint8_t), size, file) < size) {
+		PrintWarning("Write BIN failed: unexpected error.\n");
+		return false;
+	}
+	return true;
+}
+
 }	// unnamed namespace
 
 bool ReadFeatureFromBIN(const std::string &filename, Feature &feature)
@@ -81,7 +133,16 @@ bool ReadFeatureFromBIN(const std::string &filename, Feature &feature)
 		PrintWarning("Read BIN failed: unable to open file.\n");
 		return false;
 	}
-	bool success = ReadMatrixXdFromBINFile(fid, feature.data_);
+	bool success;
+	if (IsQuantizedFeatureBINFile(fid)) {
+		QuantizedFeature quantized;
+		success = ReadQuantizedFeatureFromBINFile(fid, quantized);
+		if (success) {
+			feature.data_ = DequantizeFeature(quantized)->data_;
+		}
+	} else {
+		success = ReadMatrixXdFromBINFile(fid, feature.data_);
+	}
 	fclose(fid);
 	return success;
 }
@@ -98,4 +159,39 @@ bool WriteFeatureToBIN(const std::string &filename, const Feature &feature)
 	return success;
 }
 
+bool ReadFeatureFromBIN(const std::string &filename,
+		QuantizedFeature &feature)
+{
+	FILE *fid = fopen(filename.c_str(), "rb");
+	if (fid == NULL) {
+		PrintWarning("Read BIN failed: unable to open file.\n");
+		return false;
+	}
+	bool success;
+	if (IsQuantizedFeatureBINFile(fid)) {
+		success = ReadQuantizedFeatureFromBINFile(fid, feature);
+	} else {
+		Feature values;
+		success = ReadMatrixXdFromBINFile(fid, values.data_);
+		if (success) {
+			feature = *QuantizeFeature(values);
+		}
+	}
+	fclose(fid);
+	return success;
+}
+
+bool WriteFeatureToBIN(const std::string &filename,
+		const QuantizedFeature &feature)
+{
+	FILE *fid = fopen(filename.c_str(), "wb");
+	if (fid == NULL) {
+		PrintWarning("Write BIN failed: unable to open file.\n");
+		return false;
+	}
+	bool success = WriteQuantizedFeatureToBINFile(fid, feature);
+	fclose(fid);
+	return success;
+}
+
 }	// namespace three
@@ -273,6 +273,10 @@ double UnpackBinaryPCDElement(const char *data_ptr, const char type,
 			std::float_t data;
 			memcpy(&data, data_ptr, sizeof(data));
 			return (double)data;
+		} else if (size == 8) {
+			double data;
+			memcpy(&data, data_ptr, sizeof(data));
+			return data;
 		} else {
 			return 0.0;
 		}
@@ -324,13 +328,98 @@ Eigen::Vector3d UnpackASCIIPCDColor(const char *data_ptr, const char type,
 			std::float_t value = std::strtof(data_ptr, &end);
 			memcpy(data, &value, 4);
 		}
-		return Eigen::Vector3d((double)data[0] / 255.0, (double)data[1] / 255.0,
-				(double)data[2] / 255.0);
+		// color data is packed in BGR order.
+		return Eigen::Vector3d((double)data[2] / 255.0, (double)data[1] / 255.0,
+				(double)data[0] / 255.0);
 	} else {
 		return Eigen::Vector3d::Zero();
 	}
 }
 
+bool IsPointCloudField(const PCLPointField &field)
+{
+	return field.name == "x" || field.name == "y" || field.name == "z" ||
+			field.name == "normal_x" || field.name == "normal_y" ||
+			field.name == "normal_z" || field.name == "rgb" ||
+			field.name == "rgba";
+}
+
+bool GetAttributeValueType(const PCLPointField &field,
+		PointAttribute::ValueType &value_type)
+{
+	if (field.type == 'I' && field.size == 1) {
+		value_type = PointAttribute::VALUE_INT8;
+	} else if (field.type == 'U' && field.size == 1) {
+		value_type = PointAttribute::VALUE_UINT8;
+	} else if (field.type == 'I' && field.size == 2) {
+		value_type = PointAttribute::VALUE_INT16;
+	} else if (field.type == 'U' && field.size == 2) {
+		value_type = PointAttribute::VALUE_UINT16;
+	} else if (field.type == 'I' && field.size == 4) {
+		value_type = PointAttribute::VALUE_INT32;
+	} else if (field.type == 'U' && field.size == 4) {
+		value_type = PointAttribute::VALUE_UINT32;
+	} else if (field.type == 'F' && field.size == 4) {
+		value_type = PointAttribute::VALUE_FLOAT;
+	} else if (field.type == 'F' && field.size == 8) {
+		value_type = PointAttribute::VALUE_DOUBLE;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+char GetAttributeFieldType(PointAttribute::ValueType value_type)
+{
+	switch (value_type) {
+	case PointAttribute::VALUE_INT8:
+	case PointAttribute::VALUE_INT16:
+	case PointAttribute::VALUE_INT32:
+		return 'I';
+	case PointAttribute::VALUE_UINT8:
+	case PointAttribute::VALUE_UINT16:
+	case PointAttribute::VALUE_UINT32:
+		return 'U';
+	case PointAttribute::VALUE_FLOAT:
+	case PointAttribute::VALUE_DOUBLE:
+	default:
+		return 'F';
+	}
+}
+
+/// Scalar fields other than points, normals and colors are read as attributes
+/// of the point cloud. Returns the attribute index of each field, or -1.
+std::vector<int> AddAttributeFields(const PCDHeader &header,
+		PointCloud &pointcloud)
+{
+	std::vector<int> attribute_indices(header.fields.size(), -1);
+	for (size_t i = 0; i < header.fields.size(); i++) {
+		const auto &field = header.fields[i];
+		PointAttribute::ValueType value_type;
+		if (IsPointCloudField(field) || field.count != 1 ||
+				field.name == "_" ||
+				!GetAttributeValueType(field, value_type)) {
+			continue;
+		}
+		attribute_indices[i] = (int)pointcloud.attributes_.size();
+		pointcloud.attributes_.push_back(PointAttribute(field.name,
+				value_type, header.points));
+	}
+	return attribute_indices;
+}
+
+std::vector<const PointAttribute *> GetAttributesToWrite(
+		const PointCloud &pointcloud)
+{
+	std::vector<const PointAttribute *> attributes;
+	for (const auto &attribute : pointcloud.attributes_) {
+		if (pointcloud.HasAttribute(attribute.GetName())) {
+			attributes.push_back(&attribute);
+		}
+	}
+	return attributes;
+}
+
 bool ReadPCDData(FILE *file, const PCDHeader &header, PointCloud &pointcloud)
 {
 	// The header should have been checked
@@ -346,6 +435,8 @@ bool ReadPCDData(FILE *file, const PCDHeader &header, PointCloud &pointcloud)
 	if (header.has_colors) {
 		pointcloud.colors_.resize(header.points);
 	}
+	std::vector<int> attribute_indices = AddAttributeFields(header,
+			pointcloud);
 	if (header.datatype == PCD_DATA_ASCII) {
 		char line_buffer[DEFAULT_IO_BUFFER_SIZE];
 		int idx = 0;
@@ -387,6 +478,11 @@ bool ReadPCDData(FILE *file, const PCDHeader &header, PointCloud &pointcloud)
 					pointcloud.colors_[idx] = UnpackASCIIPCDColor(
 							strs[field.count_offset].c_str(), field.type,
 							field.size);
+				} else if (attribute_indices[i] >= 0) {
+					pointcloud.attributes_[attribute_indices[i]].SetValue(idx,
+							UnpackASCIIPCDElement(
+							strs[field.count_offset].c_str(), field.type,
+							field.size));
 				}
 			}
 			idx++;
@@ -399,7 +495,8 @@ bool ReadPCDData(FILE *file, const PCDHeader &header, PointCloud &pointcloud)
 				pointcloud.Clear();
 				return false;
 			}
-			for (const auto &field : header.fields) {
+			for (size_t j = 0; j < header.fields.size(); j++) {
+				const auto &field = header.fields[j];
 				if (field.name == "x") {
 					pointcloud.points_[i](0) = UnpackBinaryPCDElement(
 							buffer.get() + field.offset, field.type,
@@ -428,6 +525,10 @@ bool ReadPCDData(FILE *file, const PCDHeader &header, PointCloud &pointcloud)
 					pointcloud.colors_[i] = UnpackBinaryPCDColor(
 							buffer.get() + field.offset, field.type,
 							field.size);
+				} else if (attribute_indices[j] >= 0) {
+					pointcloud.attributes_[attribute_indices[j]].SetValue(i,
+							UnpackBinaryPCDElement(buffer.get() +
+							field.offset, field.type, field.size));
 				}
 			}
 		}
@@ -461,7 +562,8 @@ bool ReadPCDData(FILE *file, const PCDHeader &header, PointCloud &pointcloud)
 			pointcloud.Clear();
 			return false;
 		}
-		for (const auto &field : header.fields) {
+		for (size_t j = 0; j < header.fields.size(); j++) {
+			const auto &field = header.fields[j];
 			const char *base_ptr = buffer.get() + field.offset * header.points;
 			if (field.name == "x") {
 				for (int i = 0; i < header.points; i++) {
@@ -505,6 +607,13 @@ bool ReadPCDData(FILE *file, const PCDHeader &header, PointCloud &pointcloud)
 							base_ptr + i * field.size * field.count, field.type,
 							field.size);
 				}
+			} else if (attribute_indices[j] >= 0) {
+				auto &attribute = pointcloud.attributes_[attribute_indices[j]];
+				for (int i = 0; i < header.points; i++) {
+					attribute.SetValue(i, UnpackBinaryPCDElement(
+							base_ptr + i * field.size, field.type,
+							field.size));
+				}
 			}
 		}
 	}
@@ -516,6 +625,7 @@ void RemoveNanData(PointCloud &pointcloud)
 	bool has_normal = pointcloud.HasNormals();
 	bool has_color = pointcloud.HasColors();
 	size_t old_point_num = pointcloud.points_.size();
+	std::vector<size_t> valid_indices;
 	size_t k = 0;											// new index
 	for (size_t i = 0; i < old_point_num; i++) {			// old index
 		if (std::isnan(pointcloud.points_[i](0)) == false &&
@@ -524,9 +634,15 @@ void RemoveNanData(PointCloud &pointcloud)
 			pointcloud.points_[k] = pointcloud.points_[i];
 			if (has_normal) pointcloud.normals_[k] = pointcloud.normals_[i];
 			if (has_color) pointcloud.colors_[k] = pointcloud.colors_[i];
+			valid_indices.push_back(i);
 			k++;
 		}
 	}
+	if (k < old_point_num) {
+		for (auto &attribute : pointcloud.attributes_) {
+			attribute = attribute.Select(valid_indices);
+		}
+	}
 	pointcloud.points_.resize(k);
 	if (has_normal) pointcloud.normals_.resize(k);
 	if (has_color) pointcloud.colors_.resize(k);
@@ -572,6 +688,14 @@ bool GenerateHeader(const PointCloud &pointcloud, const bool write_ascii,
 		header.elementnum ++;
 		header.pointsize += 4;
 	}
+	for (const auto attribute : GetAttributesToWrite(pointcloud)) {
+		field.name = attribute->GetName();
+		field.type = GetAttributeFieldType(attribute->GetValueType());
+		field.size = (int)attribute->GetValueSize();
+		header.fields.push_back(field);
+		header.elementnum ++;
+		header.pointsize += field.size;
+	}
 	if (write_ascii) {
 		header.datatype = PCD_DATA_ASCII;
 	} else {
@@ -631,10 +755,11 @@ bool WritePCDHeader(FILE *file, const PCDHeader &header)
 
 float ConvertRGBToFloat(const Eigen::Vector3d &color)
 {
+	// color data is packed in BGR order, as the readers expect.
 	std::uint8_t rgba[4] = {0, 0, 0, 0};
-	rgba[0] = (std::uint8_t)std::max(std::min((int)(color(0) * 255.0), 255), 0);
+	rgba[2] = (std::uint8_t)std::max(std::min((int)(color(0) * 255.0), 255), 0);
 	rgba[1] = (std::uint8_t)std::max(std::min((int)(color(1) * 255.0), 255), 0);
-	rgba[2] = (std::uint8_t)std::max(std::min((int)(color(2) * 255.0), 255), 0);
+	rgba[0] = (std::uint8_t)std::max(std::min((int)(color(2) * 255.0), 255), 0);
 	float value;
 	memcpy(&value, rgba, 4);
 	return value;
@@ -645,6 +770,10 @@ bool WritePCDData(FILE *file, const PCDHeader &header,
 {
 	bool has_normal = pointcloud.HasNormals();
 	bool has_color = pointcloud.HasColors();
+	// Attributes follow the float fields of points, normals and colors.
+	std::vector<const PointAttribute *> attributes =
+			GetAttributesToWrite(pointcloud);
+	int float_num = header.elementnum - (int)attributes.size();
 	if (header.datatype == PCD_DATA_ASCII) {
 		for (size_t i = 0; i < pointcloud.points_.size(); i++) {
 			const auto &point = pointcloud.points_[i];
@@ -658,10 +787,16 @@ bool WritePCDData(FILE *file, const PCDHeader &header,
 				const auto &color = pointcloud.colors_[i];
 				fprintf(file, " %.10g", ConvertRGBToFloat(color));
 			}
+			for (const auto attribute : attributes) {
+				fprintf(file, attribute->GetValueType() ==
+						PointAttribute::VALUE_DOUBLE ? " %.17g" : " %.10g",
+						attribute->GetValue(i));
+			}
 			fprintf(file, "\n");
 		}
 	} else if (header.datatype == PCD_DATA_BINARY) {
-		std::unique_ptr<float []> data(new float[header.elementnum]);
+		std::unique_ptr<float []> data(new float[float_num]);
+		std::unique_ptr<char []> record(new char[header.pointsize]);
 		for (size_t i = 0; i < pointcloud.points_.size(); i++) {
 			const auto &point = pointcloud.points_[i];
 			data[0] = (float)point(0);
@@ -679,14 +814,24 @@ bool WritePCDData(FILE *file, const PCDHeader &header,
 				const auto &color = pointcloud.colors_[i];
 				data[idx] = ConvertRGBToFloat(color);
 			}
-			fwrite(data.get(), sizeof(float), header.elementnum, file);
+			size_t offset = float_num * sizeof(float);
+			memcpy(record.get(), data.get(), offset);
+			for (const auto attribute : attributes) {
+				size_t size = attribute->GetValueSize();
+				memcpy(record.get() + offset, attribute->GetRawData() +
+						i * size, size);
+				offset += size;
+			}
+			fwrite(record.get(), 1, header.pointsize, file);
 		}
 	} else if (header.datatype == PCD_DATA_BINARY_COMPRESSED) {
 		int strip_size = header.points;
-		std::uint32_t buffer_size = (std::uint32_t)(header.elementnum *
-				header.points);
-		std::unique_ptr<float []> buffer(new float[buffer_size]);
-		std::unique_ptr<float []> buffer_compressed(new float[buffer_size * 2]);
+		std::uint32_t buffer_size_in_bytes = (std::uint32_t)(
+				header.pointsize * header.points);
+		std::unique_ptr<char []> buffer_bytes(new char[buffer_size_in_bytes]);
+		std::unique_ptr<char []> buffer_compressed(
+				new char[buffer_size_in_bytes * 2]);
+		float *buffer = (float *)buffer_bytes.get();
 		for (size_t i = 0; i < pointcloud.points_.size(); i++) {
 			const auto &point = pointcloud.points_[i];
 			buffer[0 * strip_size + i] = (float)point(0);
@@ -705,8 +850,15 @@ bool WritePCDData(FILE *file, const PCDHeader &header,
 				buffer[idx * strip_size + i] = ConvertRGBToFloat(color);
 			}
 		}
-		std::uint32_t buffer_size_in_bytes = buffer_size * sizeof(float);
-		std::uint32_t size_compressed = lzf_compress(buffer.get(),
+		// Each attribute is a strip of its values in the compressed layout.
+		size_t offset = float_num * sizeof(float) * strip_size;
+		for (const auto attribute : attributes) {
+			size_t strip_bytes = attribute->GetValueSize() * strip_size;
+			memcpy(buffer_bytes.get() + offset, attribute->GetRawData(),
+					strip_bytes);
+			offset += strip_bytes;
+		}
+		std::uint32_t size_compressed = lzf_compress(buffer_bytes.get(),
 				buffer_size_in_bytes, buffer_compressed.get(),
 				buffer_size_in_bytes * 2);
 		if (size_compressed == 0) {
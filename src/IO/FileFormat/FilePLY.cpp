@@ -27,6 +27,8 @@
 #include <IO/ClassIO/PointCloudIO.h>
 #include <IO/ClassIO/TriangleMeshIO.h>
 
+#include <algorithm>
+#include <cstring>
 #include <rply/rply.h>
 #include <Core/Utility/Console.h>
 
@@ -36,19 +38,32 @@ namespace {
 
 namespace ply_poincloud_reader {
 
+template<typename PointCloudType>
 struct PLYReaderState {
-	PointCloud *pointcloud_ptr;
+	PointCloudType *pointcloud_ptr;
 	long vertex_index;
 	long vertex_num;
 	long normal_index;
 	long normal_num;
 	long color_index;
 	long color_num;
+	std::vector<long> attribute_index;
 };
 
+void SetColor(Eigen::Vector3d &color, long index, double value)
+{
+	color(index) = value / 255.0;
+}
+
+void SetColor(Eigen::Matrix<uint8_t, 3, 1> &color, long index, double value)
+{
+	color(index) = (uint8_t)value;
+}
+
+template<typename PointCloudType>
 int ReadVertexCallback(p_ply_argument argument)
 {
-	PLYReaderState *state_ptr;
+	PLYReaderState<PointCloudType> *state_ptr;
 	long index;
 	ply_get_argument_user_data(argument,
 			reinterpret_cast<void **>(&state_ptr), &index);
@@ -65,9 +80,10 @@ int ReadVertexCallback(p_ply_argument argument)
 	return 1;
 }
 
+template<typename PointCloudType>
 int ReadNormalCallback(p_ply_argument argument)
 {
-	PLYReaderState *state_ptr;
+	PLYReaderState<PointCloudType> *state_ptr;
 	long index;
 	ply_get_argument_user_data(argument,
 			reinterpret_cast<void **>(&state_ptr), &index);
@@ -83,9 +99,10 @@ int ReadNormalCallback(p_ply_argument argument)
 	return 1;
 }
 
+template<typename PointCloudType>
 int ReadColorCallback(p_ply_argument argument)
 {
-	PLYReaderState *state_ptr;
+	PLYReaderState<PointCloudType> *state_ptr;
 	long index;
 	ply_get_argument_user_data(argument,
 			reinterpret_cast<void **>(&state_ptr), &index);
@@ -94,119 +111,124 @@ int ReadColorCallback(p_ply_argument argument)
 	}
 
 	double value = ply_get_argument_value(argument);
-	state_ptr->pointcloud_ptr->colors_[state_ptr->color_index](index) =
-			value / 255.0;
+	SetColor(state_ptr->pointcloud_ptr->colors_[state_ptr->color_index],
+			index, value);
 	if (index == 2) {	// reading 'z'
 		state_ptr->color_index++;
 	}
 	return 1;
 }
 
-}	// namespace ply_poincloud_reader
-
-namespace ply_trianglemesh_reader {
-
-struct PLYReaderState {
-	TriangleMesh *mesh_ptr;
-	long vertex_index;
-	long vertex_num;
-	long normal_index;
-	long normal_num;
-	long color_index;
-	long color_num;
-	long triangle_index;
-	long triangle_num;
-};
-
-int ReadVertexCallback(p_ply_argument argument)
+template<typename PointCloudType>
+int ReadAttributeCallback(p_ply_argument argument)
 {
-	PLYReaderState *state_ptr;
+	PLYReaderState<PointCloudType> *state_ptr;
 	long index;
 	ply_get_argument_user_data(argument,
 			reinterpret_cast<void **>(&state_ptr), &index);
-	if (state_ptr->vertex_index >= state_ptr->vertex_num) {
+	long &attribute_index = state_ptr->attribute_index[index];
+	if (attribute_index >= state_ptr->vertex_num) {
 		return 0;
 	}
 
 	double value = ply_get_argument_value(argument);
-	state_ptr->mesh_ptr->vertices_[state_ptr->vertex_index](index) = value;
-	if (index == 2) {	// reading 'z'
-		state_ptr->vertex_index++;
-		AdvanceConsoleProgress();
-	}
+	state_ptr->pointcloud_ptr->attributes_[index].SetValue(attribute_index,
+			value);
+	attribute_index++;
 	return 1;
 }
 
-int ReadNormalCallback(p_ply_argument argument)
+bool GetAttributeValueType(e_ply_type ply_type,
+		PointAttribute::ValueType &value_type)
 {
-	PLYReaderState *state_ptr;
-	long index;
-	ply_get_argument_user_data(argument,
-			reinterpret_cast<void **>(&state_ptr), &index);
-	if (state_ptr->normal_index >= state_ptr->normal_num) {
-		return 0;
-	}
-
-	double value = ply_get_argument_value(argument);
-	state_ptr->mesh_ptr->vertex_normals_[state_ptr->normal_index](index) =
-			value;
-	if (index == 2) {	// reading 'z'
-		state_ptr->normal_index++;
+	switch (ply_type) {
+	case PLY_INT8:
+	case PLY_CHAR:
+		value_type = PointAttribute::VALUE_INT8;
+		return true;
+	case PLY_UINT8:
+	case PLY_UCHAR:
+		value_type = PointAttribute::VALUE_UINT8;
+		return true;
+	case PLY_INT16:
+	case PLY_SHORT:
+		value_type = PointAttribute::VALUE_INT16;
+		return true;
+	case PLY_UINT16:
+	case PLY_USHORT:
+		value_type = PointAttribute::VALUE_UINT16;
+		return true;
+	case PLY_INT32:
+	case PLY_INT:
+		value_type = PointAttribute::VALUE_INT32;
+		return true;
+	case PLY_UIN32:
+	case PLY_UINT:
+		value_type = PointAttribute::VALUE_UINT32;
+		return true;
+	case PLY_FLOAT32:
+	case PLY_FLOAT:
+		value_type = PointAttribute::VALUE_FLOAT;
+		return true;
+	case PLY_FLOAT64:
+	case PLY_DOUBLE:
+		value_type = PointAttribute::VALUE_DOUBLE;
+		return true;
+	default:
+		return false;
 	}
-	return 1;
 }
 
-int ReadColorCallback(p_ply_argument argument)
+/// Scalar vertex properties other than points, normals and colors are read
+/// as attributes of a PointCloud, which has been resized to the vertex number.
+void SetAttributeReadCallbacks(p_ply ply_file,
+		PLYReaderState<PointCloud> &state)
 {
-	PLYReaderState *state_ptr;
-	long index;
-	ply_get_argument_user_data(argument,
-			reinterpret_cast<void **>(&state_ptr), &index);
-	if (state_ptr->color_index >= state_ptr->color_num) {
-		return 0;
-	}
-
-	double value = ply_get_argument_value(argument);
-	state_ptr->mesh_ptr->vertex_colors_[state_ptr->color_index](index) =
-			value / 255.0;
-	if (index == 2) {	// reading 'z'
-		state_ptr->color_index++;
+	auto &attributes = state.pointcloud_ptr->attributes_;
+	static const char *known_properties[] = {"x", "y", "z", "nx", "ny", "nz",
+			"red", "green", "blue"};
+	p_ply_element element = NULL;
+	while ((element = ply_get_next_element(ply_file, element)) != NULL) {
+		const char *element_name;
+		ply_get_element_info(element, &element_name, NULL);
+		if (strcmp(element_name, "vertex") != 0) {
+			continue;
+		}
+		p_ply_property property = NULL;
+		while ((property = ply_get_next_property(element, property)) !=
+				NULL) {
+			const char *property_name;
+			e_ply_type type;
+			PointAttribute::ValueType value_type;
+			ply_get_property_info(property, &property_name, &type, NULL,
+					NULL);
+			if (std::find_if(std::begin(known_properties),
+					std::end(known_properties), [&](const char *name) {
+					return strcmp(name, property_name) == 0; }) !=
+					std::end(known_properties) ||
+					!GetAttributeValueType(type, value_type)) {
+				continue;
+			}
+			ply_set_read_cb(ply_file, "vertex", property_name,
+					ReadAttributeCallback<PointCloud>, &state,
+					(long)attributes.size());
+			attributes.push_back(PointAttribute(property_name, value_type,
+					state.vertex_num));
+		}
 	}
-	return 1;
+	state.attribute_index.resize(attributes.size(), 0);
 }
 
-int ReadFaceCallBack(p_ply_argument argument)
+template<typename Scalar>
+void SetAttributeReadCallbacks(p_ply ply_file,
+		PLYReaderState<PointCloudT<Scalar>> &state)
 {
-	PLYReaderState *state_ptr;
-	long dummy, length, index;
-	ply_get_argument_user_data(argument,
-			reinterpret_cast<void **>(&state_ptr), &dummy);
-	double value = ply_get_argument_value(argument);
-	if (state_ptr->triangle_index >= state_ptr->triangle_num) {
-		return 0;
-	}
-
-	ply_get_argument_property(argument, NULL, &length, &index);
-	if((index >= 0) && (index <= 2)) {
-		state_ptr->mesh_ptr->triangles_[state_ptr->triangle_index](index) =
-				static_cast<int>(value);
-	}
-	if(index == 2) {	// reading 'triangles_[n](2)'
-		state_ptr->triangle_index++;
-		AdvanceConsoleProgress();
-	}
-	return 1;
 }
 
-
-}	// namespace ply_trianglemesh_reader
-
-}	// unnamed namespace
-
-bool ReadPointCloudFromPLY(const std::string &filename, PointCloud &pointcloud)
+template<typename PointCloudType>
+bool ReadPointCloudFromPLYFile(const std::string &filename,
+		PointCloudType &pointcloud)
 {
-	using namespace ply_poincloud_reader;
-
 	p_ply ply_file = ply_open(filename.c_str(), NULL, 0, NULL);
 	if (!ply_file) {
 		PrintWarning("Read PLY failed: unable to open file.\n");
@@ -217,22 +239,28 @@ bool ReadPointCloudFromPLY(const std::string &filename, PointCloud &pointcloud)
 		return false;
 	}
 
-	PLYReaderState state;
+	PLYReaderState<PointCloudType> state;
 	state.pointcloud_ptr = &pointcloud;
 	state.vertex_num = ply_set_read_cb(ply_file, "vertex", "x",
-			ReadVertexCallback, &state, 0);
-	ply_set_read_cb(ply_file, "vertex", "y",  ReadVertexCallback, &state, 1);
-	ply_set_read_cb(ply_file, "vertex", "z",  ReadVertexCallback, &state, 2);
+			ReadVertexCallback<PointCloudType>, &state, 0);
+	ply_set_read_cb(ply_file, "vertex", "y",
+			ReadVertexCallback<PointCloudType>, &state, 1);
+	ply_set_read_cb(ply_file, "vertex", "z",
+			ReadVertexCallback<PointCloudType>, &state, 2);
 
 	state.normal_num = ply_set_read_cb(ply_file, "vertex", "nx",
-			ReadNormalCallback, &state, 0);
-	ply_set_read_cb(ply_file, "vertex", "ny",  ReadNormalCallback, &state, 1);
-	ply_set_read_cb(ply_file, "vertex", "nz",  ReadNormalCallback, &state, 2);
+			ReadNormalCallback<PointCloudType>, &state, 0);
+	ply_set_read_cb(ply_file, "vertex", "ny",
+			ReadNormalCallback<PointCloudType>, &state, 1);
+	ply_set_read_cb(ply_file, "vertex", "nz",
+			ReadNormalCallback<PointCloudType>, &state, 2);
 
 	state.color_num = ply_set_read_cb(ply_file, "vertex", "red",
-			ReadColorCallback, &state, 0);
-	ply_set_read_cb(ply_file, "vertex", "green",  ReadColorCallback, &state, 1);
-	ply_set_read_cb(ply_file, "vertex", "blue",  ReadColorCallback, &state, 2);
+			ReadColorCallback<PointCloudType>, &state, 0);
+	ply_set_read_cb(ply_file, "vertex", "green",
+			ReadColorCallback<PointCloudType>, &state, 1);
+	ply_set_read_cb(ply_file, "vertex", "blue",
+			ReadColorCallback<PointCloudType>, &state, 2);
 
 	if (state.vertex_num <= 0) {
 		PrintWarning("Read PLY failed: number of vertex <= 0.\n");
@@ -247,6 +275,7 @@ bool ReadPointCloudFromPLY(const std::string &filename, PointCloud &pointcloud)
 	pointcloud.points_.resize(state.vertex_num);
 	pointcloud.normals_.resize(state.normal_num);
 	pointcloud.colors_.resize(state.color_num);
+	SetAttributeReadCallbacks(ply_file, state);
 
 	ResetConsoleProgress(state.vertex_num + 1, "Reading PLY: ");
 
@@ -260,9 +289,62 @@ bool ReadPointCloudFromPLY(const std::string &filename, PointCloud &pointcloud)
 	return true;
 }
 
-bool WritePointCloudToPLY(const std::string &filename,
-		const PointCloud &pointcloud, bool write_ascii/* = false*/,
-		bool compressed/* = false*/)
+}	// namespace ply_poincloud_reader
+
+namespace ply_poincloud_writer {
+
+double GetColorValue(const Eigen::Vector3d &color, int index)
+{
+	return std::min(255.0, std::max(0.0, color(index) * 255.0));
+}
+
+double GetColorValue(const Eigen::Matrix<uint8_t, 3, 1> &color, int index)
+{
+	return color(index);
+}
+
+void AddAttributeProperties(p_ply ply_file, const PointCloud &pointcloud)
+{
+	for (const auto &attribute : pointcloud.attributes_) {
+		if (pointcloud.HasAttribute(attribute.GetName())) {
+			// The PLY scalar types are declared in the order of the
+			// attribute value types.
+			e_ply_type type = (e_ply_type)(PLY_INT8 +
+					(int)attribute.GetValueType());
+			ply_add_property(ply_file, attribute.GetName().c_str(), type,
+					type, type);
+		}
+	}
+}
+
+template<typename Scalar>
+void AddAttributeProperties(p_ply ply_file,
+		const PointCloudT<Scalar> &pointcloud)
+{
+}
+
+void WriteAttributeValues(p_ply ply_file, const PointCloud &pointcloud,
+		size_t index)
+{
+	for (const auto &attribute : pointcloud.attributes_) {
+		if (pointcloud.HasAttribute(attribute.GetName())) {
+			ply_write(ply_file, attribute.GetValue(index));
+		}
+	}
+}
+
+template<typename Scalar>
+void WriteAttributeValues(p_ply ply_file,
+		const PointCloudT<Scalar> &pointcloud, size_t index)
+{
+}
+
+/// Points and normals are written with \param scalar_type, which matches the
+/// precision of the point cloud.
+template<typename PointCloudType>
+bool WritePointCloudToPLYFile(const std::string &filename,
+		const PointCloudType &pointcloud, e_ply_type scalar_type,
+		bool write_ascii)
 {
 	if (pointcloud.IsEmpty()) {
 		PrintWarning("Write PLY failed: point cloud has 0 points.\n");
@@ -278,19 +360,23 @@ bool WritePointCloudToPLY(const std::string &filename,
 	ply_add_comment(ply_file, "Created by Open3D");
 	ply_add_element(ply_file, "vertex",
 			static_cast<long>(pointcloud.points_.size()));
-	ply_add_property(ply_file, "x", PLY_DOUBLE, PLY_DOUBLE, PLY_DOUBLE);
-	ply_add_property(ply_file, "y", PLY_DOUBLE, PLY_DOUBLE, PLY_DOUBLE);
-	ply_add_property(ply_file, "z", PLY_DOUBLE, PLY_DOUBLE, PLY_DOUBLE);
+	ply_add_property(ply_file, "x", scalar_type, scalar_type, scalar_type);
+	ply_add_property(ply_file, "y", scalar_type, scalar_type, scalar_type);
+	ply_add_property(ply_file, "z", scalar_type, scalar_type, scalar_type);
 	if (pointcloud.HasNormals()) {
-		ply_add_property(ply_file, "nx", PLY_DOUBLE, PLY_DOUBLE, PLY_DOUBLE);
-		ply_add_property(ply_file, "ny", PLY_DOUBLE, PLY_DOUBLE, PLY_DOUBLE);
-		ply_add_property(ply_file, "nz", PLY_DOUBLE, PLY_DOUBLE, PLY_DOUBLE);
+		ply_add_property(ply_file, "nx", scalar_type, scalar_type,
+				scalar_type);
+		ply_add_property(ply_file, "ny", scalar_type, scalar_type,
+				scalar_type);
+		ply_add_property(ply_file, "nz", scalar_type, scalar_type,
+				scalar_type);
 	}
 	if (pointcloud.HasColors()) {
 		ply_add_property(ply_file, "red", PLY_UCHAR, PLY_UCHAR, PLY_UCHAR);
 		ply_add_property(ply_file, "green", PLY_UCHAR, PLY_UCHAR, PLY_UCHAR);
 		ply_add_property(ply_file, "blue", PLY_UCHAR, PLY_UCHAR, PLY_UCHAR);
 	}
+	AddAttributeProperties(ply_file, pointcloud);
 	if (!ply_write_header(ply_file)) {
 		PrintWarning("Write PLY failed: unable to write header.\n");
 		return false;
@@ -300,25 +386,23 @@ bool WritePointCloudToPLY(const std::string &filename,
 			"Writing PLY: ");
 
 	for (size_t i = 0; i < pointcloud.points_.size(); i++) {
-		const Eigen::Vector3d &point = pointcloud.points_[i];
+		const auto &point = pointcloud.points_[i];
 		ply_write(ply_file, point(0));
 		ply_write(ply_file, point(1));
 		ply_write(ply_file, point(2));
 		if (pointcloud.HasNormals()) {
-			const Eigen::Vector3d &normal = pointcloud.normals_[i];
+			const auto &normal = pointcloud.normals_[i];
 			ply_write(ply_file, normal(0));
 			ply_write(ply_file, normal(1));
 			ply_write(ply_file, normal(2));
 		}
 		if (pointcloud.HasColors()) {
-			const Eigen::Vector3d &color = pointcloud.colors_[i];
-			ply_write(ply_file, std::min(255.0, std::max(0.0,
-					color(0) * 255.0)));
-			ply_write(ply_file, std::min(255.0, std::max(0.0,
-					color(1) * 255.0)));
-			ply_write(ply_file, std::min(255.0, std::max(0.0,
-					color(2) * 255.0)));
+			const auto &color = pointcloud.colors_[i];
+			ply_write(ply_file, GetColorValue(color, 0));
+			ply_write(ply_file, GetColorValue(color, 1));
+			ply_write(ply_file, GetColorValue(color, 2));
 		}
+		WriteAttributeValues(ply_file, pointcloud, i);
 		AdvanceConsoleProgress();
 	}
 
@@ -326,6 +410,136 @@ bool WritePointCloudToPLY(const std::string &filename,
 	return true;
 }
 
+}	// namespace ply_poincloud_writer
+
+namespace ply_trianglemesh_reader {
+
+struct PLYReaderState {
+	TriangleMesh *mesh_ptr;
+	long vertex_index;
+	long vertex_num;
+	long normal_index;
+	long normal_num;
+	long color_index;
+	long color_num;
+	long triangle_index;
+	long triangle_num;
+};
+
+int ReadVertexCallback(p_ply_argument argument)
+{
+	PLYReaderState *state_ptr;
+	long index;
+	ply_get_argument_user_data(argument,
+			reinterpret_cast<void **>(&state_ptr), &index);
+	if (state_ptr->vertex_index >= state_ptr->vertex_num) {
+		return 0;
+	}
+
+	double value = ply_get_argument_value(argument);
+	state_ptr->mesh_ptr->vertices_[state_ptr->vertex_index](index) = value;
+	if (index == 2) {	// reading 'z'
+		state_ptr->vertex_index++;
+		AdvanceConsoleProgress();
+	}
+	return 1;
+}
+
+int ReadNormalCallback(p_ply_argument argument)
+{
+	PLYReaderState *state_ptr;
+	long index;
+	ply_get_argument_user_data(argument,
+			reinterpret_cast<void **>(&state_ptr), &index);
+	if (state_ptr->normal_index >= state_ptr->normal_num) {
+		return 0;
+	}
+
+	double value = ply_get_argument_value(argument);
+	state_ptr->mesh_ptr->vertex_normals_[state_ptr->normal_index](index) =
+			value;
+	if (index == 2) {	// reading 'z'
+		state_ptr->normal_index++;
+	}
+	return 1;
+}
+
+int ReadColorCallback(p_ply_argument argument)
+{
+	PLYReaderState *state_ptr;
+	long index;
+	ply_get_argument_user_data(argument,
+			reinterpret_cast<void **>(&state_ptr), &index);
+	if (state_ptr->color_index >= state_ptr->color_num) {
+		return 0;
+	}
+
+	double value = ply_get_argument_value(argument);
+	state_ptr->mesh_ptr->vertex_colors_[state_ptr->color_index](index) =
+			value / 255.0;
+	if (index == 2) {	// reading 'z'
+		state_ptr->color_index++;
+	}
+	return 1;
+}
+
+int ReadFaceCallBack(p_ply_argument argument)
+{
+	PLYReaderState *state_ptr;
+	long dummy, length, index;
+	ply_get_argument_user_data(argument,
+			reinterpret_cast<void **>(&state_ptr), &dummy);
+	double value = ply_get_argument_value(argument);
+	if (state_ptr->triangle_index >= state_ptr->triangle_num) {
+		return 0;
+	}
+
+	ply_get_argument_property(argument, NULL, &length, &index);
+	if((index >= 0) && (index <= 2)) {
+		state_ptr->mesh_ptr->triangles_[state_ptr->triangle_index](index) =
+				static_cast<int>(value);
+	}
+	if(index == 2) {	// reading 'triangles_[n](2)'
+		state_ptr->triangle_index++;
+		AdvanceConsoleProgress();
+	}
+	return 1;
+}
+
+
+}	// namespace ply_trianglemesh_reader
+
+}	// unnamed namespace
+
+bool ReadPointCloudFromPLY(const std::string &filename, PointCloud &pointcloud)
+{
+	return ply_poincloud_reader::ReadPointCloudFromPLYFile(filename,
+			pointcloud);
+}
+
+bool ReadPointCloudfFromPLY(const std::string &filename,
+		PointCloudf &pointcloud)
+{
+	return ply_poincloud_reader::ReadPointCloudFromPLYFile(filename,
+			pointcloud);
+}
+
+bool WritePointCloudToPLY(const std::string &filename,
+		const PointCloud &pointcloud, bool write_ascii/* = false*/,
+		bool compressed/* = false*/)
+{
+	return ply_poincloud_writer::WritePointCloudToPLYFile(filename,
+			pointcloud, PLY_DOUBLE, write_ascii);
+}
+
+bool WritePointCloudfToPLY(const std::string &filename,
+		const PointCloudf &pointcloud, bool write_ascii/* = false*/,
+		bool compressed/* = false*/)
+{
+	return ply_poincloud_writer::WritePointCloudToPLYFile(filename,
+			pointcloud, PLY_FLOAT, write_ascii);
+}
+
 bool ReadTriangleMeshFromPLY(const std::string &filename, TriangleMesh &mesh)
 {
 	using namespace ply_trianglemesh_reader;
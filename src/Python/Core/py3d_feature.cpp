@@ -48,6 +48,23 @@ void pybind_feature(py::module &m)
 					std::to_string(f.Num()) +
 					std::string("\nAccess its data via data member.");
 		});
+	py::class_<QuantizedFeature, std::shared_ptr<QuantizedFeature>>
+			quantized_feature(m, "QuantizedFeature");
+	py::detail::bind_default_constructor<QuantizedFeature>(quantized_feature);
+	py::detail::bind_copy_functions<QuantizedFeature>(quantized_feature);
+	quantized_feature
+		.def("resize", &QuantizedFeature::Resize, "dim"_a, "n"_a)
+		.def("dimension", &QuantizedFeature::Dimension)
+		.def("num", &QuantizedFeature::Num)
+		.def_readwrite("data", &QuantizedFeature::data_)
+		.def_readwrite("scale", &QuantizedFeature::scale_)
+		.def_readwrite("offset", &QuantizedFeature::offset_)
+		.def("__repr__", [](const QuantizedFeature &f) {
+			return std::string("QuantizedFeature class with dimension = ") +
+					std::to_string(f.Dimension()) + std::string(" and num = ") +
+					std::to_string(f.Num()) +
+					std::string("\nValues are offset + scale * data.");
+		});
 }
 
 void pybind_feature_methods(py::module &m)
@@ -61,7 +78,42 @@ void pybind_feature_methods(py::module &m)
 			const Feature &feature) {
 		return WriteFeature(filename, feature);
 	}, "Function to write Feature to file", "filename"_a, "feature"_a);
-	m.def("compute_fpfh_feature", &ComputeFPFHFeature,
-			"Function to compute FPFH feature for a point cloud",
+	m.def("read_quantized_feature", [](const std::string &filename) {
+		QuantizedFeature feature;
+		ReadFeature(filename, feature);
+		return feature;
+	}, "Function to read QuantizedFeature from file", "filename"_a);
+	m.def("write_quantized_feature", [](const std::string &filename,
+			const QuantizedFeature &feature) {
+		return WriteFeature(filename, feature);
+	}, "Function to write QuantizedFeature to file", "filename"_a,
+			"feature"_a);
+	m.def("quantize_feature", &QuantizeFeature,
+			"Function to quantize a Feature to 8 bits per value",
+			"feature"_a, "min_value"_a = 0.0, "max_value"_a = 0.0);
+	m.def("dequantize_feature", &DequantizeFeature,
+			"Function to convert a QuantizedFeature back to double values",
+			"feature"_a);
+	m.def("compute_fpfh_feature", [](const PointCloud &input,
+			const KDTreeSearchParam &search_param) {
+		return ComputeFPFHFeature(input, search_param);
+	}, "Function to compute FPFH feature for a point cloud",
+			"input"_a, "search_param"_a);
+	m.def("compute_fpfh_feature", [](const PointCloud &input,
+			const KDTreeSearchParam &search_param,
+			const std::vector<size_t> &indices) {
+		return ComputeFPFHFeature(input, search_param, indices);
+	}, "Function to compute FPFH feature for the given points of a point cloud",
+			"input"_a, "search_param"_a, "indices"_a);
+	m.def("compute_quantized_fpfh_feature", [](const PointCloud &input,
+			const KDTreeSearchParam &search_param) {
+		return ComputeQuantizedFPFHFeature(input, search_param);
+	}, "Function to compute FPFH feature for a point cloud with 8 bits per value",
 			"input"_a, "search_param"_a);
+	m.def("compute_quantized_fpfh_feature", [](const PointCloud &input,
+			const KDTreeSearchParam &search_param,
+			const std::vector<size_t> &indices) {
+		return ComputeQuantizedFPFHFeature(input, search_param, indices);
+	}, "Function to compute FPFH feature with 8 bits per value for the given points of a point cloud",
+			"input"_a, "search_param"_a, "indices"_a);
 }
@@ -45,6 +45,7 @@ void pybind_geometry(py::module &m)
 		.value("LineSet", Geometry::GEOMETRY_LINESET)
 		.value("TriangleMesh", Geometry::GEOMETRY_TRIANGLEMESH)
 		.value("Image", Geometry::GEOMETRY_IMAGE)
+		.value("PointCloudf", Geometry::GEOMETRY_POINTCLOUDF)
 		.export_values();
 
 	py::class_<Geometry3D, PyGeometry3D<Geometry3D>,
@@ -28,6 +28,7 @@
 #include "py3d_core_trampoline.h"
 
 #include <Core/Geometry/KDTreeFlann.h>
+#include <Core/Geometry/VoxelHashIndex.h>
 using namespace three;
 
 void pybind_kdtreeflann(py::module &m)
@@ -40,6 +41,8 @@ void pybind_kdtreeflann(py::module &m)
 		.value("KNNSearch", KDTreeSearchParam::SEARCH_KNN)
 		.value("RadiusSearch", KDTreeSearchParam::SEARCH_RADIUS)
 		.value("HybridSearch", KDTreeSearchParam::SEARCH_HYBRID)
+		.value("ApproximateKNNSearch",
+				KDTreeSearchParam::SEARCH_APPROXIMATE_KNN)
 		.export_values();
 
 	py::class_<KDTreeSearchParamKNN> kdtreesearchparam_knn(m,
@@ -74,15 +77,56 @@ void pybind_kdtreeflann(py::module &m)
 		.def_readwrite("radius", &KDTreeSearchParamHybrid::radius_)
 		.def_readwrite("max_nn", &KDTreeSearchParamHybrid::max_nn_);
 
+	py::class_<KDTreeSearchParamApproximateKNN>
+			kdtreesearchparam_approximate_knn(m,
+			"KDTreeSearchParamApproximateKNN", kdtreesearchparam);
+	kdtreesearchparam_approximate_knn
+		.def(py::init<int, int>(), "knn"_a = 1, "checks"_a = 128)
+		.def("__repr__", [](const KDTreeSearchParamApproximateKNN &param) {
+			return std::string("KDTreeSearchParamApproximateKNN with knn = ") +
+					std::to_string(param.knn_) + " and checks = " +
+					std::to_string(param.checks_);
+		})
+		.def_readwrite("knn", &KDTreeSearchParamApproximateKNN::knn_)
+		.def_readwrite("checks", &KDTreeSearchParamApproximateKNN::checks_);
+
 	py::class_<KDTreeFlann, std::shared_ptr<KDTreeFlann>> kdtreeflann(m,
 			"KDTreeFlann");
+	py::enum_<KDTreeFlann::Precision>(kdtreeflann, "Precision",
+			py::arithmetic())
+		.value("Double", KDTreeFlann::PRECISION_DOUBLE)
+		.value("Float", KDTreeFlann::PRECISION_FLOAT)
+		.export_values();
+	py::enum_<KDTreeFlann::IndexType>(kdtreeflann, "IndexType",
+			py::arithmetic())
+		.value("KDTreeSingle", KDTreeFlann::INDEX_KDTREE_SINGLE)
+		.value("KDTreeRandomized", KDTreeFlann::INDEX_KDTREE_RANDOMIZED)
+		.value("KMeansHierarchical", KDTreeFlann::INDEX_KMEANS_HIERARCHICAL)
+		.export_values();
 	kdtreeflann.def(py::init<>())
 		.def(py::init<const Eigen::MatrixXd &>(), "data"_a)
 		.def("set_matrix_data", &KDTreeFlann::SetMatrixData, "data"_a)
 		.def(py::init<const Geometry &>(), "geometry"_a)
-		.def("set_geometry", &KDTreeFlann::SetGeometry, "geometry"_a)
+		.def("set_geometry", [](KDTreeFlann &tree, const Geometry &geometry) {
+				return tree.SetGeometry(geometry);
+			}, "geometry"_a)
 		.def(py::init<const Feature &>(), "feature"_a)
 		.def("set_feature", &KDTreeFlann::SetFeature, "feature"_a)
+		.def("add_points", (bool (KDTreeFlann::*)(const Eigen::MatrixXd &))
+				&KDTreeFlann::AddPoints, "data"_a)
+		.def("add_points", (bool (KDTreeFlann::*)(const Geometry &))
+				&KDTreeFlann::AddPoints, "geometry"_a)
+		.def("remove_points", &KDTreeFlann::RemovePoints, "indices"_a)
+		.def("save", &KDTreeFlann::Save, "filename"_a)
+		.def("load", &KDTreeFlann::Load, "filename"_a)
+		.def_static("set_default_precision",
+				&KDTreeFlann::SetDefaultPrecision, "precision"_a)
+		.def_static("get_default_precision",
+				&KDTreeFlann::GetDefaultPrecision)
+		.def("set_precision", &KDTreeFlann::SetPrecision, "precision"_a)
+		.def("get_precision", &KDTreeFlann::GetPrecision)
+		.def("set_index_type", &KDTreeFlann::SetIndexType, "index_type"_a)
+		.def("get_index_type", &KDTreeFlann::GetIndexType)
 		// Although these C++ style functions are fast by orders of magnitudes
 		// when similar queries are performed for a large number of times and
 		// memory management is involved, we prefer not to expose them in
@@ -165,4 +209,46 @@ void pybind_kdtreeflann(py::module &m)
 					throw std::runtime_error("search_hybrid_vector_xd() error!");
 				return std::make_tuple(k, indices, distance2);
 			}, "query"_a, "radius"_a, "max_nn"_a);
+
+	py::class_<VoxelHashIndex, std::shared_ptr<VoxelHashIndex>>
+			voxelhashindex(m, "VoxelHashIndex");
+	voxelhashindex.def(py::init<>())
+		.def(py::init<const Geometry &, double>(), "geometry"_a,
+				"voxel_size"_a)
+		.def("set_geometry", &VoxelHashIndex::SetGeometry, "geometry"_a,
+				"voxel_size"_a)
+		.def("get_voxel_size", &VoxelHashIndex::GetVoxelSize)
+		.def("search_vector_3d", [](const VoxelHashIndex &index,
+				const Eigen::Vector3d &query, const KDTreeSearchParam &param) {
+				std::vector<int> indices; std::vector<double> distance2;
+				int k = index.Search(query, param, indices, distance2);
+				if (k < 0)
+					throw std::runtime_error("search_vector_3d() error!");
+				return std::make_tuple(k, indices, distance2);
+			}, "query"_a, "search_param"_a)
+		.def("search_knn_vector_3d", [](const VoxelHashIndex &index,
+				const Eigen::Vector3d &query, int knn) {
+				std::vector<int> indices; std::vector<double> distance2;
+				int k = index.SearchKNN(query, knn, indices, distance2);
+				if (k < 0)
+					throw std::runtime_error("search_knn_vector_3d() error!");
+				return std::make_tuple(k, indices, distance2);
+			}, "query"_a, "knn"_a)
+		.def("search_radius_vector_3d", [](const VoxelHashIndex &index,
+				const Eigen::Vector3d &query, double radius) {
+				std::vector<int> indices; std::vector<double> distance2;
+				int k = index.SearchRadius(query, radius, indices, distance2);
+				if (k < 0)
+					throw std::runtime_error("search_radius_vector_3d() error!");
+				return std::make_tuple(k, indices, distance2);
+			}, "query"_a, "radius"_a)
+		.def("search_hybrid_vector_3d", [](const VoxelHashIndex &index,
+				const Eigen::Vector3d &query, double radius, int max_nn) {
+				std::vector<int> indices; std::vector<double> distance2;
+				int k = index.SearchHybrid(query, radius, max_nn, indices,
+						distance2);
+				if (k < 0)
+					throw std::runtime_error("search_hybrid_vector_3d() error!");
+				return std::make_tuple(k, indices, distance2);
+			}, "query"_a, "radius"_a, "max_nn"_a);
 }
@@ -79,6 +79,15 @@ void pybind_pointcloud_methods(py::module &m)
 			"depth"_a, "intrinsic"_a,
 			"extrinsic"_a = Eigen::Matrix4d::Identity(),
 			"depth_scale"_a = 1000.0, "depth_trunc"_a = 1000.0, "stride"_a = 1);
+	m.def("create_point_cloud_with_normals_from_depth_image",
+			&CreatePointCloudWithNormalsFromDepthImage,
+			"Factory function to create a pointcloud with normals from a depth image and a camera.\n"
+			"The normals are estimated on the pixel grid from integral images and\n"
+			"oriented towards the camera.",
+			"depth"_a, "intrinsic"_a,
+			"extrinsic"_a = Eigen::Matrix4d::Identity(),
+			"depth_scale"_a = 1000.0, "depth_trunc"_a = 1000.0, "stride"_a = 1,
+			"normal_window_radius"_a = 3);
 	m.def("create_point_cloud_from_rgbd_image", &CreatePointCloudFromRGBDImage,
 			"Factory function to create a pointcloud from an RGB-D image and a camera.\n"
 			"Given depth value d at (u, v) image coordinate, the corresponding 3d point is:\n"
@@ -90,18 +99,52 @@ void pybind_pointcloud_methods(py::module &m)
 	m.def("select_down_sample", &SelectDownSample,
 			"Function to select points from input pointcloud into output pointcloud",
 			"input"_a, "indices"_a);
-	m.def("voxel_down_sample", &VoxelDownSample,
+	m.def("voxel_down_sample", [](const PointCloud &input,
+			double voxel_size) {
+		return VoxelDownSample(input, voxel_size);
+	},
 			"Function to downsample input pointcloud into output pointcloud with a voxel",
 			"input"_a, "voxel_size"_a);
+	m.def("voxel_down_sample_and_trace", [](const PointCloud &input,
+			double voxel_size) {
+		std::vector<size_t> voxel_offsets, indices, point_to_voxel;
+		auto output = VoxelDownSampleAndTrace(input, voxel_size,
+				voxel_offsets, indices, point_to_voxel);
+		return std::make_tuple(output, voxel_offsets, indices,
+				point_to_voxel);
+	}, "Function to downsample input pointcloud with a voxel and to return the input points merged into each output point as (output, voxel_offsets, indices, point_to_voxel)",
+			"input"_a, "voxel_size"_a);
 	m.def("uniform_down_sample", &UniformDownSample,
 			"Function to downsample input pointcloud into output pointcloud uniformly",
 			"input"_a, "every_k_points"_a);
-	m.def("crop_point_cloud", &CropPointCloud,
-			"Function to crop input pointcloud into output pointcloud",
+	m.def("farthest_point_down_sample", &FarthestPointDownSample,
+			"Function to downsample input pointcloud into output pointcloud by farthest point sampling",
+			"input"_a, "num_samples"_a);
+	m.def("poisson_disk_down_sample", &PoissonDiskDownSample,
+			"Function to downsample input pointcloud into output pointcloud whose points are at least radius apart",
+			"input"_a, "radius"_a);
+	m.def("crop_point_cloud", [](const PointCloud &input,
+			const Eigen::Vector3d &min_bound,
+			const Eigen::Vector3d &max_bound) {
+		return CropPointCloud(input, min_bound, max_bound);
+	}, "Function to crop input pointcloud into output pointcloud",
 			"input"_a, "min_bound"_a, "max_bound"_a);
-	m.def("estimate_normals", &EstimateNormals,
+	m.def("crop_point_cloud", [](const PointCloud &input,
+			const Eigen::Vector3d &center, const Eigen::Matrix3d &rotation,
+			const Eigen::Vector3d &extent) {
+		return CropPointCloud(input, center, rotation, extent);
+	}, "Function to crop input pointcloud with an oriented bounding box",
+			"input"_a, "center"_a, "rotation"_a, "extent"_a);
+	m.def("estimate_normals", [](PointCloud &cloud,
+			const KDTreeSearchParam &search_param) {
+		return EstimateNormals(cloud, search_param);
+	},
 			"Function to compute the normals of a point cloud",
 			"cloud"_a, "search_param"_a = KDTreeSearchParamKNN());
+	m.def("estimate_normals_organized", &EstimateNormalsOrganized,
+			"Function to compute the normals of an organized point cloud from integral images",
+			"cloud"_a, "width"_a, "height"_a, "pixel_indices"_a,
+			"window_radius"_a = 3, "depth_change_factor"_a = 0.02);
 	m.def("orient_normals_to_align_with_direction",
 			&OrientNormalsToAlignWithDirection,
 			"Function to orient the normals of a point cloud",
@@ -111,6 +154,10 @@ void pybind_pointcloud_methods(py::module &m)
 			&OrientNormalsTowardsCameraLocation,
 			"Function to orient the normals of a point cloud",
 			"cloud"_a, "camera_location"_a = Eigen::Vector3d(0.0, 0.0, 0.0));
+	m.def("orient_normals_consistent_tangent_plane",
+			&OrientNormalsConsistentTangentPlane,
+			"Function to orient the normals of a point cloud consistently along a minimum spanning tree of its k nearest neighbor graph",
+			"cloud"_a, "k"_a = 10);
 	m.def("compute_point_cloud_to_point_cloud_distance",
 			&ComputePointCloudToPointCloudDistance,
 			"Function to compute the ponit to point distances between point clouds",
@@ -127,4 +174,15 @@ void pybind_pointcloud_methods(py::module &m)
 			&ComputePointCloudNearestNeighborDistance,
 			"Function to compute the distance from a point to its nearest neighbor in the point cloud",
 			"input"_a);
+	m.def("remove_statistical_outliers", &RemoveStatisticalOutliers,
+			"Function to return the indices of the points whose average distance to their neighbors is within std_ratio standard deviations of the mean",
+			"cloud"_a, "nb_neighbors"_a, "std_ratio"_a);
+	m.def("remove_radius_outliers", &RemoveRadiusOutliers,
+			"Function to return the indices of the points that have at least nb_points neighbors within radius",
+			"cloud"_a, "nb_points"_a, "radius"_a);
+	m.def("compute_iss_keypoints", &ComputeISSKeypoints,
+			"Function to return the indices of the Intrinsic Shape Signatures keypoints of a point cloud",
+			"input"_a, "salient_radius"_a = 0.0, "non_max_radius"_a = 0.0,
+			"gamma_21"_a = 0.975, "gamma_32"_a = 0.975,
+			"min_neighbors"_a = 5);
 }
@@ -69,6 +69,12 @@ public:
 
 void pybind_registration(py::module &m)
 {
+	py::enum_<CorrespondenceSearchMethod>(m, "CorrespondenceSearchMethod",
+			py::arithmetic())
+		.value("KDTree", CORRESPONDENCE_SEARCH_KDTREE)
+		.value("VoxelHash", CORRESPONDENCE_SEARCH_VOXELHASH)
+		.export_values();
+
 	py::class_<ICPConvergenceCriteria> convergence_criteria(m,
 			"ICPConvergenceCriteria");
 	py::detail::bind_copy_functions<ICPConvergenceCriteria>(
@@ -240,13 +246,15 @@ void pybind_registration_methods(py::module &m)
 	m.def("evaluate_registration", &EvaluateRegistration,
 			"Function for evaluating registration between point clouds",
 			"source"_a, "target"_a, "max_correspondence_distance"_a,
-			"transformation"_a = Eigen::Matrix4d::Identity());
+			"transformation"_a = Eigen::Matrix4d::Identity(),
+			"search_method"_a = CORRESPONDENCE_SEARCH_KDTREE);
 	m.def("registration_icp", &RegistrationICP,
 			"Function for ICP registration",
 			"source"_a, "target"_a, "max_correspondence_distance"_a,
 			"init"_a = Eigen::Matrix4d::Identity(), "estimation_method"_a =
 			TransformationEstimationPointToPoint(false), "criteria"_a =
-			ICPConvergenceCriteria());
+			ICPConvergenceCriteria(), "search_method"_a =
+			CORRESPONDENCE_SEARCH_KDTREE);
 	m.def("registration_colored_icp", &RegistrationColoredICP,
 			"Function for Colored ICP registration",
 			"source"_a, "target"_a, "max_correspondence_distance"_a,
@@ -266,7 +274,26 @@ void pybind_registration_methods(py::module &m)
 			TransformationEstimationPointToPoint(false), "ransac_n"_a = 4,
 			"checkers"_a = std::vector<std::reference_wrapper<const
 			CorrespondenceChecker>>(), "criteria"_a =
-			RANSACConvergenceCriteria(100000, 100));
+			RANSACConvergenceCriteria(100000, 100),
+			"index_type"_a = KDTreeFlann::INDEX_KDTREE_SINGLE,
+			"checks"_a = -1);
+	m.def("compute_correspondences_from_features", [](
+			const Feature &source_feature, const Feature &target_feature,
+			bool mutual_filter, KDTreeFlann::IndexType index_type,
+			int checks) {
+		return ComputeCorrespondencesFromFeatures(source_feature,
+				target_feature, mutual_filter, index_type, checks);
+	}, "Function for computing correspondences by nearest neighbor search in feature space",
+			"source_feature"_a, "target_feature"_a, "mutual_filter"_a = true,
+			"index_type"_a = KDTreeFlann::INDEX_KDTREE_SINGLE,
+			"checks"_a = -1);
+	m.def("compute_correspondences_from_features", [](
+			const QuantizedFeature &source_feature,
+			const QuantizedFeature &target_feature, bool mutual_filter) {
+		return ComputeCorrespondencesFromFeatures(source_feature,
+				target_feature, mutual_filter);
+	}, "Function for computing correspondences by exact kd-tree nearest neighbor search on quantized features",
+			"source_feature"_a, "target_feature"_a, "mutual_filter"_a = true);
 	m.def("get_information_matrix_from_point_clouds",
 			&GetInformationMatrixFromPointClouds,
 			"Function for computing information matrix from RegistrationResult",
@@ -0,0 +1,305 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <Core/Core.h>
+
+namespace {
+
+void AppendRandomPoints(three::PointCloud &cloud, size_t num_points,
+		std::mt19937 &rng)
+{
+	std::uniform_real_distribution<double> coordinate(0.0, 1.0);
+	for (size_t i = 0; i < num_points; i++) {
+		cloud.points_.push_back(Eigen::Vector3d(coordinate(rng),
+				coordinate(rng), coordinate(rng)));
+	}
+}
+
+bool HasSameNeighbors(const three::KDTreeFlann &kdtree,
+		const three::KDTreeFlann &reference, const three::PointCloud &cloud)
+{
+	std::vector<int> indices, reference_indices;
+	std::vector<double> distance2, reference_distance2;
+	for (size_t i = 0; i < cloud.points_.size(); i += 7) {
+		kdtree.SearchKNN(cloud.points_[i], 8, indices, distance2);
+		reference.SearchKNN(cloud.points_[i], 8, reference_indices,
+				reference_distance2);
+		if (distance2 != reference_distance2) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/// Function to compare the KNN, radius and hybrid searches of \param kdtree
+/// with a linear scan over \param cloud. Neighbors at the same distance may
+/// come in any order, so only the sorted distances are compared.
+bool HasExactNeighbors(const three::KDTreeFlann &kdtree,
+		const three::PointCloud &cloud, const Eigen::Vector3d &query,
+		double tolerance)
+{
+	std::vector<double> all_distance2;
+	for (const auto &point : cloud.points_) {
+		all_distance2.push_back((point - query).squaredNorm());
+	}
+	std::sort(all_distance2.begin(), all_distance2.end());
+	const double radius = 0.1;
+
+	std::vector<int> indices;
+	std::vector<double> distance2;
+	auto IsExpected = [&](size_t count) {
+		if (indices.size() != count || distance2.size() != count) {
+			return false;
+		}
+		std::vector<double> sorted_distance2(distance2);
+		std::sort(sorted_distance2.begin(), sorted_distance2.end());
+		for (size_t i = 0; i < count; i++) {
+			if (indices[i] < 0 || (size_t)indices[i] >= cloud.points_.size() ||
+					std::abs(sorted_distance2[i] - all_distance2[i]) >
+					tolerance || std::abs(distance2[i] -
+					(cloud.points_[indices[i]] - query).squaredNorm()) >
+					tolerance) {
+				return false;
+			}
+		}
+		return true;
+	};
+	// A radius search may return the points within the tolerance of the
+	// radius either way.
+	auto IsExpectedRadius = [&](size_t max_nn) {
+		size_t low = std::lower_bound(all_distance2.begin(),
+				all_distance2.end(), radius * radius - tolerance) -
+				all_distance2.begin();
+		size_t high = std::upper_bound(all_distance2.begin(),
+				all_distance2.end(), radius * radius + tolerance) -
+				all_distance2.begin();
+		size_t count = indices.size();
+		return count >= std::min(low, max_nn) &&
+				count <= std::min(high, max_nn) && IsExpected(count);
+	};
+	kdtree.SearchKNN(query, 10, indices, distance2);
+	if (IsExpected(std::min<size_t>(10, cloud.points_.size())) == false) {
+		return false;
+	}
+	kdtree.SearchRadius(query, radius, indices, distance2);
+	if (IsExpectedRadius(cloud.points_.size()) == false) {
+		return false;
+	}
+	kdtree.SearchHybrid(query, radius, 5, indices, distance2);
+	return IsExpectedRadius(5);
+}
+
+std::vector<char> ReadFileBytes(const std::string &filename)
+{
+	std::vector<char> bytes;
+	FILE *file = fopen(filename.c_str(), "rb");
+	if (file != NULL) {
+		char buffer[4096];
+		size_t size;
+		while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+			bytes.insert(bytes.end(), buffer, buffer + size);
+		}
+		fclose(file);
+	}
+	return bytes;
+}
+
+void WriteFileBytes(const std::string &filename,
+		const std::vector<char> &bytes)
+{
+	FILE *file = fopen(filename.c_str(), "wb");
+	if (file != NULL) {
+		fwrite(bytes.data(), 1, bytes.size(), file);
+		fclose(file);
+	}
+}
+
+}	// unnamed namespace
+
+int main()
+{
+	using namespace three;
+
+	SetVerbosityLevel(VERBOSE_ALWAYS);
+	std::mt19937 rng(0);
+	bool success = true;
+
+	// The native tree and the exhaustive search for small sets agree with a
+	// linear scan, in both precisions, on random points and on a grid with
+	// many points at the same distance.
+	PointCloud grid;
+	for (int x = 0; x < 20; x++) {
+		for (int y = 0; y < 20; y++) {
+			for (int z = 0; z < 5; z++) {
+				grid.points_.push_back(Eigen::Vector3d(x, y, z) * 0.05);
+			}
+		}
+	}
+	for (size_t num_points : {40, 3000}) {
+		PointCloud random;
+		AppendRandomPoints(random, num_points, rng);
+		for (const PointCloud *points : {&random, &grid}) {
+			for (int precision = 0; precision < 2; precision++) {
+				KDTreeFlann exact_kdtree;
+				exact_kdtree.SetPrecision(precision == 0 ?
+						KDTreeFlann::PRECISION_DOUBLE :
+						KDTreeFlann::PRECISION_FLOAT);
+				exact_kdtree.SetGeometry(*points);
+				double tolerance = precision == 0 ? 1e-12 : 1e-6;
+				for (int i = 0; i < 200; i++) {
+					Eigen::Vector3d query = i % 2 == 0 ?
+							points->points_[i * 7 % points->points_.size()] :
+							Eigen::Vector3d(rng() % 1000, rng() % 1000,
+							rng() % 1000) / 1000.0;
+					if (HasExactNeighbors(exact_kdtree, *points, query,
+							tolerance) == false) {
+						PrintError("Search differs from a linear scan (%d points, precision %d).\n",
+								(int)points->points_.size(), precision);
+						success = false;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	// An index referring to the points of a growing point cloud. Each append
+	// exceeds the capacity of the point vector, so the buffer the index was
+	// built on is freed before AddPoints() is called.
+	PointCloud cloud;
+	AppendRandomPoints(cloud, 5000, rng);
+	cloud.points_.shrink_to_fit();
+	KDTreeFlann kdtree;
+	kdtree.SetGeometry(cloud, false);
+	for (int scan = 0; scan < 4; scan++) {
+		AppendRandomPoints(cloud, cloud.points_.capacity() + 1000, rng);
+		if (kdtree.AddPoints(cloud) == false) {
+			PrintError("AddPoints() failed after scan %d.\n", scan);
+			success = false;
+			break;
+		}
+		// The fingerprint of the appended blocks matches a full rehash.
+		if (kdtree.IsUpToDate(cloud) == false) {
+			PrintError("Index is not up to date after scan %d.\n", scan);
+			success = false;
+		}
+		KDTreeFlann reference(cloud);
+		if (HasSameNeighbors(kdtree, reference, cloud) == false) {
+			PrintError("Wrong neighbors after scan %d.\n", scan);
+			success = false;
+		}
+	}
+	cloud.points_[100](0) += 1.0;
+	if (kdtree.IsUpToDate(cloud)) {
+		PrintError("IsUpToDate() missed a modified point.\n");
+		success = false;
+	}
+
+	// Indexed points that have been modified are rejected.
+	PointCloud modified;
+	AppendRandomPoints(modified, 5000, rng);
+	KDTreeFlann modified_kdtree;
+	modified_kdtree.SetGeometry(modified, false);
+	modified.points_[10] = Eigen::Vector3d(2.0, 2.0, 2.0);
+	AppendRandomPoints(modified, 1000, rng);
+	if (modified_kdtree.AddPoints(modified)) {
+		PrintError("AddPoints() accepted modified points.\n");
+		success = false;
+	}
+
+	// A saved index loads with the same neighbors and removed points, for
+	// both precisions of the native tree.
+	const std::string filename = "TestKDTreeFlann.bin";
+	PointCloud saved;
+	AppendRandomPoints(saved, 2000, rng);
+	for (int precision = 0; precision < 2; precision++) {
+		KDTreeFlann saved_kdtree;
+		saved_kdtree.SetPrecision(precision == 0 ?
+				KDTreeFlann::PRECISION_DOUBLE : KDTreeFlann::PRECISION_FLOAT);
+		saved_kdtree.SetGeometry(saved);
+		saved_kdtree.RemovePoints({3, 500, 1999});
+		KDTreeFlann loaded_kdtree;
+		if (saved_kdtree.Save(filename) == false ||
+				loaded_kdtree.Load(filename) == false) {
+			PrintError("Save() or Load() failed.\n");
+			success = false;
+		} else if (HasSameNeighbors(loaded_kdtree, saved_kdtree,
+				saved) == false) {
+			PrintError("Wrong neighbors after Load().\n");
+			success = false;
+		}
+	}
+
+	// A corrupt file either fails to load or is searched within bounds:
+	// every 32-bit word is overwritten in turn with out-of-range values.
+	// 50 points are searched exhaustively, 200 points by the native tree.
+	int num_loaded = 0, num_corrupt = 0;
+	SetVerbosityLevel(VERBOSE_ERROR);
+	for (size_t num_points : {50, 200}) {
+		PointCloud small;
+		AppendRandomPoints(small, num_points, rng);
+		KDTreeFlann(small).Save(filename);
+		std::vector<char> bytes = ReadFileBytes(filename);
+		for (size_t offset = 0; offset + 4 <= bytes.size(); offset += 4) {
+			for (int32_t value : {-1, 1 << 30}) {
+				std::vector<char> corrupt(bytes);
+				memcpy(corrupt.data() + offset, &value, sizeof(value));
+				WriteFileBytes(filename, corrupt);
+				num_corrupt++;
+				KDTreeFlann corrupt_kdtree;
+				if (corrupt_kdtree.Load(filename) == false) {
+					continue;
+				}
+				num_loaded++;
+				std::vector<int> indices;
+				std::vector<double> distance2;
+				for (size_t i = 0; i < num_points; i += 10) {
+					corrupt_kdtree.SearchKNN(small.points_[i], 8, indices,
+							distance2);
+					for (int index : indices) {
+						if (index < 0 || (size_t)index >= num_points) {
+							PrintError("Corrupt file returned index %d.\n",
+									index);
+							success = false;
+						}
+					}
+				}
+			}
+		}
+	}
+	SetVerbosityLevel(VERBOSE_ALWAYS);
+	PrintInfo("%d of %d corrupt files loaded.\n", num_loaded, num_corrupt);
+	remove(filename.c_str());
+
+	PrintInfo("TestKDTreeFlann %s.\n", success ? "passed" : "failed");
+	return success ? 0 : 1;
+}
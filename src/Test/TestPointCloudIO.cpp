@@ -0,0 +1,176 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <string>
+
+#include <Core/Core.h>
+#include <IO/IO.h>
+
+namespace {
+
+const char *attribute_names[] = {"label_int8", "ring_uint8", "row_int16",
+		"column_uint16", "id_int32", "time_uint32", "intensity_float",
+		"range_double"};
+
+template<typename T>
+double GetLimitValue(size_t index)
+{
+	return index % 2 == 0 ? (double)std::numeric_limits<T>::lowest() :
+			(double)std::numeric_limits<T>::max();
+}
+
+/// Values of attribute \param type at point \param index. The first two points
+/// hold the limits of the integer types; floating point values print exactly
+/// with the 6 digits of ASCII PLY files.
+double GetAttributeValue(three::PointAttribute::ValueType type, size_t index)
+{
+	using three::PointAttribute;
+	if (index < 2) {
+		switch (type) {
+		case PointAttribute::VALUE_INT8: return GetLimitValue<int8_t>(index);
+		case PointAttribute::VALUE_UINT8: return GetLimitValue<uint8_t>(index);
+		case PointAttribute::VALUE_INT16: return GetLimitValue<int16_t>(index);
+		case PointAttribute::VALUE_UINT16:
+			return GetLimitValue<uint16_t>(index);
+		case PointAttribute::VALUE_INT32: return GetLimitValue<int32_t>(index);
+		case PointAttribute::VALUE_UINT32:
+			return GetLimitValue<uint32_t>(index);
+		default: break;
+		}
+	}
+	if (type == PointAttribute::VALUE_FLOAT ||
+			type == PointAttribute::VALUE_DOUBLE) {
+		return (double)(index % 1000) * 0.125 - 50.0 + (int)type;
+	}
+	return (double)((index * 7 + (int)type) % 100);
+}
+
+bool IsSameAttribute(const three::PointCloud &cloud,
+		const three::PointCloud &loaded)
+{
+	using three::PointAttribute;
+	for (int type = 0; type <= PointAttribute::VALUE_DOUBLE; type++) {
+		const PointAttribute *attribute =
+				loaded.GetAttribute(attribute_names[type]);
+		if (loaded.HasAttribute(attribute_names[type]) == false ||
+				attribute->GetValueType() != type) {
+			three::PrintError("Attribute %s is missing or has another type.\n",
+					attribute_names[type]);
+			return false;
+		}
+		for (size_t i = 0; i < cloud.points_.size(); i++) {
+			if (attribute->GetValue(i) != GetAttributeValue(
+					(PointAttribute::ValueType)type, i)) {
+				three::PrintError("Attribute %s differs at point %d.\n",
+						attribute_names[type], (int)i);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool IsSamePointCloud(const three::PointCloud &cloud,
+		const three::PointCloud &loaded)
+{
+	if (loaded.points_.size() != cloud.points_.size() ||
+			loaded.HasNormals() == false || loaded.HasColors() == false) {
+		three::PrintError("Points, normals or colors are missing.\n");
+		return false;
+	}
+	for (size_t i = 0; i < cloud.points_.size(); i++) {
+		if ((loaded.points_[i] - cloud.points_[i]).norm() > 1e-4 ||
+				(loaded.normals_[i] - cloud.normals_[i]).norm() > 1e-4 ||
+				(loaded.colors_[i] - cloud.colors_[i]).norm() > 1e-2) {
+			three::PrintError("Point %d differs.\n", (int)i);
+			return false;
+		}
+	}
+	return IsSameAttribute(cloud, loaded);
+}
+
+}	// unnamed namespace
+
+int main()
+{
+	using namespace three;
+
+	SetVerbosityLevel(VERBOSE_ALWAYS);
+	bool success = true;
+
+	// Attributes of every value type follow the points, normals and colors,
+	// so that both the float fields and the attribute offsets are checked.
+	PointCloud cloud;
+	const size_t num_points = 1000;
+	for (size_t i = 0; i < num_points; i++) {
+		double t = (double)i / num_points;
+		cloud.points_.push_back(Eigen::Vector3d(t, std::sin(10.0 * t),
+				std::cos(10.0 * t)));
+		cloud.normals_.push_back(Eigen::Vector3d(0.0, std::cos(10.0 * t),
+				-std::sin(10.0 * t)));
+		cloud.colors_.push_back(Eigen::Vector3d(t, 1.0 - t,
+				(double)(i % 256) / 255.0));
+	}
+	for (int type = 0; type <= PointAttribute::VALUE_DOUBLE; type++) {
+		PointAttribute &attribute = cloud.AddAttribute(attribute_names[type],
+				(PointAttribute::ValueType)type);
+		for (size_t i = 0; i < num_points; i++) {
+			attribute.SetValue(i, GetAttributeValue(
+					(PointAttribute::ValueType)type, i));
+		}
+	}
+
+	struct {
+		const char *filename;
+		bool write_ascii;
+		bool compressed;
+	} modes[] = {
+		{"TestPointCloudIO_ascii.pcd", true, false},
+		{"TestPointCloudIO_binary.pcd", false, false},
+		{"TestPointCloudIO_binary_compressed.pcd", false, true},
+		{"TestPointCloudIO_ascii.ply", true, false},
+		{"TestPointCloudIO_binary.ply", false, false},
+	};
+	for (const auto &mode : modes) {
+		PointCloud loaded;
+		if (WritePointCloud(mode.filename, cloud, mode.write_ascii,
+				mode.compressed) == false ||
+				ReadPointCloud(mode.filename, loaded) == false) {
+			PrintError("Failed to write or read %s.\n", mode.filename);
+			success = false;
+		} else if (IsSamePointCloud(cloud, loaded) == false) {
+			PrintError("%s does not round trip.\n", mode.filename);
+			success = false;
+		}
+		remove(mode.filename);
+	}
+
+	PrintInfo("TestPointCloudIO %s.\n", success ? "passed" : "failed");
+	return success ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+// ----------------------------------------------------------------------------
+// -                        Open3D: www.open3d.org                            -
+// ----------------------------------------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2018 www.open3d.org
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// ----------------------------------------------------------------------------
+
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include <Core/Core.h>
+
+namespace {
+
+typedef std::tuple<int, int, int> VoxelIndex;
+
+/// Function to group the points of \param cloud by voxel with a map, as
+/// the reference for VoxelDownSample. The points of each voxel are in
+/// increasing order.
+std::map<VoxelIndex, std::vector<size_t>> GroupPointsByVoxel(
+		const three::PointCloud &cloud, double voxel_size,
+		const Eigen::Vector3d &voxel_origin)
+{
+	std::map<VoxelIndex, std::vector<size_t>> voxels;
+	for (size_t i = 0; i < cloud.points_.size(); i++) {
+		Eigen::Vector3d coord = (cloud.points_[i] - voxel_origin) / voxel_size;
+		voxels[VoxelIndex(int(floor(coord(0))), int(floor(coord(1))),
+				int(floor(coord(2))))].push_back(i);
+	}
+	return voxels;
+}
+
+bool IsSameVoxel(const three::PointCloud &cloud,
+		const three::PointCloud &output, size_t v,
+		const std::vector<size_t> &points)
+{
+	Eigen::Vector3d point = Eigen::Vector3d::Zero();
+	Eigen::Vector3d normal = Eigen::Vector3d::Zero();
+	Eigen::Vector3d color = Eigen::Vector3d::Zero();
+	double intensity = 0.0;
+	for (size_t i : points) {
+		point += cloud.points_[i];
+		normal += cloud.normals_[i];
+		color += cloud.colors_[i];
+		intensity += cloud.GetAttribute("intensity")->GetValue(i);
+	}
+	double n = (double)points.size();
+	const double tolerance = 1e-9;
+	return (output.points_[v] - point / n).norm() < tolerance &&
+			(output.normals_[v] - normal.normalized()).norm() < tolerance &&
+			(output.colors_[v] - color / n).norm() < tolerance &&
+			std::abs(output.GetAttribute("intensity")->GetValue(v) -
+			intensity / n) < 1e-4 &&
+			output.GetAttribute("label")->GetValue(v) ==
+			cloud.GetAttribute("label")->GetValue(points[0]);
+}
+
+/// Function to compare VoxelDownSampleAndTrace and VoxelDownSample on
+/// \param cloud with the reference grouping.
+bool IsSameAsReference(const three::PointCloud &cloud, double voxel_size,
+		const Eigen::Vector3d &voxel_origin)
+{
+	using namespace three;
+	auto voxels = GroupPointsByVoxel(cloud, voxel_size, voxel_origin);
+	std::vector<size_t> voxel_offsets, indices, point_to_voxel;
+	auto output = VoxelDownSampleAndTrace(cloud, voxel_size, voxel_origin,
+			voxel_offsets, indices, point_to_voxel);
+	auto untraced = VoxelDownSample(cloud, voxel_size, voxel_origin);
+	if (output->points_.size() != voxels.size() ||
+			untraced->points_ != output->points_ ||
+			voxel_offsets.size() != voxels.size() + 1 ||
+			indices.size() != cloud.points_.size() ||
+			point_to_voxel.size() != cloud.points_.size() ||
+			output->HasAttribute("label") == false ||
+			output->HasAttribute("intensity") == false) {
+		PrintError("Wrong number of voxels or trace sizes.\n");
+		return false;
+	}
+	size_t num_matched = 0;
+	for (size_t v = 0; v + 1 < voxel_offsets.size(); v++) {
+		std::vector<size_t> points(indices.begin() + voxel_offsets[v],
+				indices.begin() + voxel_offsets[v + 1]);
+		if (points.empty()) {
+			PrintError("Voxel %d is empty.\n", (int)v);
+			return false;
+		}
+		Eigen::Vector3d coord = (cloud.points_[points[0]] - voxel_origin) /
+				voxel_size;
+		auto voxel = voxels.find(VoxelIndex(int(floor(coord(0))),
+				int(floor(coord(1))), int(floor(coord(2)))));
+		if (voxel == voxels.end() || voxel->second != points) {
+			PrintError("Voxel %d has other points than the reference.\n",
+					(int)v);
+			return false;
+		}
+		for (size_t i : points) {
+			if (point_to_voxel[i] != v) {
+				PrintError("Point %d is not traced to voxel %d.\n", (int)i,
+						(int)v);
+				return false;
+			}
+		}
+		if (IsSameVoxel(cloud, *output, v, points) == false) {
+			PrintError("Voxel %d differs from the reference average.\n",
+					(int)v);
+			return false;
+		}
+		num_matched++;
+	}
+	return num_matched == voxels.size();
+}
+
+}	// unnamed namespace
+
+int main()
+{
+	using namespace three;
+
+	SetVerbosityLevel(VERBOSE_ALWAYS);
+	std::mt19937 rng(0);
+	bool success = true;
+
+	// Points around the origin, and points spread far enough that the voxel
+	// keys do not fit into 64 bits.
+	std::uniform_real_distribution<double> unit(-1.0, 1.0);
+	for (double extent : {1.0, 1e6}) {
+		PointCloud cloud;
+		for (size_t i = 0; i < 20000; i++) {
+			Eigen::Vector3d point(unit(rng), unit(rng), unit(rng));
+			if (extent > 1.0 && i % 2 == 0) {
+				point *= extent;
+			}
+			cloud.points_.push_back(point);
+			cloud.normals_.push_back(Eigen::Vector3d(unit(rng), unit(rng),
+					1.0).normalized());
+			cloud.colors_.push_back(Eigen::Vector3d(unit(rng), unit(rng),
+					unit(rng)).cwiseAbs());
+		}
+		// The label is constant within the voxels of both sizes on a grid
+		// starting at the origin, so the majority vote is not a tie.
+		cloud.AddAttribute("label", PointAttribute::VALUE_INT32);
+		cloud.AddAttribute("intensity", PointAttribute::VALUE_FLOAT);
+		for (size_t i = 0; i < cloud.points_.size(); i++) {
+			cloud.GetAttribute("label")->SetValue(i,
+					floor(cloud.points_[i](0) * 2.0));
+			cloud.GetAttribute("intensity")->SetValue(i, (double)(i % 100));
+		}
+		for (double voxel_size : {0.1, 0.5}) {
+			if (IsSameAsReference(cloud, voxel_size,
+					Eigen::Vector3d::Zero()) == false) {
+				PrintError("VoxelDownSample differs (extent %g, voxel size %g).\n",
+						extent, voxel_size);
+				success = false;
+			}
+		}
+		if (extent == 1.0) {
+			// The default grid starts half a voxel below the minimum bound.
+			auto output = VoxelDownSample(cloud, 0.2);
+			auto reference = VoxelDownSample(cloud, 0.2,
+					cloud.GetMinBound() - Eigen::Vector3d(0.1, 0.1, 0.1));
+			if (output->points_ != reference->points_) {
+				PrintError("VoxelDownSample differs with the default origin.\n");
+				success = false;
+			}
+		}
+	}
+
+	PrintInfo("TestVoxelDownSample %s.\n", success ? "passed" : "failed");
+	return success ? 0 : 1;
+}
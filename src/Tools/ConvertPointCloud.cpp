@@ -46,6 +46,13 @@ void PrintHelp()
 	printf("    --clip_z_min z0           : Clip points with z coordinate < z0.\n");
 	printf("    --clip_z_max z1           : Clip points with z coordinate > z1.\n");
 	printf("    --filter_mahalanobis d    : Filter out points with Mahalanobis distance > d.\n");
+	printf("    --remove_statistical_outliers [k,r]\n");
+	printf("                              : Filter out points whose average distance to their\n");
+	printf("                                k nearest neighbors is more than r standard\n");
+	printf("                                deviations above the mean.\n");
+	printf("    --remove_radius_outliers [n,radius]\n");
+	printf("                              : Filter out points with less than n neighbors\n");
+	printf("                                within radius.\n");
 	printf("    --uniform_sample_every K  : Downsample the point cloud uniformly. Keep only\n");
 	printf("                              : one point for every K points.\n");
 	printf("    --voxel_sample voxel_size : Downsample the point cloud with a voxel.\n");
@@ -110,6 +117,34 @@ void convert(int argc, char **argv, const std::string &file_in,
 		pointcloud_ptr = pcd;
 	}
 
+	// remove_statistical_outliers
+	Eigen::VectorXd statistical_outlier_param =
+			GetProgramOptionAsEigenVectorXd(argc, argv,
+			"--remove_statistical_outliers");
+	if (statistical_outlier_param.size() == 2) {
+		auto pcd = SelectDownSample(*pointcloud_ptr,
+				RemoveStatisticalOutliers(*pointcloud_ptr,
+				(int)statistical_outlier_param(0),
+				statistical_outlier_param(1)));
+		PrintDebug("Based on neighbor distance statistics, %d points were filtered.\n",
+				(int)(pointcloud_ptr->points_.size() - pcd->points_.size()));
+		pointcloud_ptr = pcd;
+		processed = true;
+	}
+
+	// remove_radius_outliers
+	Eigen::VectorXd radius_outlier_param = GetProgramOptionAsEigenVectorXd(
+			argc, argv, "--remove_radius_outliers");
+	if (radius_outlier_param.size() == 2) {
+		auto pcd = SelectDownSample(*pointcloud_ptr,
+				RemoveRadiusOutliers(*pointcloud_ptr,
+				(int)radius_outlier_param(0), radius_outlier_param(1)));
+		PrintDebug("Based on neighbor count, %d points were filtered.\n",
+				(int)(pointcloud_ptr->points_.size() - pcd->points_.size()));
+		pointcloud_ptr = pcd;
+		processed = true;
+	}
+
 	// uniform_downsample
 	int every_k = GetProgramOptionAsInt(argc, argv, "--uniform_sample_every",
 			0);
@@ -27,6 +27,7 @@
 #include "GeometryRenderer.h"
 
 #include <Core/Geometry/PointCloud.h>
+#include <Core/Geometry/PointCloudT.h>
 #include <Core/Geometry/LineSet.h>
 #include <Core/Geometry/TriangleMesh.h>
 #include <Core/Geometry/Image.h>
@@ -42,9 +43,13 @@ bool PointCloudRenderer::Render(const RenderOption &option,
 		const ViewControl &view)
 {
 	if (is_visible_ == false || geometry_ptr_->IsEmpty()) return true;
-	const auto &pointcloud = (const PointCloud &)(*geometry_ptr_);
+	const auto &pointcloud = *geometry_ptr_;
+	bool has_normals = pointcloud.GetGeometryType() ==
+			Geometry::GEOMETRY_POINTCLOUDF ?
+			((const PointCloudf &)pointcloud).HasNormals() :
+			((const PointCloud &)pointcloud).HasNormals();
 	bool success = true;
-	if (pointcloud.HasNormals()) {
+	if (has_normals) {
 		if (option.point_color_option_ == RenderOption::POINTCOLOR_NORMAL) {
 			success &= normal_point_shader_.Render(pointcloud, option, view);
 		} else {
@@ -63,7 +68,9 @@ bool PointCloudRenderer::Render(const RenderOption &option,
 bool PointCloudRenderer::AddGeometry(
 		std::shared_ptr<const Geometry> geometry_ptr)
 {
-	if (geometry_ptr->GetGeometryType() != Geometry::GEOMETRY_POINTCLOUD) {
+	if (geometry_ptr->GetGeometryType() != Geometry::GEOMETRY_POINTCLOUD &&
+			geometry_ptr->GetGeometryType() !=
+			Geometry::GEOMETRY_POINTCLOUDF) {
 		return false;
 	}
 	geometry_ptr_ = geometry_ptr;
@@ -27,6 +27,7 @@
 #include "NormalShader.h"
 
 #include <Core/Geometry/PointCloud.h>
+#include <Core/Geometry/PointCloudT.h>
 #include <Core/Geometry/TriangleMesh.h>
 #include <Visualization/Shader/Shader.h>
 
@@ -34,6 +35,34 @@ namespace three{
 
 namespace glsl {
 
+namespace {
+
+bool HasPointCloudNormals(const Geometry &geometry)
+{
+	if (geometry.GetGeometryType() == Geometry::GEOMETRY_POINTCLOUDF) {
+		return ((const PointCloudf &)geometry).HasNormals();
+	}
+	return ((const PointCloud &)geometry).HasNormals();
+}
+
+template<typename PointCloudType>
+void PreparePointCloudBinding(const PointCloudType &pointcloud,
+		const RenderOption &option, const ViewControl &view,
+		std::vector<Eigen::Vector3f> &points,
+		std::vector<Eigen::Vector3f> &normals)
+{
+	points.resize(pointcloud.points_.size());
+	normals.resize(pointcloud.points_.size());
+	for (size_t i = 0; i < pointcloud.points_.size(); i++) {
+		const auto &point = pointcloud.points_[i];
+		const auto &normal = pointcloud.normals_[i];
+		points[i] = point.template cast<float>();
+		normals[i] = normal.template cast<float>();
+	}
+}
+
+}	// unnamed namespace
+
 bool NormalShader::Compile()
 {
 	if (CompileShaders(NormalVertexShader, NULL, NormalFragmentShader) == false) {
@@ -122,7 +151,8 @@ void NormalShader::UnbindGeometry()
 bool NormalShaderForPointCloud::PrepareRendering(const Geometry &geometry,
 		const RenderOption &option,const ViewControl &view)
 {
-	if (geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUD) {
+	if (geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUD &&
+			geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUDF) {
 		PrintShaderWarning("Rendering type is not PointCloud.");
 		return false;
 	}
@@ -137,26 +167,25 @@ bool NormalShaderForPointCloud::PrepareBinding(const Geometry &geometry,
 		std::vector<Eigen::Vector3f> &points,
 		std::vector<Eigen::Vector3f> &normals)
 {
-	if (geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUD) {
+	if (geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUD &&
+			geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUDF) {
 		PrintShaderWarning("Rendering type is not PointCloud.");
 		return false;
 	}
-	const PointCloud &pointcloud = (const PointCloud &)geometry;
-	if (pointcloud.HasPoints() == false) {
+	if (geometry.IsEmpty()) {
 		PrintShaderWarning("Binding failed with empty pointcloud.");
 		return false;
 	}
-	if (pointcloud.HasNormals() == false) {
+	if (HasPointCloudNormals(geometry) == false) {
 		PrintShaderWarning("Binding failed with pointcloud with no normals.");
 		return false;
 	}
-	points.resize(pointcloud.points_.size());
-	normals.resize(pointcloud.points_.size());
-	for (size_t i = 0; i < pointcloud.points_.size(); i++) {
-		const auto &point = pointcloud.points_[i];
-		const auto &normal = pointcloud.normals_[i];
-		points[i] = point.cast<float>();
-		normals[i] = normal.cast<float>();
+	if (geometry.GetGeometryType() == Geometry::GEOMETRY_POINTCLOUD) {
+		PreparePointCloudBinding((const PointCloud &)geometry, option,
+				view, points, normals);
+	} else {
+		PreparePointCloudBinding((const PointCloudf &)geometry,
+				option, view, points, normals);
 	}
 	draw_arrays_mode_ = GL_POINTS;
 	draw_arrays_size_ = GLsizei(points.size());
@@ -27,6 +27,7 @@
 #include "PhongShader.h"
 
 #include <Core/Geometry/PointCloud.h>
+#include <Core/Geometry/PointCloudT.h>
 #include <Core/Geometry/TriangleMesh.h>
 #include <Visualization/Shader/Shader.h>
 #include <Visualization/Utility/ColorMap.h>
@@ -35,6 +36,73 @@ namespace three{
 
 namespace glsl {
 
+namespace {
+
+Eigen::Vector3d GetPointColor(const PointCloud &pointcloud, size_t i)
+{
+	return pointcloud.colors_[i];
+}
+
+Eigen::Vector3d GetPointColor(const PointCloudf &pointcloud, size_t i)
+{
+	return pointcloud.colors_[i].cast<double>() / 255.0;
+}
+
+bool HasPointCloudNormals(const Geometry &geometry)
+{
+	if (geometry.GetGeometryType() == Geometry::GEOMETRY_POINTCLOUDF) {
+		return ((const PointCloudf &)geometry).HasNormals();
+	}
+	return ((const PointCloud &)geometry).HasNormals();
+}
+
+template<typename PointCloudType>
+void PreparePointCloudBinding(const PointCloudType &pointcloud,
+		const RenderOption &option, const ViewControl &view,
+		std::vector<Eigen::Vector3f> &points,
+		std::vector<Eigen::Vector3f> &normals,
+		std::vector<Eigen::Vector3f> &colors)
+{
+	const ColorMap &global_color_map = *GetGlobalColorMap();
+	points.resize(pointcloud.points_.size());
+	normals.resize(pointcloud.points_.size());
+	colors.resize(pointcloud.points_.size());
+	for (size_t i = 0; i < pointcloud.points_.size(); i++) {
+		const auto &point = pointcloud.points_[i];
+		const auto &normal = pointcloud.normals_[i];
+		points[i] = point.template cast<float>();
+		normals[i] = normal.template cast<float>();
+		Eigen::Vector3d color;
+		switch (option.point_color_option_) {
+		case RenderOption::POINTCOLOR_X:
+			color = global_color_map.GetColor(
+					view.GetBoundingBox().GetXPercentage(point(0)));
+			break;
+		case RenderOption::POINTCOLOR_Y:
+			color = global_color_map.GetColor(
+					view.GetBoundingBox().GetYPercentage(point(1)));
+			break;
+		case RenderOption::POINTCOLOR_Z:
+			color = global_color_map.GetColor(
+					view.GetBoundingBox().GetZPercentage(point(2)));
+			break;
+		case RenderOption::POINTCOLOR_COLOR:
+		case RenderOption::POINTCOLOR_DEFAULT:
+		default:
+			if (pointcloud.HasColors()) {
+				color = GetPointColor(pointcloud, i);
+			} else {
+				color = global_color_map.GetColor(
+						view.GetBoundingBox().GetZPercentage(point(2)));
+			}
+			break;
+		}
+		colors[i] = color.cast<float>();
+	}
+}
+
+}	// unnamed namespace
+
 bool PhongShader::Compile()
 {
 	if (CompileShaders(PhongVertexShader, NULL, PhongFragmentShader) == false) {
@@ -185,7 +253,8 @@ void PhongShader::SetLighting(const ViewControl &view,
 bool PhongShaderForPointCloud::PrepareRendering(const Geometry &geometry,
 		const RenderOption &option,const ViewControl &view)
 {
-	if (geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUD) {
+	if (geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUD &&
+			geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUDF) {
 		PrintShaderWarning("Rendering type is not PointCloud.");
 		return false;
 	}
@@ -202,54 +271,25 @@ bool PhongShaderForPointCloud::PrepareBinding(const Geometry &geometry,
 		std::vector<Eigen::Vector3f> &normals,
 		std::vector<Eigen::Vector3f> &colors)
 {
-	if (geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUD) {
+	if (geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUD &&
+			geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUDF) {
 		PrintShaderWarning("Rendering type is not PointCloud.");
 		return false;
 	}
-	const PointCloud &pointcloud = (const PointCloud &)geometry;
-	if (pointcloud.HasPoints() == false) {
+	if (geometry.IsEmpty()) {
 		PrintShaderWarning("Binding failed with empty pointcloud.");
 		return false;
 	}
-	if (pointcloud.HasNormals() == false) {
+	if (HasPointCloudNormals(geometry) == false) {
 		PrintShaderWarning("Binding failed with pointcloud with no normals.");
 		return false;
 	}
-	const ColorMap &global_color_map = *GetGlobalColorMap();
-	points.resize(pointcloud.points_.size());
-	normals.resize(pointcloud.points_.size());
-	colors.resize(pointcloud.points_.size());
-	for (size_t i = 0; i < pointcloud.points_.size(); i++) {
-		const auto &point = pointcloud.points_[i];
-		const auto &normal = pointcloud.normals_[i];
-		points[i] = point.cast<float>();
-		normals[i] = normal.cast<float>();
-		Eigen::Vector3d color;
-		switch (option.point_color_option_) {
-		case RenderOption::POINTCOLOR_X:
-			color = global_color_map.GetColor(
-					view.GetBoundingBox().GetXPercentage(point(0)));
-			break;
-		case RenderOption::POINTCOLOR_Y:
-			color = global_color_map.GetColor(
-					view.GetBoundingBox().GetYPercentage(point(1)));
-			break;
-		case RenderOption::POINTCOLOR_Z:
-			color = global_color_map.GetColor(
-					view.GetBoundingBox().GetZPercentage(point(2)));
-			break;
-		case RenderOption::POINTCOLOR_COLOR:
-		case RenderOption::POINTCOLOR_DEFAULT:
-		default:
-			if (pointcloud.HasColors()) {
-				color = pointcloud.colors_[i];
-			} else {
-				color = global_color_map.GetColor(
-						view.GetBoundingBox().GetZPercentage(point(2)));
-			}
-			break;
-		}
-		colors[i] = color.cast<float>();
+	if (geometry.GetGeometryType() == Geometry::GEOMETRY_POINTCLOUD) {
+		PreparePointCloudBinding((const PointCloud &)geometry, option,
+				view, points, normals, colors);
+	} else {
+		PreparePointCloudBinding((const PointCloudf &)geometry,
+				option, view, points, normals, colors);
 	}
 	draw_arrays_mode_ = GL_POINTS;
 	draw_arrays_size_ = GLsizei(points.size());
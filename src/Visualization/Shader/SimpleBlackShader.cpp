@@ -27,6 +27,7 @@
 #include "SimpleBlackShader.h"
 
 #include <Core/Geometry/PointCloud.h>
+#include <Core/Geometry/PointCloudT.h>
 #include <Core/Geometry/TriangleMesh.h>
 #include <Visualization/Shader/Shader.h>
 #include <Visualization/Utility/ColorMap.h>
@@ -35,6 +36,28 @@ namespace three{
 
 namespace glsl {
 
+namespace {
+
+template<typename PointCloudType>
+void PreparePointCloudNormalBinding(const PointCloudType &pointcloud,
+		const RenderOption &option, const ViewControl &view,
+		std::vector<Eigen::Vector3f> &points)
+{
+	points.resize(pointcloud.points_.size() * 2);
+	double line_length = option.point_size_ *
+			0.01 * view.GetBoundingBox().GetSize();
+	for (size_t i = 0; i < pointcloud.points_.size(); i++) {
+		const auto &point = pointcloud.points_[i];
+		const auto &normal = pointcloud.normals_[i];
+		points[i * 2] = point.template cast<float>();
+		points[i * 2 + 1] = (point.template cast<double>() +
+				normal.template cast<double>() * line_length).
+				template cast<float>();
+	}
+}
+
+}	// unnamed namespace
+
 bool SimpleBlackShader::Compile()
 {
 	if (CompileShaders(SimpleBlackVertexShader, NULL,
@@ -110,7 +133,8 @@ bool SimpleBlackShaderForPointCloudNormal::PrepareRendering(
 		const Geometry &geometry, const RenderOption &option,
 		const ViewControl &view)
 {
-	if (geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUD) {
+	if (geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUD &&
+			geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUDF) {
 		PrintShaderWarning("Rendering type is not PointCloud.");
 		return false;
 	}
@@ -123,23 +147,21 @@ bool SimpleBlackShaderForPointCloudNormal::PrepareBinding(
 		const Geometry &geometry, const RenderOption &option,
 		const ViewControl &view, std::vector<Eigen::Vector3f> &points)
 {
-	if (geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUD) {
+	if (geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUD &&
+			geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUDF) {
 		PrintShaderWarning("Rendering type is not PointCloud.");
 		return false;
 	}
-	const PointCloud &pointcloud = (const PointCloud &)geometry;
-	if (pointcloud.HasPoints() == false) {
+	if (geometry.IsEmpty()) {
 		PrintShaderWarning("Binding failed with empty pointcloud.");
 		return false;
 	}
-	points.resize(pointcloud.points_.size() * 2);
-	double line_length = option.point_size_ *
-			0.01 * view.GetBoundingBox().GetSize();
-	for (size_t i = 0; i < pointcloud.points_.size(); i++) {
-		const auto &point = pointcloud.points_[i];
-		const auto &normal = pointcloud.normals_[i];
-		points[i * 2] = point.cast<float>();
-		points[i * 2 + 1] = (point + normal * line_length).cast<float>();
+	if (geometry.GetGeometryType() == Geometry::GEOMETRY_POINTCLOUD) {
+		PreparePointCloudNormalBinding((const PointCloud &)geometry,
+				option, view, points);
+	} else {
+		PreparePointCloudNormalBinding((const PointCloudf &)geometry,
+				option, view, points);
 	}
 	draw_arrays_mode_ = GL_LINES;
 	draw_arrays_size_ = GLsizei(points.size());
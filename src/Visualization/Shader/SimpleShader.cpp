@@ -27,6 +27,7 @@
 #include "SimpleShader.h"
 
 #include <Core/Geometry/PointCloud.h>
+#include <Core/Geometry/PointCloudT.h>
 #include <Core/Geometry/LineSet.h>
 #include <Core/Geometry/TriangleMesh.h>
 #include <Visualization/Shader/Shader.h>
@@ -36,6 +37,61 @@ namespace three{
 
 namespace glsl {
 
+namespace {
+
+Eigen::Vector3d GetPointColor(const PointCloud &pointcloud, size_t i)
+{
+	return pointcloud.colors_[i];
+}
+
+Eigen::Vector3d GetPointColor(const PointCloudf &pointcloud, size_t i)
+{
+	return pointcloud.colors_[i].cast<double>() / 255.0;
+}
+
+template<typename PointCloudType>
+void PreparePointCloudBinding(const PointCloudType &pointcloud,
+		const RenderOption &option, const ViewControl &view,
+		std::vector<Eigen::Vector3f> &points,
+		std::vector<Eigen::Vector3f> &colors)
+{
+	const ColorMap &global_color_map = *GetGlobalColorMap();
+	points.resize(pointcloud.points_.size());
+	colors.resize(pointcloud.points_.size());
+	for (size_t i = 0; i < pointcloud.points_.size(); i++) {
+		const auto &point = pointcloud.points_[i];
+		points[i] = point.template cast<float>();
+		Eigen::Vector3d color;
+		switch (option.point_color_option_) {
+		case RenderOption::POINTCOLOR_X:
+			color = global_color_map.GetColor(
+					view.GetBoundingBox().GetXPercentage(point(0)));
+			break;
+		case RenderOption::POINTCOLOR_Y:
+			color = global_color_map.GetColor(
+					view.GetBoundingBox().GetYPercentage(point(1)));
+			break;
+		case RenderOption::POINTCOLOR_Z:
+			color = global_color_map.GetColor(
+					view.GetBoundingBox().GetZPercentage(point(2)));
+			break;
+		case RenderOption::POINTCOLOR_COLOR:
+		case RenderOption::POINTCOLOR_DEFAULT:
+		default:
+			if (pointcloud.HasColors()) {
+				color = GetPointColor(pointcloud, i);
+			} else {
+				color = global_color_map.GetColor(
+						view.GetBoundingBox().GetZPercentage(point(2)));
+			}
+			break;
+		}
+		colors[i] = color.cast<float>();
+	}
+}
+
+}	// unnamed namespace
+
 bool SimpleShader::Compile()
 {
 	if (CompileShaders(SimpleVertexShader, NULL,
@@ -120,7 +176,8 @@ void SimpleShader::UnbindGeometry()
 bool SimpleShaderForPointCloud::PrepareRendering(const Geometry &geometry,
 		const RenderOption &option, const ViewControl &view)
 {
-	if (geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUD) {
+	if (geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUD &&
+			geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUDF) {
 		PrintShaderWarning("Rendering type is not PointCloud.");
 		return false;
 	}
@@ -135,47 +192,21 @@ bool SimpleShaderForPointCloud::PrepareBinding(const Geometry &geometry,
 		std::vector<Eigen::Vector3f> &points,
 		std::vector<Eigen::Vector3f> &colors)
 {
-	if (geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUD) {
+	if (geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUD &&
+			geometry.GetGeometryType() != Geometry::GEOMETRY_POINTCLOUDF) {
 		PrintShaderWarning("Rendering type is not PointCloud.");
 		return false;
 	}
-	const PointCloud &pointcloud = (const PointCloud &)geometry;
-	if (pointcloud.HasPoints() == false) {
+	if (geometry.IsEmpty()) {
 		PrintShaderWarning("Binding failed with empty pointcloud.");
 		return false;
 	}
-	const ColorMap &global_color_map = *GetGlobalColorMap();
-	points.resize(pointcloud.points_.size());
-	colors.resize(pointcloud.points_.size());
-	for (size_t i = 0; i < pointcloud.points_.size(); i++) {
-		const auto &point = pointcloud.points_[i];
-		points[i] = point.cast<float>();
-		Eigen::Vector3d color;
-		switch (option.point_color_option_) {
-		case RenderOption::POINTCOLOR_X:
-			color = global_color_map.GetColor(
-					view.GetBoundingBox().GetXPercentage(point(0)));
-			break;
-		case RenderOption::POINTCOLOR_Y:
-			color = global_color_map.GetColor(
-					view.GetBoundingBox().GetYPercentage(point(1)));
-			break;
-		case RenderOption::POINTCOLOR_Z:
-			color = global_color_map.GetColor(
-					view.GetBoundingBox().GetZPercentage(point(2)));
-			break;
-		case RenderOption::POINTCOLOR_COLOR:
-		case RenderOption::POINTCOLOR_DEFAULT:
-		default:
-			if (pointcloud.HasColors()) {
-				color = pointcloud.colors_[i];
-			} else {
-				color = global_color_map.GetColor(
-						view.GetBoundingBox().GetZPercentage(point(2)));
-			}
-			break;
-		}
-		colors[i] = color.cast<float>();
+	if (geometry.GetGeometryType() == Geometry::GEOMETRY_POINTCLOUD) {
+		PreparePointCloudBinding((const PointCloud &)geometry,
+				option, view, points, colors);
+	} else {
+		PreparePointCloudBinding((const PointCloudf &)geometry,
+				option, view, points, colors);
 	}
 	draw_arrays_mode_ = GL_POINTS;
 	draw_arrays_size_ = GLsizei(points.size());
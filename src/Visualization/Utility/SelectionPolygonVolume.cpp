@@ -28,6 +28,7 @@
 
 #include <json/json.h>
 #include <Core/Utility/Console.h>
+#include <Core/Utility/Helper.h>
 #include <Core/Geometry/PointCloud.h>
 
 namespace three{
@@ -100,7 +101,6 @@ std::shared_ptr<PointCloud> SelectionPolygonVolume::CropPointCloudInPolygon(
 std::vector<size_t> SelectionPolygonVolume::CropInPolygon(
 		const std::vector<Eigen::Vector3d> &input) const
 {
-	std::vector<size_t> output_index;
 	int u, v, w;
 	if (orthogonal_axis_ == "x" || orthogonal_axis_ == "X") {
 		u = 1; v = 2; w = 0;
@@ -109,32 +109,44 @@ std::vector<size_t> SelectionPolygonVolume::CropInPolygon(
 	} else {
 		u = 0; v = 1; w = 2;
 	}
-	std::vector<double> nodes;
-	ResetConsoleProgress((int64_t)input.size(), "Cropping geometry: ");
-	for (size_t k = 0; k < input.size(); k++) {
-		AdvanceConsoleProgress();
-		const auto &point = input[k];
-		if (point(w) < axis_min_ || point(w) > axis_max_) continue;
-		nodes.clear();
-		for (size_t i = 0; i < bounding_polygon_.size(); i++) {
-			size_t j = (i + 1) % bounding_polygon_.size();
-			if ((bounding_polygon_[i](v) < point(v) &&
-					bounding_polygon_[j](v) >= point(v)) ||
-					(bounding_polygon_[j](v) < point(v) &&
-					bounding_polygon_[i](v) >= point(v))) {
-				nodes.push_back(bounding_polygon_[i](u) +
-						(point(v) - bounding_polygon_[i](v)) /
-						(bounding_polygon_[j](v) - bounding_polygon_[i](v)) *
-						(bounding_polygon_[j](u) - bounding_polygon_[i](u)));
+	// Each point is tested independently, and the selected points are
+	// compacted with a prefix sum.
+	std::vector<uint8_t> is_inside(input.size());
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+	{
+		std::vector<double> nodes;
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+		for (int k = 0; k < (int)input.size(); k++) {
+			is_inside[k] = 0;
+			const auto &point = input[k];
+			if (point(w) < axis_min_ || point(w) > axis_max_) continue;
+			nodes.clear();
+			for (size_t i = 0; i < bounding_polygon_.size(); i++) {
+				size_t j = (i + 1) % bounding_polygon_.size();
+				if ((bounding_polygon_[i](v) < point(v) &&
+						bounding_polygon_[j](v) >= point(v)) ||
+						(bounding_polygon_[j](v) < point(v) &&
+						bounding_polygon_[i](v) >= point(v))) {
+					nodes.push_back(bounding_polygon_[i](u) +
+							(point(v) - bounding_polygon_[i](v)) /
+							(bounding_polygon_[j](v) -
+							bounding_polygon_[i](v)) *
+							(bounding_polygon_[j](u) -
+							bounding_polygon_[i](u)));
+				}
+			}
+			std::sort(nodes.begin(), nodes.end());
+			auto loc = std::lower_bound(nodes.begin(), nodes.end(), point(u));
+			if (std::distance(nodes.begin(), loc) % 2 == 1) {
+				is_inside[k] = 1;
 			}
-		}
-		std::sort(nodes.begin(), nodes.end());
-		auto loc = std::lower_bound(nodes.begin(), nodes.end(), point(u));
-		if (std::distance(nodes.begin(), loc) % 2 == 1) {
-			output_index.push_back(k);
 		}
 	}
-	return output_index;
+	return GetNonZeroIndices(is_inside);
 }
 
 }	// namespace three
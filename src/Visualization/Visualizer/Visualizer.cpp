@@ -312,7 +312,8 @@ bool Visualizer::AddGeometry(std::shared_ptr<const Geometry> geometry_ptr)
 			Geometry::GEOMETRY_UNSPECIFIED) {
 		return false;
 	} else if (geometry_ptr->GetGeometryType() ==
-			Geometry::GEOMETRY_POINTCLOUD) {
+			Geometry::GEOMETRY_POINTCLOUD || geometry_ptr->GetGeometryType() ==
+			Geometry::GEOMETRY_POINTCLOUDF) {
 		auto renderer_ptr = std::make_shared<glsl::PointCloudRenderer>();
 		if (renderer_ptr->AddGeometry(geometry_ptr) == false) {
 			return false;